@@ -0,0 +1,65 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! path of the query socket served by the cluster aggregator */
+#define AGGREGATOR_CONTROL_SOCKET "/tmp/procmon-aggregator.sock"
+
+/*! time (in milliseconds) a node is given to restart a process during a
+ *  rolling restart before the rollout is halted */
+#define AGGREGATOR_ROLLOUT_TIMEOUT ( 120000 )
+
+/*! maximum number of rollouts which are remembered */
+#define AGGREGATOR_MAX_ROLLOUTS ( 16 )
+
+/*! time (in milliseconds) an agent is given to authenticate after it
+ *  connects */
+#define AGGREGATOR_HELLO_TIMEOUT ( 10000 )
+
+/*! maximum number of processes held for a node, which matches the size
+ *  of the process monitor state table */
+#define AGGREGATOR_MAX_PROCESSES ( 1024 )
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int AGGREGATOR_Start( const char *address,
+                      const char *path,
+                      const char *secret );
+
+#endif
@@ -0,0 +1,71 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stddef.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! the ArenaBlock object is a block of memory which arena allocations
+ *  are carved from */
+typedef struct _arenaBlock ArenaBlock;
+
+/*! the Arena object allocates memory which is released all at once.
+ *  The arena is sized when it is created, and is only grown by adding
+ *  another block if the size was underestimated */
+typedef struct _arena
+{
+    /*! most recently added block of the arena, or NULL */
+    ArenaBlock *pBlocks;
+
+    /*! size (in bytes) of the blocks added when the arena is full */
+    size_t blockSize;
+
+    /*! total size (in bytes) of the blocks of the arena */
+    size_t size;
+
+    /*! number of bytes allocated from the arena */
+    size_t used;
+
+} Arena;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int ARENA_Init( Arena *pArena, size_t size );
+void *ARENA_Alloc( Arena *pArena, size_t size );
+char *ARENA_Strdup( Arena *pArena, const char *s );
+void ARENA_Move( Arena *pTo, Arena *pFrom );
+void ARENA_Free( Arena *pArena );
+
+#endif
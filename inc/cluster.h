@@ -0,0 +1,175 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "eventloop.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! maximum length of a cluster protocol line, including its newline */
+#define CLUSTER_MAX_LINE        ( 256 )
+
+/*! maximum length of a node name */
+#define CLUSTER_NODE_LEN        ( 64 )
+
+/*! maximum length of the cluster token, including its NUL terminator */
+#define CLUSTER_TOKEN_LEN       ( 128 )
+
+/*! length of a hex encoded challenge nonce, including its NUL terminator */
+#define CLUSTER_NONCE_LEN       ( 33 )
+
+/*! length of a hex encoded HMAC-SHA256 proof, including its NUL
+ *  terminator */
+#define CLUSTER_PROOF_LEN       ( 65 )
+
+/*! size of the buffer holding the messages waiting to be sent to the
+ *  aggregator.  An agent whose aggregator falls this far behind is
+ *  disconnected, and sends a new snapshot when it reconnects */
+#define CLUSTER_SEND_BUFFER     ( 64 * 1024 )
+
+/*! initial delay (in milliseconds) before reconnecting to the aggregator */
+#define CLUSTER_RECONNECT_MIN   ( 1000 )
+
+/*! maximum delay (in milliseconds) before reconnecting to the aggregator */
+#define CLUSTER_RECONNECT_MAX   ( 30000 )
+
+/*! cluster command handler invoked when the aggregator sends a command
+ *  for a process, which returns EOK or an errno value */
+typedef int (*ClusterCommandHandler)( const char *command,
+                                      const char *id,
+                                      void *arg );
+
+/*! cluster snapshot handler invoked when the agent has connected to the
+ *  aggregator, which sends the current state of every process */
+typedef void (*ClusterSnapshotHandler)( void *arg );
+
+/*! the ClusterAgent object holds the connection of a process monitor
+ *  to the cluster aggregator */
+typedef struct _clusterAgent
+{
+    /*! connection to the aggregator */
+    EventSource source;
+
+    /*! address of the aggregator */
+    struct sockaddr_storage addr;
+
+    /*! length of the aggregator address */
+    socklen_t addrlen;
+
+    /*! name of this node */
+    char node[CLUSTER_NODE_LEN];
+
+    /*! shared secret of the cluster */
+    char token[CLUSTER_TOKEN_LEN];
+
+    /*! challenge sent by the aggregator, or empty until it is received */
+    char challenge[CLUSTER_NONCE_LEN];
+
+    /*! challenge sent to the aggregator in the hello */
+    char nonce[CLUSTER_NONCE_LEN];
+
+    /*! indicates that a connection is being established */
+    bool connecting;
+
+    /*! indicates that the agent is connected to the aggregator */
+    bool connected;
+
+    /*! indicates that the agent and the aggregator have proved their
+     *  knowledge of the cluster token to each other */
+    bool authenticated;
+
+    /*! indicates that the connection is waiting to be writable */
+    bool blocked;
+
+    /*! messages waiting to be sent to the aggregator */
+    char *pOut;
+
+    /*! number of bytes waiting to be sent */
+    size_t outLen;
+
+    /*! partial command line received from the aggregator */
+    char in[CLUSTER_MAX_LINE];
+
+    /*! number of bytes of the partial command line */
+    size_t inLen;
+
+    /*! timer used to reconnect to the aggregator */
+    Timer reconnectTimer;
+
+    /*! delay (in milliseconds) before the next reconnection */
+    int64_t backoff;
+
+    /*! handler for commands sent by the aggregator */
+    ClusterCommandHandler handler;
+
+    /*! handler which sends a snapshot of the process states */
+    ClusterSnapshotHandler snapshot;
+
+    /*! opaque argument passed to the handlers */
+    void *arg;
+
+} ClusterAgent;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int CLUSTER_Connect( ClusterAgent *pAgent,
+                     const char *address,
+                     const char *node,
+                     const char *token,
+                     ClusterCommandHandler handler,
+                     ClusterSnapshotHandler snapshot,
+                     void *arg );
+int CLUSTER_Send( ClusterAgent *pAgent, const char *format, ... );
+void CLUSTER_Disconnect( ClusterAgent *pAgent );
+int CLUSTER_ReadToken( const char *path, char *token, size_t len );
+int CLUSTER_MakeNonce( char *nonce );
+void CLUSTER_MakeProof( const char *token,
+                        const char *role,
+                        const char *node,
+                        const char *challenge,
+                        const char *nonce,
+                        char *proof );
+bool CLUSTER_CheckProof( const char *token,
+                         const char *role,
+                         const char *node,
+                         const char *challenge,
+                         const char *nonce,
+                         const char *proof );
+
+#endif
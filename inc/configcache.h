@@ -0,0 +1,259 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef CONFIGCACHE_H
+#define CONFIGCACHE_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! configuration cache file identifier ( "PMCC" ) */
+#define CONFIGCACHE_MAGIC       ( 0x43434d50 )
+
+/*! configuration cache format version */
+#define CONFIGCACHE_VERSION     ( 9 )
+
+/*! offset of an absent string or data block */
+#define CONFIGCACHE_NONE        ( 0 )
+
+/*! the process is monitored */
+#define CONFIGCACHE_MONITORED               ( 1 << 0 )
+
+/*! the process has verbose output enabled */
+#define CONFIGCACHE_VERBOSE                 ( 1 << 1 )
+
+/*! the process is skipped */
+#define CONFIGCACHE_SKIP                    ( 1 << 2 )
+
+/*! the process notifies its readiness */
+#define CONFIGCACHE_NOTIFY                  ( 1 << 3 )
+
+/*! the process is restarted when its parent restarts */
+#define CONFIGCACHE_RESTART_ON_PARENT_DEATH ( 1 << 4 )
+
+/*! the process has a nice value */
+#define CONFIGCACHE_SET_NICE                ( 1 << 5 )
+
+/*! the process keeps a warm standby */
+#define CONFIGCACHE_STANDBY                 ( 1 << 6 )
+
+/*! the ConfigCacheProcess object is the compiled definition of a single
+ *  process.  Strings and arrays are stored as offsets from the start
+ *  of the cache */
+typedef struct _configCacheProcess
+{
+    /*! offset of the process identifier */
+    uint32_t id;
+
+    /*! offset of the command line */
+    uint32_t exec;
+
+    /*! offset of the argument vector ( argc string offsets ) */
+    uint32_t argv;
+
+    /*! number of arguments in the argument vector */
+    uint32_t argc;
+
+    /*! offset of the dependencies ( ndepends process indices ) */
+    uint32_t depends;
+
+    /*! number of dependencies */
+    uint32_t ndepends;
+
+    /*! offset of the cgroup */
+    uint32_t cgroup;
+
+    /*! offset of the cgroup cpu.max limit */
+    uint32_t cpu_max;
+
+    /*! offset of the cgroup memory.max limit */
+    uint32_t memory_max;
+
+    /*! offset of the CPU set ( a cpu_set_t ) */
+    uint32_t cpuset;
+
+    /*! CONFIGCACHE_* process flags */
+    uint32_t flags;
+
+    /*! startup wait ( or readiness timeout ) in seconds */
+    int32_t wait;
+
+    /*! restart delay in seconds */
+    int32_t restart_delay;
+
+    /*! maximum restart backoff delay in seconds */
+    int32_t restart_backoff_max;
+
+    /*! maximum number of restarts in the restart window */
+    int32_t restart_limit;
+
+    /*! restart budget window in seconds */
+    int32_t restart_window;
+
+    /*! nice value */
+    int32_t nice;
+
+    /*! I/O priority */
+    int32_t ioprio;
+
+    /*! signal used to ask the process to stop */
+    int32_t stop_signal;
+
+    /*! time in seconds the process is given to stop before it is killed */
+    int32_t stop_timeout;
+
+    /*! offset of the log file path */
+    uint32_t log_file;
+
+    /*! size of the output ring buffer in bytes */
+    int32_t log_buffer;
+
+    /*! size in bytes at which the log file is rotated */
+    int32_t log_file_size;
+
+    /*! offset of the listening socket addresses */
+    uint32_t listen;
+
+    /*! idle timeout in seconds of a socket activated process */
+    int32_t idle_timeout;
+
+    /*! offset of the health check specification */
+    uint32_t health_check;
+
+    /*! interval in seconds between health check probes */
+    int32_t health_interval;
+
+    /*! timeout in seconds of a health check probe */
+    int32_t health_timeout;
+
+    /*! number of failed health check probes before a restart */
+    int32_t health_failures;
+
+} ConfigCacheProcess;
+
+/*! the ConfigCacheHeader object is stored at the start of the cache */
+typedef struct _configCacheHeader
+{
+    /*! CONFIGCACHE_MAGIC */
+    uint32_t magic;
+
+    /*! CONFIGCACHE_VERSION */
+    uint32_t version;
+
+    /*! size of the cache in bytes */
+    uint64_t size;
+
+    /*! size of the source configuration file */
+    uint64_t sourceSize;
+
+    /*! modification time of the source configuration file
+     *  in nanoseconds */
+    int64_t sourceTime;
+
+    /*! FNV-1a hash of the source configuration file */
+    uint64_t sourceHash;
+
+    /*! size of a CPU set on the system which built the cache */
+    uint32_t cpusetSize;
+
+    /*! number of processes */
+    uint32_t count;
+
+    /*! offset of the process definitions */
+    uint32_t processes;
+
+    /*! interval between process metrics samples in seconds */
+    int32_t metricsInterval;
+
+    /*! TCP port of the OpenMetrics endpoint */
+    int32_t metricsPort;
+
+    /*! offset of the OpenMetrics endpoint address */
+    uint32_t metricsAddress;
+
+    /*! offset of the cluster aggregator address */
+    uint32_t aggregator;
+
+    /*! offset of the cluster node name */
+    uint32_t nodeName;
+
+    /*! offset of the path of the cluster token file */
+    uint32_t tokenFile;
+
+} ConfigCacheHeader;
+
+/*! the ConfigCache object is a configuration cache which is either
+ *  mapped from a cache file, or is being built in memory */
+typedef struct _configCache
+{
+    /*! pointer to the cache contents */
+    uint8_t *pData;
+
+    /*! number of bytes used by the cache */
+    size_t size;
+
+    /*! number of bytes allocated for a cache being built */
+    size_t length;
+
+    /*! indicates that the cache is mapped from a file */
+    bool mapped;
+
+} ConfigCache;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int CONFIGCACHE_Open( ConfigCache *pCache,
+                      const char *path,
+                      const char *source );
+int CONFIGCACHE_Create( ConfigCache *pCache, size_t count );
+int CONFIGCACHE_AddData( ConfigCache *pCache,
+                         const void *pData,
+                         size_t len,
+                         uint32_t *pOffset );
+int CONFIGCACHE_AddString( ConfigCache *pCache,
+                           const char *str,
+                           uint32_t *pOffset );
+int CONFIGCACHE_Write( ConfigCache *pCache,
+                       const char *path,
+                       const char *source );
+void CONFIGCACHE_Close( ConfigCache *pCache );
+ConfigCacheHeader *CONFIGCACHE_GetHeader( ConfigCache *pCache );
+ConfigCacheProcess *CONFIGCACHE_GetProcess( ConfigCache *pCache, size_t n );
+const char *CONFIGCACHE_GetString( ConfigCache *pCache, uint32_t offset );
+const void *CONFIGCACHE_GetData( ConfigCache *pCache,
+                                 uint32_t offset,
+                                 size_t len );
+
+#endif
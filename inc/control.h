@@ -0,0 +1,66 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! maximum length of a control request line */
+#define CONTROL_MAX_REQUEST     ( 256 )
+
+/*! time limit (in milliseconds) for a client to make progress sending
+ *  its request or reading its response */
+#define CONTROL_IDLE_TIMEOUT    ( 5000 )
+
+/*! maximum number of concurrent client connections */
+#define CONTROL_MAX_CLIENTS     ( 32 )
+
+/*! control request handler function invoked with a NUL terminated
+ *  request line (without the newline), which writes its response to
+ *  the specified output stream */
+typedef int (*ControlHandler)( FILE *fp, char *request, void *arg );
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int CONTROL_Listen( const char *path, ControlHandler handler, void *arg );
+int CONTROL_ListenTcp( const char *address,
+                       uint16_t port,
+                       ControlHandler handler,
+                       void *arg );
+int CONTROL_Connect( const char *path );
+
+#endif
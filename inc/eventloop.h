@@ -0,0 +1,104 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! maximum number of events processed per event loop iteration */
+#define EVENTLOOP_MAX_EVENTS    ( 64 )
+
+struct _eventSource;
+
+/*! event handler function invoked when an event source is ready */
+typedef void (*EventHandler)( struct _eventSource *pSource, uint32_t events );
+
+/*! the EventSource object associates a file descriptor with the
+ *  handler to be invoked when the file descriptor is ready */
+typedef struct _eventSource
+{
+    /*! file descriptor to monitor */
+    int fd;
+
+    /*! handler to invoke when the file descriptor is ready */
+    EventHandler handler;
+
+    /*! opaque argument for use by the handler */
+    void *arg;
+
+} EventSource;
+
+/*! timer handler function invoked when a timer expires */
+typedef void (*TimerHandler)( void *arg );
+
+/*! the Timer object is used to schedule a deferred action in the
+ *  event loop */
+typedef struct _timer
+{
+    /*! monotonic time (in milliseconds) at which the timer expires */
+    int64_t expiry;
+
+    /*! handler to invoke when the timer expires */
+    TimerHandler handler;
+
+    /*! opaque argument passed to the timer handler */
+    void *arg;
+
+    /*! indicates if the timer is currently scheduled */
+    bool active;
+
+    /*! pointer to the next timer in the same timer wheel slot */
+    struct _timer *pNext;
+
+    /*! pointer to the previous timer in the same timer wheel slot */
+    struct _timer *pPrev;
+
+} Timer;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int EVENTLOOP_Init( void );
+int EVENTLOOP_Add( EventSource *pSource, uint32_t events );
+int EVENTLOOP_Remove( EventSource *pSource );
+int EVENTLOOP_StartTimer( Timer *pTimer,
+                          int64_t delay,
+                          TimerHandler handler,
+                          void *arg );
+int EVENTLOOP_StopTimer( Timer *pTimer );
+int64_t EVENTLOOP_GetTime( void );
+int EVENTLOOP_Run( void );
+
+#endif
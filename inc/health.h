@@ -0,0 +1,163 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+
+#ifndef HEALTH_H
+#define HEALTH_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "eventloop.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! size of the buffer holding the start of an HTTP health check response */
+#define HEALTH_RESPONSE_LEN     ( 16 )
+
+/*! type of health check probe */
+typedef enum _healthType
+{
+    /*! no health check */
+    HEALTH_eNONE = 0,
+
+    /*! a command which exits with status 0 when the process is healthy */
+    HEALTH_eEXEC = 1,
+
+    /*! a TCP connection to the process */
+    HEALTH_eTCP = 2,
+
+    /*! an HTTP GET request which succeeds with a 2xx or 3xx status */
+    HEALTH_eHTTP = 3,
+
+    /*! a heartbeat counter which the process increments */
+    HEALTH_eHEARTBEAT = 4
+
+} HealthType;
+
+/*! health check handler invoked when the health of a process changes:
+ *  when it first passes its health check after the check was started,
+ *  and when it has failed its health check the configured number of
+ *  consecutive times */
+typedef void (*HealthHandler)( void *arg, bool healthy );
+
+/*! the HealthCheck object periodically probes the health of a process
+ *  from the event loop */
+typedef struct _healthCheck
+{
+    /*! type of probe */
+    HealthType type;
+
+    /*! argument vector of the command run by an exec probe */
+    char **argv;
+
+    /*! address connected to by a TCP or HTTP probe */
+    struct sockaddr_storage addr;
+
+    /*! length of the probe address */
+    socklen_t addrlen;
+
+    /*! request sent by an HTTP probe */
+    char *request;
+
+    /*! interval between probes in milliseconds */
+    int64_t interval;
+
+    /*! time (in milliseconds) a probe may take before it fails */
+    int64_t timeout;
+
+    /*! number of consecutive failed probes after which the process
+     *  is considered unhealthy */
+    int threshold;
+
+    /*! number of consecutive failed probes */
+    int failures;
+
+    /*! pointer to the heartbeat counter of a heartbeat probe */
+    const uint32_t *pHeartbeat;
+
+    /*! heartbeat counter value seen by the previous probe */
+    uint32_t heartbeat;
+
+    /*! timer used to start each probe */
+    Timer timer;
+
+    /*! timer used to fail a probe which takes too long */
+    Timer timeoutTimer;
+
+    /*! socket or pidfd of the probe in progress */
+    EventSource source;
+
+    /*! process identifier of the command run by an exec probe */
+    pid_t pid;
+
+    /*! indicates that the HTTP request has been sent */
+    bool sent;
+
+    /*! start of the HTTP response */
+    char response[HEALTH_RESPONSE_LEN];
+
+    /*! number of bytes of the HTTP response received */
+    size_t received;
+
+    /*! handler invoked when the health of the process changes */
+    HealthHandler handler;
+
+    /*! opaque argument passed to the handler */
+    void *arg;
+
+    /*! indicates that the health check is running */
+    bool active;
+
+    /*! indicates that the process has passed a probe since the health
+     *  check was started */
+    bool healthy;
+
+} HealthCheck;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int HEALTH_Init( HealthCheck *pCheck,
+                 const char *spec,
+                 int interval,
+                 int timeout,
+                 int threshold );
+int HEALTH_Start( HealthCheck *pCheck,
+                  const uint32_t *pHeartbeat,
+                  HealthHandler handler,
+                  void *arg );
+void HEALTH_Stop( HealthCheck *pCheck );
+void HEALTH_Close( HealthCheck *pCheck );
+
+#endif
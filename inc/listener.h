@@ -0,0 +1,79 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+
+#ifndef LISTENER_H
+#define LISTENER_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "eventloop.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! maximum number of listening sockets of a process */
+#define LISTENER_MAX_SOCKETS    ( 8 )
+
+/*! the Listener object holds the listening sockets of a socket activated
+ *  process.  The sockets are bound by the process monitor and passed to
+ *  the process when it is started */
+typedef struct _listener
+{
+    /*! listening sockets, in the order of their addresses */
+    EventSource sources[LISTENER_MAX_SOCKETS];
+
+    /*! number of listening sockets */
+    size_t count;
+
+    /*! addresses the sockets are bound to, or NULL if the sockets are
+     *  not open */
+    char *addresses;
+
+    /*! indicates that the sockets are being watched by the event loop */
+    bool watching;
+
+} Listener;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int LISTENER_Open( Listener *pListener, const char *addresses );
+bool LISTENER_Equal( Listener *pListener, const char *addresses );
+int LISTENER_Watch( Listener *pListener,
+                    uint32_t events,
+                    EventHandler handler,
+                    void *arg );
+void LISTENER_Unwatch( Listener *pListener );
+void LISTENER_Close( Listener *pListener );
+bool LISTENER_Connected( Listener *pListener );
+
+#endif
@@ -0,0 +1,98 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "eventloop.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! the LogBuffer object captures the output of a process.  The output
+ *  is read from a pipe by the event loop into an in-memory ring buffer,
+ *  and/or written to a rotating log file */
+typedef struct _logBuffer
+{
+    /*! read end of the log pipe */
+    EventSource source;
+
+    /*! write end of the log pipe which is passed to the process */
+    int writefd;
+
+    /*! ring buffer holding the most recent output, or NULL */
+    char *pData;
+
+    /*! size of the ring buffer in bytes */
+    size_t size;
+
+    /*! total number of bytes written to the ring buffer */
+    uint64_t total;
+
+    /*! path of the log file, or NULL */
+    char *path;
+
+    /*! size (in bytes) at which the log file is rotated, or 0 */
+    size_t maxFileSize;
+
+    /*! log file descriptor, or -1 */
+    int filefd;
+
+    /*! current size of the log file in bytes */
+    size_t fileSize;
+
+    /*! number of bytes which could not be written to the log file */
+    uint64_t dropped;
+
+    /*! indicates that the log pipe is open */
+    bool open;
+
+} LogBuffer;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int LOGBUFFER_Open( LogBuffer *pLog,
+                    size_t size,
+                    const char *path,
+                    size_t maxFileSize );
+int LOGBUFFER_GetFd( LogBuffer *pLog );
+bool LOGBUFFER_Equal( LogBuffer *pLog,
+                      size_t size,
+                      const char *path,
+                      size_t maxFileSize );
+int LOGBUFFER_Write( LogBuffer *pLog, FILE *fp );
+void LOGBUFFER_Close( LogBuffer *pLog );
+
+#endif
@@ -0,0 +1,135 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! number of restart latency histogram buckets ( excluding +Inf ) */
+#define METRICS_BUCKETS         ( 15 )
+
+/*! the ProcessMetrics object holds the most recent resource usage sample
+ *  and the restart latency histogram of a single process */
+typedef struct _processMetrics
+{
+    /*! process identifier used as the id label, or NULL if the
+     *  process is not reported */
+    const char *id;
+
+    /*! process identifier of the sampled process */
+    pid_t pid;
+
+    /*! cached /proc/<pid>/stat file descriptor */
+    int statfd;
+
+    /*! cached /proc/<pid>/status file descriptor */
+    int statusfd;
+
+    /*! cached /proc/<pid>/fd directory file descriptor */
+    int fdfd;
+
+    /*! indicates that the process was running when it was sampled */
+    bool up;
+
+    /*! user and system CPU time in seconds */
+    double cpu;
+
+    /*! resident set size in bytes */
+    uint64_t rss;
+
+    /*! number of open file descriptors */
+    uint64_t fds;
+
+    /*! number of voluntary context switches */
+    uint64_t vctxsw;
+
+    /*! number of involuntary context switches */
+    uint64_t nvctxsw;
+
+    /*! number of times the process has been restarted */
+    uint64_t restarts;
+
+    /*! total number of exits of the process */
+    uint64_t exits;
+
+    /*! exit code of the most recent exit, or -1 if the process did not
+     *  exit normally */
+    int exitCode;
+
+    /*! signal which terminated the process at the most recent exit,
+     *  or 0 if the process was not terminated by a signal */
+    int exitSignal;
+
+    /*! length of time (in seconds) the process ran for before the
+     *  most recent exit */
+    double uptime;
+
+    /*! monotonic time (in nanoseconds) at which the process exited,
+     *  or 0 if the process is not being restarted */
+    int64_t exitTime;
+
+    /*! number of restarts in each restart latency histogram bucket */
+    uint64_t buckets[METRICS_BUCKETS + 1];
+
+    /*! sum of the restart latencies in seconds */
+    double sum;
+
+} ProcessMetrics;
+
+/*! metrics iterator function which returns the metrics of the n'th
+ *  process, or NULL when there are no more processes */
+typedef ProcessMetrics *(*MetricsIterator)( size_t n, void *arg );
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+void METRICS_Init( ProcessMetrics *pMetrics, const char *id );
+int METRICS_Sample( ProcessMetrics *pMetrics, pid_t pid, uint64_t restarts );
+void METRICS_SampleExits( ProcessMetrics *pMetrics,
+                          uint64_t exits,
+                          int wstatus,
+                          uint32_t uptime );
+void METRICS_Close( ProcessMetrics *pMetrics );
+void METRICS_ProcessExited( ProcessMetrics *pMetrics );
+void METRICS_ProcessStarted( ProcessMetrics *pMetrics );
+int METRICS_Write( FILE *fp, MetricsIterator iterator, void *arg );
+int METRICS_ServeHttp( FILE *fp,
+                       char *request,
+                       MetricsIterator iterator,
+                       void *arg );
+
+#endif
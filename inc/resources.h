@@ -0,0 +1,97 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! mount point of the cgroup v2 hierarchy */
+#define RESOURCES_CGROUP_ROOT   "/sys/fs/cgroup"
+
+/*! sysfs directory describing the NUMA nodes of the system */
+#define RESOURCES_NODE_ROOT     "/sys/devices/system/node"
+
+/*! the ProcessResources object describes the cgroup placement, resource
+ *  limits and scheduling attributes applied to a process when it
+ *  is launched */
+typedef struct _processResources
+{
+    /*! cgroup to place the process in, relative to the cgroup root */
+    char *cgroup;
+
+    /*! cgroup cpu.max limit, eg "50000 100000" */
+    char *cpu_max;
+
+    /*! cgroup memory.max limit, eg "256M" */
+    char *memory_max;
+
+    /*! CPU affinity of the process, or NULL to leave it unchanged.
+     *  The CPU set is owned by the caller */
+    cpu_set_t *pCpuset;
+
+    /*! indicates that the nice value should be set */
+    bool setNice;
+
+    /*! nice value of the process */
+    int nice;
+
+    /*! I/O priority of the process ( as passed to ioprio_set ),
+     *  or 0 to leave it unchanged */
+    int ioprio;
+
+    /*! open cgroup.procs file of the cgroup, or -1 */
+    int cgroupfd;
+
+} ProcessResources;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+void RESOURCES_Init( ProcessResources *pResources );
+int RESOURCES_ParseCpuset( const char *cpuset, cpu_set_t *pCpuset );
+int RESOURCES_ParseIoPriority( const char *ioprio, int *pValue );
+int RESOURCES_Pin( ProcessResources *pResources,
+                   const char *policy,
+                   size_t index,
+                   cpu_set_t *pCpuset );
+void RESOURCES_Inherit( ProcessResources *pResources,
+                        const ProcessResources *pParent );
+bool RESOURCES_Equal( const ProcessResources *pResources1,
+                      const ProcessResources *pResources2 );
+int RESOURCES_Prepare( ProcessResources *pResources );
+int RESOURCES_Apply( ProcessResources *pResources );
+
+#endif
@@ -0,0 +1,209 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef STATETABLE_H
+#define STATETABLE_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! name of the shared memory object containing the state table */
+#define STATETABLE_NAME         "/procmon"
+
+/*! state table layout identifier */
+#define STATETABLE_MAGIC        ( 0x50524F43 )
+
+/*! state table layout version */
+#define STATETABLE_VERSION      ( 6 )
+
+/*! maximum number of processes in the state table */
+#define STATETABLE_MAX_ENTRIES  ( 1024 )
+
+/*! number of slots in the state table id index */
+#define STATETABLE_INDEX_SIZE   ( 2 * STATETABLE_MAX_ENTRIES )
+
+/*! maximum length of a process identifier (including the NUL) */
+#define STATETABLE_ID_LEN       ( 64 )
+
+/*! maximum length of a process command line (including the NUL) */
+#define STATETABLE_EXEC_LEN     ( 512 )
+
+/*! terminate command to terminate a process and suspend monitoring */
+#define STATETABLE_SUSPEND      ( 0xDEADBEEF )
+
+/*! terminate command to terminate a process and stop monitoring */
+#define STATETABLE_STOP         ( 0xDEAFBABE )
+
+/*! number of exits kept in the exit history of a process */
+#define STATETABLE_HISTORY_LEN  ( 16 )
+
+/*! wait status of an exit whose status is not known */
+#define STATETABLE_STATUS_UNKNOWN ( -1 )
+
+/*! the StateExit object records a single exit of a process in its
+ *  exit history.  It is written by the process monitor supervising the
+ *  process, and may be read by any process without taking a lock */
+typedef struct _stateExit
+{
+    /*! sequence number of the entry, which is odd while the entry
+     *  is being written */
+    uint32_t sequence;
+
+    /*! wait status of the process, or STATETABLE_STATUS_UNKNOWN */
+    int32_t status;
+
+    /*! length of time (in milliseconds) the process ran for */
+    uint32_t uptime;
+
+    /*! length of time (in milliseconds) from the exit until the process
+     *  was started again, or 0 if it has not been restarted */
+    uint32_t latency;
+
+    /*! time (in seconds since the epoch) at which the process exited */
+    int64_t timestamp;
+
+} StateExit;
+
+/*! the LockData object contains the runtime
+ * state of a process and is used to detect process death
+ * and to terminate the process on demand */
+typedef struct _lockData
+{
+    /*! current process ID of the monitored process */
+    pid_t pid;
+
+    /*! terminate command used to force the process to exit */
+    uint32_t terminate;
+
+    /*! process run counter */
+    size_t runcount;
+
+    /*! last process start time */
+    time_t starttime;
+
+    /*! indicates that the process has exhausted its restart budget */
+    uint32_t failed;
+
+    /*! signal used to ask the process to stop */
+    uint32_t stopSignal;
+
+    /*! time (in seconds) the process is given to stop before it is killed */
+    uint32_t stopTimeout;
+
+    /*! total number of exits of the process */
+    uint32_t exits;
+
+    /*! the most recent exits of the process, indexed by the exit number
+     *  modulo STATETABLE_HISTORY_LEN */
+    StateExit history[STATETABLE_HISTORY_LEN];
+
+    /*! heartbeat counter incremented by a process with a heartbeat
+     *  health check */
+    uint32_t heartbeat;
+
+} LockData;
+
+/*! the StateRecord object contains the shared state of a single process */
+typedef struct _stateRecord
+{
+    /*! name or unique identifier for the process */
+    char id[STATETABLE_ID_LEN];
+
+    /*! indicates that the record describes a monitored process */
+    uint32_t inuse;
+
+    /*! runtime state of the process */
+    LockData data;
+
+    /*! command line used to (re)start the process */
+    char exec[STATETABLE_EXEC_LEN];
+
+} StateRecord;
+
+/*! the StateTable object is the fixed layout of the shared
+ *  memory region shared by all process monitor instances */
+typedef struct _stateTable
+{
+    /*! state table layout identifier */
+    uint32_t magic;
+
+    /*! state table layout version */
+    uint32_t version;
+
+    /*! mutex used to serialize state table insertions */
+    pthread_mutex_t mutex;
+
+    /*! command sequence number, incremented (and waited on as a futex)
+     *  whenever a process monitoring command is issued */
+    uint32_t sequence;
+
+    /*! number of records which have been allocated */
+    uint32_t count;
+
+    /*! hash index of record numbers (plus one) keyed by process id */
+    uint32_t index[STATETABLE_INDEX_SIZE];
+
+    /*! process state records */
+    StateRecord records[STATETABLE_MAX_ENTRIES];
+
+} StateTable;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int STATETABLE_Open( void );
+int STATETABLE_GetFd( void );
+StateRecord *STATETABLE_Find( const char *id );
+StateRecord *STATETABLE_Add( const char *id, bool *pCreated );
+int STATETABLE_Remove( StateRecord *pRecord );
+StateRecord *STATETABLE_Get( size_t n );
+size_t STATETABLE_Count( void );
+int STATETABLE_Lock( StateRecord *pRecord, int cmd );
+int STATETABLE_OpenLock( void );
+int STATETABLE_LockHandle( StateRecord *pRecord, int fd );
+uint32_t STATETABLE_GetSequence( void );
+int STATETABLE_Notify( void );
+int STATETABLE_Wait( uint32_t sequence );
+int STATETABLE_RecordExit( StateRecord *pRecord,
+                           int status,
+                           uint32_t uptime );
+int STATETABLE_RecordRestart( StateRecord *pRecord, uint32_t latency );
+size_t STATETABLE_GetHistory( StateRecord *pRecord,
+                              StateExit *pHistory,
+                              size_t n );
+
+#endif
@@ -0,0 +1,62 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! number of trace events kept per thread.  The oldest events of a
+ *  thread are overwritten once its ring buffer is full */
+#define TRACE_BUFFER_EVENTS     ( 4096 )
+
+/*! maximum length of the argument of a trace event, such as the
+ *  identifier of a process */
+#define TRACE_ARG_LEN           ( 32 )
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int TRACE_Enable( const char *path );
+int64_t TRACE_Now( void );
+int64_t TRACE_Begin( void );
+void TRACE_End( const char *name, const char *arg, int64_t start );
+void TRACE_Span( const char *name,
+                 const char *arg,
+                 int64_t start,
+                 int64_t end );
+void TRACE_Async( const char *name, const char *arg, int64_t start );
+int TRACE_Write( void );
+
+#endif
@@ -0,0 +1,1754 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup aggregator aggregator
+ * @brief Cluster aggregator
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file aggregator.c
+
+    Cluster Aggregator
+
+    The aggregator module collects the process states streamed by the
+    cluster agents of a fleet of process monitors, and serves fleet-wide
+    queries and commands on a control socket.
+
+    Each agent sends a snapshot of its processes when it connects, and
+    then only the changes, so the aggregator holds the current state of
+    every process on every connected node.  The protocol is described in
+    cluster.c.  An agent must prove its knowledge of the cluster token
+    within AGGREGATOR_HELLO_TIMEOUT of connecting, and a node may report
+    at most AGGREGATOR_MAX_PROCESSES processes.
+
+    The following requests are served on the control socket:
+
+    - nodes - list the connected nodes
+    - list [<id>] - list the processes of all nodes, or a single process
+    - restart|start|stop|delete <id> [<node> ...] - send a command to all
+      nodes, or to the specified nodes
+    - rolling <id> <concurrency> - restart a process across the fleet,
+      on at most <concurrency> nodes at a time
+    - rollouts - display the progress of the rolling restarts
+
+    A process identifier in a request may also be the id of a replica
+    group, which matches each of the instances of the group.  A rolling
+    restart moves on from a node once the node reports that the process,
+    or each instance of the group, has been restarted.  If the restart
+    fails, the node disconnects, or the process is not restarted within
+    AGGREGATOR_ROLLOUT_TIMEOUT, the rollout is halted, so a bad release
+    does not take down the whole fleet.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "eventloop.h"
+#include "listener.h"
+#include "control.h"
+#include "cluster.h"
+#include "aggregator.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! maximum length of a process identifier */
+#define AGGREGATOR_ID_LEN       ( 64 )
+
+/*! maximum length of a process status */
+#define AGGREGATOR_STATUS_LEN   ( 16 )
+
+/*! maximum length of the description of a process exit */
+#define AGGREGATOR_EXIT_LEN     ( 24 )
+
+/*! maximum number of fields of a cluster protocol line */
+#define AGGREGATOR_MAX_FIELDS   ( 8 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! the AggProcess object holds the state of a process on a node */
+typedef struct _aggProcess
+{
+    /*! process identifier */
+    char id[AGGREGATOR_ID_LEN];
+
+    /*! process identifier of the running process, or 0 */
+    int pid;
+
+    /*! number of times the process has been started */
+    uint32_t runcount;
+
+    /*! running, stopped or failed */
+    char status[AGGREGATOR_STATUS_LEN];
+
+    /*! healthy, unhealthy, or - if the health is not known */
+    char health[AGGREGATOR_STATUS_LEN];
+
+    /*! description of the most recent exit of the process */
+    char exit[AGGREGATOR_EXIT_LEN];
+
+    /*! time (in seconds since the epoch) of the most recent change */
+    time_t since;
+
+    /*! number of the most recent rollout which restarted the process */
+    uint32_t rollout;
+
+    /*! pointer to the next process of the node */
+    struct _aggProcess *pNext;
+
+} AggProcess;
+
+/*! the AggNode object holds the connection from a cluster agent and the
+ *  state of the processes of its node */
+typedef struct _aggNode
+{
+    /*! connection from the agent */
+    EventSource source;
+
+    /*! name of the node, which is empty until the agent has said hello */
+    char name[CLUSTER_NODE_LEN];
+
+    /*! challenge sent to the agent */
+    char challenge[CLUSTER_NONCE_LEN];
+
+    /*! timer which closes the connection if the agent does not say hello */
+    Timer helloTimer;
+
+    /*! address of the agent */
+    char address[NI_MAXHOST];
+
+    /*! time (in seconds since the epoch) the agent connected */
+    time_t connected;
+
+    /*! partial line received from the agent */
+    char in[CLUSTER_MAX_LINE];
+
+    /*! number of bytes of the partial line */
+    size_t inLen;
+
+    /*! processes of the node */
+    AggProcess *pProcesses;
+
+    /*! number of processes of the node */
+    size_t count;
+
+    /*! pointer to the next node */
+    struct _aggNode *pNext;
+
+} AggNode;
+
+/*! state of a rolling restart step */
+typedef enum _stepState
+{
+    /*! the node has not been restarted yet */
+    STEP_PENDING,
+
+    /*! the node is restarting the process */
+    STEP_ACTIVE,
+
+    /*! the node has restarted the process */
+    STEP_DONE,
+
+    /*! the node failed to restart the process */
+    STEP_FAILED
+
+} StepState;
+
+struct _rollout;
+
+/*! the RolloutStep object tracks the restart of a process on one node
+ *  during a rolling restart */
+typedef struct _rolloutStep
+{
+    /*! name of the node */
+    char node[CLUSTER_NODE_LEN];
+
+    /*! state of the step */
+    StepState state;
+
+    /*! reason the step failed */
+    const char *reason;
+
+    /*! number of processes of the node which are still to be restarted */
+    size_t remaining;
+
+    /*! timer which fails the step if the process is not restarted */
+    Timer timer;
+
+    /*! pointer to the rollout the step belongs to */
+    struct _rollout *pRollout;
+
+} RolloutStep;
+
+/*! the Rollout object tracks a rolling restart of a process */
+typedef struct _rollout
+{
+    /*! rollout number */
+    uint32_t number;
+
+    /*! identifier of the process or replica group being restarted */
+    char id[AGGREGATOR_ID_LEN];
+
+    /*! maximum number of nodes restarting the process at a time */
+    size_t concurrency;
+
+    /*! one step per node */
+    RolloutStep *pSteps;
+
+    /*! number of steps */
+    size_t count;
+
+    /*! index of the next pending step */
+    size_t next;
+
+    /*! number of active steps */
+    size_t active;
+
+    /*! number of completed steps */
+    size_t done;
+
+    /*! indicates that the rollout was halted by a failed step */
+    bool halted;
+
+    /*! pointer to the next (older) rollout */
+    struct _rollout *pNext;
+
+} Rollout;
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! socket accepting agent connections */
+static Listener listener;
+
+/*! shared secret of the cluster */
+static char token[CLUSTER_TOKEN_LEN];
+
+/*! connected nodes */
+static AggNode *pNodes = NULL;
+
+/*! rollouts, most recent first */
+static Rollout *pRollouts = NULL;
+
+/*! number of the most recent rollout */
+static uint32_t rolloutNumber = 0;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static void HandleConnection( EventSource *pSource, uint32_t events );
+static void HandleNode( EventSource *pSource, uint32_t events );
+static int HandleMessage( AggNode *pNode, char *line );
+static int HandleHello( AggNode *pNode,
+                        const char *name,
+                        const char *nonce,
+                        const char *proof );
+static void HelloTimeout( void *arg );
+static void DiscardProcesses( AggNode *pNode );
+static void HandleResult( AggNode *pNode,
+                          const char *command,
+                          const char *id,
+                          int error );
+static AggProcess *GetProcess( AggNode *pNode, const char *id, bool create );
+static void SetStatus( AggProcess *pProcess, const char *status, int pid );
+static void CloseNode( AggNode *pNode );
+static AggNode *FindNode( const char *name );
+static size_t CountProcesses( AggNode *pNode, const char *id );
+static bool Matches( const char *id, const char *name );
+static bool IsInstance( const char *id, const char *group );
+static int SendCommand( AggNode *pNode, const char *command, const char *id );
+static int HandleRequest( FILE *fp, char *request, void *arg );
+static int ListNodes( FILE *fp );
+static int ListProcesses( FILE *fp, const char *id );
+static int SendCommands( FILE *fp,
+                         const char *command,
+                         const char *id,
+                         char **saveptr );
+static int StartRollout( FILE *fp, const char *id, const char *concurrency );
+static int ListRollouts( FILE *fp );
+static void AdvanceRollout( Rollout *pRollout );
+static void CompleteStep( AggNode *pNode, const char *id, const char *reason );
+static void EndStep( RolloutStep *pStep, const char *reason );
+static void StepTimeout( void *arg );
+static void PruneRollouts( void );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  AGGREGATOR_Start                                                          */
+/*!
+    Start the cluster aggregator
+
+    The AGGREGATOR_Start function starts accepting connections from the
+    cluster agents, and serving queries on the aggregator control socket.
+    The aggregator is served from the event loop, which must have been
+    initialized.
+
+    @param[in]
+        address
+            address to accept agent connections on, in one of the forms
+            <port>, :<port>, <host>:<port> or [<IPv6 address>]:<port>
+
+    @param[in]
+        path
+            path of the aggregator control socket
+
+    @param[in]
+        secret
+            shared secret of the cluster
+
+    @retval EOK - the aggregator was started
+    @retval EINVAL - invalid arguments
+    @retval other - error from LISTENER_Open, LISTENER_Watch or
+                    CONTROL_Listen
+
+==============================================================================*/
+int AGGREGATOR_Start( const char *address,
+                      const char *path,
+                      const char *secret )
+{
+    int result = EINVAL;
+
+    if ( ( address != NULL ) &&
+         ( path != NULL ) &&
+         ( secret != NULL ) &&
+         ( *secret != '\0' ) &&
+         ( strlen( secret ) < sizeof( token ) ) )
+    {
+        strcpy( token, secret );
+
+        result = LISTENER_Open( &listener, address );
+        if ( result == EOK )
+        {
+            result = LISTENER_Watch( &listener,
+                                     EPOLLIN,
+                                     HandleConnection,
+                                     NULL );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONTROL_Listen( path, HandleRequest, NULL );
+        }
+
+        if ( result != EOK )
+        {
+            LISTENER_Close( &listener );
+        }
+    }
+
+    return result;
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  HandleConnection                                                          */
+/*!
+    Accept a connection from a cluster agent
+
+    The HandleConnection function accepts a connection from an agent and
+    sends it a challenge.  The agent must answer the challenge with a
+    hello within AGGREGATOR_HELLO_TIMEOUT, or the connection is closed.
+
+    @param[in]
+        pSource
+            pointer to the listening socket event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleConnection( EventSource *pSource, uint32_t events )
+{
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof( addr );
+    AggNode *pNode;
+    int fd;
+
+    (void)events;
+
+    if ( pSource != NULL )
+    {
+        fd = accept4( pSource->fd,
+                      (struct sockaddr *)&addr,
+                      &addrlen,
+                      SOCK_NONBLOCK | SOCK_CLOEXEC );
+        if ( fd != -1 )
+        {
+            pNode = calloc( 1, sizeof( AggNode ) );
+            if ( pNode == NULL )
+            {
+                close( fd );
+            }
+            else
+            {
+                pNode->source.fd = fd;
+                pNode->source.handler = HandleNode;
+                pNode->source.arg = pNode;
+                pNode->connected = time( NULL );
+
+                if ( getnameinfo( (struct sockaddr *)&addr,
+                                  addrlen,
+                                  pNode->address,
+                                  sizeof( pNode->address ),
+                                  NULL,
+                                  0,
+                                  NI_NUMERICHOST ) != 0 )
+                {
+                    strcpy( pNode->address, "-" );
+                }
+
+                if ( ( CLUSTER_MakeNonce( pNode->challenge ) == EOK ) &&
+                     ( SendCommand( pNode,
+                                    "challenge",
+                                    pNode->challenge ) == EOK ) &&
+                     ( EVENTLOOP_Add( &pNode->source, EPOLLIN ) == EOK ) )
+                {
+                    pNode->pNext = pNodes;
+                    pNodes = pNode;
+
+                    EVENTLOOP_StartTimer( &pNode->helloTimer,
+                                          AGGREGATOR_HELLO_TIMEOUT,
+                                          HelloTimeout,
+                                          pNode );
+                }
+                else
+                {
+                    close( fd );
+                    free( pNode );
+                }
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleNode                                                                */
+/*!
+    Receive messages from a cluster agent
+
+    The HandleNode function reads the available data from an agent, and
+    handles each complete message line.  The node is closed when the
+    agent disconnects, or sends a message it is not allowed to.
+
+    @param[in]
+        pSource
+            pointer to the agent connection event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleNode( EventSource *pSource, uint32_t events )
+{
+    AggNode *pNode;
+    int result = EOK;
+    char *line;
+    char *p;
+    ssize_t n;
+
+    (void)events;
+
+    if ( ( pSource != NULL ) && ( pSource->arg != NULL ) )
+    {
+        pNode = (AggNode *)pSource->arg;
+
+        n = read( pSource->fd,
+                  &pNode->in[pNode->inLen],
+                  sizeof( pNode->in ) - pNode->inLen - 1 );
+        if ( n > 0 )
+        {
+            pNode->inLen += n;
+            pNode->in[pNode->inLen] = '\0';
+
+            line = pNode->in;
+            while ( ( result == EOK ) &&
+                    ( ( p = strchr( line, '\n' ) ) != NULL ) )
+            {
+                *p = '\0';
+                result = HandleMessage( pNode, line );
+                line = &p[1];
+            }
+
+            /* keep the partial line, and discard an over-long line */
+            pNode->inLen -= ( line - pNode->in );
+            memmove( pNode->in, line, pNode->inLen );
+            if ( pNode->inLen == sizeof( pNode->in ) - 1 )
+            {
+                pNode->inLen = 0;
+            }
+        }
+        else if ( ( n == 0 ) || ( errno != EAGAIN ) )
+        {
+            result = ECONNRESET;
+        }
+
+        if ( result != EOK )
+        {
+            CloseNode( pNode );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleMessage                                                             */
+/*!
+    Handle a message from a cluster agent
+
+    The HandleMessage function updates the state of the processes of a
+    node from a message sent by its agent.  The first message must be
+    an authenticated hello, and a second hello is not allowed.
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        line
+            NUL terminated message line
+
+    @retval EOK - the message was handled
+    @retval EACCES - the agent has not authenticated, or failed to
+    @retval EPROTO - the agent said hello again
+
+==============================================================================*/
+static int HandleMessage( AggNode *pNode, char *line )
+{
+    int result = EOK;
+    char *fields[AGGREGATOR_MAX_FIELDS];
+    AggProcess *pProcess;
+    char *saveptr;
+    size_t n = 0;
+    char *type;
+
+    while ( ( n < AGGREGATOR_MAX_FIELDS ) &&
+            ( ( fields[n] = strtok_r( n == 0 ? line : NULL,
+                                      " \r",
+                                      &saveptr ) ) != NULL ) )
+    {
+        n++;
+    }
+
+    type = ( n > 0 ) ? fields[0] : "";
+
+    if ( pNode->name[0] == '\0' )
+    {
+        /* the agent must say hello first */
+        result = ( ( strcmp( type, "hello" ) == 0 ) && ( n == 4 ) )
+                 ? HandleHello( pNode, fields[1], fields[2], fields[3] )
+                 : EACCES;
+    }
+    else if ( strcmp( type, "hello" ) == 0 )
+    {
+        printf( "node %s said hello again\n", pNode->name );
+        result = EPROTO;
+    }
+    else if ( n < 2 )
+    {
+        /* ignore an empty message */
+    }
+    else if ( strcmp( type, "result" ) == 0 )
+    {
+        if ( n == 4 )
+        {
+            HandleResult( pNode, fields[1], fields[2], atoi( fields[3] ) );
+        }
+    }
+    else if ( ( pProcess = GetProcess( pNode, fields[1], true ) ) != NULL )
+    {
+        if ( ( strcmp( type, "state" ) == 0 ) && ( n == 5 ) )
+        {
+            SetStatus( pProcess, fields[4], atoi( fields[2] ) );
+            pProcess->runcount = strtoul( fields[3], NULL, 10 );
+        }
+        else if ( ( strcmp( type, "start" ) == 0 ) && ( n == 3 ) )
+        {
+            SetStatus( pProcess, "running", atoi( fields[2] ) );
+            pProcess->runcount++;
+        }
+        else if ( ( strcmp( type, "restart" ) == 0 ) && ( n == 4 ) )
+        {
+            SetStatus( pProcess, "running", atoi( fields[2] ) );
+            pProcess->runcount++;
+            CompleteStep( pNode, pProcess->id, NULL );
+        }
+        else if ( ( strcmp( type, "exit" ) == 0 ) && ( n >= 3 ) )
+        {
+            SetStatus( pProcess, "stopped", 0 );
+            snprintf( pProcess->exit,
+                      sizeof( pProcess->exit ),
+                      "%s%s%s",
+                      fields[2],
+                      ( n > 3 ) ? " " : "",
+                      ( n > 3 ) ? fields[3] : "" );
+        }
+        else if ( strcmp( type, "failed" ) == 0 )
+        {
+            SetStatus( pProcess, "failed", 0 );
+            CompleteStep( pNode, pProcess->id, "process failed" );
+        }
+        else if ( ( strcmp( type, "health" ) == 0 ) && ( n == 3 ) )
+        {
+            snprintf( pProcess->health,
+                      sizeof( pProcess->health ),
+                      "%s",
+                      fields[2] );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleHello                                                               */
+/*!
+    Start a session with a cluster agent
+
+    The HandleHello function checks the proof of the agent, names the
+    node, and answers with the proof of the aggregator.  Any state
+    previously held for the node is discarded, since the agent follows
+    its welcome with a snapshot of its processes.  A stale connection
+    from an agent which has reconnected is only closed once the new
+    connection has authenticated.
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        name
+            name of the node
+
+    @param[in]
+        nonce
+            challenge sent by the agent
+
+    @param[in]
+        proof
+            proof of the agent
+
+    @retval EOK - the agent authenticated
+    @retval EACCES - invalid hello, or wrong proof
+    @retval other - error from SendCommand
+
+==============================================================================*/
+static int HandleHello( AggNode *pNode,
+                        const char *name,
+                        const char *nonce,
+                        const char *proof )
+{
+    int result = EACCES;
+    char welcome[CLUSTER_PROOF_LEN];
+    AggNode *pOld;
+
+    if ( ( strlen( name ) < sizeof( pNode->name ) ) &&
+         ( strlen( nonce ) == CLUSTER_NONCE_LEN - 1 ) &&
+         ( CLUSTER_CheckProof( token,
+                               "agent",
+                               name,
+                               pNode->challenge,
+                               nonce,
+                               proof ) == true ) )
+    {
+        CLUSTER_MakeProof( token,
+                           "aggregator",
+                           name,
+                           pNode->challenge,
+                           nonce,
+                           welcome );
+
+        result = SendCommand( pNode, "welcome", welcome );
+    }
+
+    if ( result == EOK )
+    {
+        EVENTLOOP_StopTimer( &pNode->helloTimer );
+
+        pOld = FindNode( name );
+        if ( ( pOld != NULL ) && ( pOld != pNode ) )
+        {
+            printf( "node %s reconnected from %s\n", name, pNode->address );
+            CloseNode( pOld );
+        }
+        else
+        {
+            printf( "node %s connected from %s\n", name, pNode->address );
+        }
+
+        DiscardProcesses( pNode );
+        strcpy( pNode->name, name );
+    }
+    else
+    {
+        printf( "node %.*s from %s failed to authenticate\n",
+                CLUSTER_NODE_LEN - 1,
+                name,
+                pNode->address );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HelloTimeout                                                              */
+/*!
+    Close the connection of an agent which has not said hello
+
+    @param[in]
+        arg
+            pointer to the node
+
+==============================================================================*/
+static void HelloTimeout( void *arg )
+{
+    AggNode *pNode = (AggNode *)arg;
+
+    if ( ( pNode != NULL ) && ( pNode->name[0] == '\0' ) )
+    {
+        printf( "agent at %s did not say hello\n", pNode->address );
+        CloseNode( pNode );
+    }
+}
+
+/*============================================================================*/
+/*  DiscardProcesses                                                          */
+/*!
+    Discard the state of the processes of a node
+
+    @param[in]
+        pNode
+            pointer to the node
+
+==============================================================================*/
+static void DiscardProcesses( AggNode *pNode )
+{
+    AggProcess *pProcess;
+
+    while ( pNode->pProcesses != NULL )
+    {
+        pProcess = pNode->pProcesses;
+        pNode->pProcesses = pProcess->pNext;
+        free( pProcess );
+    }
+
+    pNode->count = 0;
+}
+
+/*============================================================================*/
+/*  HandleResult                                                              */
+/*!
+    Handle the result of a command sent to a cluster agent
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        command
+            the command
+
+    @param[in]
+        id
+            the process identifier
+
+    @param[in]
+        error
+            EOK or an errno value
+
+==============================================================================*/
+static void HandleResult( AggNode *pNode,
+                          const char *command,
+                          const char *id,
+                          int error )
+{
+    printf( "node %s: %s %s: %s\n",
+            pNode->name,
+            command,
+            id,
+            strerror( error ) );
+
+    if ( ( strcmp( command, "restart" ) == 0 ) && ( error != EOK ) )
+    {
+        CompleteStep( pNode, id, "restart failed" );
+    }
+}
+
+/*============================================================================*/
+/*  GetProcess                                                                */
+/*!
+    Get the state of a process on a node
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        id
+            the process identifier
+
+    @param[in]
+        create
+            indicates whether to create the process if it is not known
+
+    @retval pointer to the process state
+    @retval NULL - the process is not known or could not be created, or
+                   the node already has AGGREGATOR_MAX_PROCESSES processes
+
+==============================================================================*/
+static AggProcess *GetProcess( AggNode *pNode, const char *id, bool create )
+{
+    AggProcess *pProcess = pNode->pProcesses;
+
+    while ( ( pProcess != NULL ) && ( strcmp( pProcess->id, id ) != 0 ) )
+    {
+        pProcess = pProcess->pNext;
+    }
+
+    if ( ( pProcess == NULL ) &&
+         ( create == true ) &&
+         ( pNode->count < AGGREGATOR_MAX_PROCESSES ) &&
+         ( strlen( id ) < AGGREGATOR_ID_LEN ) )
+    {
+        pProcess = calloc( 1, sizeof( AggProcess ) );
+        if ( pProcess != NULL )
+        {
+            strcpy( pProcess->id, id );
+            strcpy( pProcess->status, "stopped" );
+            strcpy( pProcess->health, "-" );
+            strcpy( pProcess->exit, "-" );
+            pProcess->since = time( NULL );
+            pProcess->pNext = pNode->pProcesses;
+            pNode->pProcesses = pProcess;
+            pNode->count++;
+        }
+    }
+
+    return pProcess;
+}
+
+/*============================================================================*/
+/*  SetStatus                                                                 */
+/*!
+    Set the status of a process
+
+    @param[in]
+        pProcess
+            pointer to the process state
+
+    @param[in]
+        status
+            running, stopped or failed
+
+    @param[in]
+        pid
+            process identifier of the running process, or 0
+
+==============================================================================*/
+static void SetStatus( AggProcess *pProcess, const char *status, int pid )
+{
+    snprintf( pProcess->status, sizeof( pProcess->status ), "%s", status );
+    pProcess->pid = pid;
+    pProcess->since = time( NULL );
+}
+
+/*============================================================================*/
+/*  CloseNode                                                                 */
+/*!
+    Close the connection from a cluster agent
+
+    The CloseNode function closes the connection from an agent, fails
+    the rollout steps active on the node, and discards the state of
+    the node.
+
+    @param[in]
+        pNode
+            pointer to the node to close
+
+==============================================================================*/
+static void CloseNode( AggNode *pNode )
+{
+    AggNode **ppNode = &pNodes;
+    AggProcess *pProcess;
+
+    while ( ( *ppNode != NULL ) && ( *ppNode != pNode ) )
+    {
+        ppNode = &(*ppNode)->pNext;
+    }
+
+    if ( *ppNode != NULL )
+    {
+        *ppNode = pNode->pNext;
+
+        if ( pNode->name[0] != '\0' )
+        {
+            printf( "node %s disconnected\n", pNode->name );
+
+            for ( pProcess = pNode->pProcesses ;
+                  pProcess != NULL ;
+                  pProcess = pProcess->pNext )
+            {
+                CompleteStep( pNode, pProcess->id, "node disconnected" );
+            }
+        }
+
+        EVENTLOOP_StopTimer( &pNode->helloTimer );
+        EVENTLOOP_Remove( &pNode->source );
+        close( pNode->source.fd );
+
+        DiscardProcesses( pNode );
+        free( pNode );
+    }
+}
+
+/*============================================================================*/
+/*  FindNode                                                                  */
+/*!
+    Find a connected node by name
+
+    @param[in]
+        name
+            name of the node
+
+    @retval pointer to the node
+    @retval NULL - the node is not connected
+
+==============================================================================*/
+static AggNode *FindNode( const char *name )
+{
+    AggNode *pNode = pNodes;
+
+    while ( ( pNode != NULL ) && ( strcmp( pNode->name, name ) != 0 ) )
+    {
+        pNode = pNode->pNext;
+    }
+
+    return pNode;
+}
+
+/*============================================================================*/
+/*  CountProcesses                                                            */
+/*!
+    Count the processes of a node which match a process identifier
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        id
+            the process or replica group identifier
+
+    @retval number of processes of the node which are the process, or
+            instances of the replica group
+
+==============================================================================*/
+static size_t CountProcesses( AggNode *pNode, const char *id )
+{
+    AggProcess *pProcess;
+    size_t count = 0;
+
+    for ( pProcess = pNode->pProcesses ;
+          pProcess != NULL ;
+          pProcess = pProcess->pNext )
+    {
+        count += ( Matches( pProcess->id, id ) == true );
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  Matches                                                                   */
+/*!
+    Check if a process matches a process or replica group identifier
+
+    @param[in]
+        id
+            the process identifier
+
+    @param[in]
+        name
+            the process or replica group identifier to match
+
+    @retval true - the process is the named process, or an instance of
+                   the named replica group
+    @retval false - the process does not match
+
+==============================================================================*/
+static bool Matches( const char *id, const char *name )
+{
+    return ( strcmp( id, name ) == 0 ) || ( IsInstance( id, name ) );
+}
+
+/*============================================================================*/
+/*  IsInstance                                                                */
+/*!
+    Check if a process is an instance of a replica group
+
+    The IsInstance function checks if a process identifier has the form
+    <group>.<index> of an instance of the specified replica group.
+
+    @param[in]
+        id
+            pointer to the process identifier
+
+    @param[in]
+        group
+            pointer to the replica group identifier
+
+    @retval true - the process is an instance of the group
+    @retval false - the process is not an instance of the group
+
+==============================================================================*/
+static bool IsInstance( const char *id, const char *group )
+{
+    bool result = false;
+    size_t len;
+
+    if ( ( id != NULL ) && ( group != NULL ) )
+    {
+        len = strlen( group );
+        if ( ( strncmp( id, group, len ) == 0 ) &&
+             ( id[len] == '.' ) &&
+             ( isdigit( (unsigned char)id[len + 1] ) ) )
+        {
+            id += len + 1;
+            while ( isdigit( (unsigned char)*id ) )
+            {
+                id++;
+            }
+
+            result = ( *id == '\0' );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SendCommand                                                               */
+/*!
+    Send a command to a cluster agent
+
+    Commands are short, so they are written directly to the connection.
+    A command which cannot be written without blocking is not sent.  The
+    challenge and welcome messages of the hello are sent the same way.
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        command
+            restart, start, stop or delete, or challenge or welcome
+
+    @param[in]
+        id
+            the process identifier, or the challenge or proof
+
+    @retval EOK - the command was sent
+    @retval EINVAL - invalid command
+    @retval other - error from send
+
+==============================================================================*/
+static int SendCommand( AggNode *pNode, const char *command, const char *id )
+{
+    int result = EINVAL;
+    char line[CLUSTER_MAX_LINE];
+    int len;
+
+    len = snprintf( line, sizeof( line ), "%s %s\n", command, id );
+    if ( ( len > 0 ) && ( (size_t)len < sizeof( line ) ) )
+    {
+        result = ( send( pNode->source.fd,
+                         line,
+                         len,
+                         MSG_NOSIGNAL | MSG_DONTWAIT ) == len ) ? EOK
+                                                                : errno;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleRequest                                                             */
+/*!
+    Handle an aggregator control socket request
+
+    The HandleRequest function is invoked by the control module when a
+    request is received on the aggregator control socket.  The requests
+    are described at the top of this file.
+
+    @param[in]
+        fp
+            output stream to write the response to
+
+    @param[in]
+        request
+            pointer to the NUL terminated request line
+
+    @param[in]
+        arg
+            unused
+
+    @retval EOK - the request was handled
+    @retval EINVAL - invalid arguments
+    @retval ENOTSUP - unsupported request
+
+==============================================================================*/
+static int HandleRequest( FILE *fp, char *request, void *arg )
+{
+    int result = EINVAL;
+    char *saveptr;
+    char *cmd;
+    char *param;
+
+    (void)arg;
+
+    if ( ( fp != NULL ) && ( request != NULL ) )
+    {
+        cmd = strtok_r( request, " ", &saveptr );
+        param = strtok_r( NULL, " ", &saveptr );
+        cmd = ( cmd != NULL ) ? cmd : "";
+
+        if ( strcmp( cmd, "nodes" ) == 0 )
+        {
+            result = ListNodes( fp );
+        }
+        else if ( strcmp( cmd, "list" ) == 0 )
+        {
+            result = ListProcesses( fp, param );
+        }
+        else if ( ( strcmp( cmd, "restart" ) == 0 ) ||
+                  ( strcmp( cmd, "start" ) == 0 ) ||
+                  ( strcmp( cmd, "stop" ) == 0 ) ||
+                  ( strcmp( cmd, "delete" ) == 0 ) )
+        {
+            result = SendCommands( fp, cmd, param, &saveptr );
+        }
+        else if ( strcmp( cmd, "rolling" ) == 0 )
+        {
+            result = StartRollout( fp,
+                                   param,
+                                   strtok_r( NULL, " ", &saveptr ) );
+        }
+        else if ( strcmp( cmd, "rollouts" ) == 0 )
+        {
+            result = ListRollouts( fp );
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
+
+        if ( result != EOK )
+        {
+            fprintf( fp, "{\"error\": \"%s\"}\n", strerror( result ) );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ListNodes                                                                 */
+/*!
+    List the connected nodes
+
+    @param[in]
+        fp
+            output stream to write the list to
+
+    @retval EOK - the nodes were listed
+
+==============================================================================*/
+static int ListNodes( FILE *fp )
+{
+    AggNode *pNode;
+    AggProcess *pProcess;
+    size_t count;
+    size_t running;
+
+    fprintf( fp, "%-24s %-24s %9s %9s %s\n",
+             "node", "address", "processes", "running", "since" );
+
+    for ( pNode = pNodes ; pNode != NULL ; pNode = pNode->pNext )
+    {
+        if ( pNode->name[0] != '\0' )
+        {
+            count = 0;
+            running = 0;
+
+            for ( pProcess = pNode->pProcesses ;
+                  pProcess != NULL ;
+                  pProcess = pProcess->pNext )
+            {
+                count++;
+                running += ( strcmp( pProcess->status, "running" ) == 0 );
+            }
+
+            fprintf( fp, "%-24s %-24s %9zu %9zu %ld\n",
+                     pNode->name,
+                     pNode->address,
+                     count,
+                     running,
+                     (long)pNode->connected );
+        }
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  ListProcesses                                                             */
+/*!
+    List the processes of all nodes
+
+    @param[in]
+        fp
+            output stream to write the list to
+
+    @param[in]
+        id
+            identifier of the process or replica group to list, or NULL
+            to list all processes
+
+    @retval EOK - the processes were listed
+
+==============================================================================*/
+static int ListProcesses( FILE *fp, const char *id )
+{
+    AggNode *pNode;
+    AggProcess *pProcess;
+
+    fprintf( fp, "%-24s %-24s %8s %8s %-8s %-9s %-12s %s\n",
+             "node", "id", "pid", "runcount", "status", "health", "exit",
+             "since" );
+
+    for ( pNode = pNodes ; pNode != NULL ; pNode = pNode->pNext )
+    {
+        for ( pProcess = pNode->pProcesses ;
+              pProcess != NULL ;
+              pProcess = pProcess->pNext )
+        {
+            if ( ( id == NULL ) || ( Matches( pProcess->id, id ) ) )
+            {
+                fprintf( fp, "%-24s %-24s %8d %8u %-8s %-9s %-12s %ld\n",
+                         pNode->name,
+                         pProcess->id,
+                         pProcess->pid,
+                         pProcess->runcount,
+                         pProcess->status,
+                         pProcess->health,
+                         pProcess->exit,
+                         (long)pProcess->since );
+            }
+        }
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  SendCommands                                                              */
+/*!
+    Send a command to a batch of nodes
+
+    The SendCommands function sends a command for a process to each node
+    named in the request, or to every node which runs the process if no
+    nodes are named.  The process may be a replica group, whose
+    instances the agents apply the command to.  The results are reported
+    by the agents asynchronously.
+
+    @param[in]
+        fp
+            output stream to write the nodes the command was sent to
+
+    @param[in]
+        command
+            restart, start, stop or delete
+
+    @param[in]
+        id
+            the process or replica group identifier
+
+    @param[in]
+        saveptr
+            pointer to the strtok_r state of the request, from which the
+            node names are read
+
+    @retval EOK - the command was sent to at least one node
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - there are no nodes to send the command to
+
+==============================================================================*/
+static int SendCommands( FILE *fp,
+                         const char *command,
+                         const char *id,
+                         char **saveptr )
+{
+    int result = EINVAL;
+    AggNode *pNode;
+    char *name;
+    size_t count = 0;
+    int rc;
+
+    if ( id != NULL )
+    {
+        name = strtok_r( NULL, " ", saveptr );
+        if ( name == NULL )
+        {
+            for ( pNode = pNodes ; pNode != NULL ; pNode = pNode->pNext )
+            {
+                if ( ( pNode->name[0] != '\0' ) &&
+                     ( CountProcesses( pNode, id ) > 0 ) )
+                {
+                    rc = SendCommand( pNode, command, id );
+                    fprintf( fp, "%s: %s\n",
+                             pNode->name,
+                             ( rc == EOK ) ? "sent" : strerror( rc ) );
+                    count++;
+                }
+            }
+        }
+
+        while ( name != NULL )
+        {
+            pNode = FindNode( name );
+            rc = ( pNode != NULL ) ? SendCommand( pNode, command, id )
+                                   : ENOTCONN;
+            fprintf( fp, "%s: %s\n",
+                     name,
+                     ( rc == EOK ) ? "sent" : strerror( rc ) );
+            count += ( rc == EOK );
+
+            name = strtok_r( NULL, " ", saveptr );
+        }
+
+        result = ( count > 0 ) ? EOK : ENOENT;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StartRollout                                                              */
+/*!
+    Start a rolling restart of a process
+
+    The StartRollout function starts restarting a process on every node
+    which runs it, on at most the specified number of nodes at a time.
+    The process may be a replica group, in which case each step restarts
+    all the instances of the group on a node.
+
+    @param[in]
+        fp
+            output stream to write the rollout number to
+
+    @param[in]
+        id
+            the process or replica group identifier
+
+    @param[in]
+        concurrency
+            maximum number of nodes restarting the process at a time
+
+    @retval EOK - the rollout was started
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - no connected node runs the process
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int StartRollout( FILE *fp, const char *id, const char *concurrency )
+{
+    int result = EINVAL;
+    Rollout *pRollout;
+    AggNode *pNode;
+    size_t count = 0;
+    long n;
+
+    n = ( concurrency != NULL ) ? strtol( concurrency, NULL, 10 ) : 1;
+    if ( ( id != NULL ) && ( strlen( id ) < AGGREGATOR_ID_LEN ) && ( n > 0 ) )
+    {
+        for ( pNode = pNodes ; pNode != NULL ; pNode = pNode->pNext )
+        {
+            count += ( ( pNode->name[0] != '\0' ) &&
+                       ( CountProcesses( pNode, id ) > 0 ) );
+        }
+
+        pRollout = ( count > 0 ) ? calloc( 1, sizeof( Rollout ) ) : NULL;
+        if ( pRollout != NULL )
+        {
+            pRollout->pSteps = calloc( count, sizeof( RolloutStep ) );
+        }
+
+        if ( count == 0 )
+        {
+            result = ENOENT;
+        }
+        else if ( ( pRollout == NULL ) || ( pRollout->pSteps == NULL ) )
+        {
+            free( pRollout );
+            result = ENOMEM;
+        }
+        else
+        {
+            pRollout->number = ++rolloutNumber;
+            strcpy( pRollout->id, id );
+            pRollout->concurrency = n;
+
+            for ( pNode = pNodes ; pNode != NULL ; pNode = pNode->pNext )
+            {
+                if ( ( pNode->name[0] != '\0' ) &&
+                     ( CountProcesses( pNode, id ) > 0 ) )
+                {
+                    strcpy( pRollout->pSteps[pRollout->count].node,
+                            pNode->name );
+                    pRollout->pSteps[pRollout->count].pRollout = pRollout;
+                    pRollout->count++;
+                }
+            }
+
+            pRollout->pNext = pRollouts;
+            pRollouts = pRollout;
+            PruneRollouts();
+
+            fprintf( fp, "rollout %u: restarting %s on %zu nodes\n",
+                     pRollout->number,
+                     id,
+                     pRollout->count );
+
+            AdvanceRollout( pRollout );
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ListRollouts                                                              */
+/*!
+    Display the progress of the rolling restarts
+
+    @param[in]
+        fp
+            output stream to write the progress to
+
+    @retval EOK - the rollouts were listed
+
+==============================================================================*/
+static int ListRollouts( FILE *fp )
+{
+    static const char *states[] = { "pending", "active", "done", "failed" };
+    Rollout *pRollout;
+    RolloutStep *pStep;
+    const char *status;
+    size_t i;
+
+    for ( pRollout = pRollouts ; pRollout != NULL ; pRollout = pRollout->pNext )
+    {
+        if ( pRollout->halted == true )
+        {
+            status = "halted";
+        }
+        else if ( pRollout->done == pRollout->count )
+        {
+            status = "complete";
+        }
+        else
+        {
+            status = "running";
+        }
+
+        fprintf( fp, "rollout %u: %s %s %zu/%zu\n",
+                 pRollout->number,
+                 pRollout->id,
+                 status,
+                 pRollout->done,
+                 pRollout->count );
+
+        for ( i = 0 ; i < pRollout->count ; i++ )
+        {
+            pStep = &pRollout->pSteps[i];
+            fprintf( fp, "    %-24s %s%s%s\n",
+                     pStep->node,
+                     states[pStep->state],
+                     ( pStep->reason != NULL ) ? ": " : "",
+                     ( pStep->reason != NULL ) ? pStep->reason : "" );
+        }
+    }
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  AdvanceRollout                                                            */
+/*!
+    Start the next steps of a rolling restart
+
+    The AdvanceRollout function sends the restart command to pending
+    nodes until the concurrency limit of the rollout is reached.  Each
+    step waits for every process of the node which matches the rollout
+    to be restarted.  A halted rollout does not start any more steps.
+
+    @param[in]
+        pRollout
+            pointer to the rollout
+
+==============================================================================*/
+static void AdvanceRollout( Rollout *pRollout )
+{
+    RolloutStep *pStep;
+    AggNode *pNode;
+
+    while ( ( pRollout->halted == false ) &&
+            ( pRollout->active < pRollout->concurrency ) &&
+            ( pRollout->next < pRollout->count ) )
+    {
+        pStep = &pRollout->pSteps[pRollout->next++];
+        pStep->state = STEP_ACTIVE;
+        pRollout->active++;
+
+        pNode = FindNode( pStep->node );
+        if ( pNode == NULL )
+        {
+            EndStep( pStep, "node disconnected" );
+        }
+        else if ( SendCommand( pNode, "restart", pRollout->id ) != EOK )
+        {
+            EndStep( pStep, "restart not sent" );
+        }
+        else
+        {
+            pStep->remaining = CountProcesses( pNode, pRollout->id );
+            EVENTLOOP_StartTimer( &pStep->timer,
+                                  AGGREGATOR_ROLLOUT_TIMEOUT,
+                                  StepTimeout,
+                                  pStep );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  CompleteStep                                                              */
+/*!
+    Complete the active rollout steps for a process on a node
+
+    The CompleteStep function fails the active steps of the rollouts of
+    the process, or of its replica group, on the node.  When the process
+    was restarted, the step is done once each of the processes of the
+    node which match the rollout has been restarted.
+
+    @param[in]
+        pNode
+            pointer to the node
+
+    @param[in]
+        id
+            the process or replica group identifier
+
+    @param[in]
+        reason
+            reason the steps failed, or NULL if the process was restarted
+
+==============================================================================*/
+static void CompleteStep( AggNode *pNode, const char *id, const char *reason )
+{
+    Rollout *pRollout;
+    RolloutStep *pStep;
+    AggProcess *pProcess = GetProcess( pNode, id, false );
+    size_t i;
+
+    for ( pRollout = pRollouts ; pRollout != NULL ; pRollout = pRollout->pNext )
+    {
+        if ( ( pRollout->active > 0 ) && ( Matches( id, pRollout->id ) ) )
+        {
+            for ( i = 0 ; i < pRollout->next ; i++ )
+            {
+                pStep = &pRollout->pSteps[i];
+                if ( ( pStep->state != STEP_ACTIVE ) ||
+                     ( strcmp( pStep->node, pNode->name ) != 0 ) )
+                {
+                    continue;
+                }
+
+                if ( ( reason == NULL ) &&
+                     ( pProcess != NULL ) &&
+                     ( pProcess->rollout != pRollout->number ) )
+                {
+                    /* count each process once per rollout */
+                    pProcess->rollout = pRollout->number;
+                    if ( pStep->remaining > 0 )
+                    {
+                        pStep->remaining--;
+                    }
+                }
+
+                if ( ( reason != NULL ) || ( pStep->remaining == 0 ) )
+                {
+                    EVENTLOOP_StopTimer( &pStep->timer );
+                    EndStep( pStep, reason );
+                    AdvanceRollout( pRollout );
+                }
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  EndStep                                                                   */
+/*!
+    End an active rollout step
+
+    The EndStep function marks a rollout step done, or failed, in which
+    case the rollout is halted.  The rollout is not advanced.
+
+    @param[in]
+        pStep
+            pointer to the active rollout step
+
+    @param[in]
+        reason
+            reason the step failed, or NULL if the process was restarted
+
+==============================================================================*/
+static void EndStep( RolloutStep *pStep, const char *reason )
+{
+    Rollout *pRollout = pStep->pRollout;
+
+    pRollout->active--;
+    pStep->reason = reason;
+
+    if ( reason == NULL )
+    {
+        pStep->state = STEP_DONE;
+        pRollout->done++;
+    }
+    else
+    {
+        pStep->state = STEP_FAILED;
+        if ( pRollout->halted == false )
+        {
+            printf( "rollout %u halted: %s on %s: %s\n",
+                    pRollout->number,
+                    pRollout->id,
+                    pStep->node,
+                    reason );
+            pRollout->halted = true;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  StepTimeout                                                               */
+/*!
+    Fail a rollout step which has not completed in time
+
+    @param[in]
+        arg
+            pointer to the rollout step
+
+==============================================================================*/
+static void StepTimeout( void *arg )
+{
+    RolloutStep *pStep = (RolloutStep *)arg;
+
+    if ( ( pStep != NULL ) && ( pStep->state == STEP_ACTIVE ) )
+    {
+        EndStep( pStep, "timed out" );
+    }
+}
+
+/*============================================================================*/
+/*  PruneRollouts                                                             */
+/*!
+    Discard the oldest finished rollouts
+
+    The PruneRollouts function discards finished rollouts beyond the
+    AGGREGATOR_MAX_ROLLOUTS most recent rollouts.  Rollouts with active
+    steps are kept until their steps end.
+
+==============================================================================*/
+static void PruneRollouts( void )
+{
+    Rollout **ppRollout = &pRollouts;
+    Rollout *pRollout;
+    size_t n = 0;
+
+    while ( *ppRollout != NULL )
+    {
+        pRollout = *ppRollout;
+        if ( ( ++n > AGGREGATOR_MAX_ROLLOUTS ) && ( pRollout->active == 0 ) )
+        {
+            *ppRollout = pRollout->pNext;
+            free( pRollout->pSteps );
+            free( pRollout );
+        }
+        else
+        {
+            ppRollout = &pRollout->pNext;
+        }
+    }
+}
+
+/*! @}
+ * end of aggregator group */
@@ -0,0 +1,349 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup arena arena
+ * @brief Arena memory allocation
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file arena.c
+
+    Arena Memory Allocation
+
+    The arena module allocates memory which shares a lifetime, such as
+    the data derived from a configuration, from large blocks.  Allocating
+    from an arena is a pointer increment, allocations are never freed
+    individually, and the whole arena is released at once, so the heap
+    is not fragmented by many small allocations of different lifetimes.
+
+    An arena is created with an estimate of the total size of its
+    allocations.  If the estimate is too small, further blocks are
+    added to the arena.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include "arena.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! alignment of the arena allocations */
+#define ARENA_ALIGN         ( sizeof( max_align_t ) )
+
+/*! minimum size (in bytes) of an arena block */
+#define ARENA_MIN_BLOCK     ( 4096 )
+
+/*! the ArenaBlock object is a block of memory which arena allocations
+ *  are carved from.  The allocations follow the block header */
+struct _arenaBlock
+{
+    /*! previously added block of the arena, or NULL */
+    struct _arenaBlock *pNext;
+
+    /*! number of bytes of the block which can be allocated */
+    size_t size;
+
+    /*! number of bytes of the block which have been allocated */
+    size_t used;
+
+    /*! start of the allocations */
+    max_align_t data[];
+};
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static ArenaBlock *AddBlock( Arena *pArena, size_t size );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  ARENA_Init                                                                */
+/*!
+    Create an arena
+
+    The ARENA_Init function creates an arena with a single block which
+    is large enough for the expected allocations.
+
+    @param[in]
+        pArena
+            pointer to the arena to create
+
+    @param[in]
+        size
+            expected total size (in bytes) of the arena allocations
+
+    @retval EOK - the arena was created
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int ARENA_Init( Arena *pArena, size_t size )
+{
+    int result = EINVAL;
+
+    if ( pArena != NULL )
+    {
+        memset( pArena, 0, sizeof( Arena ) );
+        pArena->blockSize = ( size > ARENA_MIN_BLOCK ) ? size
+                                                       : ARENA_MIN_BLOCK;
+
+        result = ( AddBlock( pArena, pArena->blockSize ) != NULL ) ? EOK
+                                                                   : ENOMEM;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ARENA_Alloc                                                               */
+/*!
+    Allocate memory from an arena
+
+    The ARENA_Alloc function allocates zeroed memory from the current
+    block of an arena.  A new block is added to the arena if the current
+    block is full.  The memory is released when the arena is freed.
+
+    @param[in]
+        pArena
+            pointer to the arena to allocate from
+
+    @param[in]
+        size
+            number of bytes to allocate
+
+    @retval pointer to the allocated memory
+    @retval NULL - memory allocation failure
+
+==============================================================================*/
+void *ARENA_Alloc( Arena *pArena, size_t size )
+{
+    ArenaBlock *pBlock;
+    void *p = NULL;
+
+    if ( pArena != NULL )
+    {
+        /* keep every allocation aligned for any type */
+        size = ( size + ARENA_ALIGN - 1 ) & ~( ARENA_ALIGN - 1 );
+
+        pBlock = pArena->pBlocks;
+        if ( ( pBlock == NULL ) || ( pBlock->size - pBlock->used < size ) )
+        {
+            pBlock = ( size > pArena->blockSize )
+                     ? AddBlock( pArena, size )
+                     : AddBlock( pArena, pArena->blockSize );
+        }
+
+        if ( pBlock != NULL )
+        {
+            p = (char *)pBlock->data + pBlock->used;
+            pBlock->used += size;
+            pArena->used += size;
+        }
+    }
+
+    return p;
+}
+
+/*============================================================================*/
+/*  ARENA_Strdup                                                              */
+/*!
+    Copy a string into an arena
+
+    @param[in]
+        pArena
+            pointer to the arena to allocate from
+
+    @param[in]
+        s
+            pointer to the string to copy, or NULL
+
+    @retval pointer to the copy of the string
+    @retval NULL - the string is NULL, or memory allocation failure
+
+==============================================================================*/
+char *ARENA_Strdup( Arena *pArena, const char *s )
+{
+    char *p = NULL;
+    size_t len;
+
+    if ( s != NULL )
+    {
+        len = strlen( s ) + 1;
+        p = ARENA_Alloc( pArena, len );
+        if ( p != NULL )
+        {
+            memcpy( p, s, len );
+        }
+    }
+
+    return p;
+}
+
+/*============================================================================*/
+/*  ARENA_Move                                                                */
+/*!
+    Move the blocks of one arena to another
+
+    The ARENA_Move function transfers the blocks of an arena to another
+    arena, so they are released when the other arena is freed.  The
+    source arena is left empty.
+
+    @param[in]
+        pTo
+            pointer to the arena to move the blocks to
+
+    @param[in]
+        pFrom
+            pointer to the arena to move the blocks from
+
+==============================================================================*/
+void ARENA_Move( Arena *pTo, Arena *pFrom )
+{
+    ArenaBlock *pBlock;
+
+    if ( ( pTo != NULL ) && ( pFrom != NULL ) && ( pFrom->pBlocks != NULL ) )
+    {
+        /* the blocks are added behind the current block of the
+         * destination, which is still used for its allocations */
+        pBlock = pFrom->pBlocks;
+        while ( pBlock->pNext != NULL )
+        {
+            pBlock = pBlock->pNext;
+        }
+
+        if ( pTo->pBlocks != NULL )
+        {
+            pBlock->pNext = pTo->pBlocks->pNext;
+            pTo->pBlocks->pNext = pFrom->pBlocks;
+        }
+        else
+        {
+            pTo->pBlocks = pFrom->pBlocks;
+            pTo->blockSize = pFrom->blockSize;
+        }
+
+        pTo->size += pFrom->size;
+        pTo->used += pFrom->used;
+
+        memset( pFrom, 0, sizeof( Arena ) );
+    }
+}
+
+/*============================================================================*/
+/*  ARENA_Free                                                                */
+/*!
+    Free an arena
+
+    The ARENA_Free function releases all of the memory allocated from
+    an arena.  The arena is left empty, and may be used again.
+
+    @param[in]
+        pArena
+            pointer to the arena to free
+
+==============================================================================*/
+void ARENA_Free( Arena *pArena )
+{
+    ArenaBlock *pBlock;
+    ArenaBlock *pNext;
+
+    if ( pArena != NULL )
+    {
+        for ( pBlock = pArena->pBlocks ; pBlock != NULL ; pBlock = pNext )
+        {
+            pNext = pBlock->pNext;
+            free( pBlock );
+        }
+
+        pArena->pBlocks = NULL;
+        pArena->size = 0;
+        pArena->used = 0;
+    }
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  AddBlock                                                                  */
+/*!
+    Add a block to an arena
+
+    The AddBlock function allocates a zeroed block and makes it the
+    current block of an arena.
+
+    @param[in]
+        pArena
+            pointer to the arena to add the block to
+
+    @param[in]
+        size
+            number of bytes which can be allocated from the block
+
+    @retval pointer to the new block
+    @retval NULL - memory allocation failure
+
+==============================================================================*/
+static ArenaBlock *AddBlock( Arena *pArena, size_t size )
+{
+    ArenaBlock *pBlock;
+
+    pBlock = calloc( 1, sizeof( ArenaBlock ) + size );
+    if ( pBlock != NULL )
+    {
+        pBlock->size = size;
+        pBlock->pNext = pArena->pBlocks;
+        pArena->pBlocks = pBlock;
+        pArena->size += size;
+    }
+
+    return pBlock;
+}
+
+/*! @}
+ * end of arena group */
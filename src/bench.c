@@ -0,0 +1,2232 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup bench bench
+ * @brief Process Monitor Benchmark
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file bench.c
+
+    Process Monitor Benchmark
+
+    The procmon-bench application measures how quickly the process monitor
+    starts a synthetic set of processes, and how quickly it detects the
+    death of a process and restarts it.
+
+    A configuration file is generated containing a dependency graph of
+    processes with the selected shape: a forest of trees with the
+    specified fan-out and depth, a single deep chain, a wide fan-out from
+    a single parent, layers of diamond dependencies, or a random DAG.
+    Each process is an instance of procmon-bench running in child mode,
+    which reports the time at which it was executed to the benchmark over
+    a datagram socket and then waits to be killed.
+
+    Once all of the processes are running, the benchmark kills processes
+    at a controlled rate and measures the time from the kill to:
+
+    - detect: the process monitor clearing the pid of the process in the
+      state table before forking its replacement
+    - fork: the pid of the replacement process appearing in the state table
+    - exec: the replacement process reporting that it is running
+
+    The detect and fork times are sampled by polling the state table,
+    so they are only as accurate as the polling interval.
+
+    When dependents are restarted with their parent, the benchmark also
+    measures the time until every dependent of the killed process has
+    been restarted ( subtree ), and checks that each of them was
+    restarted exactly once and that no other process was restarted.
+
+    In load mode the processes are not run.  The configuration is
+    compiled with procmon -c repeatedly to measure the time taken to load
+    and validate large graphs, which are not limited by the size of the
+    state table.  A graph containing a cycle must be rejected.
+
+    The memory usage, thread count and context switches of the primary
+    and backup process monitors are reported after startup and after
+    the restarts.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include "statetable.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! path of the report socket, formatted with the benchmark pid */
+#define BENCH_SOCKET_FMT        "/tmp/procmon-bench.%d.sock"
+
+/*! path of the generated configuration, formatted with the benchmark pid */
+#define BENCH_CONFIG_FMT        "/tmp/procmon-bench.%d.json"
+
+/*! suffix of the configuration cache compiled by the process monitor */
+#define BENCH_CACHE_SUFFIX      ".cache"
+
+/*! path of the control socket served by the primary process monitor */
+#define BENCH_CONTROL_SOCKET    "/tmp/procmon.sock"
+
+/*! prefix of the generated process identifiers */
+#define BENCH_ID_PREFIX         "bench"
+
+/*! state table polling interval in nanoseconds */
+#define BENCH_POLL_INTERVAL     ( 20000 )
+
+/*! time to wait for a process to be restarted in milliseconds */
+#define BENCH_RESTART_TIMEOUT   ( 10000 )
+
+/*! time to wait for all the processes to start in milliseconds,
+ *  in addition to the configured wait times */
+#define BENCH_STARTUP_TIMEOUT   ( 30000 )
+
+/*! time to wait for duplicate restarts after a restart in milliseconds */
+#define BENCH_SETTLE_TIME       ( 200 )
+
+/*! maximum number of processes generated in load mode */
+#define BENCH_MAX_PROCESSES     ( 100000 )
+
+/*! maximum number of parents of a generated process */
+#define BENCH_MAX_PARENTS       ( 8 )
+
+/*! number of times the configuration is compiled in load mode */
+#define BENCH_LOAD_RUNS         ( 10 )
+
+/*! seed of the random DAG generator, so the graphs are reproducible */
+#define BENCH_DAG_SEED          ( 1 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! the BenchShape enumeration selects the shape of the generated
+ *  dependency graph */
+typedef enum _benchShape
+{
+    /*! a forest of trees with the specified fan-out and depth */
+    BENCH_eFOREST,
+
+    /*! a single chain in which each process depends on the previous one */
+    BENCH_eCHAIN,
+
+    /*! a single parent which all of the other processes depend on */
+    BENCH_eFAN,
+
+    /*! layers of fan-out processes, each depending on two adjacent
+     *  processes of the previous layer */
+    BENCH_eDIAMOND,
+
+    /*! a random DAG in which each process depends on up to fan-out
+     *  earlier processes */
+    BENCH_eDAG,
+
+    /*! a chain whose first process depends on its last process */
+    BENCH_eCYCLE
+
+} BenchShape;
+
+/*! the BenchReport object is sent by each child process when it starts */
+typedef struct _benchReport
+{
+    /*! index of the process in the generated configuration */
+    uint32_t index;
+
+    /*! process identifier of the child */
+    pid_t pid;
+
+    /*! monotonic time (in nanoseconds) at which the child was executed */
+    int64_t time;
+
+} BenchReport;
+
+/*! the BenchProcess object tracks a single generated process */
+typedef struct _benchProcess
+{
+    /*! process identifier of the most recently reported instance */
+    pid_t pid;
+
+    /*! monotonic time (in nanoseconds) of the most recent report */
+    int64_t time;
+
+    /*! shared state of the process */
+    StateRecord *pRecord;
+
+    /*! number of times the process has reported that it is running */
+    uint32_t starts;
+
+    /*! number of reports before the most recent kill */
+    uint32_t base;
+
+    /*! indices of the processes this process depends on */
+    uint32_t parents[BENCH_MAX_PARENTS];
+
+    /*! number of processes this process depends on */
+    uint32_t nparents;
+
+    /*! indicates that the process should be restarted by the most
+     *  recent kill */
+    bool expected;
+
+} BenchProcess;
+
+/*! the BenchSamples object holds one latency measurement per kill */
+typedef struct _benchSamples
+{
+    /*! kill to pid cleared latencies in milliseconds */
+    double *pDetect;
+
+    /*! kill to new pid latencies in milliseconds */
+    double *pFork;
+
+    /*! kill to exec latencies in milliseconds */
+    double *pExec;
+
+    /*! kill to last dependent exec latencies in milliseconds */
+    double *pSubtree;
+
+    /*! number of samples */
+    size_t count;
+
+    /*! number of processes restarted by the kills */
+    size_t restarts;
+
+    /*! number of restarts which were duplicated or not expected */
+    size_t duplicates;
+
+} BenchSamples;
+
+/*! the BenchState object holds the benchmark options and state */
+typedef struct _benchState
+{
+    /*! number of processes to generate */
+    size_t n;
+
+    /*! shape of the dependency graph */
+    BenchShape shape;
+
+    /*! compile the configuration without running the processes */
+    bool load;
+
+    /*! number of children of each process */
+    size_t fanout;
+
+    /*! depth of each process tree */
+    size_t depth;
+
+    /*! wait time of each process in seconds */
+    int wait;
+
+    /*! number of processes to kill */
+    size_t kills;
+
+    /*! number of kills per second */
+    double rate;
+
+    /*! restart dependents when their parent is restarted */
+    bool restart_on_parent_death;
+
+    /*! keep a warm standby of each process */
+    bool standby;
+
+    /*! show the process monitor output */
+    bool verbose;
+
+    /*! path of the process monitor executable */
+    char *procmon;
+
+    /*! path of the benchmark executable */
+    char self[PATH_MAX];
+
+    /*! path of the report socket */
+    char socketPath[PATH_MAX];
+
+    /*! path of the generated configuration file */
+    char configPath[PATH_MAX];
+
+    /*! path of the configuration cache compiled by the process monitor */
+    char cachePath[PATH_MAX + sizeof( BENCH_CACHE_SUFFIX )];
+
+    /*! report socket */
+    int sock;
+
+    /*! process identifier of the primary process monitor */
+    pid_t procmonPid;
+
+    /*! generated processes */
+    BenchProcess *pProcesses;
+
+    /*! number of dependencies of the generated processes */
+    size_t edges;
+
+    /*! number of processes which have reported */
+    size_t reported;
+
+    /*! restart latency measurements */
+    BenchSamples samples;
+
+    /*! indicates that a correctness check of the benchmark failed */
+    bool failed;
+
+} BenchState;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+int main( int argC, char *argV[] );
+static void usage( char *cmdname );
+static int ProcessOptions( int argC, char *argV[], BenchState *pState );
+static int RunChild( char *path, char *index );
+static int CheckIdle( void );
+static int ParseShape( char *name, BenchShape *pShape );
+static char *ShapeName( BenchShape shape );
+static int GenerateConfig( BenchState *pState );
+static void GetParents( BenchState *pState, size_t i, unsigned int *pSeed );
+static void AddParent( BenchProcess *pProcess, size_t parent );
+static size_t GetParent( BenchState *pState, size_t i );
+static int LoadConfig( BenchState *pState );
+static int RunBenchmark( BenchState *pState );
+static int OpenSocket( BenchState *pState );
+static int StartProcmon( BenchState *pState );
+static int WaitStartup( BenchState *pState );
+static int RunKills( BenchState *pState );
+static int KillProcess( BenchState *pState, size_t i );
+static size_t MarkDependents( BenchState *pState, size_t i );
+static int WaitDependents( BenchState *pState, size_t i, int64_t start );
+static void CheckRestarts( BenchState *pState );
+static void CheckLocks( BenchState *pState );
+static void ReceiveReports( BenchState *pState );
+static int64_t GetTime( void );
+static void Sleep( int64_t ns );
+static void ReportLatency( BenchState *pState );
+static void ReportPercentiles( char *name, double *pValues, size_t n );
+static int CompareDouble( const void *a, const void *b );
+static void ReportProcmon( char *label, BenchState *pState );
+static void ReportProcess( char *label, pid_t pid );
+static pid_t GetBackupPid( BenchState *pState );
+static void Cleanup( BenchState *pState );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  main                                                                      */
+/*!
+    Main entry point for the procmon benchmark
+
+    The main function starts the procmon benchmark
+
+    @param[in]
+        argc
+            number of arguments on the command line
+            (including the command itself)
+
+    @param[in]
+        argv
+            array of pointers to the command line arguments
+
+    @return none
+
+==============================================================================*/
+int main( int argC, char *argV[] )
+{
+    BenchState state;
+    int result;
+
+    memset( &state, 0, sizeof( state ) );
+    state.n = 100;
+    state.fanout = 4;
+    state.depth = 3;
+    state.kills = 100;
+    state.rate = 10.0;
+    state.procmon = "procmon";
+    state.sock = -1;
+
+    if ( ( argC > 2 ) && ( strcmp( argV[1], "-c" ) == 0 ) )
+    {
+        /* run as a benchmark child process */
+        return RunChild( argV[2], ( argC > 3 ) ? argV[3] : NULL );
+    }
+
+    result = ProcessOptions( argC, argV, &state );
+    if ( ( result == EOK ) && ( state.load == false ) )
+    {
+        result = CheckIdle();
+        if ( result == EBUSY )
+        {
+            fprintf( stderr, "procmon is already running\n" );
+        }
+    }
+
+    if ( result == EOK )
+    {
+        result = GenerateConfig( &state );
+    }
+
+    if ( result == EOK )
+    {
+        result = ( state.load == true ) ? LoadConfig( &state )
+                                        : RunBenchmark( &state );
+    }
+
+    if ( result != EOK )
+    {
+        fprintf( stderr, "procmon-bench: %s\n", strerror( result ) );
+    }
+
+    Cleanup( &state );
+
+    return ( ( result == EOK ) && ( state.failed == false ) ) ? 0 : 1;
+}
+
+/*============================================================================*/
+/*  usage                                                                     */
+/*!
+    Display the application usage
+
+    The usage function dumps the application usage message
+    to stderr.
+
+    @param[in]
+       cmdname
+            pointer to the invoked command name
+
+    @return none
+
+==============================================================================*/
+static void usage( char *cmdname )
+{
+    if( cmdname != NULL )
+    {
+        fprintf(stderr,
+                "usage: %s [-v] [-h] [-R] [-S] [-l] [-G <shape>] [-n <count>]"
+                " [-F <fanout>] [-D <depth>] [-w <wait>] [-k <kills>]"
+                " [-r <rate>] [-p <procmon>]\n"
+                " [-h] : display this help\n"
+                " [-v] : show the process monitor output\n"
+                " [-R] : restart dependents when their parent restarts\n"
+                " [-S] : keep a warm standby of each process\n"
+                " [-l] : only load the configuration\n"
+                " [-G shape] : shape of the dependency graph, one of\n"
+                "              forest, chain, fan, diamond, dag or cycle\n"
+                "              ( default forest )\n"
+                " [-n count] : number of processes ( default 100 )\n"
+                " [-F fanout] : children of each process, the width of\n"
+                "               each diamond layer, or the maximum parents\n"
+                "               of each DAG process ( default 4 )\n"
+                " [-D depth] : depth of each process tree ( default 3 )\n"
+                " [-w wait] : wait time of each process ( default 0 )\n"
+                " [-k kills] : number of processes to kill ( default 100 )\n"
+                " [-r rate] : kills per second ( default 10 )\n"
+                " [-p procmon] : path of the procmon executable\n",
+                cmdname );
+    }
+}
+
+/*============================================================================*/
+/*  ProcessOptions                                                            */
+/*!
+    Process the command line options
+
+    The ProcessOptions function processes the command line options and
+    populates the BenchState object
+
+    @param[in]
+        argC
+            number of arguments
+            (including the command itself)
+
+    @param[in]
+        argv
+            array of pointers to the command line arguments
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - the options were processed
+    @retval EINVAL - invalid options
+
+============================================================================*/
+static int ProcessOptions( int argC, char *argV[], BenchState *pState )
+{
+    int c;
+    int result = EINVAL;
+    const char *options = "hvRSlG:n:F:D:w:k:r:p:";
+    ssize_t len;
+    size_t max;
+
+    if ( ( pState != NULL ) && ( argV != NULL ) )
+    {
+        result = EOK;
+
+        while( ( c = getopt( argC, argV, options ) ) != -1 )
+        {
+            switch( c )
+            {
+                case 'v':
+                    pState->verbose = true;
+                    break;
+
+                case 'R':
+                    pState->restart_on_parent_death = true;
+                    break;
+
+                case 'S':
+                    pState->standby = true;
+                    break;
+
+                case 'l':
+                    pState->load = true;
+                    break;
+
+                case 'G':
+                    if ( ParseShape( optarg, &pState->shape ) != EOK )
+                    {
+                        fprintf( stderr,
+                                 "procmon-bench: unknown shape %s\n",
+                                 optarg );
+                        result = EINVAL;
+                    }
+                    break;
+
+                case 'n':
+                    pState->n = strtoul( optarg, NULL, 0 );
+                    break;
+
+                case 'F':
+                    pState->fanout = strtoul( optarg, NULL, 0 );
+                    break;
+
+                case 'D':
+                    pState->depth = strtoul( optarg, NULL, 0 );
+                    break;
+
+                case 'w':
+                    pState->wait = atoi( optarg );
+                    break;
+
+                case 'k':
+                    pState->kills = strtoul( optarg, NULL, 0 );
+                    break;
+
+                case 'r':
+                    pState->rate = strtod( optarg, NULL );
+                    break;
+
+                case 'p':
+                    pState->procmon = optarg;
+                    break;
+
+                case 'h':
+                    usage( argV[0] );
+                    exit( 0 );
+                    break;
+
+                default:
+                    usage( argV[0] );
+                    result = EINVAL;
+                    break;
+            }
+        }
+
+        /* leave room in the state table for the process monitors */
+        max = ( pState->load == true ) ? BENCH_MAX_PROCESSES
+                                       : STATETABLE_MAX_ENTRIES - 2;
+        if ( ( pState->n == 0 ) ||
+             ( pState->n > max ) ||
+             ( pState->fanout == 0 ) ||
+             ( pState->depth == 0 ) ||
+             ( pState->wait < 0 ) ||
+             ( pState->rate <= 0.0 ) )
+        {
+            fprintf( stderr,
+                     "procmon-bench: count must be 1-%zu, fanout, depth "
+                     "and rate must be positive\n",
+                     max );
+            result = EINVAL;
+        }
+
+        if ( ( pState->shape == BENCH_eCYCLE ) && ( pState->load == false ) )
+        {
+            /* the processes of a cycle can never be started */
+            fprintf( stderr,
+                     "procmon-bench: a cycle can only be loaded ( -l )\n" );
+            result = EINVAL;
+        }
+
+        len = readlink( "/proc/self/exe",
+                        pState->self,
+                        sizeof( pState->self ) - 1 );
+        if ( len == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            pState->self[len] = '\0';
+        }
+
+        snprintf( pState->socketPath,
+                  sizeof( pState->socketPath ),
+                  BENCH_SOCKET_FMT,
+                  getpid() );
+
+        snprintf( pState->configPath,
+                  sizeof( pState->configPath ),
+                  BENCH_CONFIG_FMT,
+                  getpid() );
+
+        snprintf( pState->cachePath,
+                  sizeof( pState->cachePath ),
+                  "%s" BENCH_CACHE_SUFFIX,
+                  pState->configPath );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunChild                                                                  */
+/*!
+    Run as a benchmark child process
+
+    The RunChild function is invoked when procmon-bench is started by
+    the process monitor.  It reports the time at which it was executed
+    to the benchmark and waits to be killed.  A standby first waits on
+    its PROCMON_STANDBY_FD barrier, and reports the time at which it was
+    released, or exits if it is no longer required.
+
+    @param[in]
+        path
+            path of the benchmark report socket
+
+    @param[in]
+        index
+            index of the process in the generated configuration
+
+    @retval 0 - the standby is no longer required
+    @retval 1 - unable to report to the benchmark
+
+==============================================================================*/
+static int RunChild( char *path, char *index )
+{
+    struct sockaddr_un addr;
+    BenchReport report;
+    char *standby;
+    char buf[8];
+    int fd;
+
+    standby = getenv( "PROCMON_STANDBY_FD" );
+    if ( standby != NULL )
+    {
+        /* the barrier is released with data, or closed at end of file */
+        if ( read( atoi( standby ), buf, sizeof( buf ) ) <= 0 )
+        {
+            return 0;
+        }
+    }
+
+    report.time = GetTime();
+    report.pid = getpid();
+    report.index = ( index != NULL ) ? strtoul( index, NULL, 0 ) : 0;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+
+    fd = socket( AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+    if ( ( fd == -1 ) ||
+         ( sendto( fd,
+                   &report,
+                   sizeof( report ),
+                   0,
+                   (struct sockaddr *)&addr,
+                   sizeof( addr ) ) != sizeof( report ) ) )
+    {
+        return 1;
+    }
+
+    close( fd );
+
+    /* wait to be killed */
+    while ( 1 )
+    {
+        pause();
+    }
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  CheckIdle                                                                 */
+/*!
+    Check that no process monitor is running
+
+    The CheckIdle function opens the shared state table and checks that
+    no process monitor is running, since the benchmark shares the state
+    table, and replaces the state table when it finishes.
+
+    @retval EOK - no process monitor is running
+    @retval EBUSY - a process monitor is already running
+    @retval other - unable to open the state table
+
+==============================================================================*/
+static int CheckIdle( void )
+{
+    int result;
+    StateRecord *pRecord;
+    pid_t pid;
+    char *names[] = { "procmon1", "procmon2" };
+    size_t i;
+
+    result = STATETABLE_Open();
+    if ( result == EOK )
+    {
+        for ( i = 0; i < sizeof( names ) / sizeof( names[0] ); i++ )
+        {
+            pRecord = STATETABLE_Find( names[i] );
+            if ( pRecord != NULL )
+            {
+                pid = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
+                if ( ( pid > 0 ) && ( kill( pid, 0 ) == 0 ) )
+                {
+                    result = EBUSY;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ParseShape                                                                */
+/*!
+    Parse the name of a dependency graph shape
+
+    @param[in]
+        name
+            name of the shape
+
+    @param[out]
+        pShape
+            pointer to a location to store the shape
+
+    @retval EOK - the shape was parsed
+    @retval ENOENT - unknown shape
+
+==============================================================================*/
+static int ParseShape( char *name, BenchShape *pShape )
+{
+    int result = ENOENT;
+    BenchShape shape;
+
+    for ( shape = BENCH_eFOREST; shape <= BENCH_eCYCLE; shape++ )
+    {
+        if ( strcmp( name, ShapeName( shape ) ) == 0 )
+        {
+            *pShape = shape;
+            result = EOK;
+            break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ShapeName                                                                 */
+/*!
+    Get the name of a dependency graph shape
+
+    @param[in]
+        shape
+            shape of the dependency graph
+
+    @retval name of the shape
+
+==============================================================================*/
+static char *ShapeName( BenchShape shape )
+{
+    char *names[] = { "forest", "chain", "fan", "diamond", "dag", "cycle" };
+
+    return ( shape <= BENCH_eCYCLE ) ? names[shape] : "unknown";
+}
+
+/*============================================================================*/
+/*  GenerateConfig                                                            */
+/*!
+    Generate the benchmark configuration file
+
+    The GenerateConfig function writes a process configuration file
+    describing a dependency graph of monitored benchmark child processes
+    with the selected shape.  The processes are numbered so that every
+    process other than those of a cycle comes after its parents.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - the configuration file was generated
+    @retval ENOMEM - memory allocation failure
+    @retval other - unable to write the configuration file
+
+==============================================================================*/
+static int GenerateConfig( BenchState *pState )
+{
+    int result = EINVAL;
+    FILE *fp;
+    BenchProcess *pProcess;
+    unsigned int seed = BENCH_DAG_SEED;
+    size_t i;
+    uint32_t j;
+
+    if ( pState != NULL )
+    {
+        result = ENOMEM;
+        pState->pProcesses = calloc( pState->n, sizeof( BenchProcess ) );
+        pState->samples.pDetect = calloc( pState->kills + 1, sizeof( double ) );
+        pState->samples.pFork = calloc( pState->kills + 1, sizeof( double ) );
+        pState->samples.pExec = calloc( pState->kills + 1, sizeof( double ) );
+        pState->samples.pSubtree = calloc( pState->kills + 1,
+                                           sizeof( double ) );
+
+        if ( ( pState->pProcesses != NULL ) &&
+             ( pState->samples.pDetect != NULL ) &&
+             ( pState->samples.pFork != NULL ) &&
+             ( pState->samples.pExec != NULL ) &&
+             ( pState->samples.pSubtree != NULL ) )
+        {
+            result = EOK;
+
+            fp = fopen( pState->configPath, "w" );
+            if ( fp == NULL )
+            {
+                result = errno;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            fprintf( fp, "{\n    \"processes\":[\n" );
+
+            for ( i = 0; i < pState->n; i++ )
+            {
+                fprintf( fp,
+                         "        {\n"
+                         "            \"id\":\"" BENCH_ID_PREFIX "%zu\",\n"
+                         "            \"exec\":\"%s -c %s %zu\",\n"
+                         "            \"wait\":\"%d\",\n",
+                         i,
+                         pState->self,
+                         pState->socketPath,
+                         i,
+                         pState->wait );
+
+                pProcess = &pState->pProcesses[i];
+                GetParents( pState, i, &seed );
+                if ( pProcess->nparents > 0 )
+                {
+                    fprintf( fp, "            \"depends\":[" );
+                    for ( j = 0; j < pProcess->nparents; j++ )
+                    {
+                        fprintf( fp,
+                                 "%s\"" BENCH_ID_PREFIX "%u\"",
+                                 ( j > 0 ) ? "," : "",
+                                 pProcess->parents[j] );
+                    }
+
+                    fprintf( fp,
+                             "],\n"
+                             "            \"restart_on_parent_death\" : %s,\n",
+                             pState->restart_on_parent_death ? "true"
+                                                             : "false" );
+
+                    pState->edges += pProcess->nparents;
+                }
+
+                if ( pState->standby == true )
+                {
+                    fprintf( fp, "            \"standby\" : true,\n" );
+                }
+
+                fprintf( fp,
+                         "            \"monitored\" : true\n"
+                         "        }%s\n",
+                         ( i + 1 < pState->n ) ? "," : "" );
+            }
+
+            fprintf( fp, "    ]\n}\n" );
+
+            if ( fclose( fp ) != 0 )
+            {
+                result = errno;
+            }
+
+            printf( "Configuration: %s of %zu processes, %zu dependencies, "
+                    "fan-out %zu, depth %zu, wait %ds\n",
+                    ShapeName( pState->shape ),
+                    pState->n,
+                    pState->edges,
+                    pState->fanout,
+                    pState->depth,
+                    pState->wait );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetParents                                                                */
+/*!
+    Get the parents of a generated process
+
+    The GetParents function gets the indices of the processes which a
+    generated process depends on, according to the shape of the graph:
+
+    - forest: the parent in its tree ( see GetParent )
+    - chain: the previous process
+    - fan: the first process
+    - diamond: two adjacent processes of the previous layer, so that
+      each pair of adjacent processes in a layer share a parent
+    - dag: up to fan-out randomly selected earlier processes
+    - cycle: the previous process, with the first process depending on
+      the last one
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @param[in]
+        i
+            index of the process
+
+    @param[in,out]
+        pSeed
+            pointer to the state of the random DAG generator
+
+==============================================================================*/
+static void GetParents( BenchState *pState, size_t i, unsigned int *pSeed )
+{
+    BenchProcess *pProcess = &pState->pProcesses[i];
+    size_t width = pState->fanout;
+    size_t layer;
+    size_t n;
+    size_t k;
+
+    switch ( pState->shape )
+    {
+        case BENCH_eCHAIN:
+            if ( i > 0 )
+            {
+                AddParent( pProcess, i - 1 );
+            }
+            break;
+
+        case BENCH_eFAN:
+            if ( i > 0 )
+            {
+                AddParent( pProcess, 0 );
+            }
+            break;
+
+        case BENCH_eDIAMOND:
+            if ( i >= width )
+            {
+                layer = i - ( i % width ) - width;
+                AddParent( pProcess, layer + ( i % width ) );
+                AddParent( pProcess, layer + ( ( i + 1 ) % width ) );
+            }
+            break;
+
+        case BENCH_eDAG:
+            if ( i > 0 )
+            {
+                n = 1 + ( rand_r( pSeed ) % width );
+                for ( k = 0; k < n; k++ )
+                {
+                    AddParent( pProcess, rand_r( pSeed ) % i );
+                }
+            }
+            break;
+
+        case BENCH_eCYCLE:
+            AddParent( pProcess, ( i > 0 ) ? i - 1 : pState->n - 1 );
+            break;
+
+        case BENCH_eFOREST:
+        default:
+            k = GetParent( pState, i );
+            if ( k != i )
+            {
+                AddParent( pProcess, k );
+            }
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  AddParent                                                                 */
+/*!
+    Add a parent to a generated process
+
+    The AddParent function adds a process to the parents of a generated
+    process, unless it is already one of its parents or the process
+    already has BENCH_MAX_PARENTS parents.
+
+    @param[in]
+        pProcess
+            pointer to the generated process
+
+    @param[in]
+        parent
+            index of the parent process
+
+==============================================================================*/
+static void AddParent( BenchProcess *pProcess, size_t parent )
+{
+    uint32_t j;
+
+    for ( j = 0; j < pProcess->nparents; j++ )
+    {
+        if ( pProcess->parents[j] == parent )
+        {
+            break;
+        }
+    }
+
+    if ( ( j == pProcess->nparents ) && ( j < BENCH_MAX_PARENTS ) )
+    {
+        pProcess->parents[pProcess->nparents++] = (uint32_t)parent;
+    }
+}
+
+/*============================================================================*/
+/*  GetParent                                                                 */
+/*!
+    Get the parent of a generated process
+
+    The GetParent function gets the index of the parent of a generated
+    process.  Processes are numbered breadth first within each tree.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @param[in]
+        i
+            index of the process
+
+    @retval index of the parent of the process
+    @retval i - the process is the root of a tree
+
+==============================================================================*/
+static size_t GetParent( BenchState *pState, size_t i )
+{
+    size_t size = 0;
+    size_t level = 1;
+    size_t d;
+    size_t j;
+
+    /* calculate the number of processes in each tree */
+    for ( d = 0; ( d < pState->depth ) && ( size < pState->n ); d++ )
+    {
+        size += level;
+        level *= pState->fanout;
+    }
+
+    j = i % size;
+
+    return ( j == 0 ) ? i : ( i - j ) + ( j - 1 ) / pState->fanout;
+}
+
+/*============================================================================*/
+/*  LoadConfig                                                                */
+/*!
+    Measure the time taken to load the configuration
+
+    The LoadConfig function compiles the generated configuration with
+    procmon -c BENCH_LOAD_RUNS times, and reports the distribution of the
+    time taken to parse the configuration, build and validate its
+    dependency graph and write the configuration cache.  A configuration
+    containing a dependency cycle must be rejected.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - the configuration load was measured
+    @retval ENOEXEC - unable to execute the process monitor
+    @retval other - unable to run the process monitor
+
+==============================================================================*/
+static int LoadConfig( BenchState *pState )
+{
+    int result = EINVAL;
+    double times[BENCH_LOAD_RUNS];
+    int64_t start;
+    size_t n = 0;
+    pid_t pid;
+    int status;
+    int fd;
+    bool loaded = false;
+    bool valid;
+
+    if ( pState != NULL )
+    {
+        /* only a configuration without a cycle is valid */
+        valid = ( pState->shape != BENCH_eCYCLE );
+        result = EOK;
+
+        while ( ( result == EOK ) && ( n < BENCH_LOAD_RUNS ) )
+        {
+            start = GetTime();
+
+            pid = fork();
+            if ( pid == 0 )
+            {
+                if ( pState->verbose == false )
+                {
+                    fd = open( "/dev/null", O_WRONLY );
+                    if ( fd != -1 )
+                    {
+                        dup2( fd, STDOUT_FILENO );
+                        dup2( fd, STDERR_FILENO );
+                    }
+                }
+
+                execlp( pState->procmon,
+                        pState->procmon,
+                        "-c",
+                        pState->configPath,
+                        (char *)NULL );
+
+                _exit( 127 );
+            }
+            else if ( ( pid == -1 ) || ( waitpid( pid, &status, 0 ) == -1 ) )
+            {
+                result = errno;
+            }
+            else if ( WIFEXITED( status ) && ( WEXITSTATUS( status ) == 127 ) )
+            {
+                fprintf( stderr,
+                         "procmon-bench: failed to execute %s\n",
+                         pState->procmon );
+                result = ENOEXEC;
+            }
+            else
+            {
+                times[n++] = ( GetTime() - start ) / 1e6;
+                loaded = ( WIFEXITED( status ) &&
+                           ( WEXITSTATUS( status ) == EOK ) );
+                if ( loaded != valid )
+                {
+                    break;
+                }
+            }
+        }
+
+        if ( result == EOK )
+        {
+            printf( "Configuration load ( %zu runs, ms ):\n", n );
+            printf( "%-8s %9s %9s %9s %9s %9s %9s\n",
+                    "", "min", "mean", "p50", "p90", "p99", "max" );
+            ReportPercentiles( "load", times, n );
+
+            if ( pState->shape == BENCH_eCYCLE )
+            {
+                printf( "Dependency cycle: %s\n",
+                        loaded ? "not detected" : "rejected" );
+            }
+
+            if ( loaded != valid )
+            {
+                fprintf( stderr,
+                         "procmon-bench: the configuration was %s\n",
+                         loaded ? "accepted" : "rejected" );
+                pState->failed = true;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunBenchmark                                                              */
+/*!
+    Run the startup and restart benchmark
+
+    The RunBenchmark function starts the process monitor with the
+    generated configuration, waits for all of the processes to start,
+    and then kills processes to measure their restart latency.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - the benchmark was run
+    @retval other - the benchmark could not be run
+
+==============================================================================*/
+static int RunBenchmark( BenchState *pState )
+{
+    int result;
+
+    result = OpenSocket( pState );
+    if ( result == EOK )
+    {
+        result = StartProcmon( pState );
+    }
+
+    if ( result == EOK )
+    {
+        result = WaitStartup( pState );
+    }
+
+    if ( result == EOK )
+    {
+        ReportProcmon( "after startup", pState );
+
+        result = RunKills( pState );
+        ReportLatency( pState );
+        ReportProcmon( "after restarts", pState );
+        CheckLocks( pState );
+    }
+
+    if ( pState->samples.duplicates > 0 )
+    {
+        fprintf( stderr,
+                 "procmon-bench: %zu duplicate or unexpected restarts\n",
+                 pState->samples.duplicates );
+        pState->failed = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  OpenSocket                                                                */
+/*!
+    Open the benchmark report socket
+
+    The OpenSocket function creates the datagram socket on which the
+    benchmark child processes report that they are running.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - the socket was opened
+    @retval other - unable to open the socket
+
+==============================================================================*/
+static int OpenSocket( BenchState *pState )
+{
+    int result = EINVAL;
+    struct sockaddr_un addr;
+
+    if ( pState != NULL )
+    {
+        memset( &addr, 0, sizeof( addr ) );
+        addr.sun_family = AF_UNIX;
+        strncpy( addr.sun_path,
+                 pState->socketPath,
+                 sizeof( addr.sun_path ) - 1 );
+
+        unlink( pState->socketPath );
+
+        pState->sock = socket( AF_UNIX,
+                               SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                               0 );
+        if ( ( pState->sock != -1 ) &&
+             ( bind( pState->sock,
+                     (struct sockaddr *)&addr,
+                     sizeof( addr ) ) == 0 ) )
+        {
+            result = EOK;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StartProcmon                                                              */
+/*!
+    Start the process monitor
+
+    The StartProcmon function starts the primary process monitor using
+    the generated configuration file.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - the process monitor was started
+    @retval other - unable to start the process monitor
+
+==============================================================================*/
+static int StartProcmon( BenchState *pState )
+{
+    int result = EINVAL;
+    int fd;
+
+    if ( pState != NULL )
+    {
+        pState->procmonPid = fork();
+        if ( pState->procmonPid == 0 )
+        {
+            if ( pState->verbose == false )
+            {
+                fd = open( "/dev/null", O_WRONLY );
+                if ( fd != -1 )
+                {
+                    dup2( fd, STDOUT_FILENO );
+                    dup2( fd, STDERR_FILENO );
+                }
+            }
+
+            execlp( pState->procmon,
+                    pState->procmon,
+                    "-F",
+                    pState->configPath,
+                    (char *)NULL );
+
+            fprintf( stderr,
+                     "Failed to execute %s: %s\n",
+                     pState->procmon,
+                     strerror( errno ) );
+            _exit( 1 );
+        }
+
+        result = ( pState->procmonPid == -1 ) ? errno : EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WaitStartup                                                               */
+/*!
+    Wait for all the processes to start
+
+    The WaitStartup function waits for every generated process to report
+    that it is running, and reports the startup makespan.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - all the processes started
+    @retval ETIMEDOUT - not all the processes started in time
+    @retval ECHILD - the process monitor exited
+
+==============================================================================*/
+static int WaitStartup( BenchState *pState )
+{
+    int result = EINVAL;
+    int64_t start;
+    int64_t first = 0;
+    int64_t last = 0;
+    int64_t timeout;
+    size_t i;
+
+    if ( pState != NULL )
+    {
+        result = EOK;
+        start = GetTime();
+        timeout = ( (int64_t)BENCH_STARTUP_TIMEOUT +
+                    (int64_t)pState->wait * 1000 * pState->depth ) * 1000000;
+
+        while ( pState->reported < pState->n )
+        {
+            if ( GetTime() - start > timeout )
+            {
+                result = ETIMEDOUT;
+                break;
+            }
+
+            if ( waitpid( pState->procmonPid, NULL, WNOHANG ) > 0 )
+            {
+                pState->procmonPid = 0;
+                result = ECHILD;
+                break;
+            }
+
+            ReceiveReports( pState );
+            Sleep( 1000000 );
+        }
+
+        for ( i = 0; ( result == EOK ) && ( i < pState->n ); i++ )
+        {
+            if ( ( first == 0 ) || ( pState->pProcesses[i].time < first ) )
+            {
+                first = pState->pProcesses[i].time;
+            }
+
+            if ( pState->pProcesses[i].time > last )
+            {
+                last = pState->pProcesses[i].time;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            printf( "Startup makespan: %.1f ms ( first exec %.1f ms )\n",
+                    ( last - start ) / 1e6,
+                    ( first - start ) / 1e6 );
+        }
+        else
+        {
+            printf( "Startup: %zu of %zu processes started\n",
+                    pState->reported,
+                    pState->n );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunKills                                                                  */
+/*!
+    Kill processes at a controlled rate
+
+    The RunKills function kills randomly selected processes at the
+    configured rate, and measures how long the process monitor takes to
+    restart each one.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval EOK - all the kills were measured
+    @retval other - a process was not restarted
+
+==============================================================================*/
+static int RunKills( BenchState *pState )
+{
+    int result = EINVAL;
+    int64_t start;
+    int64_t next;
+    int64_t interval;
+    size_t k;
+    size_t i;
+    char id[STATETABLE_ID_LEN];
+
+    if ( pState != NULL )
+    {
+        result = EOK;
+
+        for ( i = 0; i < pState->n; i++ )
+        {
+            snprintf( id, sizeof( id ), BENCH_ID_PREFIX "%zu", i );
+            pState->pProcesses[i].pRecord = STATETABLE_Find( id );
+        }
+
+        srand( getpid() );
+        interval = (int64_t)( 1e9 / pState->rate );
+        start = GetTime();
+
+        for ( k = 0; ( k < pState->kills ) && ( result == EOK ); k++ )
+        {
+            result = KillProcess( pState, rand() % pState->n );
+
+            next = start + ( k + 1 ) * interval;
+            if ( next > GetTime() )
+            {
+                Sleep( next - GetTime() );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  KillProcess                                                               */
+/*!
+    Kill a process and measure its restart latency
+
+    The KillProcess function kills the specified process and polls the
+    state table until the process monitor has restarted it and the
+    replacement process has reported that it is running.  When
+    dependents are restarted with their parent, it then waits for all of
+    the dependents of the process to be restarted.  The restarts are
+    checked for duplicates once they have settled.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @param[in]
+        i
+            index of the process to kill
+
+    @retval EOK - the process was restarted
+    @retval ENOENT - the process is not in the state table
+    @retval ETIMEDOUT - the process or its dependents were not restarted
+                        in time
+
+==============================================================================*/
+static int KillProcess( BenchState *pState, size_t i )
+{
+    int result = ENOENT;
+    BenchProcess *pProcess = &pState->pProcesses[i];
+    BenchSamples *pSamples = &pState->samples;
+    int64_t start;
+    int64_t now;
+    int64_t detect = 0;
+    int64_t forked = 0;
+    pid_t old = pProcess->pid;
+    pid_t pid;
+
+    if ( pProcess->pRecord != NULL )
+    {
+        (void)MarkDependents( pState, i );
+
+        result = ETIMEDOUT;
+        start = GetTime();
+        kill( old, SIGKILL );
+
+        while ( ( now = GetTime() ) - start <
+                (int64_t)BENCH_RESTART_TIMEOUT * 1000000 )
+        {
+            pid = __atomic_load_n( &pProcess->pRecord->data.pid,
+                                   __ATOMIC_ACQUIRE );
+
+            if ( ( detect == 0 ) && ( pid != old ) )
+            {
+                detect = now;
+            }
+
+            if ( ( forked == 0 ) && ( pid > 0 ) && ( pid != old ) )
+            {
+                forked = now;
+            }
+
+            ReceiveReports( pState );
+            if ( pProcess->pid != old )
+            {
+                /* samples missed between polls happened before the exec */
+                forked = ( forked == 0 ) ? pProcess->time : forked;
+                detect = ( detect == 0 ) ? forked : detect;
+
+                pSamples->pDetect[pSamples->count] = ( detect - start ) / 1e6;
+                pSamples->pFork[pSamples->count] = ( forked - start ) / 1e6;
+                pSamples->pExec[pSamples->count] =
+                    ( pProcess->time - start ) / 1e6;
+                pSamples->count++;
+
+                result = EOK;
+                break;
+            }
+
+            Sleep( BENCH_POLL_INTERVAL );
+        }
+
+        if ( result == ETIMEDOUT )
+        {
+            fprintf( stderr,
+                     "procmon-bench: " BENCH_ID_PREFIX
+                     "%zu was not restarted\n",
+                     i );
+        }
+        else
+        {
+            result = WaitDependents( pState, i, start );
+            CheckRestarts( pState );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MarkDependents                                                            */
+/*!
+    Mark the processes which should be restarted by a kill
+
+    The MarkDependents function marks the killed process and, when
+    dependents are restarted with their parent, all of the processes
+    which depend on it directly or indirectly.  It also records the
+    number of reports of every process before the kill.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @param[in]
+        i
+            index of the process to kill
+
+    @retval number of processes which should be restarted
+
+==============================================================================*/
+static size_t MarkDependents( BenchState *pState, size_t i )
+{
+    BenchProcess *pProcess;
+    size_t count = 0;
+    size_t j;
+    uint32_t k;
+
+    for ( j = 0; j < pState->n; j++ )
+    {
+        pProcess = &pState->pProcesses[j];
+        pProcess->base = pProcess->starts;
+        pProcess->expected = ( j == i );
+
+        /* the parents of a process are generated before it, so they
+         * have already been marked */
+        for ( k = 0;
+              ( pState->restart_on_parent_death == true ) &&
+              ( j > i ) &&
+              ( pProcess->expected == false ) &&
+              ( k < pProcess->nparents ) ;
+              k++ )
+        {
+            pProcess->expected =
+                pState->pProcesses[pProcess->parents[k]].expected;
+        }
+
+        if ( pProcess->expected == true )
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  WaitDependents                                                            */
+/*!
+    Wait for the dependents of a killed process to be restarted
+
+    The WaitDependents function waits until every process marked by
+    MarkDependents has reported that it is running again, and records
+    the time from the kill until the last of them was executed.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @param[in]
+        i
+            index of the killed process
+
+    @param[in]
+        start
+            monotonic time (in nanoseconds) of the kill
+
+    @retval EOK - all of the dependents were restarted
+    @retval ETIMEDOUT - the dependents were not restarted in time
+
+==============================================================================*/
+static int WaitDependents( BenchState *pState, size_t i, int64_t start )
+{
+    int result = ETIMEDOUT;
+    BenchSamples *pSamples = &pState->samples;
+    BenchProcess *pProcess;
+    int64_t timeout;
+    int64_t last;
+    size_t pending;
+    size_t j;
+
+    /* each level of dependents waits for its parents to be ready */
+    timeout = ( (int64_t)BENCH_RESTART_TIMEOUT +
+                (int64_t)pState->wait * 1000 * pState->n ) * 1000000;
+
+    while ( GetTime() - start < timeout )
+    {
+        ReceiveReports( pState );
+
+        pending = 0;
+        last = start;
+        for ( j = 0; j < pState->n; j++ )
+        {
+            pProcess = &pState->pProcesses[j];
+            if ( pProcess->expected == true )
+            {
+                if ( pProcess->starts == pProcess->base )
+                {
+                    pending++;
+                }
+                else if ( pProcess->time > last )
+                {
+                    last = pProcess->time;
+                }
+            }
+        }
+
+        if ( pending == 0 )
+        {
+            pSamples->pSubtree[pSamples->count - 1] = ( last - start ) / 1e6;
+            result = EOK;
+            break;
+        }
+
+        Sleep( BENCH_POLL_INTERVAL );
+    }
+
+    if ( result == ETIMEDOUT )
+    {
+        fprintf( stderr,
+                 "procmon-bench: the dependents of " BENCH_ID_PREFIX "%zu "
+                 "were not restarted\n",
+                 i );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CheckRestarts                                                             */
+/*!
+    Check the restarts caused by a kill
+
+    The CheckRestarts function waits for any further restarts caused by
+    a kill, and then counts the restarts of each process.  Each process
+    marked by MarkDependents must have been restarted exactly once, and
+    no other process may have been restarted.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+==============================================================================*/
+static void CheckRestarts( BenchState *pState )
+{
+    BenchSamples *pSamples = &pState->samples;
+    BenchProcess *pProcess;
+    uint32_t restarts;
+    uint32_t expected;
+    size_t j;
+
+    Sleep( (int64_t)BENCH_SETTLE_TIME * 1000000 );
+    ReceiveReports( pState );
+
+    for ( j = 0; j < pState->n; j++ )
+    {
+        pProcess = &pState->pProcesses[j];
+        restarts = pProcess->starts - pProcess->base;
+        expected = ( pProcess->expected == true ) ? 1 : 0;
+
+        pSamples->restarts += restarts;
+        if ( restarts > expected )
+        {
+            if ( pState->verbose == true )
+            {
+                fprintf( stderr,
+                         "procmon-bench: " BENCH_ID_PREFIX "%zu was "
+                         "restarted %u times\n",
+                         j,
+                         restarts );
+            }
+
+            pSamples->duplicates += restarts - expected;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  CheckLocks                                                                */
+/*!
+    Check the process locks of the process monitors
+
+    The CheckLocks function checks that the primary process monitor has
+    not been replaced, and that the process state record of each running
+    process monitor is still locked after the restarts.  The backup takes
+    over a primary which has lost its lock.  Restarts which release a
+    standby close the lock handle of the standby, which must not release
+    the lock of the process monitor.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+==============================================================================*/
+static void CheckLocks( BenchState *pState )
+{
+    StateRecord *pRecord;
+    char *names[] = { "procmon1", "procmon2" };
+    pid_t pid;
+    size_t i;
+
+    for ( i = 0; i < sizeof( names ) / sizeof( names[0] ); i++ )
+    {
+        pRecord = STATETABLE_Find( names[i] );
+        pid = ( pRecord != NULL )
+              ? __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE )
+              : 0;
+
+        if ( ( i == 0 ) && ( pid != pState->procmonPid ) )
+        {
+            /* the backup takes over a primary which lost its lock */
+            fprintf( stderr,
+                     "procmon-bench: the primary process monitor was "
+                     "replaced by %d\n",
+                     pid );
+            pState->failed = true;
+        }
+        else if ( ( pid > 0 ) &&
+                  ( kill( pid, 0 ) == 0 ) &&
+                  ( STATETABLE_Lock( pRecord, F_GETLK ) != EAGAIN ) )
+        {
+            fprintf( stderr,
+                     "procmon-bench: %s (%d) does not hold its "
+                     "process lock\n",
+                     names[i],
+                     pid );
+            pState->failed = true;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  ReceiveReports                                                            */
+/*!
+    Receive the reports from the benchmark child processes
+
+    The ReceiveReports function receives all of the pending reports from
+    the benchmark child processes without blocking.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+==============================================================================*/
+static void ReceiveReports( BenchState *pState )
+{
+    BenchReport report;
+    BenchProcess *pProcess;
+
+    while ( recv( pState->sock, &report, sizeof( report ), 0 ) ==
+            sizeof( report ) )
+    {
+        if ( report.index < pState->n )
+        {
+            pProcess = &pState->pProcesses[report.index];
+            if ( pProcess->pid == 0 )
+            {
+                pState->reported++;
+            }
+
+            pProcess->starts++;
+            pProcess->pid = report.pid;
+            pProcess->time = report.time;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  GetTime                                                                   */
+/*!
+    Get the current monotonic time
+
+    The GetTime function gets the current monotonic time in nanoseconds.
+    The monotonic clock is shared by all processes, so times recorded
+    by the benchmark child processes can be compared directly.
+
+    @retval the current monotonic time in nanoseconds
+
+==============================================================================*/
+static int64_t GetTime( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*============================================================================*/
+/*  Sleep                                                                     */
+/*!
+    Sleep for the specified time
+
+    @param[in]
+        ns
+            time to sleep in nanoseconds
+
+==============================================================================*/
+static void Sleep( int64_t ns )
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+
+    while ( ( nanosleep( &ts, &ts ) == -1 ) && ( errno == EINTR ) );
+}
+
+/*============================================================================*/
+/*  ReportLatency                                                             */
+/*!
+    Report the restart latency percentiles
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+==============================================================================*/
+static void ReportLatency( BenchState *pState )
+{
+    BenchSamples *pSamples = &pState->samples;
+
+    printf( "Restart latency ( %zu kills at %.1f/s, ms ):\n",
+            pSamples->count,
+            pState->rate );
+
+    printf( "%-8s %9s %9s %9s %9s %9s %9s\n",
+            "", "min", "mean", "p50", "p90", "p99", "max" );
+
+    ReportPercentiles( "detect", pSamples->pDetect, pSamples->count );
+    ReportPercentiles( "fork", pSamples->pFork, pSamples->count );
+    ReportPercentiles( "exec", pSamples->pExec, pSamples->count );
+    if ( pState->restart_on_parent_death == true )
+    {
+        ReportPercentiles( "subtree", pSamples->pSubtree, pSamples->count );
+    }
+
+    printf( "Restarts: %zu processes restarted, %zu duplicates\n",
+            pSamples->restarts,
+            pSamples->duplicates );
+}
+
+/*============================================================================*/
+/*  ReportPercentiles                                                         */
+/*!
+    Report the distribution of a set of measurements
+
+    The ReportPercentiles function sorts the measurements and reports
+    their minimum, mean, 50th, 90th and 99th percentiles and maximum.
+
+    @param[in]
+        name
+            name of the measurement
+
+    @param[in]
+        pValues
+            pointer to the measurements
+
+    @param[in]
+        n
+            number of measurements
+
+==============================================================================*/
+static void ReportPercentiles( char *name, double *pValues, size_t n )
+{
+    double sum = 0.0;
+    size_t i;
+
+    if ( n > 0 )
+    {
+        qsort( pValues, n, sizeof( double ), CompareDouble );
+
+        for ( i = 0; i < n; i++ )
+        {
+            sum += pValues[i];
+        }
+
+        /* nearest rank percentiles */
+        printf( "%-8s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+                name,
+                pValues[0],
+                sum / n,
+                pValues[( n * 50 + 99 ) / 100 - 1],
+                pValues[( n * 90 + 99 ) / 100 - 1],
+                pValues[( n * 99 + 99 ) / 100 - 1],
+                pValues[n - 1] );
+    }
+}
+
+/*============================================================================*/
+/*  CompareDouble                                                             */
+/*!
+    Compare two measurements for qsort
+
+==============================================================================*/
+static int CompareDouble( const void *a, const void *b )
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return ( x > y ) - ( x < y );
+}
+
+/*============================================================================*/
+/*  ReportProcmon                                                             */
+/*!
+    Report the resource usage of the process monitors
+
+    @param[in]
+        label
+            description of when the resource usage was measured
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+==============================================================================*/
+static void ReportProcmon( char *label, BenchState *pState )
+{
+    printf( "Process monitor resource usage %s:\n", label );
+    printf( "%-8s %8s %10s %8s %10s %10s %10s\n",
+            "", "pid", "rss(kB)", "threads", "vctxsw", "nvctxsw", "cpu(ms)" );
+
+    ReportProcess( "primary", pState->procmonPid );
+    ReportProcess( "backup", GetBackupPid( pState ) );
+}
+
+/*============================================================================*/
+/*  ReportProcess                                                             */
+/*!
+    Report the resource usage of a process
+
+    The ReportProcess function reports the resident memory, thread
+    count, context switches and CPU time of a process from /proc.
+
+    @param[in]
+        label
+            name of the process
+
+    @param[in]
+        pid
+            process identifier of the process
+
+==============================================================================*/
+static void ReportProcess( char *label, pid_t pid )
+{
+    char path[64];
+    char line[256];
+    FILE *fp;
+    long rss = 0;
+    long threads = 0;
+    long vctxsw = 0;
+    long nvctxsw = 0;
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    char *p;
+
+    if ( pid > 0 )
+    {
+        snprintf( path, sizeof( path ), "/proc/%d/status", pid );
+        fp = fopen( path, "r" );
+        if ( fp != NULL )
+        {
+            while ( fgets( line, sizeof( line ), fp ) != NULL )
+            {
+                sscanf( line, "VmRSS: %ld", &rss );
+                sscanf( line, "Threads: %ld", &threads );
+                sscanf( line, "voluntary_ctxt_switches: %ld", &vctxsw );
+                sscanf( line, "nonvoluntary_ctxt_switches: %ld", &nvctxsw );
+            }
+
+            fclose( fp );
+        }
+
+        snprintf( path, sizeof( path ), "/proc/%d/stat", pid );
+        fp = fopen( path, "r" );
+        if ( fp != NULL )
+        {
+            /* skip past the command name, which may contain spaces */
+            if ( ( fgets( line, sizeof( line ), fp ) != NULL ) &&
+                 ( ( p = strrchr( line, ')' ) ) != NULL ) )
+            {
+                sscanf( p + 2,
+                        "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                        &utime,
+                        &stime );
+            }
+
+            fclose( fp );
+        }
+
+        printf( "%-8s %8d %10ld %8ld %10ld %10ld %10lu\n",
+                label,
+                pid,
+                rss,
+                threads,
+                vctxsw,
+                nvctxsw,
+                ( utime + stime ) * 1000 / sysconf( _SC_CLK_TCK ) );
+    }
+}
+
+/*============================================================================*/
+/*  GetBackupPid                                                              */
+/*!
+    Get the process identifier of the backup process monitor
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+    @retval process identifier of the backup process monitor
+    @retval 0 - the backup process monitor is not running
+
+==============================================================================*/
+static pid_t GetBackupPid( BenchState *pState )
+{
+    StateRecord *pRecord;
+    char *names[] = { "procmon1", "procmon2" };
+    pid_t pid = 0;
+    pid_t p;
+    size_t i;
+
+    for ( i = 0; i < sizeof( names ) / sizeof( names[0] ); i++ )
+    {
+        pRecord = STATETABLE_Find( names[i] );
+        if ( pRecord != NULL )
+        {
+            p = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
+            if ( ( p > 0 ) && ( p != pState->procmonPid ) )
+            {
+                pid = p;
+            }
+        }
+    }
+
+    return pid;
+}
+
+/*============================================================================*/
+/*  Cleanup                                                                   */
+/*!
+    Stop all the benchmark processes
+
+    The Cleanup function stops the process monitors and all of the
+    benchmark child processes, and removes the generated files and
+    the shared state table.
+
+    The process monitors are stopped before they are killed, so neither
+    can restart the other.
+
+    @param[in]
+        pState
+            pointer to the benchmark state object
+
+==============================================================================*/
+static void Cleanup( BenchState *pState )
+{
+    StateRecord *pRecord;
+    pid_t backup;
+    pid_t pid;
+    size_t i;
+
+    if ( pState->procmonPid > 0 )
+    {
+        backup = GetBackupPid( pState );
+
+        kill( pState->procmonPid, SIGSTOP );
+        if ( backup > 0 )
+        {
+            kill( backup, SIGSTOP );
+            kill( backup, SIGKILL );
+        }
+
+        kill( pState->procmonPid, SIGKILL );
+        waitpid( pState->procmonPid, NULL, 0 );
+
+        /* kill the children using the latest pids in the state table */
+        for ( i = 0; i < STATETABLE_Count(); i++ )
+        {
+            pRecord = STATETABLE_Get( i );
+            if ( ( pRecord != NULL ) &&
+                 ( strncmp( pRecord->id,
+                            BENCH_ID_PREFIX,
+                            strlen( BENCH_ID_PREFIX ) ) == 0 ) )
+            {
+                pid = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
+                if ( pid > 0 )
+                {
+                    kill( pid, SIGKILL );
+                }
+            }
+        }
+
+        shm_unlink( STATETABLE_NAME );
+        unlink( BENCH_CONTROL_SOCKET );
+    }
+
+    if ( pState->sock != -1 )
+    {
+        close( pState->sock );
+        unlink( pState->socketPath );
+    }
+
+    if ( pState->configPath[0] != '\0' )
+    {
+        unlink( pState->configPath );
+        unlink( pState->cachePath );
+    }
+
+    free( pState->pProcesses );
+    free( pState->samples.pDetect );
+    free( pState->samples.pFork );
+    free( pState->samples.pExec );
+    free( pState->samples.pSubtree );
+}
+
+/*! @}
+ * end of bench group */
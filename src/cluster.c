@@ -0,0 +1,1544 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup cluster cluster
+ * @brief Cluster agent
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file cluster.c
+
+    Cluster Agent
+
+    The cluster module connects the primary process monitor of a node to
+    a central aggregator, so the processes of a fleet of nodes can be
+    queried and controlled from one place.  The connection is made and
+    served from the process monitor event loop.
+
+    The agent and the aggregator exchange newline terminated text lines
+    of space separated fields.  They share a secret token, and prove
+    their knowledge of it to each other before any process state or
+    command is exchanged, without sending the token itself.  When an
+    agent connects, the aggregator sends a random challenge:
+
+    - challenge <aggregator nonce>
+
+    and the agent answers with its own challenge, and the HMAC-SHA256 of
+    "agent <node> <aggregator nonce> <agent nonce>" keyed with the token:
+
+    - hello <node> <agent nonce> <proof>
+
+    The aggregator closes the connection if the proof is wrong, and
+    otherwise answers with the HMAC-SHA256 of "aggregator <node>
+    <aggregator nonce> <agent nonce>":
+
+    - welcome <proof>
+
+    The agent drops the connection if the proof is wrong, and otherwise
+    sends a snapshot of the state of each of its processes:
+
+    - state <id> <pid> <runcount> <running|stopped|failed>
+
+    After the snapshot only changes are sent:
+
+    - start <id> <pid>
+    - restart <id> <pid> <restart latency in milliseconds>
+    - exit <id> code <exit code> | signal <signal> | unknown
+    - failed <id>
+    - health <id> healthy|unhealthy
+
+    The aggregator sends commands, which have the same effect as the
+    equivalent procmon command on the node:
+
+    - restart <id> ( procmon -r )
+    - start <id> ( procmon -s )
+    - stop <id> ( procmon -k )
+    - delete <id> ( procmon -d )
+
+    and the agent answers each command with:
+
+    - result <command> <id> <errno>
+
+    Messages are queued while the connection is busy.  If the aggregator
+    falls too far behind, the agent drops the connection rather than
+    losing changes, and sends a new snapshot when it reconnects.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/random.h>
+#include "eventloop.h"
+#include "cluster.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! maximum length of an aggregator address */
+#define CLUSTER_ADDRESS_LEN     ( 256 )
+
+/*! size of a SHA-256 block */
+#define SHA256_BLOCK_LEN        ( 64 )
+
+/*! size of a SHA-256 digest */
+#define SHA256_DIGEST_LEN       ( 32 )
+
+/*! maximum length of the message authenticated by a proof */
+#define CLUSTER_PROOF_MSG_LEN   ( 192 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! the Sha256 object holds the state of a SHA-256 digest calculation */
+typedef struct _sha256
+{
+    /*! intermediate hash value */
+    uint32_t h[8];
+
+    /*! partial block waiting to be processed */
+    uint8_t block[SHA256_BLOCK_LEN];
+
+    /*! number of bytes in the partial block */
+    size_t len;
+
+    /*! total number of bytes processed */
+    uint64_t total;
+
+} Sha256;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int ResolveAddress( ClusterAgent *pAgent, const char *address );
+static void Reconnect( void *arg );
+static int Open( ClusterAgent *pAgent );
+static void HandleAgent( EventSource *pSource, uint32_t events );
+static void Connected( ClusterAgent *pAgent );
+static int ReceiveCommands( ClusterAgent *pAgent );
+static void HandleCommand( ClusterAgent *pAgent, char *line );
+static int Authenticate( ClusterAgent *pAgent,
+                         const char *type,
+                         const char *value );
+static int Queue( ClusterAgent *pAgent, const char *format, ... );
+static int QueueLine( ClusterAgent *pAgent,
+                      const char *format,
+                      va_list args );
+static int Flush( ClusterAgent *pAgent );
+static void Drop( ClusterAgent *pAgent, bool reconnect );
+static void Sha256Init( Sha256 *pCtx );
+static void Sha256Update( Sha256 *pCtx, const void *data, size_t len );
+static void Sha256Final( Sha256 *pCtx, uint8_t *digest );
+static void Sha256Block( Sha256 *pCtx, const uint8_t *block );
+static void HmacSha256( const char *key,
+                        const char *msg,
+                        size_t len,
+                        uint8_t *digest );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  CLUSTER_Connect                                                           */
+/*!
+    Connect to the cluster aggregator
+
+    The CLUSTER_Connect function resolves the address of the aggregator
+    and starts connecting to it.  The agent keeps reconnecting, with an
+    increasing delay, whenever it cannot connect or the connection is
+    lost.
+
+    @param[in]
+        pAgent
+            pointer to the agent to connect
+
+    @param[in]
+        address
+            address of the aggregator: <host>:<port> or
+            [<IPv6 address>]:<port>
+
+    @param[in]
+        node
+            name of this node
+
+    @param[in]
+        token
+            shared secret of the cluster
+
+    @param[in]
+        handler
+            handler for the commands sent by the aggregator
+
+    @param[in]
+        snapshot
+            handler which sends the state of each process when the agent
+            has connected
+
+    @param[in]
+        arg
+            opaque argument passed to the handlers
+
+    @retval EOK - the agent is connecting to the aggregator
+    @retval EINVAL - invalid arguments or aggregator address
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int CLUSTER_Connect( ClusterAgent *pAgent,
+                     const char *address,
+                     const char *node,
+                     const char *token,
+                     ClusterCommandHandler handler,
+                     ClusterSnapshotHandler snapshot,
+                     void *arg )
+{
+    int result = EINVAL;
+
+    if ( ( pAgent != NULL ) &&
+         ( address != NULL ) &&
+         ( node != NULL ) &&
+         ( *node != '\0' ) &&
+         ( strlen( node ) < sizeof( pAgent->node ) ) &&
+         ( strpbrk( node, " \t\r\n" ) == NULL ) &&
+         ( token != NULL ) &&
+         ( *token != '\0' ) &&
+         ( strlen( token ) < sizeof( pAgent->token ) ) &&
+         ( handler != NULL ) &&
+         ( snapshot != NULL ) )
+    {
+        memset( pAgent, 0, sizeof( ClusterAgent ) );
+        pAgent->source.fd = -1;
+
+        result = ResolveAddress( pAgent, address );
+        if ( result == EOK )
+        {
+            pAgent->pOut = malloc( CLUSTER_SEND_BUFFER );
+            if ( pAgent->pOut != NULL )
+            {
+                strcpy( pAgent->node, node );
+                strcpy( pAgent->token, token );
+                pAgent->handler = handler;
+                pAgent->snapshot = snapshot;
+                pAgent->arg = arg;
+                pAgent->backoff = CLUSTER_RECONNECT_MIN;
+
+                Reconnect( pAgent );
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CLUSTER_Send                                                              */
+/*!
+    Send a message to the cluster aggregator
+
+    The CLUSTER_Send function formats a message line and queues it to
+    be sent to the aggregator.  Messages are discarded while the agent
+    is not connected and authenticated, since the aggregator receives a
+    new snapshot when the agent reconnects.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @param[in]
+        format
+            printf format of the message, without its newline
+
+    @retval EOK - the message was queued
+    @retval EINVAL - invalid arguments or message
+    @retval ENOTCONN - the agent is not connected and authenticated
+    @retval ENOBUFS - the aggregator has fallen too far behind, and the
+                      connection has been dropped
+
+==============================================================================*/
+int CLUSTER_Send( ClusterAgent *pAgent, const char *format, ... )
+{
+    int result = EINVAL;
+    va_list args;
+
+    if ( ( pAgent != NULL ) && ( format != NULL ) )
+    {
+        if ( pAgent->authenticated == false )
+        {
+            result = ENOTCONN;
+        }
+        else
+        {
+            va_start( args, format );
+            result = QueueLine( pAgent, format, args );
+            va_end( args );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CLUSTER_Disconnect                                                        */
+/*!
+    Disconnect from the cluster aggregator
+
+    The CLUSTER_Disconnect function closes the connection to the
+    aggregator, stops reconnecting, and releases the agent resources.
+
+    @param[in]
+        pAgent
+            pointer to the agent to disconnect
+
+==============================================================================*/
+void CLUSTER_Disconnect( ClusterAgent *pAgent )
+{
+    if ( pAgent != NULL )
+    {
+        EVENTLOOP_StopTimer( &pAgent->reconnectTimer );
+        Drop( pAgent, false );
+
+        free( pAgent->pOut );
+        pAgent->pOut = NULL;
+
+        memset( pAgent->token, 0, sizeof( pAgent->token ) );
+    }
+}
+
+/*============================================================================*/
+/*  CLUSTER_ReadToken                                                         */
+/*!
+    Read the cluster token from a file
+
+    The CLUSTER_ReadToken function reads the shared secret of the cluster
+    from the first line of a file.  The file should only be readable by
+    the user the process monitor runs as.
+
+    @param[in]
+        path
+            path of the token file
+
+    @param[out]
+        token
+            pointer to the buffer to store the token in
+
+    @param[in]
+        len
+            size of the token buffer
+
+    @retval EOK - the token was read
+    @retval EINVAL - invalid arguments, or the token is empty or too long
+    @retval other - error from fopen or fgets
+
+==============================================================================*/
+int CLUSTER_ReadToken( const char *path, char *token, size_t len )
+{
+    int result = EINVAL;
+    FILE *fp;
+    size_t n;
+
+    if ( ( path != NULL ) && ( token != NULL ) && ( len > 1 ) )
+    {
+        fp = fopen( path, "r" );
+        if ( fp == NULL )
+        {
+            result = errno;
+        }
+        else
+        {
+            if ( fgets( token, len, fp ) == NULL )
+            {
+                result = ferror( fp ) ? EIO : EINVAL;
+            }
+            else
+            {
+                n = strcspn( token, "\r\n" );
+                if ( ( n > 0 ) && ( ( n < len - 1 ) || feof( fp ) ) )
+                {
+                    token[n] = '\0';
+                    result = EOK;
+                }
+            }
+
+            fclose( fp );
+        }
+
+        if ( result != EOK )
+        {
+            memset( token, 0, len );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CLUSTER_MakeNonce                                                         */
+/*!
+    Make a random challenge
+
+    The CLUSTER_MakeNonce function makes a random challenge of 16 bytes
+    from the kernel random number generator, hex encoded.
+
+    @param[out]
+        nonce
+            pointer to a buffer of CLUSTER_NONCE_LEN bytes to store the
+            challenge in
+
+    @retval EOK - the challenge was made
+    @retval EINVAL - invalid arguments
+    @retval other - error from getrandom
+
+==============================================================================*/
+int CLUSTER_MakeNonce( char *nonce )
+{
+    int result = EINVAL;
+    uint8_t bytes[( CLUSTER_NONCE_LEN - 1 ) / 2];
+    size_t i;
+
+    if ( nonce != NULL )
+    {
+        if ( getrandom( bytes, sizeof( bytes ), 0 ) != sizeof( bytes ) )
+        {
+            result = errno;
+        }
+        else
+        {
+            for ( i = 0 ; i < sizeof( bytes ) ; i++ )
+            {
+                sprintf( &nonce[i * 2], "%02x", bytes[i] );
+            }
+
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CLUSTER_MakeProof                                                         */
+/*!
+    Make a proof of the knowledge of the cluster token
+
+    The CLUSTER_MakeProof function calculates the hex encoded
+    HMAC-SHA256 of "<role> <node> <challenge> <nonce>" keyed with the
+    cluster token.  The role prevents a proof made by one side from
+    being replayed by the other.
+
+    @param[in]
+        token
+            shared secret of the cluster
+
+    @param[in]
+        role
+            agent or aggregator
+
+    @param[in]
+        node
+            name of the node
+
+    @param[in]
+        challenge
+            challenge sent by the aggregator
+
+    @param[in]
+        nonce
+            challenge sent by the agent
+
+    @param[out]
+        proof
+            pointer to a buffer of CLUSTER_PROOF_LEN bytes to store the
+            proof in
+
+==============================================================================*/
+void CLUSTER_MakeProof( const char *token,
+                        const char *role,
+                        const char *node,
+                        const char *challenge,
+                        const char *nonce,
+                        char *proof )
+{
+    char msg[CLUSTER_PROOF_MSG_LEN];
+    uint8_t digest[SHA256_DIGEST_LEN];
+    int len;
+    size_t i;
+
+    if ( proof != NULL )
+    {
+        *proof = '\0';
+    }
+
+    if ( ( token != NULL ) &&
+         ( role != NULL ) &&
+         ( node != NULL ) &&
+         ( challenge != NULL ) &&
+         ( nonce != NULL ) &&
+         ( proof != NULL ) )
+    {
+        len = snprintf( msg,
+                        sizeof( msg ),
+                        "%s %s %s %s",
+                        role,
+                        node,
+                        challenge,
+                        nonce );
+        if ( ( len > 0 ) && ( (size_t)len < sizeof( msg ) ) )
+        {
+            HmacSha256( token, msg, len, digest );
+
+            for ( i = 0 ; i < sizeof( digest ) ; i++ )
+            {
+                sprintf( &proof[i * 2], "%02x", digest[i] );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  CLUSTER_CheckProof                                                        */
+/*!
+    Check a proof of the knowledge of the cluster token
+
+    The CLUSTER_CheckProof function compares a proof received from the
+    peer with the expected proof, in constant time so the comparison
+    does not reveal how much of the proof was correct.
+
+    @param[in]
+        token
+            shared secret of the cluster
+
+    @param[in]
+        role
+            role of the peer: agent or aggregator
+
+    @param[in]
+        node
+            name of the node
+
+    @param[in]
+        challenge
+            challenge sent by the aggregator
+
+    @param[in]
+        nonce
+            challenge sent by the agent
+
+    @param[in]
+        proof
+            proof received from the peer
+
+    @retval true - the proof is correct
+    @retval false - the proof is wrong
+
+==============================================================================*/
+bool CLUSTER_CheckProof( const char *token,
+                         const char *role,
+                         const char *node,
+                         const char *challenge,
+                         const char *nonce,
+                         const char *proof )
+{
+    bool result = false;
+    char expected[CLUSTER_PROOF_LEN];
+    uint8_t diff = 0;
+    size_t i;
+
+    if ( ( proof != NULL ) && ( strlen( proof ) == CLUSTER_PROOF_LEN - 1 ) )
+    {
+        CLUSTER_MakeProof( token, role, node, challenge, nonce, expected );
+        if ( expected[0] != '\0' )
+        {
+            for ( i = 0 ; i < CLUSTER_PROOF_LEN - 1 ; i++ )
+            {
+                diff |= expected[i] ^ proof[i];
+            }
+
+            result = ( diff == 0 );
+        }
+    }
+
+    return result;
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  ResolveAddress                                                            */
+/*!
+    Resolve the address of the aggregator
+
+    @param[in]
+        pAgent
+            pointer to the agent to store the address in
+
+    @param[in]
+        address
+            address of the aggregator: <host>:<port> or
+            [<IPv6 address>]:<port>
+
+    @retval EOK - the address was resolved
+    @retval EINVAL - invalid address
+
+==============================================================================*/
+static int ResolveAddress( ClusterAgent *pAgent, const char *address )
+{
+    int result = EINVAL;
+    char buf[CLUSTER_ADDRESS_LEN];
+    struct addrinfo hints;
+    struct addrinfo *pInfo = NULL;
+    char *host = buf;
+    char *port = NULL;
+    char *p;
+
+    if ( strlen( address ) < sizeof( buf ) )
+    {
+        strcpy( buf, address );
+
+        if ( buf[0] == '[' )
+        {
+            /* IPv6 address */
+            p = strchr( buf, ']' );
+            if ( ( p != NULL ) && ( p[1] == ':' ) )
+            {
+                *p = '\0';
+                host = &buf[1];
+                port = &p[2];
+            }
+        }
+        else if ( ( p = strrchr( buf, ':' ) ) != NULL )
+        {
+            *p = '\0';
+            port = &p[1];
+        }
+
+        memset( &hints, 0, sizeof( hints ) );
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICSERV;
+
+        if ( ( *host != '\0' ) &&
+             ( port != NULL ) &&
+             ( *port != '\0' ) &&
+             ( getaddrinfo( host, port, &hints, &pInfo ) == 0 ) )
+        {
+            if ( pInfo->ai_addrlen <= sizeof( pAgent->addr ) )
+            {
+                memcpy( &pAgent->addr, pInfo->ai_addr, pInfo->ai_addrlen );
+                pAgent->addrlen = pInfo->ai_addrlen;
+                result = EOK;
+            }
+
+            freeaddrinfo( pInfo );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Reconnect                                                                 */
+/*!
+    Connect to the aggregator
+
+    The Reconnect function starts connecting to the aggregator.  If the
+    connection cannot be started, it is tried again after a delay which
+    doubles with each attempt up to CLUSTER_RECONNECT_MAX.
+
+    @param[in]
+        arg
+            pointer to the agent
+
+==============================================================================*/
+static void Reconnect( void *arg )
+{
+    ClusterAgent *pAgent = (ClusterAgent *)arg;
+
+    if ( ( pAgent != NULL ) && ( Open( pAgent ) != EOK ) )
+    {
+        Drop( pAgent, true );
+    }
+}
+
+/*============================================================================*/
+/*  Open                                                                      */
+/*!
+    Start a connection to the aggregator
+
+    The Open function starts a non-blocking connection to the aggregator,
+    and watches it for its completion.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @retval EOK - the connection was started
+    @retval other - error from socket, connect or epoll_ctl
+
+==============================================================================*/
+static int Open( ClusterAgent *pAgent )
+{
+    int result = EOK;
+    int fd;
+
+    fd = socket( pAgent->addr.ss_family,
+                 SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                 0 );
+    if ( fd == -1 )
+    {
+        result = errno;
+    }
+    else
+    {
+        pAgent->source.fd = fd;
+        pAgent->source.handler = HandleAgent;
+        pAgent->source.arg = pAgent;
+        pAgent->connecting = true;
+        pAgent->authenticated = false;
+        pAgent->challenge[0] = '\0';
+        pAgent->blocked = false;
+        pAgent->outLen = 0;
+        pAgent->inLen = 0;
+
+        if ( ( connect( fd,
+                        (struct sockaddr *)&pAgent->addr,
+                        pAgent->addrlen ) == -1 ) &&
+             ( errno != EINPROGRESS ) )
+        {
+            result = errno;
+        }
+        else
+        {
+            result = EVENTLOOP_Add( &pAgent->source, EPOLLOUT );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleAgent                                                               */
+/*!
+    Handle the connection to the aggregator
+
+    The HandleAgent function is invoked from the event loop when the
+    connection to the aggregator has been established or has failed,
+    when commands have been received, or when queued messages can be
+    sent.
+
+    @param[in]
+        pSource
+            pointer to the connection event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleAgent( EventSource *pSource, uint32_t events )
+{
+    ClusterAgent *pAgent;
+    int error = 0;
+    socklen_t len = sizeof( error );
+    int result = EOK;
+
+    if ( ( pSource != NULL ) && ( pSource->arg != NULL ) )
+    {
+        pAgent = (ClusterAgent *)pSource->arg;
+
+        if ( pAgent->connecting == true )
+        {
+            if ( ( getsockopt( pSource->fd,
+                               SOL_SOCKET,
+                               SO_ERROR,
+                               &error,
+                               &len ) == -1 ) ||
+                 ( error != 0 ) )
+            {
+                result = ECONNREFUSED;
+            }
+            else
+            {
+                Connected( pAgent );
+            }
+        }
+        else
+        {
+            if ( events & EPOLLIN )
+            {
+                result = ReceiveCommands( pAgent );
+            }
+
+            if ( ( result == EOK ) && ( events & EPOLLOUT ) )
+            {
+                result = Flush( pAgent );
+            }
+
+            if ( ( result == EOK ) && ( events & ( EPOLLERR | EPOLLHUP ) ) )
+            {
+                result = ECONNRESET;
+            }
+        }
+
+        if ( ( result != EOK ) && ( pAgent->source.fd != -1 ) )
+        {
+            Drop( pAgent, true );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Connected                                                                 */
+/*!
+    Start a session with the aggregator
+
+    The Connected function is invoked once the connection to the
+    aggregator has been established, and waits for the challenge of the
+    aggregator.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+==============================================================================*/
+static void Connected( ClusterAgent *pAgent )
+{
+    pAgent->connecting = false;
+    pAgent->connected = true;
+
+    /* wait for the challenge, and only for the connection to become
+     * writable when messages are queued */
+    EVENTLOOP_Remove( &pAgent->source );
+    if ( EVENTLOOP_Add( &pAgent->source, EPOLLIN ) != EOK )
+    {
+        Drop( pAgent, true );
+    }
+}
+
+/*============================================================================*/
+/*  ReceiveCommands                                                           */
+/*!
+    Receive commands from the aggregator
+
+    The ReceiveCommands function reads the available data from the
+    aggregator, and handles each complete command line.  An over-long
+    line is discarded.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @retval EOK - the commands were received
+    @retval ECONNRESET - the aggregator closed the connection
+    @retval other - error from read
+
+==============================================================================*/
+static int ReceiveCommands( ClusterAgent *pAgent )
+{
+    int result = EOK;
+    char *line;
+    char *p;
+    ssize_t n;
+
+    n = read( pAgent->source.fd,
+              &pAgent->in[pAgent->inLen],
+              sizeof( pAgent->in ) - pAgent->inLen - 1 );
+    if ( n > 0 )
+    {
+        pAgent->inLen += n;
+        pAgent->in[pAgent->inLen] = '\0';
+
+        line = pAgent->in;
+        while ( ( pAgent->connected == true ) &&
+                ( ( p = strchr( line, '\n' ) ) != NULL ) )
+        {
+            *p = '\0';
+            HandleCommand( pAgent, line );
+            line = &p[1];
+        }
+
+        if ( pAgent->connected == true )
+        {
+            /* keep the partial line */
+            pAgent->inLen -= ( line - pAgent->in );
+            memmove( pAgent->in, line, pAgent->inLen );
+            if ( pAgent->inLen == sizeof( pAgent->in ) - 1 )
+            {
+                pAgent->inLen = 0;
+            }
+        }
+    }
+    else if ( n == 0 )
+    {
+        result = ECONNRESET;
+    }
+    else if ( errno != EAGAIN )
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleCommand                                                             */
+/*!
+    Handle a command from the aggregator
+
+    The HandleCommand function passes a command to the command handler,
+    and sends its result back to the aggregator.  Until the aggregator
+    has been authenticated, only the challenge and welcome messages are
+    accepted, and the connection is dropped if the aggregator sends
+    anything else.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @param[in]
+        line
+            NUL terminated command line: <command> <id>
+
+==============================================================================*/
+static void HandleCommand( ClusterAgent *pAgent, char *line )
+{
+    char *saveptr;
+    char *command;
+    char *id;
+    int result;
+
+    command = strtok_r( line, " \r", &saveptr );
+    id = strtok_r( NULL, " \r", &saveptr );
+
+    if ( pAgent->authenticated == false )
+    {
+        if ( ( command == NULL ) ||
+             ( id == NULL ) ||
+             ( Authenticate( pAgent, command, id ) != EOK ) )
+        {
+            fprintf( stderr,
+                     "cluster: the aggregator failed to authenticate\n" );
+            if ( pAgent->connected == true )
+            {
+                Drop( pAgent, true );
+            }
+        }
+    }
+    else if ( ( command != NULL ) && ( id != NULL ) )
+    {
+        result = pAgent->handler( command, id, pAgent->arg );
+        (void)CLUSTER_Send( pAgent, "result %s %s %d", command, id, result );
+    }
+}
+
+/*============================================================================*/
+/*  Authenticate                                                              */
+/*!
+    Authenticate with the aggregator
+
+    The Authenticate function answers the challenge of the aggregator
+    with a hello carrying the proof of the agent and a challenge for the
+    aggregator, and checks the proof of the aggregator in its welcome.
+    Once the aggregator has been authenticated, the agent sends a
+    snapshot of the state of its processes.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @param[in]
+        type
+            challenge or welcome
+
+    @param[in]
+        value
+            the challenge or the proof of the aggregator
+
+    @retval EOK - the message was handled
+    @retval EACCES - unexpected message, or wrong proof
+    @retval other - error from CLUSTER_MakeNonce or Queue
+
+==============================================================================*/
+static int Authenticate( ClusterAgent *pAgent,
+                         const char *type,
+                         const char *value )
+{
+    int result = EACCES;
+    char proof[CLUSTER_PROOF_LEN];
+
+    if ( ( strcmp( type, "challenge" ) == 0 ) &&
+         ( pAgent->challenge[0] == '\0' ) &&
+         ( strlen( value ) == CLUSTER_NONCE_LEN - 1 ) )
+    {
+        strcpy( pAgent->challenge, value );
+
+        result = CLUSTER_MakeNonce( pAgent->nonce );
+        if ( result == EOK )
+        {
+            CLUSTER_MakeProof( pAgent->token,
+                               "agent",
+                               pAgent->node,
+                               pAgent->challenge,
+                               pAgent->nonce,
+                               proof );
+
+            result = Queue( pAgent,
+                            "hello %s %s %s",
+                            pAgent->node,
+                            pAgent->nonce,
+                            proof );
+        }
+    }
+    else if ( ( strcmp( type, "welcome" ) == 0 ) &&
+              ( pAgent->challenge[0] != '\0' ) &&
+              ( CLUSTER_CheckProof( pAgent->token,
+                                    "aggregator",
+                                    pAgent->node,
+                                    pAgent->challenge,
+                                    pAgent->nonce,
+                                    value ) == true ) )
+    {
+        pAgent->authenticated = true;
+        pAgent->backoff = CLUSTER_RECONNECT_MIN;
+        pAgent->snapshot( pAgent->arg );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Queue                                                                     */
+/*!
+    Queue a message to the cluster aggregator
+
+    The Queue function formats a message line and queues it to be sent
+    to the aggregator, whether or not the aggregator has been
+    authenticated.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @param[in]
+        format
+            printf format of the message, without its newline
+
+    @retval EOK - the message was queued
+    @retval other - error from QueueLine
+
+==============================================================================*/
+static int Queue( ClusterAgent *pAgent, const char *format, ... )
+{
+    int result;
+    va_list args;
+
+    va_start( args, format );
+    result = QueueLine( pAgent, format, args );
+    va_end( args );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  QueueLine                                                                 */
+/*!
+    Format and queue a message line
+
+    The QueueLine function formats a message line and appends it to the
+    messages waiting to be sent to the aggregator.  If the aggregator
+    has fallen too far behind, the connection is dropped.
+
+    @param[in]
+        pAgent
+            pointer to the connected agent
+
+    @param[in]
+        format
+            printf format of the message, without its newline
+
+    @param[in]
+        args
+            arguments of the format
+
+    @retval EOK - the message was queued
+    @retval EINVAL - invalid message
+    @retval ENOTCONN - the agent is not connected
+    @retval ENOBUFS - the aggregator has fallen too far behind, and the
+                      connection has been dropped
+    @retval other - error from Flush
+
+==============================================================================*/
+static int QueueLine( ClusterAgent *pAgent,
+                      const char *format,
+                      va_list args )
+{
+    int result = EINVAL;
+    char line[CLUSTER_MAX_LINE];
+    int len;
+
+    if ( pAgent->connected == false )
+    {
+        result = ENOTCONN;
+    }
+    else
+    {
+        len = vsnprintf( line, sizeof( line ) - 1, format, args );
+        if ( ( len > 0 ) && ( (size_t)len < sizeof( line ) - 1 ) )
+        {
+            line[len++] = '\n';
+
+            if ( pAgent->outLen + len > CLUSTER_SEND_BUFFER )
+            {
+                /* resynchronize rather than lose a change */
+                Drop( pAgent, true );
+                result = ENOBUFS;
+            }
+            else
+            {
+                memcpy( &pAgent->pOut[pAgent->outLen], line, len );
+                pAgent->outLen += len;
+                result = pAgent->blocked ? EOK : Flush( pAgent );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Flush                                                                     */
+/*!
+    Send the queued messages to the aggregator
+
+    The Flush function sends as many of the queued messages as the
+    connection will accept without blocking.  The connection is watched
+    for becoming writable while messages remain queued.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @retval EOK - the messages were sent, or remain queued
+    @retval other - error from send or epoll_ctl
+
+==============================================================================*/
+static int Flush( ClusterAgent *pAgent )
+{
+    int result = EOK;
+    size_t sent = 0;
+    ssize_t n;
+    bool blocked;
+
+    while ( sent < pAgent->outLen )
+    {
+        n = send( pAgent->source.fd,
+                  &pAgent->pOut[sent],
+                  pAgent->outLen - sent,
+                  MSG_NOSIGNAL | MSG_DONTWAIT );
+        if ( n > 0 )
+        {
+            sent += n;
+        }
+        else
+        {
+            if ( ( n == -1 ) && ( errno != EAGAIN ) )
+            {
+                result = errno;
+            }
+
+            break;
+        }
+    }
+
+    pAgent->outLen -= sent;
+    memmove( pAgent->pOut, &pAgent->pOut[sent], pAgent->outLen );
+
+    blocked = ( pAgent->outLen > 0 );
+    if ( ( result == EOK ) && ( blocked != pAgent->blocked ) )
+    {
+        EVENTLOOP_Remove( &pAgent->source );
+        result = EVENTLOOP_Add( &pAgent->source,
+                                blocked ? EPOLLIN | EPOLLOUT : EPOLLIN );
+        pAgent->blocked = blocked;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Drop                                                                      */
+/*!
+    Drop the connection to the aggregator
+
+    The Drop function closes the connection to the aggregator, discards
+    the queued messages, and optionally schedules a reconnection.
+
+    @param[in]
+        pAgent
+            pointer to the agent
+
+    @param[in]
+        reconnect
+            indicates whether to reconnect to the aggregator
+
+==============================================================================*/
+static void Drop( ClusterAgent *pAgent, bool reconnect )
+{
+    if ( pAgent->source.fd != -1 )
+    {
+        EVENTLOOP_Remove( &pAgent->source );
+        close( pAgent->source.fd );
+        pAgent->source.fd = -1;
+    }
+
+    pAgent->connecting = false;
+    pAgent->connected = false;
+    pAgent->authenticated = false;
+    pAgent->challenge[0] = '\0';
+    pAgent->blocked = false;
+    pAgent->outLen = 0;
+    pAgent->inLen = 0;
+
+    if ( reconnect == true )
+    {
+        EVENTLOOP_StartTimer( &pAgent->reconnectTimer,
+                              pAgent->backoff,
+                              Reconnect,
+                              pAgent );
+
+        pAgent->backoff *= 2;
+        if ( pAgent->backoff > CLUSTER_RECONNECT_MAX )
+        {
+            pAgent->backoff = CLUSTER_RECONNECT_MAX;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Sha256Init                                                                */
+/*!
+    Start a SHA-256 digest calculation
+
+    @param[in]
+        pCtx
+            pointer to the digest state to initialize
+
+==============================================================================*/
+static void Sha256Init( Sha256 *pCtx )
+{
+    static const uint32_t h[8] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy( pCtx->h, h, sizeof( h ) );
+    pCtx->len = 0;
+    pCtx->total = 0;
+}
+
+/*============================================================================*/
+/*  Sha256Update                                                              */
+/*!
+    Add data to a SHA-256 digest calculation
+
+    @param[in]
+        pCtx
+            pointer to the digest state
+
+    @param[in]
+        data
+            pointer to the data
+
+    @param[in]
+        len
+            number of bytes of data
+
+==============================================================================*/
+static void Sha256Update( Sha256 *pCtx, const void *data, size_t len )
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t n;
+
+    pCtx->total += len;
+
+    while ( len > 0 )
+    {
+        n = SHA256_BLOCK_LEN - pCtx->len;
+        n = ( n < len ) ? n : len;
+
+        memcpy( &pCtx->block[pCtx->len], p, n );
+        pCtx->len += n;
+        p += n;
+        len -= n;
+
+        if ( pCtx->len == SHA256_BLOCK_LEN )
+        {
+            Sha256Block( pCtx, pCtx->block );
+            pCtx->len = 0;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Sha256Final                                                               */
+/*!
+    Complete a SHA-256 digest calculation
+
+    The Sha256Final function pads the data with its length in bits, as
+    specified in FIPS 180-4, and stores the big-endian digest.
+
+    @param[in]
+        pCtx
+            pointer to the digest state
+
+    @param[out]
+        digest
+            pointer to a buffer of SHA256_DIGEST_LEN bytes to store the
+            digest in
+
+==============================================================================*/
+static void Sha256Final( Sha256 *pCtx, uint8_t *digest )
+{
+    uint64_t bits = pCtx->total * 8;
+    uint8_t pad = 0x80;
+    uint8_t length[8];
+    size_t i;
+
+    Sha256Update( pCtx, &pad, 1 );
+
+    pad = 0;
+    while ( pCtx->len != SHA256_BLOCK_LEN - sizeof( length ) )
+    {
+        Sha256Update( pCtx, &pad, 1 );
+    }
+
+    for ( i = 0 ; i < sizeof( length ) ; i++ )
+    {
+        length[i] = (uint8_t)( bits >> ( 56 - ( i * 8 ) ) );
+    }
+
+    Sha256Update( pCtx, length, sizeof( length ) );
+
+    for ( i = 0 ; i < SHA256_DIGEST_LEN ; i++ )
+    {
+        digest[i] = (uint8_t)( pCtx->h[i / 4] >> ( 24 - ( ( i % 4 ) * 8 ) ) );
+    }
+}
+
+/*============================================================================*/
+/*  Sha256Block                                                               */
+/*!
+    Process a block of a SHA-256 digest calculation
+
+    @param[in]
+        pCtx
+            pointer to the digest state
+
+    @param[in]
+        block
+            pointer to the SHA256_BLOCK_LEN byte block
+
+==============================================================================*/
+static void Sha256Block( Sha256 *pCtx, const uint8_t *block )
+{
+    static const uint32_t k[64] =
+    {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    uint32_t w[64];
+    uint32_t v[8];
+    uint32_t s0;
+    uint32_t s1;
+    uint32_t t1;
+    uint32_t t2;
+    size_t i;
+
+#define ROTR( x, n )    ( ( (x) >> (n) ) | ( (x) << ( 32 - (n) ) ) )
+
+    for ( i = 0 ; i < 16 ; i++ )
+    {
+        w[i] = ( (uint32_t)block[i * 4] << 24 ) |
+               ( (uint32_t)block[i * 4 + 1] << 16 ) |
+               ( (uint32_t)block[i * 4 + 2] << 8 ) |
+               (uint32_t)block[i * 4 + 3];
+    }
+
+    for ( i = 16 ; i < 64 ; i++ )
+    {
+        s0 = ROTR( w[i - 15], 7 ) ^ ROTR( w[i - 15], 18 ) ^ ( w[i - 15] >> 3 );
+        s1 = ROTR( w[i - 2], 17 ) ^ ROTR( w[i - 2], 19 ) ^ ( w[i - 2] >> 10 );
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    memcpy( v, pCtx->h, sizeof( v ) );
+
+    for ( i = 0 ; i < 64 ; i++ )
+    {
+        s1 = ROTR( v[4], 6 ) ^ ROTR( v[4], 11 ) ^ ROTR( v[4], 25 );
+        t1 = v[7] + s1 + ( ( v[4] & v[5] ) ^ ( ~v[4] & v[6] ) ) + k[i] + w[i];
+        s0 = ROTR( v[0], 2 ) ^ ROTR( v[0], 13 ) ^ ROTR( v[0], 22 );
+        t2 = s0 + ( ( v[0] & v[1] ) ^ ( v[0] & v[2] ) ^ ( v[1] & v[2] ) );
+
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = v[3] + t1;
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = t1 + t2;
+    }
+
+#undef ROTR
+
+    for ( i = 0 ; i < 8 ; i++ )
+    {
+        pCtx->h[i] += v[i];
+    }
+}
+
+/*============================================================================*/
+/*  HmacSha256                                                                */
+/*!
+    Calculate an HMAC-SHA256
+
+    The HmacSha256 function calculates the HMAC of a message with the
+    SHA-256 hash function, as specified in RFC 2104.
+
+    @param[in]
+        key
+            NUL terminated key
+
+    @param[in]
+        msg
+            pointer to the message
+
+    @param[in]
+        len
+            length of the message
+
+    @param[out]
+        digest
+            pointer to a buffer of SHA256_DIGEST_LEN bytes to store the
+            HMAC in
+
+==============================================================================*/
+static void HmacSha256( const char *key,
+                        const char *msg,
+                        size_t len,
+                        uint8_t *digest )
+{
+    uint8_t pad[SHA256_BLOCK_LEN];
+    uint8_t inner[SHA256_DIGEST_LEN];
+    size_t keylen = strlen( key );
+    Sha256 ctx;
+    size_t i;
+
+    /* a key longer than a block is replaced with its digest */
+    memset( pad, 0, sizeof( pad ) );
+    if ( keylen > sizeof( pad ) )
+    {
+        Sha256Init( &ctx );
+        Sha256Update( &ctx, key, keylen );
+        Sha256Final( &ctx, pad );
+    }
+    else
+    {
+        memcpy( pad, key, keylen );
+    }
+
+    for ( i = 0 ; i < sizeof( pad ) ; i++ )
+    {
+        pad[i] ^= 0x36;
+    }
+
+    Sha256Init( &ctx );
+    Sha256Update( &ctx, pad, sizeof( pad ) );
+    Sha256Update( &ctx, msg, len );
+    Sha256Final( &ctx, inner );
+
+    /* switch the inner pad to the outer pad */
+    for ( i = 0 ; i < sizeof( pad ) ; i++ )
+    {
+        pad[i] ^= 0x36 ^ 0x5c;
+    }
+
+    Sha256Init( &ctx );
+    Sha256Update( &ctx, pad, sizeof( pad ) );
+    Sha256Update( &ctx, inner, sizeof( inner ) );
+    Sha256Final( &ctx, digest );
+
+    memset( pad, 0, sizeof( pad ) );
+    memset( &ctx, 0, sizeof( ctx ) );
+}
+
+/*! @}
+ * end of cluster group */
@@ -0,0 +1,867 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup configcache configcache
+ * @brief Compiled configuration cache
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file configcache.c
+
+    Compiled Configuration Cache
+
+    The configcache module stores the process definitions of a parsed
+    configuration file in a binary cache file, which is mapped directly
+    into memory when the process monitor starts, so the configuration
+    file does not need to be parsed again.
+
+    The cache is a single block containing a header, a fixed size
+    definition per process, and the strings, argument vectors,
+    dependency indices and CPU sets of the processes, referred to by
+    their offset from the start of the cache.
+
+    The cache records the size, modification time and hash of the
+    configuration file it was built from.  It is only used while it
+    matches the configuration file.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "configcache.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! alignment of the data blocks in the cache */
+#define CONFIGCACHE_ALIGN       ( 8 )
+
+/*! FNV-1a 64 bit offset basis */
+#define FNV64_OFFSET_BASIS      ( 0xcbf29ce484222325ULL )
+
+/*! FNV-1a 64 bit prime */
+#define FNV64_PRIME             ( 0x100000001b3ULL )
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int CheckCache( ConfigCache *pCache );
+static int CheckSource( ConfigCacheHeader *pHeader, const char *source );
+static int HashFile( const char *path, uint64_t *pHash );
+static int64_t GetModificationTime( struct stat *pStat );
+static size_t Align( size_t n );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  CONFIGCACHE_Open                                                          */
+/*!
+    Open a configuration cache
+
+    The CONFIGCACHE_Open function maps a configuration cache file into
+    memory and checks that it is valid, and that it was built from the
+    current contents of the source configuration file.
+
+    The cache remains mapped until CONFIGCACHE_Close is called.
+
+    @param[in]
+        pCache
+            pointer to the cache object to open
+
+    @param[in]
+        path
+            path of the configuration cache file
+
+    @param[in]
+        source
+            path of the configuration file the cache was built from
+
+    @retval EOK - the cache was opened
+    @retval ESTALE - the configuration file has changed
+    @retval EINVAL - invalid arguments, or the cache is invalid
+    @retval other - error opening or mapping the cache file
+
+==============================================================================*/
+int CONFIGCACHE_Open( ConfigCache *pCache,
+                      const char *path,
+                      const char *source )
+{
+    int result = EINVAL;
+    struct stat sb;
+    void *p;
+    int fd;
+
+    if ( ( pCache != NULL ) && ( path != NULL ) && ( source != NULL ) )
+    {
+        memset( pCache, 0, sizeof( ConfigCache ) );
+
+        fd = open( path, O_RDONLY | O_CLOEXEC );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else if ( fstat( fd, &sb ) == -1 )
+        {
+            result = errno;
+        }
+        else if ( ( sb.st_size < (off_t)sizeof( ConfigCacheHeader ) ) ||
+                  ( sb.st_size > (off_t)UINT32_MAX ) )
+        {
+            result = EINVAL;
+        }
+        else
+        {
+            p = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( p != MAP_FAILED )
+            {
+                pCache->pData = p;
+                pCache->size = sb.st_size;
+                pCache->length = sb.st_size;
+                pCache->mapped = true;
+
+                result = CheckCache( pCache );
+                if ( result == EOK )
+                {
+                    result = CheckSource( CONFIGCACHE_GetHeader( pCache ),
+                                          source );
+                }
+
+                if ( result != EOK )
+                {
+                    CONFIGCACHE_Close( pCache );
+                }
+            }
+            else
+            {
+                result = errno;
+            }
+        }
+
+        if ( fd != -1 )
+        {
+            close( fd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_Create                                                        */
+/*!
+    Create a configuration cache in memory
+
+    The CONFIGCACHE_Create function creates an empty configuration cache
+    with space for the specified number of process definitions.  The
+    strings and data blocks of the processes are added to the cache
+    with CONFIGCACHE_AddData and CONFIGCACHE_AddString.
+
+    @param[in]
+        pCache
+            pointer to the cache object to create
+
+    @param[in]
+        count
+            number of processes in the cache
+
+    @retval EOK - the cache was created
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int CONFIGCACHE_Create( ConfigCache *pCache, size_t count )
+{
+    int result = EINVAL;
+    ConfigCacheHeader *pHeader;
+    size_t processes;
+
+    if ( ( pCache != NULL ) && ( count < UINT32_MAX / 2 ) )
+    {
+        memset( pCache, 0, sizeof( ConfigCache ) );
+
+        processes = Align( sizeof( ConfigCacheHeader ) );
+        pCache->size = processes + ( count * sizeof( ConfigCacheProcess ) );
+        pCache->length = pCache->size + BUFSIZ;
+
+        pCache->pData = calloc( 1, pCache->length );
+        if ( pCache->pData != NULL )
+        {
+            pHeader = (ConfigCacheHeader *)pCache->pData;
+            pHeader->magic = CONFIGCACHE_MAGIC;
+            pHeader->version = CONFIGCACHE_VERSION;
+            pHeader->cpusetSize = sizeof( cpu_set_t );
+            pHeader->count = count;
+            pHeader->processes = processes;
+
+            result = EOK;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_AddData                                                       */
+/*!
+    Add a data block to a configuration cache
+
+    The CONFIGCACHE_AddData function copies a data block into a cache
+    which is being built.  The cache may be reallocated, so pointers
+    returned by the CONFIGCACHE_Get functions are no longer valid.
+
+    @param[in]
+        pCache
+            pointer to the cache being built
+
+    @param[in]
+        pData
+            pointer to the data to add, or NULL for no data
+
+    @param[in]
+        len
+            length of the data to add
+
+    @param[out]
+        pOffset
+            pointer to a location to store the offset of the data block,
+            or CONFIGCACHE_NONE if there is no data
+
+    @retval EOK - the data was added
+    @retval EINVAL - invalid arguments
+    @retval EFBIG - the cache is too large
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int CONFIGCACHE_AddData( ConfigCache *pCache,
+                         const void *pData,
+                         size_t len,
+                         uint32_t *pOffset )
+{
+    int result = EINVAL;
+    size_t offset;
+    size_t length;
+    uint8_t *p;
+
+    if ( ( pCache != NULL ) &&
+         ( pCache->pData != NULL ) &&
+         ( pCache->mapped == false ) &&
+         ( pOffset != NULL ) )
+    {
+        result = EOK;
+        *pOffset = CONFIGCACHE_NONE;
+
+        offset = Align( pCache->size );
+        if ( pData == NULL )
+        {
+            /* nothing to add */
+        }
+        else if ( ( len > UINT32_MAX ) || ( offset + len > UINT32_MAX ) )
+        {
+            result = EFBIG;
+        }
+        else
+        {
+            if ( offset + len > pCache->length )
+            {
+                length = 2 * ( offset + len );
+                p = realloc( pCache->pData, length );
+                if ( p != NULL )
+                {
+                    memset( &p[pCache->length], 0, length - pCache->length );
+                    pCache->pData = p;
+                    pCache->length = length;
+                }
+                else
+                {
+                    result = ENOMEM;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                memcpy( &pCache->pData[offset], pData, len );
+                pCache->size = offset + len;
+                *pOffset = offset;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_AddString                                                     */
+/*!
+    Add a string to a configuration cache
+
+    The CONFIGCACHE_AddString function copies a NUL terminated string
+    into a cache which is being built.
+
+    @param[in]
+        pCache
+            pointer to the cache being built
+
+    @param[in]
+        str
+            pointer to the string to add, or NULL for no string
+
+    @param[out]
+        pOffset
+            pointer to a location to store the offset of the string,
+            or CONFIGCACHE_NONE if there is no string
+
+    @retval EOK - the string was added
+    @retval EINVAL - invalid arguments
+    @retval EFBIG - the cache is too large
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int CONFIGCACHE_AddString( ConfigCache *pCache,
+                           const char *str,
+                           uint32_t *pOffset )
+{
+    return CONFIGCACHE_AddData( pCache,
+                                str,
+                                ( str != NULL ) ? strlen( str ) + 1 : 0,
+                                pOffset );
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_Write                                                         */
+/*!
+    Write a configuration cache file
+
+    The CONFIGCACHE_Write function records the size, modification time
+    and hash of the source configuration file in a cache which has been
+    built, and writes the cache to a file.  The cache is written to a
+    temporary file which is renamed over the cache file, so a cache file
+    is never partially written.
+
+    @param[in]
+        pCache
+            pointer to the cache which has been built
+
+    @param[in]
+        path
+            path of the configuration cache file
+
+    @param[in]
+        source
+            path of the configuration file the cache was built from
+
+    @retval EOK - the cache file was written
+    @retval EINVAL - invalid arguments
+    @retval other - error writing the cache file
+
+==============================================================================*/
+int CONFIGCACHE_Write( ConfigCache *pCache,
+                       const char *path,
+                       const char *source )
+{
+    int result = EINVAL;
+    ConfigCacheHeader *pHeader;
+    char tmpPath[PATH_MAX];
+    struct stat sb;
+    uint32_t offset;
+    uint64_t hash;
+    uint8_t nul = 0;
+    size_t n = 0;
+    ssize_t rc;
+    int fd;
+
+    if ( ( pCache != NULL ) &&
+         ( pCache->mapped == false ) &&
+         ( path != NULL ) &&
+         ( source != NULL ) )
+    {
+        result = ( stat( source, &sb ) == 0 ) ? EOK : errno;
+        if ( result == EOK )
+        {
+            result = HashFile( source, &hash );
+        }
+
+        if ( result == EOK )
+        {
+            /* end the cache with a NUL so a string at any offset
+             * is terminated inside the cache */
+            result = CONFIGCACHE_AddData( pCache, &nul, 1, &offset );
+        }
+
+        if ( result == EOK )
+        {
+            pHeader = CONFIGCACHE_GetHeader( pCache );
+            pHeader->size = pCache->size;
+            pHeader->sourceSize = sb.st_size;
+            pHeader->sourceTime = GetModificationTime( &sb );
+            pHeader->sourceHash = hash;
+
+            if ( (size_t)snprintf( tmpPath,
+                                   sizeof( tmpPath ),
+                                   "%s.tmp",
+                                   path ) >= sizeof( tmpPath ) )
+            {
+                result = ENAMETOOLONG;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            fd = open( tmpPath,
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644 );
+            if ( fd != -1 )
+            {
+                while ( ( result == EOK ) && ( n < pCache->size ) )
+                {
+                    rc = write( fd, &pCache->pData[n], pCache->size - n );
+                    if ( rc > 0 )
+                    {
+                        n += rc;
+                    }
+                    else if ( ( rc == -1 ) && ( errno != EINTR ) )
+                    {
+                        result = errno;
+                    }
+                }
+
+                /* make sure the cache is on disk before it replaces
+                 * the previous cache */
+                if ( ( result == EOK ) && ( fsync( fd ) == -1 ) )
+                {
+                    result = errno;
+                }
+
+                close( fd );
+
+                if ( ( result == EOK ) && ( rename( tmpPath, path ) == -1 ) )
+                {
+                    result = errno;
+                }
+
+                if ( result != EOK )
+                {
+                    unlink( tmpPath );
+                }
+            }
+            else
+            {
+                result = errno;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_Close                                                         */
+/*!
+    Close a configuration cache
+
+    The CONFIGCACHE_Close function unmaps a cache which was opened, or
+    frees a cache which was built.  The strings and data of the cache
+    are no longer available.
+
+    @param[in]
+        pCache
+            pointer to the cache to close
+
+==============================================================================*/
+void CONFIGCACHE_Close( ConfigCache *pCache )
+{
+    if ( ( pCache != NULL ) && ( pCache->pData != NULL ) )
+    {
+        if ( pCache->mapped == true )
+        {
+            munmap( pCache->pData, pCache->length );
+        }
+        else
+        {
+            free( pCache->pData );
+        }
+
+        memset( pCache, 0, sizeof( ConfigCache ) );
+    }
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_GetHeader                                                     */
+/*!
+    Get the header of a configuration cache
+
+    @param[in]
+        pCache
+            pointer to the cache
+
+    @retval pointer to the cache header
+    @retval NULL - invalid arguments
+
+==============================================================================*/
+ConfigCacheHeader *CONFIGCACHE_GetHeader( ConfigCache *pCache )
+{
+    ConfigCacheHeader *pHeader = NULL;
+
+    if ( ( pCache != NULL ) &&
+         ( pCache->pData != NULL ) &&
+         ( pCache->size >= sizeof( ConfigCacheHeader ) ) )
+    {
+        pHeader = (ConfigCacheHeader *)pCache->pData;
+    }
+
+    return pHeader;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_GetProcess                                                    */
+/*!
+    Get a process definition of a configuration cache
+
+    @param[in]
+        pCache
+            pointer to the cache
+
+    @param[in]
+        n
+            index of the process definition
+
+    @retval pointer to the n'th process definition
+    @retval NULL - there is no n'th process definition
+
+==============================================================================*/
+ConfigCacheProcess *CONFIGCACHE_GetProcess( ConfigCache *pCache, size_t n )
+{
+    ConfigCacheHeader *pHeader;
+    ConfigCacheProcess *pProcess = NULL;
+
+    pHeader = CONFIGCACHE_GetHeader( pCache );
+    if ( ( pHeader != NULL ) && ( n < pHeader->count ) )
+    {
+        pProcess = (ConfigCacheProcess *)&pCache->pData[pHeader->processes];
+        pProcess += n;
+    }
+
+    return pProcess;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_GetString                                                     */
+/*!
+    Get a string of a configuration cache
+
+    @param[in]
+        pCache
+            pointer to the cache
+
+    @param[in]
+        offset
+            offset of the string
+
+    @retval pointer to the string
+    @retval NULL - the string is absent or the offset is invalid
+
+==============================================================================*/
+const char *CONFIGCACHE_GetString( ConfigCache *pCache, uint32_t offset )
+{
+    const char *str = NULL;
+
+    if ( ( pCache != NULL ) &&
+         ( pCache->pData != NULL ) &&
+         ( offset != CONFIGCACHE_NONE ) &&
+         ( offset < pCache->size ) )
+    {
+        str = (const char *)&pCache->pData[offset];
+    }
+
+    return str;
+}
+
+/*============================================================================*/
+/*  CONFIGCACHE_GetData                                                       */
+/*!
+    Get a data block of a configuration cache
+
+    @param[in]
+        pCache
+            pointer to the cache
+
+    @param[in]
+        offset
+            offset of the data block
+
+    @param[in]
+        len
+            length of the data block
+
+    @retval pointer to the data block
+    @retval NULL - the data block is absent or is outside of the cache
+
+==============================================================================*/
+const void *CONFIGCACHE_GetData( ConfigCache *pCache,
+                                 uint32_t offset,
+                                 size_t len )
+{
+    const void *pData = NULL;
+
+    if ( ( pCache != NULL ) &&
+         ( pCache->pData != NULL ) &&
+         ( offset != CONFIGCACHE_NONE ) &&
+         ( ( offset % CONFIGCACHE_ALIGN ) == 0 ) &&
+         ( len <= pCache->size ) &&
+         ( offset <= pCache->size - len ) )
+    {
+        pData = &pCache->pData[offset];
+    }
+
+    return pData;
+}
+
+/*============================================================================*/
+/*  CheckCache                                                                */
+/*!
+    Check that a mapped configuration cache is valid
+
+    The CheckCache function checks the cache header, and that the
+    process definitions fit inside the cache.
+
+    @param[in]
+        pCache
+            pointer to the mapped cache
+
+    @retval EOK - the cache is valid
+    @retval EINVAL - the cache is invalid or was built for another
+                     version or system
+
+==============================================================================*/
+static int CheckCache( ConfigCache *pCache )
+{
+    int result = EINVAL;
+    ConfigCacheHeader *pHeader;
+
+    pHeader = CONFIGCACHE_GetHeader( pCache );
+    if ( ( pHeader != NULL ) &&
+         ( pHeader->magic == CONFIGCACHE_MAGIC ) &&
+         ( pHeader->version == CONFIGCACHE_VERSION ) &&
+         ( pHeader->cpusetSize == sizeof( cpu_set_t ) ) &&
+         ( pHeader->size == pCache->size ) &&
+         ( pCache->pData[pCache->size - 1] == 0 ) &&
+         ( ( pHeader->processes % CONFIGCACHE_ALIGN ) == 0 ) &&
+         ( pHeader->processes >= sizeof( ConfigCacheHeader ) ) &&
+         ( pHeader->processes <= pCache->size ) &&
+         ( pHeader->count <= ( pCache->size - pHeader->processes ) /
+                             sizeof( ConfigCacheProcess ) ) )
+    {
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CheckSource                                                               */
+/*!
+    Check that a configuration cache matches its configuration file
+
+    The CheckSource function compares the configuration file with the
+    size and modification time recorded in the cache.  If the
+    modification time has changed, the contents of the configuration
+    file are hashed, so a configuration file which has been touched or
+    copied without being changed does not invalidate the cache.
+
+    @param[in]
+        pHeader
+            pointer to the cache header
+
+    @param[in]
+        source
+            path of the configuration file
+
+    @retval EOK - the cache matches the configuration file
+    @retval ESTALE - the configuration file has changed
+    @retval EINVAL - invalid arguments
+    @retval other - error reading the configuration file
+
+==============================================================================*/
+static int CheckSource( ConfigCacheHeader *pHeader, const char *source )
+{
+    int result = EINVAL;
+    struct stat sb;
+    uint64_t hash;
+
+    if ( ( pHeader != NULL ) && ( source != NULL ) )
+    {
+        result = ( stat( source, &sb ) == 0 ) ? EOK : errno;
+        if ( result == EOK )
+        {
+            if ( (uint64_t)sb.st_size != pHeader->sourceSize )
+            {
+                result = ESTALE;
+            }
+            else if ( GetModificationTime( &sb ) != pHeader->sourceTime )
+            {
+                result = HashFile( source, &hash );
+                if ( ( result == EOK ) && ( hash != pHeader->sourceHash ) )
+                {
+                    result = ESTALE;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HashFile                                                                  */
+/*!
+    Calculate the hash of a file
+
+    The HashFile function calculates the 64 bit FNV-1a hash of the
+    contents of a file.
+
+    @param[in]
+        path
+            path of the file to hash
+
+    @param[out]
+        pHash
+            pointer to a location to store the hash
+
+    @retval EOK - the file was hashed
+    @retval EINVAL - invalid arguments
+    @retval other - error reading the file
+
+==============================================================================*/
+static int HashFile( const char *path, uint64_t *pHash )
+{
+    int result = EINVAL;
+    uint8_t buf[BUFSIZ];
+    uint64_t hash = FNV64_OFFSET_BASIS;
+    ssize_t n;
+    ssize_t i;
+    int fd;
+
+    if ( ( path != NULL ) && ( pHash != NULL ) )
+    {
+        fd = open( path, O_RDONLY | O_CLOEXEC );
+        if ( fd != -1 )
+        {
+            result = EOK;
+
+            do
+            {
+                n = read( fd, buf, sizeof( buf ) );
+                for ( i = 0 ; i < n ; i++ )
+                {
+                    hash = ( hash ^ buf[i] ) * FNV64_PRIME;
+                }
+
+                if ( ( n == -1 ) && ( errno != EINTR ) )
+                {
+                    result = errno;
+                }
+            } while ( ( n != 0 ) && ( result == EOK ) );
+
+            close( fd );
+
+            *pHash = hash;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetModificationTime                                                       */
+/*!
+    Get the modification time of a file in nanoseconds
+
+    @param[in]
+        pStat
+            pointer to the status of the file
+
+    @retval modification time of the file in nanoseconds
+
+==============================================================================*/
+static int64_t GetModificationTime( struct stat *pStat )
+{
+    return ( (int64_t)pStat->st_mtim.tv_sec * 1000000000LL ) +
+           pStat->st_mtim.tv_nsec;
+}
+
+/*============================================================================*/
+/*  Align                                                                     */
+/*!
+    Align an offset to the alignment of the cache data blocks
+
+    @param[in]
+        n
+            offset to align
+
+    @retval the aligned offset
+
+==============================================================================*/
+static size_t Align( size_t n )
+{
+    return ( n + CONFIGCACHE_ALIGN - 1 ) & ~( (size_t)CONFIGCACHE_ALIGN - 1 );
+}
+
+/*! @}
+ * end of configcache group */
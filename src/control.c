@@ -0,0 +1,780 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup control control
+ * @brief Process monitor control socket
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file control.c
+
+    Process Monitor Control Socket
+
+    The control module provides Unix domain and TCP stream sockets which
+    are served from the process monitor event loop.  Clients connect to
+    a socket, send a single newline terminated request line, and read the
+    response until the server closes the connection.
+
+    The content of the requests and responses is defined by the request
+    handler which is registered with CONTROL_Listen or CONTROL_ListenTcp.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "eventloop.h"
+#include "control.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! maximum number of pending client connections */
+#define CONTROL_BACKLOG ( 16 )
+
+/*! maximum number of sockets which can be served */
+#define CONTROL_MAX_LISTENERS ( 4 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! the ControlListener object holds the state of a listening socket */
+typedef struct _controlListener
+{
+    /*! listening socket event source */
+    EventSource source;
+
+    /*! control request handler */
+    ControlHandler handler;
+
+    /*! opaque argument passed to the control request handler */
+    void *arg;
+
+} ControlListener;
+
+/*! the ControlClient object holds the state of a single client
+ *  connection while its request is being received and its response
+ *  is being sent */
+typedef struct _controlClient
+{
+    /*! client socket event source */
+    EventSource source;
+
+    /*! listener which accepted the connection */
+    ControlListener *pListener;
+
+    /*! timer which closes the connection when the client stalls */
+    Timer idleTimer;
+
+    /*! number of request bytes received */
+    size_t len;
+
+    /*! request buffer */
+    char request[CONTROL_MAX_REQUEST];
+
+    /*! response buffer */
+    char *pResponse;
+
+    /*! length of the response */
+    size_t responseLen;
+
+    /*! number of response bytes sent */
+    size_t sent;
+
+} ControlClient;
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! listening sockets */
+static ControlListener listeners[CONTROL_MAX_LISTENERS];
+
+/*! number of listening sockets */
+static size_t numListeners = 0;
+
+/*! number of open client connections */
+static size_t numClients = 0;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int InitAddress( struct sockaddr_un *pAddr, const char *path );
+static int AddListener( int fd, ControlHandler handler, void *arg );
+static void HandleConnection( EventSource *pSource, uint32_t events );
+static void HandleRequest( EventSource *pSource, uint32_t events );
+static void HandleWrite( EventSource *pSource, uint32_t events );
+static void SendResponse( ControlClient *pClient );
+static bool Flush( ControlClient *pClient );
+static void IdleTimeout( void *arg );
+static void CloseClient( ControlClient *pClient );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  CONTROL_Listen                                                            */
+/*!
+    Start serving a Unix domain control socket
+
+    The CONTROL_Listen function creates the control socket at the
+    specified path, replacing any stale socket left behind by a previous
+    instance, and adds it to the event loop.  Each request received on
+    the socket is passed to the specified request handler.
+
+    @param[in]
+        path
+            path of the control socket
+
+    @param[in]
+        handler
+            function to invoke for each control request
+
+    @param[in]
+        arg
+            opaque argument to pass to the request handler
+
+    @retval EOK - the control socket is being served
+    @retval EINVAL - invalid arguments
+    @retval EBUSY - the maximum number of sockets are already being served
+    @retval other - error from socket, bind, listen or epoll_ctl
+
+==============================================================================*/
+int CONTROL_Listen( const char *path, ControlHandler handler, void *arg )
+{
+    int result = EINVAL;
+    struct sockaddr_un addr;
+    int fd;
+
+    if ( numListeners == CONTROL_MAX_LISTENERS )
+    {
+        result = EBUSY;
+    }
+    else if ( ( handler != NULL ) &&
+              ( InitAddress( &addr, path ) == EOK ) )
+    {
+        result = EOK;
+
+        fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0 );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            /* remove any stale socket */
+            unlink( path );
+
+            if ( ( bind( fd,
+                         (struct sockaddr *)&addr,
+                         sizeof( addr ) ) == -1 ) ||
+                 ( chmod( path, S_IRUSR | S_IWUSR ) == -1 ) ||
+                 ( listen( fd, CONTROL_BACKLOG ) == -1 ) )
+            {
+                result = errno;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            result = AddListener( fd, handler, arg );
+        }
+
+        if ( ( result != EOK ) && ( fd != -1 ) )
+        {
+            close( fd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CONTROL_ListenTcp                                                         */
+/*!
+    Start serving a TCP control socket
+
+    The CONTROL_ListenTcp function creates a TCP socket listening on the
+    specified address and port, and adds it to the event loop.  Each
+    request line received on the socket is passed to the specified
+    request handler.
+
+    @param[in]
+        address
+            IPv4 address to listen on, eg "127.0.0.1" or "0.0.0.0"
+
+    @param[in]
+        port
+            TCP port to listen on
+
+    @param[in]
+        handler
+            function to invoke for each control request
+
+    @param[in]
+        arg
+            opaque argument to pass to the request handler
+
+    @retval EOK - the socket is being served
+    @retval EINVAL - invalid arguments
+    @retval EBUSY - the maximum number of sockets are already being served
+    @retval other - error from socket, bind, listen or epoll_ctl
+
+==============================================================================*/
+int CONTROL_ListenTcp( const char *address,
+                       uint16_t port,
+                       ControlHandler handler,
+                       void *arg )
+{
+    int result = EINVAL;
+    struct sockaddr_in addr;
+    int fd;
+    int on = 1;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons( port );
+
+    if ( numListeners == CONTROL_MAX_LISTENERS )
+    {
+        result = EBUSY;
+    }
+    else if ( ( handler != NULL ) &&
+              ( address != NULL ) &&
+              ( inet_pton( AF_INET, address, &addr.sin_addr ) == 1 ) )
+    {
+        result = EOK;
+
+        fd = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0 );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else if ( ( setsockopt( fd,
+                                SOL_SOCKET,
+                                SO_REUSEADDR,
+                                &on,
+                                sizeof( on ) ) == -1 ) ||
+                  ( bind( fd,
+                          (struct sockaddr *)&addr,
+                          sizeof( addr ) ) == -1 ) ||
+                  ( listen( fd, CONTROL_BACKLOG ) == -1 ) )
+        {
+            result = errno;
+        }
+
+        if ( result == EOK )
+        {
+            result = AddListener( fd, handler, arg );
+        }
+
+        if ( ( result != EOK ) && ( fd != -1 ) )
+        {
+            close( fd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CONTROL_Connect                                                           */
+/*!
+    Connect to the control socket
+
+    The CONTROL_Connect function connects to the control socket of
+    a running process monitor.
+
+    @param[in]
+        path
+            path of the control socket
+
+    @retval file descriptor of the connected socket
+    @retval -1 - unable to connect to the control socket
+
+==============================================================================*/
+int CONTROL_Connect( const char *path )
+{
+    int fd = -1;
+    struct sockaddr_un addr;
+
+    if ( InitAddress( &addr, path ) == EOK )
+    {
+        fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if ( fd != -1 )
+        {
+            if ( connect( fd,
+                          (struct sockaddr *)&addr,
+                          sizeof( addr ) ) == -1 )
+            {
+                close( fd );
+                fd = -1;
+            }
+        }
+    }
+
+    return fd;
+}
+
+/*============================================================================*/
+/*  InitAddress                                                               */
+/*!
+    Initialize a Unix domain socket address
+
+    The InitAddress function initializes a Unix domain socket address
+    for the specified socket path.
+
+    @param[in]
+        pAddr
+            pointer to the socket address to initialize
+
+    @param[in]
+        path
+            path of the socket
+
+    @retval EOK - the address was initialized
+    @retval EINVAL - invalid arguments
+    @retval ENAMETOOLONG - the socket path is too long
+
+==============================================================================*/
+static int InitAddress( struct sockaddr_un *pAddr, const char *path )
+{
+    int result = EINVAL;
+
+    if ( ( pAddr != NULL ) && ( path != NULL ) )
+    {
+        memset( pAddr, 0, sizeof( struct sockaddr_un ) );
+        pAddr->sun_family = AF_UNIX;
+
+        if ( strlen( path ) < sizeof( pAddr->sun_path ) )
+        {
+            strcpy( pAddr->sun_path, path );
+            result = EOK;
+        }
+        else
+        {
+            result = ENAMETOOLONG;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddListener                                                               */
+/*!
+    Serve a listening socket
+
+    The AddListener function adds a listening socket to the event loop.
+
+    @param[in]
+        fd
+            listening socket
+
+    @param[in]
+        handler
+            function to invoke for each control request
+
+    @param[in]
+        arg
+            opaque argument to pass to the request handler
+
+    @retval EOK - the socket is being served
+    @retval other - error from epoll_ctl
+
+==============================================================================*/
+static int AddListener( int fd, ControlHandler handler, void *arg )
+{
+    int result;
+    ControlListener *pListener = &listeners[numListeners];
+
+    pListener->source.fd = fd;
+    pListener->source.handler = HandleConnection;
+    pListener->source.arg = pListener;
+    pListener->handler = handler;
+    pListener->arg = arg;
+
+    result = EVENTLOOP_Add( &pListener->source, EPOLLIN );
+    if ( result == EOK )
+    {
+        numListeners++;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleConnection                                                          */
+/*!
+    Accept a control socket connection
+
+    The HandleConnection function is invoked from the event loop when
+    a client connects to the control socket.  The client connection is
+    added to the event loop to receive its request.
+
+    Once the maximum number of clients are connected, further
+    connections are accepted and closed immediately, so the pending
+    connections do not keep the listening socket ready.
+
+    @param[in]
+        pSource
+            pointer to the listening socket event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleConnection( EventSource *pSource, uint32_t events )
+{
+    ControlClient *pClient = NULL;
+    int fd;
+
+    if ( pSource != NULL )
+    {
+        fd = accept4( pSource->fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK );
+        if ( fd != -1 )
+        {
+            if ( numClients < CONTROL_MAX_CLIENTS )
+            {
+                pClient = calloc( 1, sizeof( ControlClient ) );
+            }
+
+            if ( pClient != NULL )
+            {
+                pClient->source.fd = fd;
+                pClient->source.handler = HandleRequest;
+                pClient->source.arg = pClient;
+                pClient->pListener = (ControlListener *)pSource->arg;
+
+                if ( EVENTLOOP_Add( &pClient->source, EPOLLIN ) == EOK )
+                {
+                    numClients++;
+                    EVENTLOOP_StartTimer( &pClient->idleTimer,
+                                          CONTROL_IDLE_TIMEOUT,
+                                          IdleTimeout,
+                                          pClient );
+                }
+                else
+                {
+                    free( pClient );
+                    pClient = NULL;
+                }
+            }
+
+            if ( pClient == NULL )
+            {
+                close( fd );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleRequest                                                             */
+/*!
+    Receive a control request
+
+    The HandleRequest function is invoked from the event loop when
+    data is available on a client connection.  Once a complete request
+    line has been received, the response is sent, and the connection
+    is closed once the whole response has been sent.
+
+    @param[in]
+        pSource
+            pointer to the client connection event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleRequest( EventSource *pSource, uint32_t events )
+{
+    ControlClient *pClient;
+    ssize_t n;
+    char *p;
+    bool done = false;
+
+    if ( pSource != NULL )
+    {
+        pClient = (ControlClient *)pSource->arg;
+
+        n = read( pSource->fd,
+                  &pClient->request[pClient->len],
+                  sizeof( pClient->request ) - pClient->len - 1 );
+        if ( n > 0 )
+        {
+            pClient->len += n;
+            pClient->request[pClient->len] = '\0';
+
+            EVENTLOOP_StartTimer( &pClient->idleTimer,
+                                  CONTROL_IDLE_TIMEOUT,
+                                  IdleTimeout,
+                                  pClient );
+
+            p = strchr( pClient->request, '\n' );
+            if ( ( p != NULL ) ||
+                 ( pClient->len == sizeof( pClient->request ) - 1 ) )
+            {
+                if ( p != NULL )
+                {
+                    *p = '\0';
+                }
+
+                SendResponse( pClient );
+                done = Flush( pClient );
+            }
+        }
+        else if ( ( n == 0 ) || ( errno != EAGAIN ) )
+        {
+            /* client closed the connection */
+            done = true;
+        }
+
+        if ( done == true )
+        {
+            CloseClient( pClient );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleWrite                                                               */
+/*!
+    Continue sending a control response
+
+    The HandleWrite function is invoked from the event loop when a
+    client connection whose response could not be sent in full becomes
+    writable.  The connection is closed once the whole response has
+    been sent.
+
+    @param[in]
+        pSource
+            pointer to the client connection event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleWrite( EventSource *pSource, uint32_t events )
+{
+    ControlClient *pClient;
+
+    if ( pSource != NULL )
+    {
+        pClient = (ControlClient *)pSource->arg;
+        if ( Flush( pClient ) == true )
+        {
+            CloseClient( pClient );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  SendResponse                                                              */
+/*!
+    Generate the response to a control request
+
+    The SendResponse function invokes the request handler to generate
+    the response to a control request in memory.  The response is
+    sent to the client by Flush.
+
+    @param[in]
+        pClient
+            pointer to the client connection
+
+==============================================================================*/
+static void SendResponse( ControlClient *pClient )
+{
+    FILE *fp;
+
+    fp = open_memstream( &pClient->pResponse, &pClient->responseLen );
+    if ( fp != NULL )
+    {
+        pClient->pListener->handler( fp,
+                                     pClient->request,
+                                     pClient->pListener->arg );
+        fclose( fp );
+    }
+}
+
+/*============================================================================*/
+/*  Flush                                                                     */
+/*!
+    Send the buffered control response
+
+    The Flush function sends as much of the client's response as the
+    socket will accept without blocking.  If the socket is full, the
+    connection waits for the socket to become writable before the
+    rest of the response is sent, and the idle timer closes it if the
+    client stops reading.  A client which has gone away does not raise
+    SIGPIPE.
+
+    @param[in]
+        pClient
+            pointer to the client connection
+
+    @retval true - the response has been sent, or cannot be sent
+    @retval false - the rest of the response will be sent when the
+                    socket becomes writable
+
+==============================================================================*/
+static bool Flush( ControlClient *pClient )
+{
+    bool done = false;
+    ssize_t n;
+    int fd = pClient->source.fd;
+
+    while ( ( done == false ) && ( pClient->sent < pClient->responseLen ) )
+    {
+        n = send( fd,
+                  &pClient->pResponse[pClient->sent],
+                  pClient->responseLen - pClient->sent,
+                  MSG_NOSIGNAL );
+        if ( n > 0 )
+        {
+            pClient->sent += n;
+            EVENTLOOP_StartTimer( &pClient->idleTimer,
+                                  CONTROL_IDLE_TIMEOUT,
+                                  IdleTimeout,
+                                  pClient );
+        }
+        else if ( ( n == -1 ) && ( errno == EAGAIN ) )
+        {
+            break;
+        }
+        else
+        {
+            done = true;
+        }
+    }
+
+    if ( pClient->sent == pClient->responseLen )
+    {
+        done = true;
+    }
+    else if ( ( done == false ) &&
+              ( pClient->source.handler != HandleWrite ) )
+    {
+        /* wait for the socket to become writable */
+        EVENTLOOP_Remove( &pClient->source );
+        pClient->source.handler = HandleWrite;
+        if ( EVENTLOOP_Add( &pClient->source, EPOLLOUT ) != EOK )
+        {
+            done = true;
+        }
+    }
+
+    return done;
+}
+
+/*============================================================================*/
+/*  IdleTimeout                                                               */
+/*!
+    Close a stalled client connection
+
+    The IdleTimeout function is invoked from the event loop when a
+    client has not sent any request data or read any response data
+    within the idle timeout, and closes the connection.
+
+    @param[in]
+        arg
+            pointer to the client connection
+
+==============================================================================*/
+static void IdleTimeout( void *arg )
+{
+    CloseClient( (ControlClient *)arg );
+}
+
+/*============================================================================*/
+/*  CloseClient                                                               */
+/*!
+    Close a client connection
+
+    The CloseClient function removes a client connection from the
+    event loop, closes it, and releases its resources.
+
+    Any further request data which the client has sent ( such as HTTP
+    request headers ) is discarded first, so closing the connection does
+    not reset it before the client has read the response.
+
+    @param[in]
+        pClient
+            pointer to the client connection to close
+
+==============================================================================*/
+static void CloseClient( ControlClient *pClient )
+{
+    char discard[CONTROL_MAX_REQUEST];
+
+    if ( pClient != NULL )
+    {
+        while ( recv( pClient->source.fd,
+                      discard,
+                      sizeof( discard ),
+                      MSG_DONTWAIT ) > 0 );
+
+        EVENTLOOP_StopTimer( &pClient->idleTimer );
+        EVENTLOOP_Remove( &pClient->source );
+        close( pClient->source.fd );
+        free( pClient->pResponse );
+        free( pClient );
+        numClients--;
+    }
+}
+
+/*! @}
+ * end of control group */
@@ -0,0 +1,810 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup eventloop eventloop
+ * @brief Process monitor event loop
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file eventloop.c
+
+    Process Monitor Event Loop
+
+    The eventloop module provides a single threaded epoll based event
+    loop with millisecond timers.  It allows the process monitor to
+    supervise all of its processes from a single thread, rather than
+    dedicating a blocked thread to each process.
+
+    Event sources and timers are owned by the caller, so the event loop
+    does not perform any memory allocation.
+
+    Timers are kept in a hierarchical timer wheel with a resolution of
+    one millisecond.  Each level of the wheel has 64 slots, and each slot
+    of a level spans all of the slots of the level below it.  A timer is
+    placed in the lowest level whose span covers its delay, and is moved
+    (cascaded) down a level each time the slot it is in is reached, until
+    it is in the bottom level and expires.  Starting and stopping a timer
+    therefore takes constant time however many timers are pending, and
+    bitmaps of the occupied slots let the event loop find the next timer
+    to run without visiting the empty slots.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include "eventloop.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! number of bits of the expiry time indexing each timer wheel level */
+#define EVENTLOOP_WHEEL_BITS    ( 6 )
+
+/*! number of slots in each timer wheel level */
+#define EVENTLOOP_WHEEL_SLOTS   ( 1 << EVENTLOOP_WHEEL_BITS )
+
+/*! mask to get the slot index from the expiry time */
+#define EVENTLOOP_WHEEL_MASK    ( EVENTLOOP_WHEEL_SLOTS - 1 )
+
+/*! number of timer wheel levels */
+#define EVENTLOOP_WHEEL_LEVELS  ( 5 )
+
+/*! longest delay (in milliseconds) spanned by the timer wheel, about
+ *  12 days.  Longer timers are cascaded from the top level until they
+ *  are within range */
+#define EVENTLOOP_WHEEL_RANGE \
+    ( (int64_t)1 << ( EVENTLOOP_WHEEL_BITS * EVENTLOOP_WHEEL_LEVELS ) )
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! epoll file descriptor */
+static int epfd = -1;
+
+/*! timer wheel slots.  Each slot is the sentinel of a circular list */
+static Timer wheel[EVENTLOOP_WHEEL_LEVELS][EVENTLOOP_WHEEL_SLOTS];
+
+/*! bitmaps of the non-empty slots of each timer wheel level */
+static uint64_t occupied[EVENTLOOP_WHEEL_LEVELS];
+
+/*! list of timers which were due before the current tick */
+static Timer expired;
+
+/*! the next tick (monotonic time in milliseconds) of the timer wheel
+ *  to be processed */
+static int64_t wheelTime;
+
+/*! number of active timers */
+static size_t nTimers;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static void InitTimers( void );
+static void InsertTimer( Timer *pTimer );
+static void AppendTimer( Timer *pList, Timer *pTimer );
+static void UnlinkTimer( Timer *pTimer );
+static void RunTimers( Timer *pList );
+static void Cascade( int64_t tick );
+static int64_t NextExpiry( void );
+static uint64_t Rotate( uint64_t bits, unsigned int n );
+static int GetTimeout( void );
+static void ProcessTimers( void );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  EVENTLOOP_Init                                                            */
+/*!
+    Initialize the event loop
+
+    The EVENTLOOP_Init function creates the epoll instance used
+    by the event loop.
+
+    @retval EOK - the event loop was initialized
+    @retval other - error from epoll_create1
+
+==============================================================================*/
+int EVENTLOOP_Init( void )
+{
+    int result = EOK;
+
+    if ( epfd == -1 )
+    {
+        epfd = epoll_create1( EPOLL_CLOEXEC );
+        if ( epfd == -1 )
+        {
+            result = errno;
+        }
+    }
+
+    if ( expired.pNext == NULL )
+    {
+        InitTimers();
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOOP_Add                                                             */
+/*!
+    Add an event source to the event loop
+
+    The EVENTLOOP_Add function registers the event source's file
+    descriptor with the event loop.  The event source's handler will
+    be invoked from the event loop whenever the file descriptor is ready.
+
+    @param[in]
+        pSource
+            pointer to the event source to add
+
+    @param[in]
+        events
+            epoll events to wait for, eg EPOLLIN
+
+    @retval EOK - the event source was added
+    @retval EINVAL - invalid arguments
+    @retval other - error from epoll_ctl
+
+==============================================================================*/
+int EVENTLOOP_Add( EventSource *pSource, uint32_t events )
+{
+    int result = EINVAL;
+    struct epoll_event ev;
+
+    if ( ( pSource != NULL ) &&
+         ( pSource->fd != -1 ) &&
+         ( pSource->handler != NULL ) )
+    {
+        memset( &ev, 0, sizeof( ev ) );
+        ev.events = events;
+        ev.data.ptr = pSource;
+
+        result = epoll_ctl( epfd, EPOLL_CTL_ADD, pSource->fd, &ev );
+        if ( result == -1 )
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOOP_Remove                                                          */
+/*!
+    Remove an event source from the event loop
+
+    The EVENTLOOP_Remove function de-registers the event source's file
+    descriptor from the event loop.  The file descriptor is not closed.
+
+    @param[in]
+        pSource
+            pointer to the event source to remove
+
+    @retval EOK - the event source was removed
+    @retval EINVAL - invalid arguments
+    @retval other - error from epoll_ctl
+
+==============================================================================*/
+int EVENTLOOP_Remove( EventSource *pSource )
+{
+    int result = EINVAL;
+
+    if ( ( pSource != NULL ) && ( pSource->fd != -1 ) )
+    {
+        result = epoll_ctl( epfd, EPOLL_CTL_DEL, pSource->fd, NULL );
+        if ( result == -1 )
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOOP_StartTimer                                                      */
+/*!
+    Start a timer
+
+    The EVENTLOOP_StartTimer function schedules the timer handler to be
+    invoked from the event loop after the specified delay.  If the timer
+    is already running it is re-scheduled.  Timers which are started
+    with the same expiry time at the same time run in the order in which
+    they were started.
+
+    @param[in]
+        pTimer
+            pointer to the timer to start
+
+    @param[in]
+        delay
+            delay in milliseconds before the timer expires
+
+    @param[in]
+        handler
+            function to invoke when the timer expires
+
+    @param[in]
+        arg
+            opaque argument to pass to the timer handler
+
+    @retval EOK - the timer was started
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+int EVENTLOOP_StartTimer( Timer *pTimer,
+                          int64_t delay,
+                          TimerHandler handler,
+                          void *arg )
+{
+    int result = EINVAL;
+
+    if ( ( pTimer != NULL ) && ( handler != NULL ) )
+    {
+        EVENTLOOP_StopTimer( pTimer );
+
+        if ( expired.pNext == NULL )
+        {
+            InitTimers();
+        }
+
+        pTimer->expiry = EVENTLOOP_GetTime() + ( delay > 0 ? delay : 0 );
+        pTimer->handler = handler;
+        pTimer->arg = arg;
+        pTimer->active = true;
+
+        InsertTimer( pTimer );
+        nTimers++;
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOOP_StopTimer                                                       */
+/*!
+    Stop a timer
+
+    The EVENTLOOP_StopTimer function cancels a scheduled timer.  It is
+    safe to stop a timer which is not running.
+
+    @param[in]
+        pTimer
+            pointer to the timer to stop
+
+    @retval EOK - the timer was stopped
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+int EVENTLOOP_StopTimer( Timer *pTimer )
+{
+    int result = EINVAL;
+
+    if ( pTimer != NULL )
+    {
+        result = EOK;
+
+        if ( pTimer->active == true )
+        {
+            UnlinkTimer( pTimer );
+            pTimer->active = false;
+            nTimers--;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOOP_GetTime                                                         */
+/*!
+    Get the current monotonic time
+
+    The EVENTLOOP_GetTime function gets the current time from the
+    monotonic clock in milliseconds.
+
+    @retval the current monotonic time in milliseconds
+
+==============================================================================*/
+int64_t EVENTLOOP_GetTime( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( (int64_t)ts.tv_sec * 1000 ) + ( ts.tv_nsec / 1000000 );
+}
+
+/*============================================================================*/
+/*  EVENTLOOP_Run                                                             */
+/*!
+    Run the event loop
+
+    The EVENTLOOP_Run function waits for events on all of the registered
+    event sources and dispatches them to their handlers.  Expired timers
+    are dispatched after each wait.
+
+    This function does not return unless an error occurs.
+
+    @retval error code from epoll_wait
+
+==============================================================================*/
+int EVENTLOOP_Run( void )
+{
+    struct epoll_event events[EVENTLOOP_MAX_EVENTS];
+    EventSource *pSource;
+    int result = EOK;
+    int n;
+    int i;
+
+    while ( result == EOK )
+    {
+        n = epoll_wait( epfd, events, EVENTLOOP_MAX_EVENTS, GetTimeout() );
+        if ( n == -1 )
+        {
+            if ( errno != EINTR )
+            {
+                result = errno;
+            }
+        }
+
+        for ( i = 0 ; i < n ; i++ )
+        {
+            pSource = (EventSource *)events[i].data.ptr;
+            if ( ( pSource != NULL ) && ( pSource->handler != NULL ) )
+            {
+                pSource->handler( pSource, events[i].events );
+            }
+        }
+
+        ProcessTimers();
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitTimers                                                                */
+/*!
+    Initialize the timer wheel
+
+    The InitTimers function empties all of the timer wheel slots, and
+    starts the timer wheel at the current time.
+
+==============================================================================*/
+static void InitTimers( void )
+{
+    int level;
+    int slot;
+
+    for ( level = 0 ; level < EVENTLOOP_WHEEL_LEVELS ; level++ )
+    {
+        for ( slot = 0 ; slot < EVENTLOOP_WHEEL_SLOTS ; slot++ )
+        {
+            wheel[level][slot].pNext = &wheel[level][slot];
+            wheel[level][slot].pPrev = &wheel[level][slot];
+        }
+
+        occupied[level] = 0;
+    }
+
+    expired.pNext = &expired;
+    expired.pPrev = &expired;
+
+    wheelTime = EVENTLOOP_GetTime();
+    nTimers = 0;
+}
+
+/*============================================================================*/
+/*  InsertTimer                                                               */
+/*!
+    Insert a timer into the timer wheel
+
+    The InsertTimer function appends a timer to the slot of the lowest
+    timer wheel level which spans the time remaining until it expires.
+    The slot within the level is selected by the expiry time, so each
+    slot of the bottom level only holds timers which expire at the same
+    tick.  A timer which was due before the current tick is added to
+    the expired list.
+
+    @param[in]
+        pTimer
+            pointer to the timer to insert
+
+==============================================================================*/
+static void InsertTimer( Timer *pTimer )
+{
+    int64_t expiry = pTimer->expiry;
+    int64_t delta = expiry - wheelTime;
+    int level = 0;
+    int slot;
+
+    if ( delta < 0 )
+    {
+        AppendTimer( &expired, pTimer );
+    }
+    else
+    {
+        if ( delta >= EVENTLOOP_WHEEL_RANGE )
+        {
+            /* park the timer in the furthest slot of the top level,
+             * from where it will be cascaded again */
+            delta = EVENTLOOP_WHEEL_RANGE - 1;
+            expiry = wheelTime + delta;
+        }
+
+        while ( delta >= ( (int64_t)1 <<
+                           ( EVENTLOOP_WHEEL_BITS * ( level + 1 ) ) ) )
+        {
+            level++;
+        }
+
+        slot = (int)( expiry >> ( EVENTLOOP_WHEEL_BITS * level ) ) &
+               EVENTLOOP_WHEEL_MASK;
+
+        AppendTimer( &wheel[level][slot], pTimer );
+        occupied[level] |= (uint64_t)1 << slot;
+    }
+}
+
+/*============================================================================*/
+/*  AppendTimer                                                               */
+/*!
+    Append a timer to a timer list
+
+    @param[in]
+        pList
+            pointer to the sentinel of the timer list
+
+    @param[in]
+        pTimer
+            pointer to the timer to append
+
+==============================================================================*/
+static void AppendTimer( Timer *pList, Timer *pTimer )
+{
+    pTimer->pNext = pList;
+    pTimer->pPrev = pList->pPrev;
+    pList->pPrev->pNext = pTimer;
+    pList->pPrev = pTimer;
+}
+
+/*============================================================================*/
+/*  UnlinkTimer                                                               */
+/*!
+    Remove a timer from its timer list
+
+    The UnlinkTimer function removes a timer from the timer wheel slot
+    or expired list it is in, and clears the occupied bit of a timer
+    wheel slot which becomes empty.
+
+    @param[in]
+        pTimer
+            pointer to the timer to remove
+
+==============================================================================*/
+static void UnlinkTimer( Timer *pTimer )
+{
+    Timer *pNext = pTimer->pNext;
+    Timer *pPrev = pTimer->pPrev;
+    ptrdiff_t index;
+
+    pPrev->pNext = pNext;
+    pNext->pPrev = pPrev;
+    pTimer->pNext = NULL;
+    pTimer->pPrev = NULL;
+
+    if ( ( pNext == pPrev ) &&
+         ( pNext >= &wheel[0][0] ) &&
+         ( pNext < &wheel[0][0] + EVENTLOOP_WHEEL_LEVELS *
+                                  EVENTLOOP_WHEEL_SLOTS ) )
+    {
+        /* the slot is empty */
+        index = pNext - &wheel[0][0];
+        occupied[index / EVENTLOOP_WHEEL_SLOTS] &=
+            ~( (uint64_t)1 << ( index % EVENTLOOP_WHEEL_SLOTS ) );
+    }
+}
+
+/*============================================================================*/
+/*  RunTimers                                                                 */
+/*!
+    Dispatch the timers of a timer list
+
+    The RunTimers function invokes the handlers of all the timers in
+    a bottom level timer wheel slot or the expired list, in the order in
+    which they were added.  Timers which are added to the list by a
+    handler are dispatched in the same pass.
+
+    @param[in]
+        pList
+            pointer to the sentinel of the timer list
+
+==============================================================================*/
+static void RunTimers( Timer *pList )
+{
+    Timer *pTimer;
+
+    while ( pList->pNext != pList )
+    {
+        pTimer = pList->pNext;
+        UnlinkTimer( pTimer );
+        pTimer->active = false;
+        nTimers--;
+
+        pTimer->handler( pTimer->arg );
+    }
+}
+
+/*============================================================================*/
+/*  Cascade                                                                   */
+/*!
+    Cascade timers down the timer wheel
+
+    The Cascade function is invoked when the timer wheel reaches a tick
+    at which the bottom level wraps.  The timers in the slot of each
+    higher level which has been reached are re-inserted, which moves them
+    to a lower level.  A level is only reached when all of the levels
+    below it have wrapped.
+
+    @param[in]
+        tick
+            the tick being processed
+
+==============================================================================*/
+static void Cascade( int64_t tick )
+{
+    Timer list;
+    Timer *pTimer;
+    Timer *pSlot;
+    int level;
+    int slot;
+
+    for ( level = 1 ; level < EVENTLOOP_WHEEL_LEVELS ; level++ )
+    {
+        slot = (int)( tick >> ( EVENTLOOP_WHEEL_BITS * level ) ) &
+               EVENTLOOP_WHEEL_MASK;
+        pSlot = &wheel[level][slot];
+
+        if ( pSlot->pNext != pSlot )
+        {
+            /* detach the slot's timers before re-inserting them, since
+             * a timer beyond the range of the wheel returns to it */
+            list.pNext = pSlot->pNext;
+            list.pPrev = pSlot->pPrev;
+            list.pNext->pPrev = &list;
+            list.pPrev->pNext = &list;
+            pSlot->pNext = pSlot;
+            pSlot->pPrev = pSlot;
+            occupied[level] &= ~( (uint64_t)1 << slot );
+
+            while ( list.pNext != &list )
+            {
+                pTimer = list.pNext;
+                list.pNext = pTimer->pNext;
+                InsertTimer( pTimer );
+            }
+        }
+
+        if ( slot != 0 )
+        {
+            /* the next level has not been reached */
+            break;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  NextExpiry                                                                */
+/*!
+    Get the time at which the timer wheel next needs processing
+
+    The NextExpiry function finds the earliest tick, from the current
+    tick onwards, at which either a bottom level timer expires or a
+    timer is due to be cascaded from one of the higher levels.  The
+    slots of each level are reached at the start of the span they cover.
+
+    @retval monotonic time (in milliseconds) of the next timer event
+    @retval INT64_MAX - no timers are scheduled in the timer wheel
+
+==============================================================================*/
+static int64_t NextExpiry( void )
+{
+    int64_t next = INT64_MAX;
+    int64_t when;
+    int64_t span;
+    uint64_t bits;
+    unsigned int shift;
+    int level;
+
+    for ( level = 0 ; level < EVENTLOOP_WHEEL_LEVELS ; level++ )
+    {
+        if ( occupied[level] != 0 )
+        {
+            /* first span of the level which has not been reached yet */
+            shift = EVENTLOOP_WHEEL_BITS * level;
+            span = ( wheelTime + ( (int64_t)1 << shift ) - 1 ) >> shift;
+
+            bits = Rotate( occupied[level],
+                           (unsigned int)( span & EVENTLOOP_WHEEL_MASK ) );
+            when = ( span + __builtin_ctzll( bits ) ) << shift;
+            if ( when < next )
+            {
+                next = when;
+            }
+        }
+    }
+
+    return next;
+}
+
+/*============================================================================*/
+/*  Rotate                                                                    */
+/*!
+    Rotate a slot bitmap
+
+    The Rotate function rotates a timer wheel slot bitmap right, so the
+    specified slot becomes bit 0.
+
+    @param[in]
+        bits
+            slot bitmap to rotate
+
+    @param[in]
+        n
+            slot to rotate to bit 0
+
+    @retval the rotated bitmap
+
+==============================================================================*/
+static uint64_t Rotate( uint64_t bits, unsigned int n )
+{
+    return ( n == 0 ) ? bits : ( bits >> n ) | ( bits << ( 64 - n ) );
+}
+
+/*============================================================================*/
+/*  GetTimeout                                                                */
+/*!
+    Get the epoll timeout
+
+    The GetTimeout function calculates how long the event loop may block
+    waiting for events before the timer wheel next needs processing.
+
+    @retval timeout in milliseconds
+    @retval -1 - no timers are scheduled
+
+==============================================================================*/
+static int GetTimeout( void )
+{
+    int timeout = -1;
+    int64_t delay;
+
+    if ( expired.pNext != &expired )
+    {
+        timeout = 0;
+    }
+    else if ( nTimers > 0 )
+    {
+        delay = NextExpiry() - EVENTLOOP_GetTime();
+        if ( delay < 0 )
+        {
+            timeout = 0;
+        }
+        else if ( delay > INT_MAX )
+        {
+            timeout = INT_MAX;
+        }
+        else
+        {
+            timeout = (int)delay;
+        }
+    }
+
+    return timeout;
+}
+
+/*============================================================================*/
+/*  ProcessTimers                                                             */
+/*!
+    Dispatch all expired timers
+
+    The ProcessTimers function advances the timer wheel to the current
+    time, cascading timers and invoking the handlers of all the timers
+    which have expired.  Ticks at which there is nothing to do are
+    skipped, so the cost does not depend on how long the event loop
+    has been waiting.  Timers which are started by a handler with no delay are
+    dispatched in the same pass.
+
+==============================================================================*/
+static void ProcessTimers( void )
+{
+    int64_t now = EVENTLOOP_GetTime();
+    int64_t next;
+
+    if ( expired.pNext != NULL )
+    {
+        RunTimers( &expired );
+
+        next = NextExpiry();
+        while ( next <= now )
+        {
+            wheelTime = next;
+
+            if ( ( wheelTime & EVENTLOOP_WHEEL_MASK ) == 0 )
+            {
+                Cascade( wheelTime );
+            }
+
+            RunTimers( &wheel[0][wheelTime & EVENTLOOP_WHEEL_MASK] );
+
+            /* timers started by the handlers without a delay are due
+             * before the next tick */
+            wheelTime++;
+            RunTimers( &expired );
+
+            next = NextExpiry();
+        }
+
+        if ( wheelTime <= now )
+        {
+            /* the remaining ticks have nothing to do */
+            wheelTime = now + 1;
+        }
+    }
+}
+
+/*! @}
+ * end of eventloop group */
@@ -0,0 +1,1035 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup health health
+ * @brief Process health checks
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file health.c
+
+    Process Health Checks
+
+    The health module periodically probes the health of a running
+    process, to detect a process which is still alive (and so still
+    holds its process lock) but is hung or live-locked.
+
+    A health check is one of:
+
+    - exec:<command> - the command is run with /bin/sh -c and must exit
+      with status 0
+    - tcp:<host>:<port> - a TCP connection must be accepted
+    - http://<host>[:<port>][/<path>] - an HTTP GET request must be
+      answered with a 2xx or 3xx status
+    - heartbeat - the process must have incremented its heartbeat counter
+      in the shared state table since the previous probe
+
+    Probes are driven by event loop timers, and their sockets and processes
+    are watched by the event loop, so no thread is used for any probe and a
+    probe never blocks the process monitor.  Each probe which does not
+    succeed within the health check timeout fails.  The health handler is
+    invoked when the first probe succeeds, and when the configured number
+    of consecutive probes have failed.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include "eventloop.h"
+#include "health.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+#ifndef SYS_pidfd_open
+/*! pidfd_open system call number for libc versions which don't define it */
+#define SYS_pidfd_open 434
+#endif
+
+/*! prefix of an exec health check */
+#define HEALTH_EXEC_PREFIX      "exec:"
+
+/*! prefix of a TCP health check */
+#define HEALTH_TCP_PREFIX       "tcp:"
+
+/*! prefix of an HTTP health check */
+#define HEALTH_HTTP_PREFIX      "http://"
+
+/*! heartbeat health check */
+#define HEALTH_HEARTBEAT        "heartbeat"
+
+/*! shell used to run the command of an exec health check */
+#define HEALTH_SHELL            "/bin/sh"
+
+/*! maximum length of a health check address */
+#define HEALTH_ADDRESS_LEN      ( 256 )
+
+/*! length of the status line prefix of an HTTP response, eg
+ *  "HTTP/1.1 200" */
+#define HEALTH_STATUS_LEN       ( 12 )
+
+/*==============================================================================
+        External Variables
+==============================================================================*/
+
+extern char **environ;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int InitExec( HealthCheck *pCheck, const char *command );
+static int InitHttp( HealthCheck *pCheck, const char *url );
+static int ResolveAddress( HealthCheck *pCheck,
+                           char *address,
+                           const char *port );
+static void Probe( void *arg );
+static int SpawnProbe( HealthCheck *pCheck );
+static int ConnectProbe( HealthCheck *pCheck );
+static void HandleProbe( EventSource *pSource, uint32_t events );
+static bool HandleHttp( HealthCheck *pCheck, uint32_t events, bool *pDone );
+static bool Connected( HealthCheck *pCheck, uint32_t events );
+static void ProbeTimeout( void *arg );
+static void Complete( HealthCheck *pCheck, bool healthy );
+static void EndProbe( HealthCheck *pCheck );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  HEALTH_Init                                                               */
+/*!
+    Initialize a health check
+
+    The HEALTH_Init function parses a health check specification, and
+    initializes the health check.  The address of a TCP or HTTP health
+    check is resolved once, when the health check is initialized.
+
+    @param[in]
+        pCheck
+            pointer to the health check to initialize
+
+    @param[in]
+        spec
+            health check specification, or NULL for no health check
+
+    @param[in]
+        interval
+            interval between probes in seconds
+
+    @param[in]
+        timeout
+            time (in seconds) a probe may take before it fails
+
+    @param[in]
+        threshold
+            number of consecutive failed probes after which the process
+            is considered unhealthy
+
+    @retval EOK - the health check was initialized
+    @retval EINVAL - invalid arguments or health check specification
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int HEALTH_Init( HealthCheck *pCheck,
+                 const char *spec,
+                 int interval,
+                 int timeout,
+                 int threshold )
+{
+    int result = EINVAL;
+    char address[HEALTH_ADDRESS_LEN];
+    size_t len;
+
+    if ( pCheck != NULL )
+    {
+        memset( pCheck, 0, sizeof( HealthCheck ) );
+        pCheck->source.fd = -1;
+        pCheck->interval = (int64_t)( ( interval > 0 ) ? interval : 1 ) * 1000;
+        pCheck->timeout = (int64_t)( ( timeout > 0 ) ? timeout : 1 ) * 1000;
+        pCheck->threshold = ( threshold > 0 ) ? threshold : 1;
+
+        if ( spec == NULL )
+        {
+            result = EOK;
+        }
+        else if ( strcmp( spec, HEALTH_HEARTBEAT ) == 0 )
+        {
+            pCheck->type = HEALTH_eHEARTBEAT;
+            result = EOK;
+        }
+        else if ( strncmp( spec,
+                           HEALTH_EXEC_PREFIX,
+                           strlen( HEALTH_EXEC_PREFIX ) ) == 0 )
+        {
+            result = InitExec( pCheck, &spec[strlen( HEALTH_EXEC_PREFIX )] );
+        }
+        else if ( strncmp( spec,
+                           HEALTH_TCP_PREFIX,
+                           strlen( HEALTH_TCP_PREFIX ) ) == 0 )
+        {
+            len = strlen( &spec[strlen( HEALTH_TCP_PREFIX )] );
+            if ( len < sizeof( address ) )
+            {
+                strcpy( address, &spec[strlen( HEALTH_TCP_PREFIX )] );
+                result = ResolveAddress( pCheck, address, NULL );
+                if ( result == EOK )
+                {
+                    pCheck->type = HEALTH_eTCP;
+                }
+            }
+        }
+        else if ( strncmp( spec,
+                           HEALTH_HTTP_PREFIX,
+                           strlen( HEALTH_HTTP_PREFIX ) ) == 0 )
+        {
+            result = InitHttp( pCheck, &spec[strlen( HEALTH_HTTP_PREFIX )] );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HEALTH_Start                                                              */
+/*!
+    Start checking the health of a process
+
+    The HEALTH_Start function schedules the first probe of a health check
+    one interval from now.  The handler is invoked when the first probe
+    succeeds, and once the configured number of consecutive probes have
+    failed, after which the health check is stopped.  Starting a health
+    check which is already running restarts it.
+
+    @param[in]
+        pCheck
+            pointer to the health check to start
+
+    @param[in]
+        pHeartbeat
+            pointer to the heartbeat counter of the process, used by a
+            heartbeat health check
+
+    @param[in]
+        handler
+            handler to invoke when the health of the process changes
+
+    @param[in]
+        arg
+            opaque argument to pass to the handler
+
+    @retval EOK - the health check was started
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - no health check is configured
+
+==============================================================================*/
+int HEALTH_Start( HealthCheck *pCheck,
+                  const uint32_t *pHeartbeat,
+                  HealthHandler handler,
+                  void *arg )
+{
+    int result = EINVAL;
+
+    if ( ( pCheck != NULL ) && ( handler != NULL ) )
+    {
+        if ( pCheck->type == HEALTH_eNONE )
+        {
+            result = ENOENT;
+        }
+        else
+        {
+            HEALTH_Stop( pCheck );
+
+            pCheck->pHeartbeat = pHeartbeat;
+            pCheck->heartbeat = ( pHeartbeat != NULL )
+                                ? __atomic_load_n( pHeartbeat,
+                                                   __ATOMIC_ACQUIRE )
+                                : 0;
+            pCheck->handler = handler;
+            pCheck->arg = arg;
+            pCheck->failures = 0;
+            pCheck->active = true;
+            pCheck->healthy = false;
+
+            result = EVENTLOOP_StartTimer( &pCheck->timer,
+                                           pCheck->interval,
+                                           Probe,
+                                           pCheck );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HEALTH_Stop                                                               */
+/*!
+    Stop checking the health of a process
+
+    The HEALTH_Stop function cancels the next probe of a health check,
+    and abandons any probe in progress.
+
+    @param[in]
+        pCheck
+            pointer to the health check to stop
+
+==============================================================================*/
+void HEALTH_Stop( HealthCheck *pCheck )
+{
+    if ( ( pCheck != NULL ) && ( pCheck->active == true ) )
+    {
+        EVENTLOOP_StopTimer( &pCheck->timer );
+        EndProbe( pCheck );
+        pCheck->active = false;
+    }
+}
+
+/*============================================================================*/
+/*  HEALTH_Close                                                              */
+/*!
+    Release a health check
+
+    The HEALTH_Close function stops a health check and releases the
+    memory used by its specification.
+
+    @param[in]
+        pCheck
+            pointer to the health check to release
+
+==============================================================================*/
+void HEALTH_Close( HealthCheck *pCheck )
+{
+    if ( pCheck != NULL )
+    {
+        HEALTH_Stop( pCheck );
+
+        free( pCheck->argv );
+        free( pCheck->request );
+        pCheck->argv = NULL;
+        pCheck->request = NULL;
+        pCheck->type = HEALTH_eNONE;
+    }
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  InitExec                                                                  */
+/*!
+    Initialize an exec health check
+
+    The InitExec function creates the argument vector used to run the
+    command of an exec health check with the shell.  The argument vector
+    and the command are stored in a single allocation.
+
+    @param[in]
+        pCheck
+            pointer to the health check to initialize
+
+    @param[in]
+        command
+            command to run
+
+    @retval EOK - the health check was initialized
+    @retval EINVAL - no command was specified
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int InitExec( HealthCheck *pCheck, const char *command )
+{
+    int result = EINVAL;
+    char *p;
+
+    if ( *command != '\0' )
+    {
+        pCheck->argv = malloc( 4 * sizeof( char * ) + strlen( command ) + 1 );
+        if ( pCheck->argv != NULL )
+        {
+            p = (char *)&pCheck->argv[4];
+            strcpy( p, command );
+
+            pCheck->argv[0] = HEALTH_SHELL;
+            pCheck->argv[1] = "-c";
+            pCheck->argv[2] = p;
+            pCheck->argv[3] = NULL;
+
+            pCheck->type = HEALTH_eEXEC;
+            result = EOK;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitHttp                                                                  */
+/*!
+    Initialize an HTTP health check
+
+    The InitHttp function resolves the address of an HTTP health check
+    and creates its request.
+
+    @param[in]
+        pCheck
+            pointer to the health check to initialize
+
+    @param[in]
+        url
+            URL following the http:// prefix: <host>[:<port>][/<path>]
+
+    @retval EOK - the health check was initialized
+    @retval EINVAL - invalid URL
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int InitHttp( HealthCheck *pCheck, const char *url )
+{
+    int result = EINVAL;
+    char address[HEALTH_ADDRESS_LEN];
+    const char *path;
+    size_t len;
+    int n;
+
+    path = strchr( url, '/' );
+    len = ( path != NULL ) ? (size_t)( path - url ) : strlen( url );
+    if ( path == NULL )
+    {
+        path = "/";
+    }
+
+    if ( ( len > 0 ) && ( len < sizeof( address ) ) )
+    {
+        memcpy( address, url, len );
+        address[len] = '\0';
+
+        n = snprintf( NULL,
+                      0,
+                      "GET %s HTTP/1.0\r\nHost: %s\r\n\r\n",
+                      path,
+                      address );
+
+        pCheck->request = malloc( n + 1 );
+        if ( pCheck->request != NULL )
+        {
+            sprintf( pCheck->request,
+                     "GET %s HTTP/1.0\r\nHost: %s\r\n\r\n",
+                     path,
+                     address );
+
+            result = ResolveAddress( pCheck, address, "80" );
+            if ( result == EOK )
+            {
+                pCheck->type = HEALTH_eHTTP;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResolveAddress                                                            */
+/*!
+    Resolve the address of a health check
+
+    The ResolveAddress function resolves a TCP address in one of the forms
+    <host>:<port> or [<IPv6 address>]:<port>.
+
+    @param[in]
+        pCheck
+            pointer to the health check to store the address in
+
+    @param[in]
+        address
+            address to resolve.  The address is modified.
+
+    @param[in]
+        port
+            port to use if the address has no port, or NULL if the port
+            must be specified
+
+    @retval EOK - the address was resolved
+    @retval EINVAL - invalid address
+
+==============================================================================*/
+static int ResolveAddress( HealthCheck *pCheck,
+                           char *address,
+                           const char *port )
+{
+    int result = EINVAL;
+    struct addrinfo hints;
+    struct addrinfo *pInfo = NULL;
+    char *host = address;
+    char *p;
+
+    if ( address[0] == '[' )
+    {
+        /* IPv6 address */
+        p = strchr( address, ']' );
+        if ( p != NULL )
+        {
+            *p = '\0';
+            host = &address[1];
+            if ( p[1] == ':' )
+            {
+                port = &p[2];
+            }
+        }
+    }
+    else if ( ( p = strrchr( address, ':' ) ) != NULL )
+    {
+        *p = '\0';
+        port = &p[1];
+    }
+
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    if ( ( *host != '\0' ) &&
+         ( port != NULL ) &&
+         ( *port != '\0' ) &&
+         ( getaddrinfo( host, port, &hints, &pInfo ) == 0 ) )
+    {
+        if ( pInfo->ai_addrlen <= sizeof( pCheck->addr ) )
+        {
+            memcpy( &pCheck->addr, pInfo->ai_addr, pInfo->ai_addrlen );
+            pCheck->addrlen = pInfo->ai_addrlen;
+            result = EOK;
+        }
+
+        freeaddrinfo( pInfo );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Probe                                                                     */
+/*!
+    Start a health check probe
+
+    The Probe function is invoked by the health check timer to start a
+    probe.  A heartbeat probe completes immediately.  The other probes
+    complete from the event loop, or fail when the health check timeout
+    expires.
+
+    @param[in]
+        arg
+            pointer to the health check
+
+==============================================================================*/
+static void Probe( void *arg )
+{
+    HealthCheck *pCheck = (HealthCheck *)arg;
+    uint32_t heartbeat;
+    int result = EINVAL;
+
+    if ( pCheck != NULL )
+    {
+        switch( pCheck->type )
+        {
+            case HEALTH_eHEARTBEAT:
+                heartbeat = ( pCheck->pHeartbeat != NULL )
+                            ? __atomic_load_n( pCheck->pHeartbeat,
+                                               __ATOMIC_ACQUIRE )
+                            : pCheck->heartbeat;
+                Complete( pCheck, heartbeat != pCheck->heartbeat );
+                pCheck->heartbeat = heartbeat;
+                return;
+
+            case HEALTH_eEXEC:
+                result = SpawnProbe( pCheck );
+                break;
+
+            case HEALTH_eTCP:
+            case HEALTH_eHTTP:
+                result = ConnectProbe( pCheck );
+                break;
+
+            default:
+                break;
+        }
+
+        if ( result == EOK )
+        {
+            EVENTLOOP_StartTimer( &pCheck->timeoutTimer,
+                                  pCheck->timeout,
+                                  ProbeTimeout,
+                                  pCheck );
+        }
+        else
+        {
+            Complete( pCheck, false );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  SpawnProbe                                                                */
+/*!
+    Start an exec health check probe
+
+    The SpawnProbe function runs the command of an exec health check in
+    its own process group with the default signal dispositions, and
+    watches it for its exit using a pidfd.
+
+    @param[in]
+        pCheck
+            pointer to the health check
+
+    @retval EOK - the probe was started
+    @retval other - error from posix_spawn, pidfd_open or epoll_ctl
+
+==============================================================================*/
+static int SpawnProbe( HealthCheck *pCheck )
+{
+    int result;
+    posix_spawnattr_t attr;
+    sigset_t sigmask;
+    sigset_t sigdefault;
+    pid_t pid;
+    int fd;
+
+    sigemptyset( &sigmask );
+    sigfillset( &sigdefault );
+
+    posix_spawnattr_init( &attr );
+    posix_spawnattr_setflags( &attr,
+                              POSIX_SPAWN_SETSIGMASK |
+                              POSIX_SPAWN_SETSIGDEF |
+                              POSIX_SPAWN_SETPGROUP );
+    posix_spawnattr_setsigmask( &attr, &sigmask );
+    posix_spawnattr_setsigdefault( &attr, &sigdefault );
+    posix_spawnattr_setpgroup( &attr, 0 );
+
+    result = posix_spawn( &pid,
+                          pCheck->argv[0],
+                          NULL,
+                          &attr,
+                          pCheck->argv,
+                          environ );
+
+    posix_spawnattr_destroy( &attr );
+
+    if ( result == EOK )
+    {
+        pCheck->pid = pid;
+
+        fd = syscall( SYS_pidfd_open, pid, 0 );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            pCheck->source.fd = fd;
+            pCheck->source.handler = HandleProbe;
+            pCheck->source.arg = pCheck;
+
+            result = EVENTLOOP_Add( &pCheck->source, EPOLLIN );
+        }
+
+        if ( result != EOK )
+        {
+            EndProbe( pCheck );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ConnectProbe                                                              */
+/*!
+    Start a TCP or HTTP health check probe
+
+    The ConnectProbe function starts a non-blocking connection to the
+    address of the health check, and watches it for its completion.
+
+    @param[in]
+        pCheck
+            pointer to the health check
+
+    @retval EOK - the probe was started
+    @retval other - error from socket, connect or epoll_ctl
+
+==============================================================================*/
+static int ConnectProbe( HealthCheck *pCheck )
+{
+    int result = EOK;
+    int fd;
+
+    fd = socket( pCheck->addr.ss_family,
+                 SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                 0 );
+    if ( fd == -1 )
+    {
+        result = errno;
+    }
+    else
+    {
+        pCheck->source.fd = fd;
+        pCheck->source.handler = HandleProbe;
+        pCheck->source.arg = pCheck;
+        pCheck->sent = false;
+        pCheck->received = 0;
+
+        if ( ( connect( fd,
+                        (struct sockaddr *)&pCheck->addr,
+                        pCheck->addrlen ) == -1 ) &&
+             ( errno != EINPROGRESS ) )
+        {
+            result = errno;
+        }
+        else
+        {
+            result = EVENTLOOP_Add( &pCheck->source, EPOLLOUT );
+        }
+
+        if ( result != EOK )
+        {
+            EndProbe( pCheck );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleProbe                                                               */
+/*!
+    Handle the progress of a health check probe
+
+    The HandleProbe function is invoked by the event loop when the command
+    of an exec probe has exited, or the socket of a TCP or HTTP probe is
+    ready.
+
+    @param[in]
+        pSource
+            pointer to the probe event source
+
+    @param[in]
+        events
+            epoll events on the probe file descriptor
+
+==============================================================================*/
+static void HandleProbe( EventSource *pSource, uint32_t events )
+{
+    HealthCheck *pCheck;
+    bool healthy = false;
+    bool done = true;
+    int wstatus;
+
+    if ( ( pSource != NULL ) && ( pSource->arg != NULL ) )
+    {
+        pCheck = (HealthCheck *)pSource->arg;
+
+        switch( pCheck->type )
+        {
+            case HEALTH_eEXEC:
+                if ( waitpid( pCheck->pid, &wstatus, WNOHANG ) == pCheck->pid )
+                {
+                    pCheck->pid = 0;
+                    healthy = WIFEXITED( wstatus ) &&
+                              ( WEXITSTATUS( wstatus ) == 0 );
+                }
+                break;
+
+            case HEALTH_eTCP:
+                healthy = Connected( pCheck, events );
+                break;
+
+            case HEALTH_eHTTP:
+                healthy = HandleHttp( pCheck, events, &done );
+                break;
+
+            default:
+                break;
+        }
+
+        if ( done == true )
+        {
+            Complete( pCheck, healthy );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleHttp                                                                */
+/*!
+    Handle the progress of an HTTP health check probe
+
+    The HandleHttp function sends the request of an HTTP probe once it
+    has connected, and then reads the status line of the response.
+
+    @param[in]
+        pCheck
+            pointer to the health check
+
+    @param[in]
+        events
+            epoll events on the probe socket
+
+    @param[out]
+        pDone
+            pointer to a location to store an indication of whether the
+            probe is complete
+
+    @retval true - the response has a 2xx or 3xx status
+    @retval false - the probe failed or is not complete
+
+==============================================================================*/
+static bool HandleHttp( HealthCheck *pCheck, uint32_t events, bool *pDone )
+{
+    bool healthy = false;
+    size_t len;
+    ssize_t n;
+    int status;
+
+    *pDone = true;
+
+    if ( pCheck->sent == false )
+    {
+        len = strlen( pCheck->request );
+        if ( ( Connected( pCheck, events ) == true ) &&
+             ( send( pCheck->source.fd,
+                     pCheck->request,
+                     len,
+                     MSG_NOSIGNAL ) == (ssize_t)len ) )
+        {
+            /* wait for the response */
+            pCheck->sent = true;
+            EVENTLOOP_Remove( &pCheck->source );
+            *pDone = ( EVENTLOOP_Add( &pCheck->source, EPOLLIN ) != EOK );
+        }
+    }
+    else
+    {
+        n = recv( pCheck->source.fd,
+                  &pCheck->response[pCheck->received],
+                  sizeof( pCheck->response ) - 1 - pCheck->received,
+                  0 );
+        if ( n > 0 )
+        {
+            pCheck->received += n;
+        }
+        else if ( ( n == -1 ) && ( errno == EAGAIN ) )
+        {
+            n = 1;
+        }
+
+        if ( ( n > 0 ) && ( pCheck->received < HEALTH_STATUS_LEN ) )
+        {
+            /* wait for the rest of the status line */
+            *pDone = false;
+        }
+        else
+        {
+            pCheck->response[pCheck->received] = '\0';
+            healthy = ( sscanf( pCheck->response,
+                                "HTTP/%*d.%*d %d",
+                                &status ) == 1 ) &&
+                      ( status >= 200 ) &&
+                      ( status < 400 );
+        }
+    }
+
+    return healthy;
+}
+
+/*============================================================================*/
+/*  Connected                                                                 */
+/*!
+    Check if the connection of a probe succeeded
+
+    @param[in]
+        pCheck
+            pointer to the health check
+
+    @param[in]
+        events
+            epoll events on the probe socket
+
+    @retval true - the probe socket is connected
+    @retval false - the connection failed
+
+==============================================================================*/
+static bool Connected( HealthCheck *pCheck, uint32_t events )
+{
+    int error = 0;
+    socklen_t len = sizeof( error );
+
+    return ( ( events & ( EPOLLERR | EPOLLHUP ) ) == 0 ) &&
+           ( getsockopt( pCheck->source.fd,
+                         SOL_SOCKET,
+                         SO_ERROR,
+                         &error,
+                         &len ) == 0 ) &&
+           ( error == 0 );
+}
+
+/*============================================================================*/
+/*  ProbeTimeout                                                              */
+/*!
+    Fail a health check probe which has taken too long
+
+    @param[in]
+        arg
+            pointer to the health check
+
+==============================================================================*/
+static void ProbeTimeout( void *arg )
+{
+    HealthCheck *pCheck = (HealthCheck *)arg;
+
+    if ( pCheck != NULL )
+    {
+        Complete( pCheck, false );
+    }
+}
+
+/*============================================================================*/
+/*  Complete                                                                  */
+/*!
+    Complete a health check probe
+
+    The Complete function ends a probe and counts its result.  Once the
+    configured number of consecutive probes have failed, the health check
+    is stopped and its handler is invoked.  Otherwise the next probe is
+    scheduled, and the handler is invoked if this is the first probe to
+    succeed.
+
+    @param[in]
+        pCheck
+            pointer to the health check
+
+    @param[in]
+        healthy
+            indicates whether the probe succeeded
+
+==============================================================================*/
+static void Complete( HealthCheck *pCheck, bool healthy )
+{
+    EndProbe( pCheck );
+
+    pCheck->failures = ( healthy == true ) ? 0 : pCheck->failures + 1;
+
+    if ( pCheck->failures >= pCheck->threshold )
+    {
+        /* the process is unhealthy */
+        pCheck->failures = 0;
+        pCheck->active = false;
+        pCheck->healthy = false;
+        pCheck->handler( pCheck->arg, false );
+    }
+    else
+    {
+        EVENTLOOP_StartTimer( &pCheck->timer,
+                              pCheck->interval,
+                              Probe,
+                              pCheck );
+
+        if ( ( healthy == true ) && ( pCheck->healthy == false ) )
+        {
+            pCheck->healthy = true;
+            pCheck->handler( pCheck->arg, true );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  EndProbe                                                                  */
+/*!
+    End a health check probe
+
+    The EndProbe function releases the resources of a probe.  The command
+    of an exec probe which is still running is killed along with its
+    process group and reaped.
+
+    @param[in]
+        pCheck
+            pointer to the health check
+
+==============================================================================*/
+static void EndProbe( HealthCheck *pCheck )
+{
+    EVENTLOOP_StopTimer( &pCheck->timeoutTimer );
+
+    if ( pCheck->source.fd != -1 )
+    {
+        EVENTLOOP_Remove( &pCheck->source );
+        close( pCheck->source.fd );
+        pCheck->source.fd = -1;
+    }
+
+    if ( pCheck->pid > 0 )
+    {
+        (void)kill( -pCheck->pid, SIGKILL );
+        (void)waitpid( pCheck->pid, NULL, 0 );
+        pCheck->pid = 0;
+    }
+}
+
+/*! @}
+ * end of health group */
@@ -0,0 +1,766 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup listener listener
+ * @brief Socket activation listening sockets
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file listener.c
+
+    Socket Activation Listening Sockets
+
+    The listener module binds the listening sockets of a socket activated
+    process.  The sockets are bound by the process monitor before the
+    process is started, so connections to the process are queued by the
+    kernel while the process is not running, and are accepted by the
+    process once it has started.
+
+    The sockets can be watched by the event loop to start the process when
+    the first connection arrives, or to detect activity on the sockets
+    while the process is running.  The connections accepted from the
+    sockets which are still established can be found from the socket
+    tables of /proc/net.
+
+    Each socket address is either an absolute path of a Unix domain
+    socket, or a TCP address in one of the forms <port>, :<port>,
+    <host>:<port> or [<IPv6 address>]:<port>.  Multiple addresses are
+    separated by commas.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "eventloop.h"
+#include "listener.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! maximum length of a socket address */
+#define LISTENER_ADDRESS_LEN    ( 256 )
+
+/*! state of an established TCP connection in /proc/net/tcp */
+#define LISTENER_TCP_ESTABLISHED    ( 0x01 )
+
+/*! state of a connected Unix domain socket in /proc/net/unix */
+#define LISTENER_UNIX_CONNECTED     ( 0x03 )
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int Bind( const char *address, int *pFd );
+static int BindUnix( const char *path, int *pFd );
+static int BindTcp( char *address, int *pFd );
+static bool TcpConnected( const char *table, unsigned int port );
+static bool UnixConnected( const char *path );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  LISTENER_Open                                                             */
+/*!
+    Open the listening sockets of a process
+
+    The LISTENER_Open function creates a listening socket for each of the
+    specified addresses.  The sockets are close-on-exec, and are passed to
+    the process by clearing the close-on-exec flag in the launched child.
+
+    The sockets are kept open while the process is restarted, so no
+    connections are refused while the process is not running.  Opening
+    sockets which are already open has no effect.
+
+    @param[in]
+        pListener
+            pointer to the listener to open
+
+    @param[in]
+        addresses
+            comma separated list of socket addresses
+
+    @retval EOK - the listening sockets are open
+    @retval EINVAL - invalid arguments
+    @retval E2BIG - too many socket addresses
+    @retval ENOMEM - memory allocation failure
+    @retval other - error from socket, bind or listen
+
+==============================================================================*/
+int LISTENER_Open( Listener *pListener, const char *addresses )
+{
+    int result = EINVAL;
+    char address[LISTENER_ADDRESS_LEN];
+    const char *p;
+    size_t len;
+    int fd = -1;
+
+    if ( ( pListener != NULL ) && ( addresses != NULL ) )
+    {
+        result = EOK;
+
+        if ( pListener->addresses == NULL )
+        {
+            pListener->count = 0;
+            pListener->watching = false;
+
+            for ( p = addresses ; ( result == EOK ) && ( *p != '\0' ) ; )
+            {
+                p += strspn( p, ", \t" );
+                len = strcspn( p, ", \t" );
+                if ( len == 0 )
+                {
+                    /* end of the address list */
+                }
+                else if ( len >= sizeof( address ) )
+                {
+                    result = EINVAL;
+                }
+                else if ( pListener->count == LISTENER_MAX_SOCKETS )
+                {
+                    result = E2BIG;
+                }
+                else
+                {
+                    memcpy( address, p, len );
+                    address[len] = '\0';
+
+                    result = Bind( address, &fd );
+                    if ( result == EOK )
+                    {
+                        pListener->sources[pListener->count++].fd = fd;
+                    }
+                    else
+                    {
+                        fprintf( stderr,
+                                 "Failed to listen on %s: %s\n",
+                                 address,
+                                 strerror( result ) );
+                    }
+                }
+
+                p += len;
+            }
+
+            if ( ( result == EOK ) && ( pListener->count == 0 ) )
+            {
+                result = EINVAL;
+            }
+
+            if ( result == EOK )
+            {
+                pListener->addresses = strdup( addresses );
+                if ( pListener->addresses == NULL )
+                {
+                    result = ENOMEM;
+                }
+            }
+
+            if ( result != EOK )
+            {
+                while ( pListener->count > 0 )
+                {
+                    close( pListener->sources[--pListener->count].fd );
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LISTENER_Equal                                                            */
+/*!
+    Check if a listener is bound to the specified addresses
+
+    The LISTENER_Equal function checks if the sockets of an open
+    listener were bound to the specified addresses.  A listener which
+    is not open matches any addresses.
+
+    @param[in]
+        pListener
+            pointer to the listener
+
+    @param[in]
+        addresses
+            comma separated list of socket addresses, or NULL
+
+    @retval true - the listener is bound to the specified addresses
+    @retval false - the listener is bound to different addresses
+
+==============================================================================*/
+bool LISTENER_Equal( Listener *pListener, const char *addresses )
+{
+    bool result = true;
+
+    if ( ( pListener != NULL ) && ( pListener->addresses != NULL ) )
+    {
+        result = ( addresses != NULL ) &&
+                 ( strcmp( pListener->addresses, addresses ) == 0 );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LISTENER_Watch                                                            */
+/*!
+    Watch the listening sockets of a process
+
+    The LISTENER_Watch function adds the listening sockets to the event
+    loop, so the specified handler is invoked when a connection arrives.
+    The connections are not accepted, they are left for the process to
+    accept.  Any previous watch of the sockets is replaced.
+
+    @param[in]
+        pListener
+            pointer to the listener to watch
+
+    @param[in]
+        events
+            epoll events to watch for, eg EPOLLIN, or EPOLLIN | EPOLLET
+            to be notified once for each new connection
+
+    @param[in]
+        handler
+            handler to invoke when a connection arrives
+
+    @param[in]
+        arg
+            opaque argument to pass to the handler
+
+    @retval EOK - the sockets are being watched
+    @retval EINVAL - invalid arguments
+    @retval other - error from epoll_ctl
+
+==============================================================================*/
+int LISTENER_Watch( Listener *pListener,
+                    uint32_t events,
+                    EventHandler handler,
+                    void *arg )
+{
+    int result = EINVAL;
+    size_t i;
+
+    if ( ( pListener != NULL ) &&
+         ( pListener->addresses != NULL ) &&
+         ( handler != NULL ) )
+    {
+        LISTENER_Unwatch( pListener );
+
+        result = EOK;
+        pListener->watching = true;
+
+        for ( i = 0 ; ( result == EOK ) && ( i < pListener->count ) ; i++ )
+        {
+            pListener->sources[i].handler = handler;
+            pListener->sources[i].arg = arg;
+            result = EVENTLOOP_Add( &pListener->sources[i], events );
+        }
+
+        if ( result != EOK )
+        {
+            /* remove the sockets which were added before the failure */
+            for ( i = i - 1 ; i > 0 ; i-- )
+            {
+                EVENTLOOP_Remove( &pListener->sources[i - 1] );
+            }
+
+            pListener->watching = false;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LISTENER_Unwatch                                                          */
+/*!
+    Stop watching the listening sockets of a process
+
+    The LISTENER_Unwatch function removes the listening sockets from the
+    event loop.  The sockets remain open.
+
+    @param[in]
+        pListener
+            pointer to the listener to stop watching
+
+==============================================================================*/
+void LISTENER_Unwatch( Listener *pListener )
+{
+    size_t i;
+
+    if ( ( pListener != NULL ) && ( pListener->watching == true ) )
+    {
+        for ( i = 0 ; i < pListener->count ; i++ )
+        {
+            EVENTLOOP_Remove( &pListener->sources[i] );
+        }
+
+        pListener->watching = false;
+    }
+}
+
+/*============================================================================*/
+/*  LISTENER_Close                                                            */
+/*!
+    Close the listening sockets of a process
+
+    The LISTENER_Close function stops watching and closes the listening
+    sockets.  Connections which have not been accepted are refused.
+
+    @param[in]
+        pListener
+            pointer to the listener to close
+
+==============================================================================*/
+void LISTENER_Close( Listener *pListener )
+{
+    if ( ( pListener != NULL ) && ( pListener->addresses != NULL ) )
+    {
+        LISTENER_Unwatch( pListener );
+
+        while ( pListener->count > 0 )
+        {
+            close( pListener->sources[--pListener->count].fd );
+        }
+
+        free( pListener->addresses );
+        pListener->addresses = NULL;
+    }
+}
+
+/*============================================================================*/
+/*  LISTENER_Connected                                                        */
+/*!
+    Check if a listener has established connections
+
+    The LISTENER_Connected function checks if any connection accepted
+    from the listening sockets is still established, by looking up the
+    connections to the socket addresses in /proc/net.  The connections
+    may be held by any process.
+
+    @param[in]
+        pListener
+            pointer to the listener to check
+
+    @retval true - a connection to the listening sockets is established
+    @retval false - the listening sockets have no established connections
+
+==============================================================================*/
+bool LISTENER_Connected( Listener *pListener )
+{
+    bool result = false;
+    struct sockaddr_storage addr;
+    struct sockaddr_un *pUnix = (struct sockaddr_un *)&addr;
+    socklen_t len;
+    unsigned int port;
+    size_t i;
+
+    if ( ( pListener != NULL ) && ( pListener->addresses != NULL ) )
+    {
+        for ( i = 0 ; ( result == false ) && ( i < pListener->count ) ; i++ )
+        {
+            len = sizeof( addr );
+            memset( &addr, 0, sizeof( addr ) );
+            if ( getsockname( pListener->sources[i].fd,
+                              (struct sockaddr *)&addr,
+                              &len ) != 0 )
+            {
+                /* the socket address is not known */
+            }
+            else if ( addr.ss_family == AF_UNIX )
+            {
+                result = UnixConnected( pUnix->sun_path );
+            }
+            else if ( addr.ss_family == AF_INET )
+            {
+                port = ntohs( ((struct sockaddr_in *)&addr)->sin_port );
+                result = TcpConnected( "/proc/net/tcp", port );
+            }
+            else if ( addr.ss_family == AF_INET6 )
+            {
+                /* a dual stack socket accepts IPv4 connections, which
+                 * are listed with IPv4-mapped IPv6 addresses */
+                port = ntohs( ((struct sockaddr_in6 *)&addr)->sin6_port );
+                result = TcpConnected( "/proc/net/tcp6", port ) ||
+                         TcpConnected( "/proc/net/tcp", port );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  Bind                                                                      */
+/*!
+    Create a listening socket
+
+    The Bind function creates a listening socket bound to the specified
+    Unix domain socket path or TCP address.
+
+    @param[in]
+        address
+            socket address
+
+    @param[out]
+        pFd
+            pointer to a location to store the listening socket
+
+    @retval EOK - the listening socket was created
+    @retval EINVAL - invalid address
+    @retval other - error from socket, bind or listen
+
+==============================================================================*/
+static int Bind( const char *address, int *pFd )
+{
+    int result = EINVAL;
+    char buf[LISTENER_ADDRESS_LEN];
+
+    if ( ( address != NULL ) && ( pFd != NULL ) )
+    {
+        if ( address[0] == '/' )
+        {
+            result = BindUnix( address, pFd );
+        }
+        else
+        {
+            /* the TCP address is split into its host and port */
+            strcpy( buf, address );
+            result = BindTcp( buf, pFd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BindUnix                                                                  */
+/*!
+    Create a listening Unix domain socket
+
+    The BindUnix function creates a Unix domain socket listening at the
+    specified path, replacing any stale socket left behind by a previous
+    instance.
+
+    @param[in]
+        path
+            path of the socket
+
+    @param[out]
+        pFd
+            pointer to a location to store the listening socket
+
+    @retval EOK - the listening socket was created
+    @retval ENAMETOOLONG - the socket path is too long
+    @retval other - error from socket, bind or listen
+
+==============================================================================*/
+static int BindUnix( const char *path, int *pFd )
+{
+    int result = EOK;
+    struct sockaddr_un addr;
+    int fd;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+
+    if ( strlen( path ) >= sizeof( addr.sun_path ) )
+    {
+        result = ENAMETOOLONG;
+    }
+    else
+    {
+        strcpy( addr.sun_path, path );
+
+        fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            /* remove any stale socket */
+            unlink( path );
+
+            if ( ( bind( fd,
+                         (struct sockaddr *)&addr,
+                         sizeof( addr ) ) == -1 ) ||
+                 ( listen( fd, SOMAXCONN ) == -1 ) )
+            {
+                result = errno;
+                close( fd );
+            }
+            else
+            {
+                *pFd = fd;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BindTcp                                                                   */
+/*!
+    Create a listening TCP socket
+
+    The BindTcp function creates a TCP socket listening on the specified
+    address.  A missing host listens on all addresses.
+
+    @param[in]
+        address
+            TCP address in one of the forms <port>, :<port>, <host>:<port>
+            or [<IPv6 address>]:<port>.  The address is modified.
+
+    @param[out]
+        pFd
+            pointer to a location to store the listening socket
+
+    @retval EOK - the listening socket was created
+    @retval EINVAL - invalid address
+    @retval other - error from socket, bind or listen
+
+==============================================================================*/
+static int BindTcp( char *address, int *pFd )
+{
+    int result = EINVAL;
+    struct addrinfo hints;
+    struct addrinfo *pInfo = NULL;
+    char *host = NULL;
+    char *port;
+    char *p;
+    int fd;
+    int on = 1;
+
+    port = address;
+
+    if ( address[0] == '[' )
+    {
+        /* IPv6 address */
+        p = strchr( address, ']' );
+        if ( ( p != NULL ) && ( p[1] == ':' ) )
+        {
+            *p = '\0';
+            host = &address[1];
+            port = &p[2];
+        }
+    }
+    else if ( ( p = strrchr( address, ':' ) ) != NULL )
+    {
+        *p = '\0';
+        host = ( p != address ) ? address : NULL;
+        port = &p[1];
+    }
+
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+    if ( ( *port != '\0' ) &&
+         ( getaddrinfo( host, port, &hints, &pInfo ) == 0 ) )
+    {
+        result = EOK;
+
+        fd = socket( pInfo->ai_family,
+                     pInfo->ai_socktype | SOCK_CLOEXEC,
+                     pInfo->ai_protocol );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else if ( ( setsockopt( fd,
+                                SOL_SOCKET,
+                                SO_REUSEADDR,
+                                &on,
+                                sizeof( on ) ) == -1 ) ||
+                  ( bind( fd, pInfo->ai_addr, pInfo->ai_addrlen ) == -1 ) ||
+                  ( listen( fd, SOMAXCONN ) == -1 ) )
+        {
+            result = errno;
+            close( fd );
+        }
+        else
+        {
+            *pFd = fd;
+        }
+
+        freeaddrinfo( pInfo );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TcpConnected                                                              */
+/*!
+    Check for an established TCP connection on a local port
+
+    The TcpConnected function searches a /proc/net TCP socket table for
+    an established connection whose local port is the specified port.
+
+    @param[in]
+        table
+            path of the socket table, /proc/net/tcp or /proc/net/tcp6
+
+    @param[in]
+        port
+            local port of the listening socket
+
+    @retval true - an established connection to the port was found
+    @retval false - no established connection to the port was found
+
+==============================================================================*/
+static bool TcpConnected( const char *table, unsigned int port )
+{
+    bool result = false;
+    char line[256];
+    unsigned int localPort;
+    unsigned int state;
+    FILE *fp;
+
+    fp = fopen( table, "r" );
+    if ( fp != NULL )
+    {
+        /* skip the heading */
+        if ( fgets( line, sizeof( line ), fp ) != NULL )
+        {
+            while ( ( result == false ) &&
+                    ( fgets( line, sizeof( line ), fp ) != NULL ) )
+            {
+                /* sl local_address:port rem_address:port st ... */
+                if ( ( sscanf( line,
+                               "%*u: %*[0-9A-Fa-f]:%x %*[0-9A-Fa-f]:%*x %x",
+                               &localPort,
+                               &state ) == 2 ) &&
+                     ( localPort == port ) &&
+                     ( state == LISTENER_TCP_ESTABLISHED ) )
+                {
+                    result = true;
+                }
+            }
+        }
+
+        fclose( fp );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  UnixConnected                                                             */
+/*!
+    Check for a connected Unix domain socket on a path
+
+    The UnixConnected function searches /proc/net/unix for a connected
+    socket other than the listening socket which is bound to the
+    specified path.  The connections accepted by a listening socket are
+    listed with the path of the listening socket.
+
+    @param[in]
+        path
+            path of the listening socket
+
+    @retval true - a connection to the path was found
+    @retval false - no connection to the path was found
+
+==============================================================================*/
+static bool UnixConnected( const char *path )
+{
+    bool result = false;
+    char line[LISTENER_ADDRESS_LEN + 128];
+    char name[LISTENER_ADDRESS_LEN];
+    unsigned int flags;
+    unsigned int state;
+    FILE *fp;
+
+    fp = fopen( "/proc/net/unix", "r" );
+    if ( ( fp != NULL ) && ( path[0] != '\0' ) )
+    {
+        /* skip the heading */
+        if ( fgets( line, sizeof( line ), fp ) != NULL )
+        {
+            while ( ( result == false ) &&
+                    ( fgets( line, sizeof( line ), fp ) != NULL ) )
+            {
+                /* Num RefCount Protocol Flags Type St Inode Path,
+                 * where the __SO_ACCEPTCON flag marks listening sockets */
+                if ( ( sscanf( line,
+                               "%*s %*x %*x %x %*x %x %*u %255s",
+                               &flags,
+                               &state,
+                               name ) == 3 ) &&
+                     ( state == LISTENER_UNIX_CONNECTED ) &&
+                     ( ( flags & 0x10000 ) == 0 ) &&
+                     ( strcmp( name, path ) == 0 ) )
+                {
+                    result = true;
+                }
+            }
+        }
+    }
+
+    if ( fp != NULL )
+    {
+        fclose( fp );
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of listener group */
@@ -0,0 +1,626 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup logbuffer logbuffer
+ * @brief Process output capture
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file logbuffer.c
+
+    Process Output Capture
+
+    The logbuffer module captures the stdout and stderr output of a
+    process through a pipe which is read by the event loop.
+
+    The output is read directly into a fixed size ring buffer, so no
+    memory is allocated while the process is running, and the most
+    recent output can be retrieved at any time.  When a log file is
+    configured the output is also written to the file from the ring
+    buffer.  A log file without a ring buffer is filled by splicing the
+    pipe into the file, so the output is not copied through user space.
+    The log file is rotated to <file>.1 when it reaches its maximum size.
+
+    The read end of the pipe is non-blocking, and the event loop reads
+    from at most one ring buffer segment per event, so a process which
+    writes a lot of output cannot stall the process monitor.  The write
+    end is blocking, so a process which writes faster than its output
+    can be captured is held back by the pipe rather than losing output.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include "eventloop.h"
+#include "logbuffer.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! maximum number of bytes spliced into a log file per event */
+#define LOGBUFFER_SPLICE_SIZE   ( 64 * 1024 )
+
+/*! size of the buffer used to discard output which cannot be logged */
+#define LOGBUFFER_DISCARD_SIZE  ( 4096 )
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static void HandleLogData( EventSource *pSource, uint32_t events );
+static int OpenFile( LogBuffer *pLog );
+static void WriteFile( LogBuffer *pLog, const char *buf, size_t len );
+static void RotateFile( LogBuffer *pLog );
+static void Discard( LogBuffer *pLog );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  LOGBUFFER_Open                                                            */
+/*!
+    Open the log capture of a process
+
+    The LOGBUFFER_Open function creates the pipe used to capture the
+    output of a process and adds it to the event loop.  The ring buffer
+    is allocated, and the log file is opened.
+
+    The log capture is kept open while the process is restarted, so the
+    output of successive runs of the process is kept together.  Opening
+    a log capture which is already open has no effect.
+
+    @param[in]
+        pLog
+            pointer to the log capture to open
+
+    @param[in]
+        size
+            size of the ring buffer in bytes, or 0 for no ring buffer
+
+    @param[in]
+        path
+            path of the log file, or NULL for no log file
+
+    @param[in]
+        maxFileSize
+            size (in bytes) at which the log file is rotated, or 0 to
+            never rotate the log file
+
+    @retval EOK - the log capture is open
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+    @retval other - error from pipe2, open or epoll_ctl
+
+==============================================================================*/
+int LOGBUFFER_Open( LogBuffer *pLog,
+                    size_t size,
+                    const char *path,
+                    size_t maxFileSize )
+{
+    int result = EINVAL;
+    int fds[2];
+
+    if ( ( pLog != NULL ) && ( pLog->open == true ) )
+    {
+        result = EOK;
+    }
+    else if ( ( pLog != NULL ) && ( ( size > 0 ) || ( path != NULL ) ) )
+    {
+        memset( pLog, 0, sizeof( LogBuffer ) );
+        pLog->source.fd = -1;
+        pLog->writefd = -1;
+        pLog->filefd = -1;
+        pLog->size = size;
+        pLog->maxFileSize = maxFileSize;
+
+        result = EOK;
+
+        if ( size > 0 )
+        {
+            pLog->pData = malloc( size );
+            result = ( pLog->pData != NULL ) ? EOK : ENOMEM;
+        }
+
+        if ( ( result == EOK ) && ( path != NULL ) )
+        {
+            pLog->path = strdup( path );
+            result = ( pLog->path != NULL ) ? OpenFile( pLog ) : ENOMEM;
+        }
+
+        if ( result == EOK )
+        {
+            /* only the read end is non-blocking, so the process is
+             * held back rather than failing when the pipe is full */
+            if ( pipe2( fds, O_CLOEXEC ) == 0 )
+            {
+                pLog->source.fd = fds[0];
+                pLog->writefd = fds[1];
+                fcntl( fds[0], F_SETFL, O_NONBLOCK );
+            }
+            else
+            {
+                result = errno;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            pLog->source.handler = HandleLogData;
+            pLog->source.arg = pLog;
+            result = EVENTLOOP_Add( &pLog->source, EPOLLIN );
+        }
+
+        pLog->open = true;
+        if ( result != EOK )
+        {
+            LOGBUFFER_Close( pLog );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LOGBUFFER_GetFd                                                           */
+/*!
+    Get the file descriptor a process writes its output to
+
+    The LOGBUFFER_GetFd function gets the write end of the log pipe,
+    which is passed to the process as its stdout and stderr.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+    @retval fd - write end of the log pipe
+    @retval -1 - the log capture is not open
+
+==============================================================================*/
+int LOGBUFFER_GetFd( LogBuffer *pLog )
+{
+    return ( ( pLog != NULL ) && ( pLog->open == true ) ) ? pLog->writefd
+                                                          : -1;
+}
+
+/*============================================================================*/
+/*  LOGBUFFER_Equal                                                           */
+/*!
+    Check if a log capture has the specified settings
+
+    The LOGBUFFER_Equal function checks if an open log capture was
+    opened with the specified settings.  A log capture which is not open
+    matches any settings.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+    @param[in]
+        size
+            size of the ring buffer in bytes
+
+    @param[in]
+        path
+            path of the log file, or NULL
+
+    @param[in]
+        maxFileSize
+            size (in bytes) at which the log file is rotated
+
+    @retval true - the log capture has the specified settings
+    @retval false - the log capture has different settings
+
+==============================================================================*/
+bool LOGBUFFER_Equal( LogBuffer *pLog,
+                      size_t size,
+                      const char *path,
+                      size_t maxFileSize )
+{
+    bool result = true;
+
+    if ( ( pLog != NULL ) && ( pLog->open == true ) )
+    {
+        result = ( pLog->size == size ) &&
+                 ( pLog->maxFileSize == maxFileSize ) &&
+                 ( ( ( pLog->path == NULL ) || ( path == NULL ) )
+                    ? ( pLog->path == path )
+                    : ( strcmp( pLog->path, path ) == 0 ) );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LOGBUFFER_Write                                                           */
+/*!
+    Write the captured output of a process
+
+    The LOGBUFFER_Write function writes the contents of the ring buffer
+    to an output stream.  If the ring buffer has wrapped, the partial
+    line at the start of the buffer is skipped.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+    @param[in]
+        fp
+            output stream to write the output to
+
+    @retval EOK - the output was written
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the log capture has no ring buffer
+
+==============================================================================*/
+int LOGBUFFER_Write( LogBuffer *pLog, FILE *fp )
+{
+    int result = EINVAL;
+    size_t offset;
+    size_t len;
+    char *p;
+
+    if ( ( pLog != NULL ) && ( fp != NULL ) )
+    {
+        if ( ( pLog->open == false ) || ( pLog->pData == NULL ) )
+        {
+            result = ENOENT;
+        }
+        else if ( pLog->total <= pLog->size )
+        {
+            fwrite( pLog->pData, 1, pLog->total, fp );
+            result = EOK;
+        }
+        else
+        {
+            /* the oldest output starts after the newest output */
+            offset = pLog->total % pLog->size;
+            len = pLog->size - offset;
+
+            p = memchr( &pLog->pData[offset], '\n', len );
+            if ( p != NULL )
+            {
+                p++;
+                fwrite( p, 1, &pLog->pData[pLog->size] - p, fp );
+                fwrite( pLog->pData, 1, offset, fp );
+            }
+            else if ( ( p = memchr( pLog->pData, '\n', offset ) ) != NULL )
+            {
+                p++;
+                fwrite( p, 1, &pLog->pData[offset] - p, fp );
+            }
+
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LOGBUFFER_Close                                                           */
+/*!
+    Close the log capture of a process
+
+    The LOGBUFFER_Close function removes the log pipe from the event
+    loop, and closes the pipe and the log file.  The ring buffer is
+    freed.
+
+    @param[in]
+        pLog
+            pointer to the log capture to close
+
+==============================================================================*/
+void LOGBUFFER_Close( LogBuffer *pLog )
+{
+    if ( ( pLog != NULL ) && ( pLog->open == true ) )
+    {
+        if ( pLog->source.fd != -1 )
+        {
+            EVENTLOOP_Remove( &pLog->source );
+            close( pLog->source.fd );
+        }
+
+        if ( pLog->writefd != -1 )
+        {
+            close( pLog->writefd );
+        }
+
+        if ( pLog->filefd != -1 )
+        {
+            close( pLog->filefd );
+        }
+
+        free( pLog->pData );
+        free( pLog->path );
+
+        memset( pLog, 0, sizeof( LogBuffer ) );
+        pLog->source.fd = -1;
+        pLog->writefd = -1;
+        pLog->filefd = -1;
+    }
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  HandleLogData                                                             */
+/*!
+    Handle output from a process
+
+    The HandleLogData function is invoked by the event loop when the
+    log pipe of a process is readable.  The output is read into the
+    free space at the end of the ring buffer, overwriting the oldest
+    output, and is written to the log file.  Without a ring buffer, the
+    output is spliced from the pipe into the log file.
+
+    Only one read is made per event, and the event loop invokes the
+    handler again if more output is available.
+
+    @param[in]
+        pSource
+            pointer to the log pipe event source
+
+    @param[in]
+        events
+            epoll events (unused)
+
+==============================================================================*/
+static void HandleLogData( EventSource *pSource, uint32_t events )
+{
+    LogBuffer *pLog;
+    size_t offset;
+    ssize_t n;
+
+    (void)events;
+
+    if ( ( pSource != NULL ) && ( pSource->arg != NULL ) )
+    {
+        pLog = (LogBuffer *)pSource->arg;
+
+        if ( pLog->pData != NULL )
+        {
+            offset = pLog->total % pLog->size;
+            n = read( pSource->fd,
+                      &pLog->pData[offset],
+                      pLog->size - offset );
+            if ( n > 0 )
+            {
+                pLog->total += n;
+                if ( pLog->filefd != -1 )
+                {
+                    WriteFile( pLog, &pLog->pData[offset], n );
+                }
+            }
+        }
+        else if ( pLog->filefd != -1 )
+        {
+            n = splice( pSource->fd,
+                        NULL,
+                        pLog->filefd,
+                        NULL,
+                        LOGBUFFER_SPLICE_SIZE,
+                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+            if ( n > 0 )
+            {
+                pLog->fileSize += n;
+                RotateFile( pLog );
+            }
+            else if ( ( n == -1 ) && ( errno != EAGAIN ) )
+            {
+                /* don't let the process block on output which
+                 * cannot be logged */
+                Discard( pLog );
+            }
+        }
+        else
+        {
+            Discard( pLog );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  OpenFile                                                                  */
+/*!
+    Open the log file
+
+    The OpenFile function opens the log file for writing at its end.
+    The log file is not opened in append mode, since output cannot be
+    spliced into a file opened in append mode.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+    @retval EOK - the log file was opened
+    @retval other - error from open
+
+==============================================================================*/
+static int OpenFile( LogBuffer *pLog )
+{
+    int result = EOK;
+    off_t size;
+
+    pLog->filefd = open( pLog->path,
+                         O_WRONLY | O_CREAT | O_CLOEXEC,
+                         0644 );
+    if ( pLog->filefd == -1 )
+    {
+        result = errno;
+    }
+    else
+    {
+        size = lseek( pLog->filefd, 0, SEEK_END );
+        pLog->fileSize = ( size > 0 ) ? (size_t)size : 0;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WriteFile                                                                 */
+/*!
+    Write output to the log file
+
+    The WriteFile function writes output from the ring buffer to the
+    log file, and rotates the log file if it has reached its maximum
+    size.  Output which cannot be written is counted and dropped.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+    @param[in]
+        buf
+            pointer to the output to write
+
+    @param[in]
+        len
+            number of bytes to write
+
+==============================================================================*/
+static void WriteFile( LogBuffer *pLog, const char *buf, size_t len )
+{
+    ssize_t n;
+
+    while ( len > 0 )
+    {
+        n = write( pLog->filefd, buf, len );
+        if ( n > 0 )
+        {
+            pLog->fileSize += n;
+            buf += n;
+            len -= n;
+        }
+        else if ( ( n == -1 ) && ( errno == EINTR ) )
+        {
+            continue;
+        }
+        else
+        {
+            pLog->dropped += len;
+            break;
+        }
+    }
+
+    RotateFile( pLog );
+}
+
+/*============================================================================*/
+/*  RotateFile                                                                */
+/*!
+    Rotate the log file
+
+    The RotateFile function renames the log file to <file>.1, replacing
+    the previous rotated log file, and opens a new log file once the log
+    file has reached its maximum size.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+==============================================================================*/
+static void RotateFile( LogBuffer *pLog )
+{
+    char path[PATH_MAX];
+    int rc;
+
+    if ( ( pLog->maxFileSize > 0 ) &&
+         ( pLog->fileSize >= pLog->maxFileSize ) &&
+         ( pLog->filefd != -1 ) )
+    {
+        close( pLog->filefd );
+        pLog->filefd = -1;
+
+        if ( (size_t)snprintf( path, sizeof( path ), "%s.1", pLog->path ) <
+                sizeof( path ) )
+        {
+            (void)rename( pLog->path, path );
+        }
+
+        rc = OpenFile( pLog );
+        if ( rc != EOK )
+        {
+            fprintf( stderr,
+                     "Failed to open log file %s: %s\n",
+                     pLog->path,
+                     strerror( rc ) );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Discard                                                                   */
+/*!
+    Discard output which cannot be logged
+
+    The Discard function reads and drops output from the log pipe when
+    it cannot be written to the log file.
+
+    @param[in]
+        pLog
+            pointer to the log capture
+
+==============================================================================*/
+static void Discard( LogBuffer *pLog )
+{
+    char buf[LOGBUFFER_DISCARD_SIZE];
+    ssize_t n;
+
+    n = read( pLog->source.fd, buf, sizeof( buf ) );
+    if ( n > 0 )
+    {
+        pLog->dropped += n;
+    }
+}
+
+/*! @}
+ * end of logbuffer group */
@@ -0,0 +1,1046 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup metrics metrics
+ * @brief Process resource usage metrics
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file metrics.c
+
+    Process Metrics
+
+    The metrics module samples the CPU time, resident memory, open file
+    descriptor count and context switches of the monitored processes,
+    keeps a restart latency histogram for each process, and writes them
+    in the OpenMetrics text format.
+
+    The /proc files of each process are opened once and kept open while
+    the process is running.  Each sample reads a file with a single pread
+    from the start of the file, so sampling a process takes three system
+    calls plus one getdents64 call per 64 open file descriptors.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "metrics.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! size of the buffer used to read a /proc file */
+#define METRICS_READ_SIZE       ( 4096 )
+
+/*! OpenMetrics content type */
+#define METRICS_CONTENT_TYPE \
+    "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! directory entry returned by the getdents64 system call */
+struct linux_dirent64
+{
+    /*! inode number */
+    uint64_t d_ino;
+
+    /*! offset of the next entry */
+    int64_t d_off;
+
+    /*! size of this entry */
+    unsigned short d_reclen;
+
+    /*! file type */
+    unsigned char d_type;
+
+    /*! NUL terminated file name */
+    char d_name[];
+};
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! upper bounds of the restart latency histogram buckets in seconds */
+static const double buckets[METRICS_BUCKETS] =
+{
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+    1.0, 2.5, 5.0, 10.0, 30.0, 60.0
+};
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int OpenProcFiles( ProcessMetrics *pMetrics, pid_t pid );
+static void CloseProcFiles( ProcessMetrics *pMetrics );
+static int ReadProcFile( int fd, char *buf, size_t len );
+static int ReadStat( ProcessMetrics *pMetrics, char *buf );
+static int ReadStatus( ProcessMetrics *pMetrics, char *buf );
+static int CountFds( ProcessMetrics *pMetrics, char *buf );
+static void WriteFamily( FILE *fp, char *name, char *type, char *help );
+static void WriteLabel( FILE *fp, const char *id );
+static int64_t GetTime( void );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  METRICS_Init                                                              */
+/*!
+    Initialize a process metrics object
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object to initialize
+
+    @param[in]
+        id
+            process identifier used as the id label, or NULL if the
+            process is not reported
+
+==============================================================================*/
+void METRICS_Init( ProcessMetrics *pMetrics, const char *id )
+{
+    if ( pMetrics != NULL )
+    {
+        memset( pMetrics, 0, sizeof( ProcessMetrics ) );
+        pMetrics->id = id;
+        pMetrics->statfd = -1;
+        pMetrics->statusfd = -1;
+        pMetrics->fdfd = -1;
+        pMetrics->exitCode = -1;
+    }
+}
+
+/*============================================================================*/
+/*  METRICS_Sample                                                            */
+/*!
+    Sample the resource usage of a process
+
+    The METRICS_Sample function samples the resource usage of the
+    specified process.  The /proc files of the process are opened the
+    first time it is sampled, and are reused until the process changes.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object to update
+
+    @param[in]
+        pid
+            process identifier of the process, or 0 if it is not running
+
+    @param[in]
+        restarts
+            number of times the process has been restarted
+
+    @retval EOK - the process was sampled
+    @retval EINVAL - invalid arguments
+    @retval ESRCH - the process is not running
+
+==============================================================================*/
+int METRICS_Sample( ProcessMetrics *pMetrics, pid_t pid, uint64_t restarts )
+{
+    int result = EINVAL;
+    char buf[METRICS_READ_SIZE];
+
+    if ( pMetrics != NULL )
+    {
+        pMetrics->restarts = restarts;
+
+        if ( pid != pMetrics->pid )
+        {
+            /* the process has been restarted */
+            CloseProcFiles( pMetrics );
+        }
+
+        result = ( pid > 0 ) ? EOK : ESRCH;
+
+        if ( ( result == EOK ) && ( pMetrics->statfd == -1 ) )
+        {
+            result = OpenProcFiles( pMetrics, pid );
+        }
+
+        if ( result == EOK )
+        {
+            result = ReadStat( pMetrics, buf );
+        }
+
+        if ( result == EOK )
+        {
+            result = ReadStatus( pMetrics, buf );
+        }
+
+        if ( result == EOK )
+        {
+            result = CountFds( pMetrics, buf );
+        }
+
+        pMetrics->up = ( result == EOK );
+        if ( result != EOK )
+        {
+            /* the process has gone away */
+            CloseProcFiles( pMetrics );
+            result = ESRCH;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  METRICS_Close                                                             */
+/*!
+    Close the cached /proc files of a process
+
+    The METRICS_Close function closes the /proc files of a process which
+    will no longer be sampled.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+==============================================================================*/
+void METRICS_Close( ProcessMetrics *pMetrics )
+{
+    if ( pMetrics != NULL )
+    {
+        CloseProcFiles( pMetrics );
+        pMetrics->up = false;
+    }
+}
+
+/*============================================================================*/
+/*  METRICS_SampleExits                                                       */
+/*!
+    Sample the exit history of a process
+
+    The METRICS_SampleExits function updates the exit count of a process
+    and the outcome of its most recent exit.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object to update
+
+    @param[in]
+        exits
+            total number of exits of the process
+
+    @param[in]
+        wstatus
+            wait status of the most recent exit, or -1 if it is not known
+
+    @param[in]
+        uptime
+            length of time (in milliseconds) the process ran for before
+            the most recent exit
+
+==============================================================================*/
+void METRICS_SampleExits( ProcessMetrics *pMetrics,
+                          uint64_t exits,
+                          int wstatus,
+                          uint32_t uptime )
+{
+    if ( pMetrics != NULL )
+    {
+        pMetrics->exits = exits;
+        pMetrics->exitCode = -1;
+        pMetrics->exitSignal = 0;
+        pMetrics->uptime = uptime / 1e3;
+
+        if ( wstatus == -1 )
+        {
+            /* the exit status is not known */
+        }
+        else if ( WIFEXITED( wstatus ) )
+        {
+            pMetrics->exitCode = WEXITSTATUS( wstatus );
+        }
+        else if ( WIFSIGNALED( wstatus ) )
+        {
+            pMetrics->exitSignal = WTERMSIG( wstatus );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  METRICS_ProcessExited                                                     */
+/*!
+    Record the exit of a process
+
+    The METRICS_ProcessExited function records the time at which a
+    process exited, to measure its restart latency.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+==============================================================================*/
+void METRICS_ProcessExited( ProcessMetrics *pMetrics )
+{
+    if ( pMetrics != NULL )
+    {
+        pMetrics->exitTime = GetTime();
+        pMetrics->up = false;
+    }
+}
+
+/*============================================================================*/
+/*  METRICS_ProcessStarted                                                    */
+/*!
+    Record the start of a process
+
+    The METRICS_ProcessStarted function adds the time since the process
+    exited to the restart latency histogram of the process.  Nothing is
+    recorded for the first start of the process.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+==============================================================================*/
+void METRICS_ProcessStarted( ProcessMetrics *pMetrics )
+{
+    double latency;
+    size_t i;
+
+    if ( ( pMetrics != NULL ) && ( pMetrics->exitTime != 0 ) )
+    {
+        latency = ( GetTime() - pMetrics->exitTime ) / 1e9;
+        pMetrics->exitTime = 0;
+
+        for ( i = 0; ( i < METRICS_BUCKETS ) && ( latency > buckets[i] ); i++ );
+
+        pMetrics->buckets[i]++;
+        pMetrics->sum += latency;
+    }
+}
+
+/*============================================================================*/
+/*  METRICS_Write                                                             */
+/*!
+    Write the process metrics
+
+    The METRICS_Write function writes the metrics of all of the processes
+    returned by the iterator in the OpenMetrics text format.
+
+    @param[in]
+        fp
+            output stream to write the metrics to
+
+    @param[in]
+        iterator
+            function which returns the metrics of each process
+
+    @param[in]
+        arg
+            opaque argument to pass to the iterator
+
+    @retval EOK - the metrics were written
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+int METRICS_Write( FILE *fp, MetricsIterator iterator, void *arg )
+{
+    int result = EINVAL;
+    ProcessMetrics *p;
+    uint64_t count;
+    size_t n;
+    size_t i;
+
+    if ( ( fp != NULL ) && ( iterator != NULL ) )
+    {
+        result = EOK;
+
+        WriteFamily( fp, "procmon_process_up", "gauge",
+                     "Whether the process is running" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( p->id != NULL )
+            {
+                fprintf( fp, "procmon_process_up" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %d\n", p->up ? 1 : 0 );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_restarts", "counter",
+                     "Number of times the process has been restarted" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( p->id != NULL )
+            {
+                fprintf( fp, "procmon_process_restarts_total" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %" PRIu64 "\n", p->restarts );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_exits", "counter",
+                     "Number of times the process has exited" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( p->id != NULL )
+            {
+                fprintf( fp, "procmon_process_exits_total" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %" PRIu64 "\n", p->exits );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_last_exit_code", "gauge",
+                     "Exit code of the most recent exit of the process" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->exitCode != -1 ) )
+            {
+                fprintf( fp, "procmon_process_last_exit_code" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %d\n", p->exitCode );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_last_exit_signal", "gauge",
+                     "Signal which terminated the process at its most "
+                     "recent exit" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->exitSignal != 0 ) )
+            {
+                fprintf( fp, "procmon_process_last_exit_signal" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %d\n", p->exitSignal );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_last_uptime_seconds", "gauge",
+                     "Length of time the process ran for before its most "
+                     "recent exit" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->exits > 0 ) )
+            {
+                fprintf( fp, "procmon_process_last_uptime_seconds" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %.3f\n", p->uptime );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_cpu_seconds", "counter",
+                     "User and system CPU time of the process" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->up == true ) )
+            {
+                fprintf( fp, "procmon_process_cpu_seconds_total" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %.2f\n", p->cpu );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_resident_memory_bytes", "gauge",
+                     "Resident set size of the process" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->up == true ) )
+            {
+                fprintf( fp, "procmon_process_resident_memory_bytes" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %" PRIu64 "\n", p->rss );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_open_fds", "gauge",
+                     "Number of open file descriptors of the process" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->up == true ) )
+            {
+                fprintf( fp, "procmon_process_open_fds" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %" PRIu64 "\n", p->fds );
+            }
+        }
+
+        WriteFamily( fp, "procmon_process_context_switches", "counter",
+                     "Number of context switches of the process" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( ( p->id != NULL ) && ( p->up == true ) )
+            {
+                fprintf( fp, "procmon_process_context_switches_total" );
+                WriteLabel( fp, p->id );
+                fprintf( fp,
+                         ",type=\"voluntary\"} %" PRIu64 "\n",
+                         p->vctxsw );
+                fprintf( fp, "procmon_process_context_switches_total" );
+                WriteLabel( fp, p->id );
+                fprintf( fp,
+                         ",type=\"involuntary\"} %" PRIu64 "\n",
+                         p->nvctxsw );
+            }
+        }
+
+        WriteFamily( fp, "procmon_restart_latency_seconds", "histogram",
+                     "Time from the process exiting to its replacement "
+                     "being executed" );
+        for ( n = 0; ( p = iterator( n, arg ) ) != NULL; n++ )
+        {
+            if ( p->id != NULL )
+            {
+                count = 0;
+                for ( i = 0; i <= METRICS_BUCKETS; i++ )
+                {
+                    count += p->buckets[i];
+                    fprintf( fp, "procmon_restart_latency_seconds_bucket" );
+                    WriteLabel( fp, p->id );
+                    if ( i < METRICS_BUCKETS )
+                    {
+                        fprintf( fp,
+                                 ",le=\"%g\"} %" PRIu64 "\n",
+                                 buckets[i],
+                                 count );
+                    }
+                    else
+                    {
+                        fprintf( fp, ",le=\"+Inf\"} %" PRIu64 "\n", count );
+                    }
+                }
+
+                fprintf( fp, "procmon_restart_latency_seconds_sum" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %.6f\n", p->sum );
+
+                fprintf( fp, "procmon_restart_latency_seconds_count" );
+                WriteLabel( fp, p->id );
+                fprintf( fp, "} %" PRIu64 "\n", count );
+            }
+        }
+
+        fprintf( fp, "# EOF\n" );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  METRICS_ServeHttp                                                         */
+/*!
+    Serve the process metrics over HTTP
+
+    The METRICS_ServeHttp function handles the request line of an HTTP
+    request.  A GET request for /metrics is answered with the process
+    metrics in the OpenMetrics text format.  Any other request is
+    answered with an error status.
+
+    @param[in]
+        fp
+            output stream to write the HTTP response to
+
+    @param[in]
+        request
+            pointer to the HTTP request line
+
+    @param[in]
+        iterator
+            function which returns the metrics of each process
+
+    @param[in]
+        arg
+            opaque argument to pass to the iterator
+
+    @retval EOK - the metrics were served
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the request was not for the metrics
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+int METRICS_ServeHttp( FILE *fp,
+                       char *request,
+                       MetricsIterator iterator,
+                       void *arg )
+{
+    int result = EINVAL;
+    char *method;
+    char *path;
+    char *saveptr;
+    char *body = NULL;
+    size_t len = 0;
+    FILE *bodyfp;
+
+    if ( ( fp != NULL ) && ( request != NULL ) )
+    {
+        method = strtok_r( request, " \r", &saveptr );
+        path = strtok_r( NULL, " \r", &saveptr );
+
+        if ( ( method == NULL ) || ( strcmp( method, "GET" ) != 0 ) )
+        {
+            fprintf( fp,
+                     "HTTP/1.1 405 Method Not Allowed\r\n"
+                     "Allow: GET\r\n"
+                     "Content-Length: 0\r\n"
+                     "Connection: close\r\n\r\n" );
+        }
+        else if ( ( path == NULL ) ||
+                  ( ( strcmp( path, "/metrics" ) != 0 ) &&
+                    ( strncmp( path, "/metrics?", 9 ) != 0 ) ) )
+        {
+            fprintf( fp,
+                     "HTTP/1.1 404 Not Found\r\n"
+                     "Content-Length: 0\r\n"
+                     "Connection: close\r\n\r\n" );
+            result = ENOENT;
+        }
+        else
+        {
+            result = ENOMEM;
+
+            /* generate the body first to get its length */
+            bodyfp = open_memstream( &body, &len );
+            if ( bodyfp != NULL )
+            {
+                result = METRICS_Write( bodyfp, iterator, arg );
+                fclose( bodyfp );
+            }
+
+            if ( result == EOK )
+            {
+                fprintf( fp,
+                         "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: " METRICS_CONTENT_TYPE "\r\n"
+                         "Content-Length: %zu\r\n"
+                         "Connection: close\r\n\r\n",
+                         len );
+                fwrite( body, 1, len, fp );
+            }
+            else
+            {
+                fprintf( fp,
+                         "HTTP/1.1 500 Internal Server Error\r\n"
+                         "Content-Length: 0\r\n"
+                         "Connection: close\r\n\r\n" );
+            }
+
+            free( body );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  OpenProcFiles                                                             */
+/*!
+    Open the /proc files of a process
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+    @param[in]
+        pid
+            process identifier of the process
+
+    @retval EOK - the /proc files were opened
+    @retval other - error from open
+
+==============================================================================*/
+static int OpenProcFiles( ProcessMetrics *pMetrics, pid_t pid )
+{
+    int result = EOK;
+    char path[64];
+
+    pMetrics->pid = pid;
+
+    snprintf( path, sizeof( path ), "/proc/%d/stat", pid );
+    pMetrics->statfd = open( path, O_RDONLY | O_CLOEXEC );
+
+    snprintf( path, sizeof( path ), "/proc/%d/status", pid );
+    pMetrics->statusfd = open( path, O_RDONLY | O_CLOEXEC );
+
+    snprintf( path, sizeof( path ), "/proc/%d/fd", pid );
+    pMetrics->fdfd = open( path, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+    if ( ( pMetrics->statfd == -1 ) ||
+         ( pMetrics->statusfd == -1 ) ||
+         ( pMetrics->fdfd == -1 ) )
+    {
+        result = errno;
+        CloseProcFiles( pMetrics );
+        pMetrics->pid = pid;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CloseProcFiles                                                            */
+/*!
+    Close the cached /proc files of a process
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+==============================================================================*/
+static void CloseProcFiles( ProcessMetrics *pMetrics )
+{
+    if ( pMetrics->statfd != -1 )
+    {
+        close( pMetrics->statfd );
+        pMetrics->statfd = -1;
+    }
+
+    if ( pMetrics->statusfd != -1 )
+    {
+        close( pMetrics->statusfd );
+        pMetrics->statusfd = -1;
+    }
+
+    if ( pMetrics->fdfd != -1 )
+    {
+        close( pMetrics->fdfd );
+        pMetrics->fdfd = -1;
+    }
+
+    pMetrics->pid = 0;
+}
+
+/*============================================================================*/
+/*  ReadProcFile                                                              */
+/*!
+    Read a cached /proc file
+
+    The ReadProcFile function reads the current content of an open
+    /proc file with a single pread from the start of the file.
+
+    @param[in]
+        fd
+            open /proc file
+
+    @param[out]
+        buf
+            buffer to read the NUL terminated content into
+
+    @param[in]
+        len
+            size of the buffer
+
+    @retval EOK - the file was read
+    @retval ESRCH - the process has exited
+
+==============================================================================*/
+static int ReadProcFile( int fd, char *buf, size_t len )
+{
+    int result = ESRCH;
+    ssize_t n;
+
+    n = pread( fd, buf, len - 1, 0 );
+    if ( n > 0 )
+    {
+        buf[n] = '\0';
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ReadStat                                                                  */
+/*!
+    Read the CPU time and resident memory of a process
+
+    The ReadStat function reads the user and system CPU time and the
+    resident set size of a process from /proc/<pid>/stat.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+    @param[in]
+        buf
+            buffer of METRICS_READ_SIZE bytes to read the file into
+
+    @retval EOK - the values were read
+    @retval ESRCH - the process has exited
+
+==============================================================================*/
+static int ReadStat( ProcessMetrics *pMetrics, char *buf )
+{
+    int result;
+    unsigned long long utime;
+    unsigned long long stime;
+    long long rss;
+    char *p;
+
+    result = ReadProcFile( pMetrics->statfd, buf, METRICS_READ_SIZE );
+    if ( result == EOK )
+    {
+        /* skip past the command name, which may contain spaces */
+        p = strrchr( buf, ')' );
+        if ( ( p != NULL ) &&
+             ( sscanf( p + 2,
+                       "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu"
+                       " %*d %*d %*d %*d %*d %*d %*u %*u %lld",
+                       &utime,
+                       &stime,
+                       &rss ) == 3 ) )
+        {
+            pMetrics->cpu = (double)( utime + stime ) / sysconf( _SC_CLK_TCK );
+            pMetrics->rss = ( rss > 0 ) ? (uint64_t)rss * getpagesize() : 0;
+        }
+        else
+        {
+            result = ESRCH;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ReadStatus                                                                */
+/*!
+    Read the context switches of a process
+
+    The ReadStatus function reads the voluntary and involuntary context
+    switch counts of a process from /proc/<pid>/status.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+    @param[in]
+        buf
+            buffer of METRICS_READ_SIZE bytes to read the file into
+
+    @retval EOK - the values were read
+    @retval ESRCH - the process has exited
+
+==============================================================================*/
+static int ReadStatus( ProcessMetrics *pMetrics, char *buf )
+{
+    int result;
+    char *p;
+
+    result = ReadProcFile( pMetrics->statusfd, buf, METRICS_READ_SIZE );
+    if ( result == EOK )
+    {
+        p = strstr( buf, "\nvoluntary_ctxt_switches:" );
+        if ( p != NULL )
+        {
+            pMetrics->vctxsw = strtoull( strchr( p, ':' ) + 1, NULL, 10 );
+        }
+
+        p = strstr( buf, "\nnonvoluntary_ctxt_switches:" );
+        if ( p != NULL )
+        {
+            pMetrics->nvctxsw = strtoull( strchr( p, ':' ) + 1, NULL, 10 );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CountFds                                                                  */
+/*!
+    Count the open file descriptors of a process
+
+    The CountFds function counts the entries of the /proc/<pid>/fd
+    directory of a process, rewinding the cached directory file
+    descriptor rather than opening the directory again.
+
+    @param[in]
+        pMetrics
+            pointer to the process metrics object
+
+    @param[in]
+        buf
+            buffer of METRICS_READ_SIZE bytes to read the directory into
+
+    @retval EOK - the file descriptors were counted
+    @retval ESRCH - the process has exited
+
+==============================================================================*/
+static int CountFds( ProcessMetrics *pMetrics, char *buf )
+{
+    int result = EOK;
+    struct linux_dirent64 *pEntry;
+    uint64_t count = 0;
+    long n;
+    long i;
+
+    if ( lseek( pMetrics->fdfd, 0, SEEK_SET ) == -1 )
+    {
+        result = ESRCH;
+    }
+
+    while ( ( result == EOK ) &&
+            ( ( n = syscall( SYS_getdents64,
+                             pMetrics->fdfd,
+                             buf,
+                             METRICS_READ_SIZE ) ) != 0 ) )
+    {
+        if ( n < 0 )
+        {
+            result = ESRCH;
+            break;
+        }
+
+        for ( i = 0; i < n; i += pEntry->d_reclen )
+        {
+            pEntry = (struct linux_dirent64 *)&buf[i];
+            if ( pEntry->d_name[0] != '.' )
+            {
+                count++;
+            }
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pMetrics->fds = count;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WriteFamily                                                               */
+/*!
+    Write the metadata of a metric family
+
+    @param[in]
+        fp
+            output stream
+
+    @param[in]
+        name
+            name of the metric family
+
+    @param[in]
+        type
+            OpenMetrics type of the metric family
+
+    @param[in]
+        help
+            description of the metric family
+
+==============================================================================*/
+static void WriteFamily( FILE *fp, char *name, char *type, char *help )
+{
+    fprintf( fp, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help );
+}
+
+/*============================================================================*/
+/*  WriteLabel                                                                */
+/*!
+    Write the opening brace and id label of a metric
+
+    The WriteLabel function writes the start of the label set of a metric
+    with the escaped process identifier.  The caller writes any further
+    labels and the closing brace.
+
+    @param[in]
+        fp
+            output stream
+
+    @param[in]
+        id
+            process identifier
+
+==============================================================================*/
+static void WriteLabel( FILE *fp, const char *id )
+{
+    fputs( "{id=\"", fp );
+
+    for ( ; *id != '\0'; id++ )
+    {
+        if ( ( *id == '\\' ) || ( *id == '"' ) )
+        {
+            fputc( '\\', fp );
+            fputc( *id, fp );
+        }
+        else if ( *id == '\n' )
+        {
+            fputs( "\\n", fp );
+        }
+        else
+        {
+            fputc( *id, fp );
+        }
+    }
+
+    fputc( '"', fp );
+}
+
+/*============================================================================*/
+/*  GetTime                                                                   */
+/*!
+    Get the current monotonic time
+
+    @retval the current monotonic time in nanoseconds
+
+==============================================================================*/
+static int64_t GetTime( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*! @}
+ * end of metrics group */
@@ -51,6 +51,8 @@ SOFTWARE.
         Includes
 ==============================================================================*/
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -58,14 +60,39 @@ SOFTWARE.
 #include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
+#include <ctype.h>
 #include <signal.h>
 #include <syslog.h>
 #include <errno.h>
 #include <pthread.h>
-#include <dirent.h>
 #include <time.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <tjson/json.h>
+#include <sched.h>
+#include <poll.h>
+#include <getopt.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include "eventloop.h"
+#include "statetable.h"
+#include "control.h"
+#include "resources.h"
+#include "metrics.h"
+#include "configcache.h"
+#include "logbuffer.h"
+#include "listener.h"
+#include "health.h"
+#include "cluster.h"
+#include "aggregator.h"
+#include "trace.h"
+#include "arena.h"
 
 /*==============================================================================
        Type Definitions
@@ -77,27 +104,50 @@ typedef enum _procState
     PROCSTATE_eSTARTED = 1,
     PROCSTATE_eRUNNING = 2,
     PROCSTATE_eTERMINATED = 3,
-    PROCSTATE_eWAITING = 4
+    PROCSTATE_eWAITING = 4,
+    PROCSTATE_eFAILED = 5
 } ProcState;
 
-/*! the LockData object contains the runtime
- * state of a process and is used to detect process death
- * and to terminate the process on demand */
-typedef struct _lockData
+/*! The ProcessList structure is a vector of references to Process objects */
+typedef struct _processList
+{
+    /*! array of pointers to the processes in the list */
+    struct _process **pProcesses;
+
+    /*! number of processes in the list */
+    size_t count;
+
+} ProcessList;
+
+/*! the Standby object is a second instance of a process which has been
+ *  launched ahead of time, and is held at a barrier until the running
+ *  instance dies */
+typedef struct _standby
 {
-    /*! current process ID of the monitored process */
+    /*! pid of the standby, or 0 if there is no standby */
     pid_t pid;
 
-    /*! terminate command used to force the process to exit */
-    uint32_t terminate;
+    /*! process monitor end of the barrier socket which releases the
+     *  standby, or -1 once the standby is being stopped */
+    int barrierfd;
 
-    /*! process run counter */
-    size_t runcount;
+    /*! lock handle through which the process lock is taken on behalf
+     *  of the standby when it is released, or -1 */
+    int lockfd;
+
+    /*! indicates that the standby has notified its readiness */
+    bool ready;
 
-    /*! last process start time */
-    time_t starttime;
+    /*! standby exit notification (pidfd) */
+    EventSource exitEvent;
 
-} LockData;
+    /*! readiness notification pipe of the standby */
+    EventSource readyEvent;
+
+    /*! timer used to delay launching the standby */
+    Timer timer;
+
+} Standby;
 
 /*! the Process structure defines a process to be monitored */
 typedef struct _process
@@ -111,6 +161,20 @@ typedef struct _process
     /*! pointer to the command line associated with this process */
     char *exec;
 
+    /*! NULL terminated argument vector parsed from the command line */
+    char **argv;
+
+    /*! storage for the environment of the process when it is passed
+     *  file descriptors, or NULL */
+    char **envp;
+
+    /*! cgroup placement, resource limits and scheduling attributes,
+     *  including those inherited from the process' parents */
+    ProcessResources resources;
+
+    /*! resource attributes specified for the process itself */
+    ProcessResources ownResources;
+
     /*! length of time (in seconds) to wait after starting the process
      * before starting any of its dependencies */
     int wait;
@@ -119,6 +183,48 @@ typedef struct _process
      * after it has died */
     int restart_delay;
 
+    /*! maximum restart delay (in seconds) when the process keeps crashing.
+     *  Consecutive crash restarts are delayed exponentially up to this
+     *  limit.  0 disables the restart backoff */
+    int restart_backoff_max;
+
+    /*! maximum number of crash restarts within the restart window before
+     *  the process is considered failed.  0 allows unlimited restarts */
+    int restart_limit;
+
+    /*! length of the restart budget window in seconds */
+    int restart_window;
+
+    /*! number of consecutive crashes used to calculate the restart backoff */
+    int crashes;
+
+    /*! monotonic time (in milliseconds) at which the process was started */
+    int64_t startTime;
+
+    /*! monotonic time (in milliseconds) at which the process exited,
+     *  or 0 if the process is not being restarted */
+    int64_t exitTime;
+
+    /*! monotonic time (in milliseconds) at which the restart window began */
+    int64_t windowStart;
+
+    /*! trace time at which the process started waiting to become ready,
+     *  or 0 */
+    int64_t traceReady;
+
+    /*! trace time at which the process exited, or 0 */
+    int64_t traceRestart;
+
+    /*! number of crash restarts in the current restart window */
+    int windowRestarts;
+
+    /*! random number seed used to add jitter to the restart backoff */
+    unsigned int seed;
+
+    /*! indicates that the process is being restarted because its
+     *  parent restarted, rather than because it crashed */
+    bool restarting;
+
     /*! indicate that this process should be restarted if its parent restarts */
     bool restart_on_parent_death;
 
@@ -131,6 +237,14 @@ typedef struct _process
     /*! indicates that this process should be skipped and not started */
     bool skip;
 
+    /*! indicates that this process will notify the process monitor when
+     *  it is ready, and its wait time is used as a readiness timeout */
+    bool notify;
+
+    /*! indicates that a warm standby instance of this process is kept
+     *  ready to take over when the process dies */
+    bool standby;
+
     /*! pid of the process */
     pid_t pid;
 
@@ -140,27 +254,232 @@ typedef struct _process
     /*! reference to the process' monitoring thread */
     pthread_t thread;
 
-    /*! list of the processes dependencies, using during config file parsing */
-    JArray *pDepends;
+    /*! shared state record prepared by the process monitor
+     *  for the process to lock when it is started */
+    StateRecord *pRecord;
+
+    /*! NULL terminated list of the ids of the processes dependencies,
+     *  used during config file parsing */
+    char **pDependIds;
+
+    /*! indices of the processes dependencies in the process list, used
+     *  instead of pDependIds when the configuration cache is loaded */
+    const uint32_t *pDependsIndex;
+
+    /*! number of entries in pDependsIndex */
+    size_t ndepends;
+
+    /*! position of the process in the process list, used to write the
+     *  dependency indices to the configuration cache */
+    size_t position;
+
+    /*! list of the process' parents */
+    ProcessList parents;
+
+    /*! list of the process' dependent processes, with the dependents
+     *  on the longest chain of wait times first */
+    ProcessList children;
+
+    /*! length of the longest chain of dependencies of the process */
+    size_t depth;
+
+    /*! sum of the wait times (in seconds) along the longest chain of
+     *  dependencies ending with the process, which is the earliest time
+     *  after the start of the startup at which it can be ready */
+    int startWait;
+
+    /*! sum of the wait times (in seconds) along the longest chain of
+     *  dependents starting with the process, used to start the processes
+     *  on the critical path first */
+    int criticalWait;
+
+    /*! number of parents which have not yet been sorted, used by the
+     *  dependency graph analysis */
+    size_t unsorted;
+
+    /*! number of parents which have not yet completed their startup,
+     *  used by the startup scheduler */
+    int pending;
+
+    /*! monotonic time (in milliseconds) at which this process is
+     *  considered ready and its dependents may be started */
+    int64_t readyTime;
+
+    /*! the parent whose readiness allowed this process to be started,
+     *  used to trace the startup critical path */
+    struct _process *pGate;
+
+    /*! timer used to signal process readiness during startup */
+    Timer readyTimer;
+
+    /*! timer used to delay process (re)starts */
+    Timer restartTimer;
+
+    /*! process exit notification (pidfd) used by the supervisor */
+    EventSource exitEvent;
+
+    /*! readiness notification pipe used by the supervisor */
+    EventSource readyEvent;
+
+    /*! indicates that the process has been spawned and the supervisor
+     *  is waiting for it to notify readiness */
+    bool awaitingReady;
+
+    /*! indicates that the process has completed its initial startup */
+    bool started;
+
+    /*! indicates that the process is being managed by the supervisor */
+    bool supervised;
+
+    /*! indicates that monitoring of the process has been suspended
+     *  and the supervisor is waiting for a command to resume it */
+    bool suspended;
+
+    /*! resource usage metrics of the process */
+    ProcessMetrics metrics;
+
+    /*! indicates that the configuration of the process was changed by
+     *  a configuration reload, and the process must be restarted */
+    bool changed;
+
+    /*! indicates that the process is being stopped to apply a
+     *  configuration reload */
+    bool reloading;
+
+    /*! indicates that the process was removed from the configuration */
+    bool removed;
+
+    /*! indicates that the process is being stopped so it can be
+     *  restarted with the subtree of a restarted parent */
+    bool stopping;
+
+    /*! signal used to ask the process to stop */
+    int stopSignal;
+
+    /*! length of time (in seconds) the process is given to stop after
+     *  its stop signal before it is killed.  0 kills it immediately */
+    int stopTimeout;
+
+    /*! timer used to kill a process which does not stop in time */
+    Timer stopTimer;
+
+    /*! number of dependents which have not yet stopped during shutdown */
+    size_t stopPending;
+
+    /*! size (in bytes) of the ring buffer holding the captured output
+     *  of the process, or 0 for no ring buffer */
+    int logBufferSize;
+
+    /*! path of the file the output of the process is written to */
+    char *logFile;
+
+    /*! size (in bytes) at which the log file is rotated, or 0 */
+    int logFileSize;
+
+    /*! captured stdout and stderr output of the process */
+    LogBuffer log;
+
+    /*! comma separated addresses of the listening sockets of a socket
+     *  activated process, or NULL */
+    char *listen;
+
+    /*! length of time (in seconds) without new or established connections
+     *  after which a socket activated process is stopped, or 0 to never
+     *  stop it */
+    int idleTimeout;
 
-    /*! pointer to a list of the process' parents */
-    struct _procNode *pParents;
+    /*! listening sockets of a socket activated process */
+    Listener listener;
 
-    /*! pointer to a list of the process' dependent processes */
-    struct _procNode *pChildren;
+    /*! indicates that a connection has arrived for a socket activated
+     *  process which is waiting to be started */
+    bool activated;
+
+    /*! timer used to stop a socket activated process when it is idle */
+    Timer idleTimer;
+
+    /*! health check specification of the process, or NULL */
+    char *healthCheck;
+
+    /*! interval (in seconds) between health check probes */
+    int healthInterval;
+
+    /*! time (in seconds) a health check probe may take before it fails */
+    int healthTimeout;
+
+    /*! number of consecutive failed health check probes after which
+     *  the process is restarted */
+    int healthFailures;
+
+    /*! active health check of the process */
+    HealthCheck health;
+
+    /*! warm standby instance of the process */
+    Standby spare;
+
+    /*! next process object in the list of free process objects */
+    struct _process *pNextFree;
 
 } Process;
 
-/*! The ProcessNode structure is used to chain Process objects
- * together in a list */
-typedef struct _procNode
+/*! the Launch object passes a process to be executed to the launched
+ *  child, which shares the memory of the process monitor until it
+ *  executes the process */
+typedef struct _launch
 {
-    /*! pointer to the process object */
+    /*! pointer to the process to execute */
     Process *pProcess;
 
-    /*! pointer to the next process object in the list */
-    struct _procNode *pNext;
-} ProcessNode;
+    /*! environment of the process */
+    char **envp;
+
+    /*! readiness pipe to pass to the process, or -1 */
+    int readyfd;
+
+    /*! log pipe to pass to the process as its stdout and stderr, or -1 */
+    int logfd;
+
+    /*! barrier socket to pass to a standby, or -1 if the process itself
+     *  is being launched */
+    int standbyfd;
+
+    /*! lock handle to pass to the process, or -1 */
+    int lockfd;
+
+    /*! signal mask to restore in the child */
+    sigset_t sigmask;
+
+    /*! indicates that the process lock could not be taken */
+    bool lockfailed;
+
+    /*! error from RESOURCES_Apply if the process resources could not
+     *  be applied */
+    int resourceError;
+
+    /*! error from execvpe if the process could not be executed */
+    int error;
+
+    /*! indicates that the child should time its setup for the trace */
+    bool trace;
+
+    /*! trace time at which the child started running */
+    int64_t childTime;
+
+    /*! trace time at which the child executed the process */
+    int64_t execTime;
+
+} Launch;
+
+/*! the SignalName object maps a signal name to its signal number */
+typedef struct _signalName
+{
+    /*! name of the signal without its SIG prefix */
+    const char *name;
+
+    /*! signal number */
+    int signal;
+
+} SignalName;
 
 /*! the ProcmonState object contains the operating state of the
  *  process monitor, and stores configuration data read from
@@ -185,31 +504,158 @@ typedef struct _procmonState
     /*! pointer to the process monitor process information */
     Process *pProcess;
 
+    /*! lock handle holding the process state record lock of the
+     *  process monitor, or -1 */
+    int lockfd;
+
     /*! pointer to the monitored process information */
     Process *pMonitoredProcess;
 
-    /*! pointer to the first ProcessNode in the process configuration list */
-    ProcessNode *pFirst;
+    /*! list of the configured processes in configuration file order */
+    ProcessList processes;
+
+    /*! list of the configured processes in dependency order, with the
+     *  processes on the longest chain of wait times first */
+    ProcessList order;
+
+    /*! length of the longest chain of dependencies */
+    size_t graphDepth;
+
+    /*! sum of the wait times (in seconds) along the critical path of
+     *  the dependency graph */
+    int graphWait;
+
+    /*! hash index of the configured processes keyed by process id */
+    Process **pIndex;
+
+    /*! number of slots in the process index (zero or a power of 2) */
+    size_t indexSize;
+
+    /*! indicates that processes are supervised by the event loop
+     *  rather than by a dedicated monitoring thread per process */
+    bool supervisor;
+
+    /*! command notification (eventfd) signalled by the command relay */
+    EventSource commandEvent;
 
-    /*! pointer to the last ProcessNode in the process configuration list */
-    ProcessNode *pLast;
+    /*! monotonic time (in milliseconds) at which the startup began */
+    int64_t startupBegin;
+
+    /*! number of processes which have been started but are not yet ready */
+    int startupPending;
+
+    /*! the last process to become ready during startup */
+    Process *pStartupLast;
+
+    /*! duration of the startup critical path in milliseconds */
+    int64_t startupTime;
+
+    /*! trace time at which the startup began, or 0 */
+    int64_t traceStartup;
+
+    /*! interval (in seconds) between process metrics samples,
+     *  or 0 to disable sampling */
+    int metricsInterval;
+
+    /*! TCP port of the OpenMetrics endpoint, or 0 for no endpoint */
+    int metricsPort;
+
+    /*! address the OpenMetrics endpoint is bound to */
+    char *metricsAddress;
+
+    /*! timer used to sample the process metrics */
+    Timer metricsTimer;
+
+    /*! address of the cluster aggregator, or NULL if this node is not
+     *  part of a cluster */
+    char *aggregator;
+
+    /*! name of this node in the cluster, or NULL to use the host name */
+    char *nodeName;
+
+    /*! path of the file holding the shared secret of the cluster */
+    char *tokenFile;
+
+    /*! connection to the cluster aggregator */
+    ClusterAgent agent;
+
+    /*! configuration reload signal notification (signalfd) */
+    EventSource reloadEvent;
+
+    /*! indicates that the primary process monitor services have
+     *  been started */
+    bool serving;
+
+    /*! compiled configuration which the processes refer to, if the
+     *  configuration was loaded from the configuration cache */
+    ConfigCache configCache;
+
+    /*! number of processes of a subtree restart which have not yet
+     *  stopped */
+    size_t subtreeStopping;
+
+    /*! timer used to wait for a restarted parent before its subtree
+     *  is started */
+    Timer subtreeTimer;
+
+    /*! indicates that the process monitor is shutting down */
+    bool shuttingDown;
+
+    /*! number of processes which have not yet stopped during shutdown */
+    size_t shutdownPending;
+
+    /*! timer used to exit once all processes have stopped */
+    Timer shutdownTimer;
+
+    /*! configuration data the processes refer to: their strings,
+     *  argument vectors, CPU sets and environments */
+    Arena arena;
+
+    /*! configuration data replaced by a configuration reload which is
+     *  kept until the removed processes have stopped */
+    Arena retired;
+
+    /*! number of removed processes which refer to the retired
+     *  configuration data */
+    size_t retiredRefs;
+
+    /*! storage for the process objects, which outlive the configuration
+     *  which created them */
+    Arena processArena;
+
+    /*! process objects which have been discarded, and are reused */
+    Process *pFreeProcesses;
+
+    /*! number of variables in the environment of the process monitor,
+     *  which the process environments are sized for */
+    size_t envCount;
+
+    /*! stack used to launch processes from the event loop, or NULL */
+    char *launchStack;
+
+    /*! command of this process monitor shown in the process list */
+    char ownCommand[BUFSIZ];
+
+    /*! command used to start the peer process monitor */
+    char peerCommand[BUFSIZ];
+
+    /*! argument vector used to start the peer process monitor */
+    char *peerArgv[5];
 
 } ProcmonState;
 
 /*==============================================================================
        Function declarations
 ==============================================================================*/
-static int makelock( Process *pProcess );
-static int waitlock( int fd );
-static int lock( int fd, int cmd );
-static int unlock( int fd );
+static int makelock( Process *pProcess, int fd );
+static int waitlock( StateRecord *pRecord );
+static int unlock( StateRecord *pRecord );
 
-static int open_lockfile( char *name );
-static int create_lockfile( Process *pProcess );
-static int remove_lockfile( char *name );
-static pid_t get_pid_from_lockfile( char *name );
+static int prepare_state( Process *pProcess );
+static int remove_state( char *name );
+static pid_t get_pid_from_state( char *name );
 
-static void Monitor( char *name, int fd );
+static void Monitor( char *name );
 
 
 static void usage( char *cmdname );
@@ -219,23 +665,82 @@ static int ProcessOptions( int argC,
 
 static int ProcessConfigFile( ProcmonState *pProcmonState );
 
+static int ParseConfigFile( ProcmonState *pProcmonState );
+
+static size_t ConfigDataSize( size_t count, size_t textSize );
+
+static int LoadConfigCache( ProcmonState *pProcmonState );
+
+static int SetupCachedProcess( ProcmonState *pProcmonState,
+                               ConfigCache *pCache,
+                               ConfigCacheProcess *pDef );
+
+static int WriteConfigCache( ProcmonState *pProcmonState );
+
+static int CompileProcess( ConfigCache *pCache, size_t n, Process *pProcess );
+
+static int GetCacheFile( ProcmonState *pProcmonState, char *buf, size_t len );
+
+static int AddProcess( ProcmonState *pProcmonState, Process *pProcess );
+
 static int SetupProcess( JNode *pNode, void *arg );
 
+static int SetupInstance( JNode *pNode,
+                          ProcmonState *pProcmonState,
+                          int index );
+
+static Process *NewProcess( void );
+
+static int SetupStrings( Process *pProcess, Arena *pArena, int index );
+
+static size_t Substitute( const char *s, const char *value, char *buf );
+
+static int SetupResources( JNode *pNode, Process *pProcess, Arena *pArena );
+
+static int SetupDepends( JNode *pNode, Process *pProcess, Arena *pArena );
+
+static int SetupEnvironment( Process *pProcess, Arena *pArena );
+
+static void InheritResources( ProcmonState *pProcmonState );
+
 Process *FindProcess( char *id, ProcmonState *pProcmonState );
 
+static bool IsInstance( const char *id, const char *group );
+
 static int BuildDependencyLists( ProcmonState *pProcmonState );
 
+static int AnalyzeDependencies( ProcmonState *pProcmonState );
+
+static void DisplayCycle( ProcmonState *pProcmonState );
+
+static Process *UnsortedParent( Process *pProcess );
+
+static int CompareCritical( const void *p1, const void *p2 );
+
+static ProcessList *StartupOrder( ProcmonState *pProcmonState );
+
 static int AddParents( ProcmonState *pProcmonState, Process *pProcess );
 
+static size_t AddGroupParents( ProcmonState *pProcmonState,
+                               Process *pProcess,
+                               const char *group,
+                               int *pResult );
+
 static int AddChild( Process *pParent, Process *pChild );
 
 static int AddParent( Process *pChild, Process *pParent );
 
+static int AppendProcess( ProcessList *pList, Process *pProcess );
+
+static int IndexProcess( ProcmonState *pProcmonState, Process *pProcess );
+
+static uint32_t HashId( const char *id );
+
 static int DisplayConfig( ProcmonState *pProcmonState );
 
 static int DisplayProcess( Process *pProcess );
 
-static void DisplayProcessIds( ProcessNode *pProcessNode );
+static void DisplayProcessIds( ProcessList *pList );
 
 static int DisplayProcessId( Process *pProcess );
 
@@ -243,42 +748,165 @@ static int DisplayState( Process *pProcess );
 
 static int RunProcesses( ProcmonState *pProcmonState );
 
-static int Runnable( Process *pProcess );
+static int Run( Process *pProcess, int64_t now );
 
-static int Run( Process *pProcess );
+static void ProcessReady( void *arg );
+
+static void StartupReady( Process *pProcess );
+
+static int StartupComplete( ProcmonState *pProcmonState );
+
+static void DisplayCriticalPath( Process *pProcess );
 
 static void SetupTerminationHandler( void );
 
 static void TerminationHandler( int signum, siginfo_t *info, void *ptr );
 
 static int InitProcess( Process *pProcess );
-static void WaitProcess( Process *pProcess );
-static int RunProcess( Process *pProcess );
+static int InitMonitorThread( Process *pProcess );
+static bool StartupWaitRequired( Process *pProcess );
+static int ParseCommand( char *command, Arena *pArena, char ***pArgv );
+static int LaunchProcess( Process *pProcess,
+                          int readyfd,
+                          int logfd,
+                          int standbyfd,
+                          pid_t *pPid );
+static int LaunchChild( void *arg );
+static void ResetSignalHandlers( void );
+static int MakeEnvironment( int readyfd,
+                            Listener *pListener,
+                            int standbyfd,
+                            int lockfd,
+                            char **envp );
+static int OpenProcessLock( Process *pProcess );
+static int OpenOwnLock( void );
 
 static void *MonitorThread( void *arg );
 
+static bool SupervisorSupported( void );
+static void SuperviseProcess( void *arg );
+static void SpawnProcess( void *arg );
+static void ProcessLaunched( Process *pProcess, pid_t pid );
+static int WatchProcess( Process *pProcess, pid_t pid );
+static void HandleProcessExit( EventSource *pSource, uint32_t events );
+static void RecordExit( Process *pProcess, int wstatus );
+static void RecordStart( Process *pProcess, pid_t pid );
+static bool UsesReadiness( Process *pProcess );
+static bool UsesActivation( Process *pProcess );
+static void AwaitConnection( Process *pProcess );
+static void HandleConnection( EventSource *pSource, uint32_t events );
+static void WatchActivity( Process *pProcess );
+static void HandleActivity( EventSource *pSource, uint32_t events );
+static void IdleTimeout( void *arg );
+static int SetupHealthCheck( Process *pProcess );
+static void StartHealthCheck( Process *pProcess );
+static void HealthChanged( void *arg, bool healthy );
+static int OpenReadyPipe( Process *pProcess, int *pWriteFd );
+static void CloseReadyPipe( Process *pProcess );
+static void HandleReadyNotification( EventSource *pSource, uint32_t events );
+static void ReadyTimeout( void *arg );
+static bool UsesStandby( Process *pProcess );
+static void StartStandby( Process *pProcess, int64_t delay );
+static void SpawnStandby( void *arg );
+static void HandleStandbyReady( EventSource *pSource, uint32_t events );
+static void HandleStandbyExit( EventSource *pSource, uint32_t events );
+static bool PromoteStandby( Process *pProcess );
+static void StopStandby( Process *pProcess );
+static void InitStandby( Standby *pStandby );
+static void CloseStandby( Standby *pStandby );
+static int InitCommandRelay( ProcmonState *pProcmonState );
+static void *CommandRelayThread( void *arg );
+static void HandleCommand( EventSource *pSource, uint32_t events );
+
 static size_t GetParentRuncount( Process *pProcess );
+static bool RestartAllowed( Process *pProcess, int64_t *pDelay );
+static int64_t GetBackoffDelay( Process *pProcess );
+static void FailProcess( Process *pProcess );
 
 static int terminate( char *name );
 static int terminate_and_stop_monitoring( char *name );
 static int terminate_command( char *name, uint32_t cmd );
 static int start( char *name );
 static int restart( char *name );
-static int ResetStartTime( int fd );
+static int heartbeat( char *name );
+static int ResetStartTime( StateRecord *pRecord );
+static int ForEachInstance( char *name, int (*fn)( char *name ) );
 
 static int ListProcesses( ProcmonState *pProcmonState );
+static int QueryProcesses( ProcmonState *pProcmonState );
+static int HandleControlRequest( FILE *fp, char *request, void *arg );
+static int StartMetrics( ProcmonState *pProcmonState );
+static int StartCluster( ProcmonState *pProcmonState );
+static void SendSnapshot( void *arg );
+static int HandleClusterCommand( const char *command,
+                                 const char *id,
+                                 void *arg );
+static int HandleInstanceCommand( const char *command,
+                                  Process *pProcess );
+static int RunAggregator( char *address, const char *tokenFile );
+static int QueryAggregator( char *request );
+static int InitReloadSignal( ProcmonState *pProcmonState );
+static void HandleReloadSignal( EventSource *pSource, uint32_t events );
+static int RequestReload( void );
+static int ReloadConfig( ProcmonState *pProcmonState, FILE *fp );
+static void ApplyConfig( ProcmonState *pProcmonState,
+                         ProcmonState *pConfig,
+                         FILE *fp );
+static bool ProcessChanged( Process *pProcess, Process *pNew );
+static void UpdateProcess( Process *pProcess, Process *pNew );
+static void ReloadProcess( Process *pProcess );
+static void ReloadComplete( Process *pProcess );
+static void FreeRemovedProcess( Process *pProcess );
+static void DiscardProcess( Process *pProcess );
+static void ReleaseRetired( ProcmonState *pProcmonState );
+static void SampleMetrics( void *arg );
+static ProcessMetrics *GetProcessMetrics( size_t n, void *arg );
+static int HandleMetricsRequest( FILE *fp, char *request, void *arg );
 static int ShutdownAllProcesses( ProcmonState *pProcmonState );
-
-static int DisplayProcessInfo( ProcmonState *pProcmonState, char *name, int n );
+static int RequestShutdown( void );
+static int QueryLog( char *name );
+static int OpenLog( Process *pProcess );
+static int Shutdown( ProcmonState *pProcmonState, FILE *fp );
+static void ShutdownProcess( Process *pProcess );
+static void ShutdownStopped( Process *pProcess );
+static void ShutdownComplete( void *arg );
+static int StopAllProcesses( void );
+static void StopProcess( Process *pProcess );
+static void KillProcess( void *arg );
+static int StopPid( pid_t pid, int sig, int timeout );
+static int WaitForExit( pid_t *pids, size_t n, int timeout );
+static int SetupStop( JNode *pNode, Process *pProcess );
+static int ParseSignal( const char *name, int *pSignal );
+
+static int DisplayProcessInfo( FILE *fp,
+                               char *outputFormat,
+                               StateRecord *pRecord );
+static char *GetStatus( LockData *pData );
+static void WriteExitStatus( FILE *fp, int wstatus );
+static void WriteJsonString( FILE *fp, const char *str, size_t len );
 static int GetProcessTime( long runtime, char *buf, size_t len );
 
 static int IncrementRestartCount( char *name );
 
 static int RestartDependents( Process *pProcess );
 static int RestartDependent( Process *pProcess, int wait );
+static void RestartSubtree( Process *pProcess, int wait );
+static bool SubtreeRestartRequired( Process *pProcess );
+static void CollectSubtree( Process *pProcess, ProcessList *pList );
+static void StopSubtreeProcess( Process *pProcess );
+static void SubtreeStopped( void *arg );
+static void ScheduleProcesses( ProcmonState *pProcmonState );
 
 static int MonitorProcmon( ProcmonState *pProcmonState );
 
+static int SetupPeer( ProcmonState *pProcmonState, Process *p );
+
+static void SupervisePeer( void *arg );
+
+static int PromoteToPrimary( ProcmonState *pProcmonState );
+
+static int StartPrimary( ProcmonState *pProcmonState );
+
 static int MakeOwnLock( ProcmonState *pProcmonState );
 
 int main( int argC, char *argV[] );
@@ -292,6 +920,87 @@ int main( int argC, char *argV[] );
 #define EOK 0
 #endif
 
+#ifndef SYS_pidfd_open
+/*! pidfd_open system call number for libc versions which don't define it */
+#define SYS_pidfd_open 434
+#endif
+
+/*! name of the environment variable which passes the readiness
+ *  notification file descriptor to a process */
+#define PROCMON_READY_FD "PROCMON_READY_FD"
+
+/*! name of the environment variable which passes the listening socket
+ *  file descriptors to a socket activated process */
+#define PROCMON_LISTEN_FDS "PROCMON_LISTEN_FDS"
+
+/*! name of the environment variable which passes the barrier socket
+ *  file descriptor to a standby */
+#define PROCMON_STANDBY_FD "PROCMON_STANDBY_FD"
+
+/*! name of the environment variable which passes the lock handle
+ *  file descriptor to a monitored process */
+#define PROCMON_LOCK_FD "PROCMON_LOCK_FD"
+
+/*! delay (in milliseconds) before a standby is launched after its
+ *  process has started, so it does not compete with the startup of the
+ *  process, or after a standby has died */
+#define PROCMON_STANDBY_DELAY ( 1000 )
+
+/*! default length of the restart budget window in seconds */
+#define PROCMON_RESTART_WINDOW ( 60 )
+
+/*! default length of time (in seconds) a process is given to stop
+ *  before it is killed */
+#define PROCMON_STOP_TIMEOUT ( 10 )
+
+/*! maximum number of instances of a replica group */
+#define PROCMON_MAX_REPLICAS ( 1024 )
+
+/*! default size (in bytes) at which a process log file is rotated */
+#define PROCMON_LOG_FILE_SIZE ( 1024 * 1024 )
+
+/*! default interval (in seconds) between health check probes */
+#define PROCMON_HEALTH_INTERVAL ( 10 )
+
+/*! default time (in seconds) a health check probe may take */
+#define PROCMON_HEALTH_TIMEOUT ( 5 )
+
+/*! default number of consecutive failed health check probes after
+ *  which a process is restarted */
+#define PROCMON_HEALTH_FAILURES ( 3 )
+
+/*! path of the control socket served by the primary process monitor */
+#define PROCMON_CONTROL_SOCKET "/tmp/procmon.sock"
+
+/*! default interval between process metrics samples in seconds */
+#define PROCMON_METRICS_INTERVAL ( 10 )
+
+/*! default address of the OpenMetrics endpoint */
+#define PROCMON_METRICS_ADDRESS "127.0.0.1"
+
+/*! suffix appended to the configuration file name to get the name of
+ *  its configuration cache */
+#define PROCMON_CACHE_SUFFIX ".cache"
+
+/*! size of the stack used by a launched child until it executes
+ *  its process */
+#define PROCMON_LAUNCH_STACK ( 64 * 1024 )
+
+/*! number of process objects allocated together */
+#define PROCMON_PROCESS_BLOCK ( 64 )
+
+/*! estimated size (in bytes) of the configuration data of a process,
+ *  excluding its environment */
+#define PROCMON_PROCESS_DATA ( 1024 )
+
+/*! size (in bytes) of the variables added to the environment of a
+ *  process which is passed file descriptors */
+#define PROCMON_ENV_VARS ( sizeof( PROCMON_READY_FD ) + \
+                           sizeof( PROCMON_LISTEN_FDS ) + \
+                           sizeof( PROCMON_STANDBY_FD ) + \
+                           sizeof( PROCMON_LOCK_FD ) + 36 + \
+                           ( LISTENER_MAX_SOCKETS * 12 ) )
+
 /*==============================================================================
        File Scoped Variables
 ==============================================================================*/
@@ -301,7 +1010,19 @@ ProcmonState *pProcmonState;
 
 char *ProcessStates[] =
 {
-    "INIT", "STARTED", "RUNNING", "TERMINATED", "WAITING"
+    "INIT", "STARTED", "RUNNING", "TERMINATED", "WAITING", "FAILED"
+};
+
+/*! signals which may be used to stop a process */
+static const SignalName SignalNames[] =
+{
+    { "HUP", SIGHUP },
+    { "INT", SIGINT },
+    { "QUIT", SIGQUIT },
+    { "KILL", SIGKILL },
+    { "USR1", SIGUSR1 },
+    { "USR2", SIGUSR2 },
+    { "TERM", SIGTERM }
 };
 
 /*==============================================================================
@@ -327,19 +1048,89 @@ char *ProcessStates[] =
 ==============================================================================*/
 int main( int argC, char *argV[] )
 {
+    sigset_t sigmask;
+
     pProcmonState = NULL;
 
     /* create the state machine instance */
     pProcmonState = (ProcmonState *)calloc(1, sizeof( ProcmonState ) );
     if ( pProcmonState != NULL )
     {
+        pProcmonState->lockfd = -1;
+
+        /* open the shared process state table used by all commands */
+        if ( STATETABLE_Open() != EOK )
+        {
+            fprintf( stderr, "Failed to open the process state table\n" );
+            exit( 1 );
+        }
+
+        /* the process environments are sized for the environment of
+         * the process monitor, which does not change */
+        while ( environ[pProcmonState->envCount] != NULL )
+        {
+            pProcmonState->envCount++;
+        }
+
+        /* the process objects are allocated in blocks, and reused */
+        if ( ARENA_Init( &pProcmonState->processArena,
+                         PROCMON_PROCESS_BLOCK * sizeof( Process ) ) != EOK )
+        {
+            fprintf( stderr, "Failed to allocate the process objects\n" );
+            exit( 1 );
+        }
+
         /* Process Options */
         ProcessOptions( argC, argV, pProcmonState );
 
         if ( pProcmonState->configFile != NULL )
         {
-            /* create a lockfile used to monitor the running status
-             * of the process monitor */
+            /* create the event loop used to supervise the processes */
+            if ( EVENTLOOP_Init() != EOK )
+            {
+                fprintf( stderr, "Failed to create the event loop\n" );
+                exit( 1 );
+            }
+
+            /* a configuration reload is requested with SIGHUP, which is
+             * received by the event loop, so it is blocked in all of
+             * our threads */
+            sigemptyset( &sigmask );
+            sigaddset( &sigmask, SIGHUP );
+            pthread_sigmask( SIG_BLOCK, &sigmask, NULL );
+
+            /* supervise processes from the event loop if pidfds are
+             * supported, otherwise fall back to one thread per process */
+            pProcmonState->supervisor = SupervisorSupported();
+
+            /* deliver process monitoring commands to the event loop */
+            if ( ( pProcmonState->supervisor == true ) &&
+                 ( InitCommandRelay( pProcmonState ) != EOK ) )
+            {
+                fprintf( stderr, "Failed to create the command relay\n" );
+                pProcmonState->supervisor = false;
+            }
+
+            if ( pProcmonState->supervisor == true )
+            {
+                /* the event loop launches one process at a time, so
+                 * the launch stack is only allocated once */
+                pProcmonState->launchStack = mmap( NULL,
+                                                   PROCMON_LAUNCH_STACK,
+                                                   PROT_READ | PROT_WRITE,
+                                                   MAP_PRIVATE |
+                                                   MAP_ANONYMOUS |
+                                                   MAP_STACK,
+                                                   -1,
+                                                   0 );
+                if ( pProcmonState->launchStack == MAP_FAILED )
+                {
+                    pProcmonState->launchStack = NULL;
+                }
+            }
+
+            /* create a process state record used to monitor the running
+             * status of the process monitor */
             MakeOwnLock(pProcmonState);
 
             /* start/monitor either the primary or secondary process monitor */
@@ -347,15 +1138,13 @@ int main( int argC, char *argV[] )
 
             if( pProcmonState->primary )
             {
-                if ( pProcmonState->verbose == true )
-                {
-                    printf("Processing the config file \n");
-                }
-                
-                /* the primary process monitor processes the config file */
-                ProcessConfigFile( pProcmonState );
+                /* the primary process monitor runs the processes */
+                StartPrimary( pProcmonState );
             }
 
+            /* supervise the processes */
+            EVENTLOOP_Run();
+
             /* let our threads do all the work while we take a nap */
             while( 1 )
             {
@@ -387,17 +1176,30 @@ static void usage( char *cmdname )
     if( cmdname != NULL )
     {
         fprintf(stderr,
-                "usage: %s [-v] [-h] [-l] [-x]"
+                "usage: %s [-v] [-h] [-l] [-x] [-R]"
                 " [-s <proc>] [-r <proc>] [-k <proc>] [-d <proc>] [-o <fmt>]"
+                " [-L <proc>] [-b <proc>] [-a <address>] [-q <request>]"
+                " [--token <filename>] [--trace <filename>]"
                 " [-f|F <filename>]\n"
                 " [-h] : display this help\n"
                 " [-l] : list all the monitored processes\n"
                 " [-o fmt] : list the monitored processes using fmt. eg json\n"
+                " [-L] : display the captured output of a process\n"
                 " [-x] : remove all monitored processes\n"
+                " [-R] : reload the configuration file\n"
+                " [-c <filename>] : compile the configuration cache\n"
                 " [-k] : kill process and suspend monitoring\n"
                 " [-r] : restart process\n"
                 " [-s] : start monitoring a previously stopped process\n"
+                " [-b] : record a heartbeat for a process\n"
                 " [-d] : stop processs and delete monitoring\n"
+                " [-k|r|s|b|d] applied to a replica group apply to"
+                " each of its instances\n"
+                " [-a <address>] : run the cluster aggregator\n"
+                " [--token <filename>] : read the cluster token of the"
+                " aggregator, given before -a\n"
+                " [-q <request>] : query the cluster aggregator\n"
+                " [--trace <filename>] : write a lifecycle trace\n"
                 " [-v] : verbose output\n"
                 " [-f|F <filename>] : start processes as per configuration\n",
                 cmdname );
@@ -434,18 +1236,38 @@ static int ProcessOptions( int argC,
 {
     int c;
     int result = EINVAL;
-    const char *options = "lhvF:f:k:r:s:d:xo:";
-
+    const char *options = "lhvRF:f:c:k:r:s:d:xo:L:b:a:q:";
+    static const struct option longOptions[] =
+    {
+        { "trace", required_argument, NULL, 'T' },
+        { "token", required_argument, NULL, 'K' },
+        { NULL, 0, NULL, 0 }
+    };
     if( ( pProcmonState != NULL ) &&
         ( argV != NULL ) )
     {
         /* save the name of the procmon executable */
         pProcmonState->argv0 = argV[0];
 
-        while( ( c = getopt( argC, argV, options ) ) != -1 )
+        while( ( c = getopt_long( argC,
+                                  argV,
+                                  options,
+                                  longOptions,
+                                  NULL ) ) != -1 )
         {
             switch( c )
             {
+                case 'T':
+                    if ( TRACE_Enable( optarg ) != EOK )
+                    {
+                        fprintf( stderr, "Invalid trace file %s\n", optarg );
+                    }
+                    break;
+
+                case 'K':
+                    pProcmonState->tokenFile = optarg;
+                    break;
+
                 case 'v':
                     pProcmonState->verbose = true;
                     break;
@@ -458,13 +1280,32 @@ static int ProcessOptions( int argC,
                     pProcmonState->configFile = optarg;
                     break;
 
+                case 'c':
+                    pProcmonState->configFile = optarg;
+                    result = ParseConfigFile( pProcmonState );
+                    if ( result == EOK )
+                    {
+                        result = WriteConfigCache( pProcmonState );
+                    }
+
+                    if ( result != EOK )
+                    {
+                        fprintf( stderr,
+                                 "Failed to compile %s (%s)\n",
+                                 optarg,
+                                 strerror( result ) );
+                    }
+                    exit( result );
+                    break;
+
                 case 'h':
                     usage( argV[0] );
                     exit( 0 );
                     break;
 
                 case 'd':
-                    result = terminate_and_stop_monitoring( optarg );
+                    result = ForEachInstance( optarg,
+                                              terminate_and_stop_monitoring );
                     if ( result != EOK )
                     {
                         fprintf( stderr,
@@ -476,7 +1317,7 @@ static int ProcessOptions( int argC,
                     break;
 
                 case 'k':
-                    result = terminate( optarg );
+                    result = ForEachInstance( optarg, terminate );
                     if ( result != EOK )
                     {
                         fprintf( stderr,
@@ -488,7 +1329,7 @@ static int ProcessOptions( int argC,
                     break;
 
                 case 'r':
-                    result = restart( optarg );
+                    result = ForEachInstance( optarg, restart );
                     if ( result != EOK )
                     {
                         fprintf( stderr,
@@ -500,7 +1341,7 @@ static int ProcessOptions( int argC,
                     break;
 
                 case 's':
-                    result = start( optarg );
+                    result = ForEachInstance( optarg, start );
                     if ( result != EOK )
                     {
                         fprintf( stderr,
@@ -511,22 +1352,78 @@ static int ProcessOptions( int argC,
                     exit(result);
                     break;
 
+                case 'b':
+                    result = ForEachInstance( optarg, heartbeat );
+                    if ( result != EOK )
+                    {
+                        fprintf( stderr,
+                                 "Failed to record a heartbeat for %s (%s)\n",
+                                 optarg,
+                                 strerror( result ) );
+                    }
+                    exit(result);
+                    break;
+
                 case 'x':
                     ShutdownAllProcesses(pProcmonState);
                     exit( 0 );
 
-                case 'l':
-                    ListProcesses(pProcmonState);
-                    exit( 0 );
+                case 'R':
+                    result = RequestReload();
+                    if ( ( result != EOK ) && ( result != EIO ) )
+                    {
+                        fprintf( stderr,
+                                 "Failed to reload the configuration (%s)\n",
+                                 strerror( result ) );
+                    }
+                    exit( result );
                     break;
 
-                case 'o':
-                    pProcmonState->outputFormat = optarg;
+                case 'l':
                     ListProcesses(pProcmonState);
-                    exit(0);
+                    exit( 0 );
                     break;
 
-                default:
+                case 'L':
+                    result = QueryLog( optarg );
+                    if ( result != EOK )
+                    {
+                        fprintf( stderr,
+                                 "Failed to get the output of %s (%s)\n",
+                                 optarg,
+                                 strerror( result ) );
+                    }
+                    exit( result );
+                    break;
+
+                case 'a':
+                    result = RunAggregator( optarg,
+                                            pProcmonState->tokenFile );
+                    fprintf( stderr,
+                             "Failed to run the aggregator on %s (%s)\n",
+                             optarg,
+                             strerror( result ) );
+                    exit( result );
+                    break;
+
+                case 'q':
+                    result = QueryAggregator( optarg );
+                    if ( result != EOK )
+                    {
+                        fprintf( stderr,
+                                 "Failed to query the aggregator (%s)\n",
+                                 strerror( result ) );
+                    }
+                    exit( result );
+                    break;
+
+                case 'o':
+                    pProcmonState->outputFormat = optarg;
+                    ListProcesses(pProcmonState);
+                    exit(0);
+                    break;
+
+                default:
                     break;
 
             }
@@ -606,21 +1503,55 @@ static void TerminationHandler( int signum, siginfo_t *info, void *ptr )
 ==============================================================================*/
 static int ProcessConfigFile( ProcmonState *pProcmonState )
 {
-    JNode *config;
-    JArray *processes;
     int result = EINVAL;
+    int64_t start;
+    int rc;
 
     if ( pProcmonState != NULL )
     {
         if ( pProcmonState->configFile != NULL )
         {
-            config = JSON_Process( pProcmonState->configFile );
-            processes = (JArray *)JSON_Find( config, "processes" );
-            JSON_Iterate( processes, SetupProcess, (void *)pProcmonState );
-            if ( BuildDependencyLists( pProcmonState ) == EOK )
+            /* use the compiled configuration if it is up to date */
+            start = TRACE_Begin();
+            result = LoadConfigCache( pProcmonState );
+            TRACE_End( "load config cache", NULL, start );
+            if ( result != EOK )
+            {
+                result = ParseConfigFile( pProcmonState );
+                if ( result == EOK )
+                {
+                    /* compile the configuration, and run from the compiled
+                     * configuration */
+                    start = TRACE_Begin();
+                    rc = WriteConfigCache( pProcmonState );
+                    if ( rc == EOK )
+                    {
+                        rc = LoadConfigCache( pProcmonState );
+                    }
+                    TRACE_End( "compile config cache", NULL, start );
+
+                    if ( ( rc != EOK ) && ( pProcmonState->verbose == true ) )
+                    {
+                        fprintf( stderr,
+                                 "Failed to compile %s (%s)\n",
+                                 pProcmonState->configFile,
+                                 strerror( rc ) );
+                    }
+                }
+                else if ( result == EINVAL )
+                {
+                    /* start the valid processes */
+                    result = EOK;
+                }
+            }
+
+            if ( result == EOK )
             {
+                InheritResources( pProcmonState );
                 result = DisplayConfig( pProcmonState );
                 RunProcesses( pProcmonState );
+                StartMetrics( pProcmonState );
+                StartCluster( pProcmonState );
             }
         }
     }
@@ -629,93 +1560,124 @@ static int ProcessConfigFile( ProcmonState *pProcmonState )
 }
 
 /*============================================================================*/
-/*  SetupProcess                                                              */
+/*  ParseConfigFile                                                           */
 /*!
-    Set up a process object
-
-    The SetupProcess function is a callback function for the JSON_Iterate
-    function which sets up a process object from the JSON configuration.
-    The process variable definition object is expected to look as follows:
+    Parse the process monitor configuration file
 
-    {
-        "id":"<process reference name (must be unique)>",
-        "exec":"<command to execute to start the process>",
-        "wait": <wait time in seconds>,
-        "depends": ["<process dependency name>","<process dependency name>"]
-    }
+    The ParseConfigFile function parses the procmon configuration file,
+    sets up a process object for each of its process definitions, and
+    builds the dependency graph of the processes.
 
-    @param[in]
-       pNode
-            pointer to the process definition node
+    The configuration data of the processes is copied from the
+    configuration tree into the configuration arena of the process
+    monitor state, which is sized from the configuration file, so the
+    tree is freed once the processes have been set up.
 
     @param[in]
-        arg
-            opaque pointer argument used for the ProcMon state object
+        pProcmonState
+            pointer to the process monitor state to set up
 
-    @retval EOK - the process object was set up successfully
-    @retval EINVAL - the process object could not be set up
+    @retval EOK - the configuration file was parsed
+    @retval EINVAL - the configuration file or one of its process
+                     definitions is invalid.  The dependency graph of
+                     the valid processes has been built.
+    @retval ENOMEM - memory allocation failure
+    @retval other - error building the dependency graph
 
 ==============================================================================*/
-static int SetupProcess( JNode *pNode, void *arg )
+static int ParseConfigFile( ProcmonState *pProcmonState )
 {
-    ProcmonState *pProcmonState = (ProcmonState *)arg;
-    ProcessNode *pProcessNode;
+    JNode *pConfig = NULL;
+    JNode *pProcesses = NULL;
+    JNode *pNode;
     int result = EINVAL;
-    Process *p;
-    JNode *pDepends;
-    char *waitstr;
-    int i;
+    struct stat sb;
+    size_t n = 0;
+    int i = 0;
+    int replicas;
+    int64_t start;
 
-    if( pProcmonState != NULL )
+    if ( ( pProcmonState != NULL ) && ( pProcmonState->configFile != NULL ) )
     {
-        /* allocate memory for the process node */
-        pProcessNode = calloc( 1, sizeof( ProcessNode ) );
-        if ( pProcessNode != NULL )
+        start = TRACE_Begin();
+        pConfig = JSON_Process( pProcmonState->configFile );
+        TRACE_End( "parse config", NULL, start );
+        if ( pConfig != NULL )
         {
-            /* allocate memory for the process object */
-            p = calloc( 1, sizeof( Process ) );
-            if ( p != NULL )
+            pProcesses = JSON_Find( pConfig, "processes" );
+        }
+
+        if ( ( pProcesses != NULL ) && ( pProcesses->type == JSON_ARRAY ) )
+        {
+            /* an invalid process definition would stop the process
+             * list being set up, so count the process objects which
+             * should be set up, including each replica */
+            while ( ( pNode = JSON_Index( (JArray *)pProcesses, i++ ) )
+                    != NULL )
             {
-                p->id = JSON_GetStr( pNode, "id" );
-                p->exec = JSON_GetStr( pNode, "exec" );
-                waitstr = JSON_GetStr( pNode, "wait" );
-                if ( waitstr != NULL )
-                {
-                    p->wait = atoi(waitstr);
-                }
+                replicas = 1;
+                (void)JSON_GetNum( pNode, "replicas", &replicas );
+                n += ( replicas > 0 ) ? (size_t)replicas : 1;
+            }
+        }
 
-                p->monitored = JSON_GetBool( pNode, "monitored" );
-                p->verbose = JSON_GetBool( pNode, "verbose" );
-                p->skip = JSON_GetBool( pNode, "skip" );
-                p->restart_on_parent_death = JSON_GetBool( pNode,
-                                                "restart_on_parent_death" );
+        /* size the configuration data from the configuration file */
+        if ( stat( pProcmonState->configFile, &sb ) != 0 )
+        {
+            sb.st_size = 0;
+        }
 
-                pDepends = JSON_Attribute( (JObject *)pNode, "depends" );
-                if ( ( pDepends != NULL ) && ( pDepends->type == JSON_ARRAY ) )
-                {
-                    p->pDepends = (JArray *)pDepends;
-                }
+        result = ARENA_Init( &pProcmonState->arena,
+                             ConfigDataSize( n, (size_t)sb.st_size ) );
 
-                pProcessNode->pProcess = p;
+        if ( ( result == EOK ) && ( pProcesses != NULL ) && ( n > 0 ) )
+        {
+            start = TRACE_Begin();
+            JSON_Iterate( (JArray *)pProcesses,
+                          SetupProcess,
+                          (void *)pProcmonState );
+            TRACE_End( "setup processes", NULL, start );
+        }
 
-                if ( pProcmonState->pLast == NULL )
-                {
-                    pProcmonState->pFirst = pProcessNode;
-                    pProcmonState->pLast = pProcessNode;
-                }
-                else
-                {
-                    pProcmonState->pLast->pNext = pProcessNode;
-                    pProcmonState->pLast = pProcessNode;
-                }
+        /* read the process metrics settings */
+        pProcmonState->metricsInterval = PROCMON_METRICS_INTERVAL;
+        (void)JSON_GetNum( pConfig,
+                           "metrics_interval",
+                           &pProcmonState->metricsInterval );
+        (void)JSON_GetNum( pConfig,
+                           "metrics_port",
+                           &pProcmonState->metricsPort );
+        pProcmonState->metricsAddress =
+            ARENA_Strdup( &pProcmonState->arena,
+                          JSON_GetStr( pConfig, "metrics_address" ) );
+
+        /* read the cluster settings */
+        pProcmonState->aggregator =
+            ARENA_Strdup( &pProcmonState->arena,
+                          JSON_GetStr( pConfig, "aggregator" ) );
+        pProcmonState->nodeName =
+            ARENA_Strdup( &pProcmonState->arena,
+                          JSON_GetStr( pConfig, "node" ) );
+        pProcmonState->tokenFile =
+            ARENA_Strdup( &pProcmonState->arena,
+                          JSON_GetStr( pConfig, "token_file" ) );
 
-                result = EOK;
-            }
-            else
-            {
-                free( pProcessNode );
-                pProcessNode = NULL;
-            }
+        if ( result == EOK )
+        {
+            result = BuildDependencyLists( pProcmonState );
+        }
+
+        if ( ( result == EOK ) &&
+             ( ( pConfig == NULL ) ||
+               ( pProcmonState->processes.count != n ) ) )
+        {
+            result = EINVAL;
+        }
+
+        /* the processes no longer refer to the configuration tree */
+        if ( pConfig != NULL )
+        {
+            JSON_Free( pConfig );
         }
     }
 
@@ -723,104 +1685,162 @@ static int SetupProcess( JNode *pNode, void *arg )
 }
 
 /*============================================================================*/
-/*  FindProcess                                                               */
+/*  ConfigDataSize                                                            */
 /*!
-    Find a process object
+    Estimate the size of the configuration data
 
-    The FindProcess function iterates through the process list
-    looking for a process which exactly matches the specified process
-    identifier.
+    The ConfigDataSize function estimates the size of the configuration
+    arena needed for the processes of a configuration.  The arena grows
+    if the estimate is too small.
 
     @param[in]
-       id
-            pointer to the name of the process to search for
+        count
+            number of processes in the configuration
 
     @param[in]
-       pProcmonState
-            pointer to the Process Monitor state object which contains the
-            process list to search in
+        textSize
+            size (in bytes) of the configuration text the strings of the
+            processes are copied from
 
-    @retval pointer to the found Process
-    @retval NULL - if the process object could not be found
+    @retval estimated size (in bytes) of the configuration data
 
 ==============================================================================*/
-Process *FindProcess( char *id, ProcmonState *pProcmonState )
+static size_t ConfigDataSize( size_t count, size_t textSize )
 {
-    ProcessNode *pProcessNode;
-    Process *pProcess = NULL;
-
-    if ( ( pProcmonState != NULL ) &&
-         ( id != NULL ) )
-    {
-        pProcessNode = pProcmonState->pFirst;
-        while ( pProcessNode != NULL )
-        {
-            pProcess = pProcessNode->pProcess;
-            if ( pProcess != NULL )
-            {
-                if ( pProcess->id != NULL )
-                {
-                    if ( strcmp( id, pProcess->id ) == 0 )
-                    {
-                        break;
-                    }
-                }
-            }
+    size_t envSize;
 
-            pProcess = NULL;
-            pProcessNode = pProcessNode->pNext;
-        }
-    }
+    envSize = ( pProcmonState->envCount + 5 ) * sizeof( char * ) +
+              PROCMON_ENV_VARS;
 
-    return pProcess;
+    /* the strings are copied, and the commands are split into
+     * argument vectors of up to one pointer per character */
+    return ( textSize * ( sizeof( char * ) + 2 ) ) +
+           ( count * ( PROCMON_PROCESS_DATA + envSize ) );
 }
 
 /*============================================================================*/
-/*  BuildDependencyLists                                                      */
+/*  LoadConfigCache                                                           */
 /*!
-    Build parent/child dependency lists for all processes
+    Load the process configuration from the configuration cache
 
-    The BuildDependencyLists function iterates through the process list
-    and builds the relationships between parents and children based
-    on the dependency JSON object retrieved from the process configuration
-    file.
+    The LoadConfigCache function maps the configuration cache of the
+    configuration file, and sets up the process objects and their
+    dependency graph from its process definitions, without parsing
+    the configuration file.
+
+    The process objects refer to the strings of the cache, which
+    remains mapped while the process monitor is running.  Their other
+    configuration data is allocated from a new configuration arena.
+    On success, the cached processes and their configuration arena
+    replace any previously set up processes.
 
     @param[in]
-       pProcmonState
-            pointer to the process monitor state object which
-            contains the list of processes to analyze
+        pProcmonState
+            pointer to the process monitor state to set up
 
-    @retval EOK - updated all process dependencies
-    @retval ENOMEM - memory allocation failure
-    @retval ENOENT - parent dependency not found
-    @retval EINVAL - invalid arguments
+    @retval EOK - the configuration was loaded from the cache
+    @retval ENOENT - there is no configuration cache
+    @retval ESTALE - the configuration file has changed
+    @retval EINVAL - the configuration cache is invalid
+    @retval other - error loading the configuration cache
 
 ==============================================================================*/
-static int BuildDependencyLists( ProcmonState *pProcmonState )
+static int LoadConfigCache( ProcmonState *pProcmonState )
 {
     int result = EINVAL;
-    ProcessNode *pProcessNode;
-    Process *pProcess;
-    int rc;
+    ProcmonState config;
+    ConfigCache cache;
+    ConfigCacheHeader *pHeader;
+    char path[PATH_MAX];
+    size_t i;
+
+    memset( &config, 0, sizeof( config ) );
 
     if ( pProcmonState != NULL )
     {
-        result = EOK;
+        result = GetCacheFile( pProcmonState, path, sizeof( path ) );
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_Open( &cache,
+                                       path,
+                                       pProcmonState->configFile );
+        }
 
-        pProcessNode = pProcmonState->pFirst;
-        while ( pProcessNode != NULL )
+        if ( result == EOK )
         {
-            pProcess = pProcessNode->pProcess;
-            rc = AddParents( pProcmonState, pProcess );
-            if ( rc != EOK )
+            pHeader = CONFIGCACHE_GetHeader( &cache );
+            result = ARENA_Init( &config.arena,
+                                 ConfigDataSize( pHeader->count, 0 ) );
+
+            for ( i = 0 ; ( result == EOK ) && ( i < pHeader->count ) ; i++ )
             {
-                fprintf( stderr,
-                         "Failed to add parents for %s\n",
-                         pProcess->id );
-                result = rc;
+                result = SetupCachedProcess( &config,
+                                             &cache,
+                                             CONFIGCACHE_GetProcess( &cache,
+                                                                     i ) );
+            }
+
+            if ( result == EOK )
+            {
+                result = BuildDependencyLists( &config );
+            }
+
+            if ( result == EOK )
+            {
+                /* replace the previously set up processes */
+                for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+                {
+                    DiscardProcess( pProcmonState->processes.pProcesses[i] );
+                }
+
+                free( pProcmonState->processes.pProcesses );
+                free( pProcmonState->order.pProcesses );
+                free( pProcmonState->pIndex );
+                CONFIGCACHE_Close( &pProcmonState->configCache );
+                ARENA_Free( &pProcmonState->arena );
+
+                pProcmonState->arena = config.arena;
+                pProcmonState->processes = config.processes;
+                pProcmonState->order = config.order;
+                pProcmonState->graphDepth = config.graphDepth;
+                pProcmonState->graphWait = config.graphWait;
+                pProcmonState->pIndex = config.pIndex;
+                pProcmonState->indexSize = config.indexSize;
+                pProcmonState->configCache = cache;
+
+                pProcmonState->metricsInterval = pHeader->metricsInterval;
+                pProcmonState->metricsPort = pHeader->metricsPort;
+                pProcmonState->metricsAddress =
+                    (char *)CONFIGCACHE_GetString( &cache,
+                                                   pHeader->metricsAddress );
+                pProcmonState->aggregator =
+                    (char *)CONFIGCACHE_GetString( &cache,
+                                                   pHeader->aggregator );
+                pProcmonState->nodeName =
+                    (char *)CONFIGCACHE_GetString( &cache,
+                                                   pHeader->nodeName );
+                pProcmonState->tokenFile =
+                    (char *)CONFIGCACHE_GetString( &cache,
+                                                   pHeader->tokenFile );
+
+                if ( pProcmonState->verbose == true )
+                {
+                    printf("Loaded the config cache %s\n", path );
+                }
             }
+            else
+            {
+                for ( i = 0 ; i < config.processes.count ; i++ )
+                {
+                    DiscardProcess( config.processes.pProcesses[i] );
+                }
 
-            pProcessNode = pProcessNode->pNext;
+                free( config.processes.pProcesses );
+                free( config.order.pProcesses );
+                free( config.pIndex );
+                ARENA_Free( &config.arena );
+                CONFIGCACHE_Close( &cache );
+            }
         }
     }
 
@@ -828,125 +1848,7625 @@ static int BuildDependencyLists( ProcmonState *pProcmonState )
 }
 
 /*============================================================================*/
-/*  AddParents                                                                */
+/*  SetupCachedProcess                                                        */
 /*!
-    Add parent dependencies for the specified process
+    Set up a process object from the configuration cache
 
-    The AddParents function iterates through the JSON dependency list
-    for the specified process, searches for the parent processes,
-    and adds references to the parent processes to the process parent
-    dependency list.
+    The SetupCachedProcess function sets up a process object from its
+    compiled process definition.  The command line has already been
+    split into its arguments, and the dependencies have already been
+    resolved to process indices.  The argument vector, CPU set and
+    environment of the process are allocated from the configuration
+    arena.
 
     @param[in]
-       pProcmonState
-            pointer to the process monitor state object which
-            contains the list of processes to analyze
+        pProcmonState
+            pointer to the process monitor state to add the process to
 
-    @retval EOK - updated all process dependencies
+    @param[in]
+        pCache
+            pointer to the configuration cache
+
+    @param[in]
+        pDef
+            pointer to the compiled process definition
+
+    @retval EOK - the process object was set up successfully
+    @retval EINVAL - the process definition is invalid
     @retval ENOMEM - memory allocation failure
-    @retval ENOENT - parent dependency not found
-    @retval EINVAL - invalid arguments
 
 ==============================================================================*/
-static int AddParents( ProcmonState *pProcmonState, Process *pProcess )
+static int SetupCachedProcess( ProcmonState *pProcmonState,
+                               ConfigCache *pCache,
+                               ConfigCacheProcess *pDef )
 {
-    JArray *pDepends;
-    JNode *pName;
-    JVar *pVar;
-    int i = 0;
     int result = EINVAL;
     Process *p;
-    char *id;
-    int rc;
+    ProcessResources *pResources;
+    const uint32_t *pArgs = NULL;
+    const cpu_set_t *pCpuset = NULL;
+    size_t i;
 
-    if ( pProcess != NULL )
+    if ( ( pProcmonState != NULL ) && ( pCache != NULL ) && ( pDef != NULL ) )
     {
-        pDepends = pProcess->pDepends;
-        result = EOK;
-
-        do
+        /* allocate memory for the process object */
+        p = NewProcess();
+        if ( p != NULL )
         {
-            /* iterate through the JSON dependency list */
-            pName = JSON_Index( pDepends, i++ );
-            if( ( pName != NULL ) && ( pName->type == JSON_VAR ) )
+            result = EOK;
+
+            p->id = (char *)CONFIGCACHE_GetString( pCache, pDef->id );
+            p->exec = (char *)CONFIGCACHE_GetString( pCache, pDef->exec );
+            p->wait = pDef->wait;
+            p->monitored = ( pDef->flags & CONFIGCACHE_MONITORED ) != 0;
+            p->verbose = ( pDef->flags & CONFIGCACHE_VERBOSE ) != 0;
+            p->skip = ( pDef->flags & CONFIGCACHE_SKIP ) != 0;
+            p->notify = ( pDef->flags & CONFIGCACHE_NOTIFY ) != 0;
+            p->standby = ( pDef->flags & CONFIGCACHE_STANDBY ) != 0;
+            p->restart_on_parent_death =
+                ( pDef->flags & CONFIGCACHE_RESTART_ON_PARENT_DEATH ) != 0;
+            p->restart_delay = pDef->restart_delay;
+            p->restart_backoff_max = pDef->restart_backoff_max;
+            p->restart_limit = pDef->restart_limit;
+            p->restart_window = pDef->restart_window;
+            p->stopSignal = pDef->stop_signal;
+            p->stopTimeout = pDef->stop_timeout;
+            p->logBufferSize = pDef->log_buffer;
+            p->logFile =
+                (char *)CONFIGCACHE_GetString( pCache, pDef->log_file );
+            p->logFileSize = pDef->log_file_size;
+            p->listen = (char *)CONFIGCACHE_GetString( pCache, pDef->listen );
+            p->idleTimeout = pDef->idle_timeout;
+            p->healthCheck =
+                (char *)CONFIGCACHE_GetString( pCache, pDef->health_check );
+            p->healthInterval = pDef->health_interval;
+            p->healthTimeout = pDef->health_timeout;
+            p->healthFailures = pDef->health_failures;
+            p->seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+            p->exitEvent.fd = -1;
+            p->readyEvent.fd = -1;
+            InitStandby( &p->spare );
+            METRICS_Init( &p->metrics,
+                          ( p->monitored && !p->skip ) ? p->id : NULL );
+
+            pResources = &p->resources;
+            RESOURCES_Init( pResources );
+            pResources->cgroup =
+                (char *)CONFIGCACHE_GetString( pCache, pDef->cgroup );
+            pResources->cpu_max =
+                (char *)CONFIGCACHE_GetString( pCache, pDef->cpu_max );
+            pResources->memory_max =
+                (char *)CONFIGCACHE_GetString( pCache, pDef->memory_max );
+            pResources->setNice = ( pDef->flags & CONFIGCACHE_SET_NICE ) != 0;
+            pResources->nice = pDef->nice;
+            pResources->ioprio = pDef->ioprio;
+
+            if ( pDef->cpuset != CONFIGCACHE_NONE )
             {
-                pVar = (JVar *)pName;
-                if ( pVar->var.type = JVARTYPE_STR )
+                pCpuset = CONFIGCACHE_GetData( pCache,
+                                               pDef->cpuset,
+                                               sizeof( cpu_set_t ) );
+                pResources->pCpuset = ARENA_Alloc( &pProcmonState->arena,
+                                                   sizeof( cpu_set_t ) );
+                if ( pCpuset == NULL )
                 {
-                    id = pVar->var.val.str;
-                    p = FindProcess( id, pProcmonState );
-                    if ( p != NULL )
-                    {
-                        rc = AddParent( pProcess, p );
-                        if ( rc != EOK )
-                        {
-                            result = rc;
-                        }
-                    }
-                    else
+                    result = EINVAL;
+                }
+                else if ( pResources->pCpuset == NULL )
+                {
+                    result = ENOMEM;
+                }
+                else
+                {
+                    memcpy( pResources->pCpuset, pCpuset, sizeof( cpu_set_t ) );
+                }
+            }
+
+            if ( pDef->ndepends > 0 )
+            {
+                p->pDependsIndex = CONFIGCACHE_GetData(
+                                        pCache,
+                                        pDef->depends,
+                                        pDef->ndepends * sizeof( uint32_t ) );
+                p->ndepends = pDef->ndepends;
+                if ( p->pDependsIndex == NULL )
+                {
+                    result = EINVAL;
+                }
+            }
+
+            if ( ( result == EOK ) && ( pDef->argc > 0 ) )
+            {
+                /* the argument vector refers to the strings of the cache */
+                pArgs = CONFIGCACHE_GetData( pCache,
+                                             pDef->argv,
+                                             pDef->argc * sizeof( uint32_t ) );
+                p->argv = ARENA_Alloc( &pProcmonState->arena,
+                                       ( pDef->argc + 1 ) * sizeof( char * ) );
+                if ( pArgs == NULL )
+                {
+                    result = EINVAL;
+                }
+                else if ( p->argv == NULL )
+                {
+                    result = ENOMEM;
+                }
+
+                for ( i = 0 ; ( result == EOK ) && ( i < pDef->argc ) ; i++ )
+                {
+                    p->argv[i] = (char *)CONFIGCACHE_GetString( pCache,
+                                                                pArgs[i] );
+                    if ( p->argv[i] == NULL )
                     {
-                        fprintf( stderr,
-                                 "Cannot find parent %s for process %s\n",
-                                 id,
-                                 pProcess->id );
-                        result = ENOENT;
-                        break;
+                        result = EINVAL;
                     }
                 }
             }
-        } while( pName != NULL );
+
+            if ( ( result == EOK ) &&
+                 ( p->skip == false ) &&
+                 ( p->argv == NULL ) )
+            {
+                result = EINVAL;
+            }
+
+            p->ownResources = p->resources;
+
+            if ( result == EOK )
+            {
+                result = SetupEnvironment( p, &pProcmonState->arena );
+            }
+
+            if ( result == EOK )
+            {
+                result = SetupHealthCheck( p );
+            }
+
+            if ( result == EOK )
+            {
+                result = AddProcess( pProcmonState, p );
+            }
+
+            if ( result != EOK )
+            {
+                DiscardProcess( p );
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  AddChild                                                                  */
+/*  WriteConfigCache                                                          */
 /*!
-    Add child dependencies for the specified process
+    Write the configuration cache
 
-    The AddChild function adds the parent/child relationship for the
-    specified parent and child processes.  It adds the child process
-    to the parent's child dependency list
+    The WriteConfigCache function compiles the process definitions of
+    the processes which have been set up from the configuration file,
+    and writes them to the configuration cache of the configuration file.
 
     @param[in]
-        pParent
+        pProcmonState
+            pointer to the process monitor state containing the processes
+
+    @retval EOK - the configuration cache was written
+    @retval EINVAL - invalid arguments
+    @retval other - error writing the configuration cache
+
+==============================================================================*/
+static int WriteConfigCache( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    ConfigCache cache;
+    ConfigCacheHeader *pHeader;
+    char path[PATH_MAX];
+    uint32_t address;
+    uint32_t aggregator;
+    uint32_t node;
+    uint32_t tokenFile;
+    size_t i;
+
+    if ( pProcmonState != NULL )
+    {
+        result = GetCacheFile( pProcmonState, path, sizeof( path ) );
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_Create( &cache,
+                                         pProcmonState->processes.count );
+        }
+
+        if ( result == EOK )
+        {
+            for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+            {
+                pProcmonState->processes.pProcesses[i]->position = i;
+            }
+
+            for ( i = 0 ;
+                  ( result == EOK ) && ( i < pProcmonState->processes.count ) ;
+                  i++ )
+            {
+                result = CompileProcess(
+                                &cache,
+                                i,
+                                pProcmonState->processes.pProcesses[i] );
+            }
+
+            if ( result == EOK )
+            {
+                result = CONFIGCACHE_AddString( &cache,
+                                                pProcmonState->metricsAddress,
+                                                &address );
+            }
+
+            if ( result == EOK )
+            {
+                result = CONFIGCACHE_AddString( &cache,
+                                                pProcmonState->aggregator,
+                                                &aggregator );
+            }
+
+            if ( result == EOK )
+            {
+                result = CONFIGCACHE_AddString( &cache,
+                                                pProcmonState->nodeName,
+                                                &node );
+            }
+
+            if ( result == EOK )
+            {
+                result = CONFIGCACHE_AddString( &cache,
+                                                pProcmonState->tokenFile,
+                                                &tokenFile );
+            }
+
+            if ( result == EOK )
+            {
+                pHeader = CONFIGCACHE_GetHeader( &cache );
+                pHeader->metricsInterval = pProcmonState->metricsInterval;
+                pHeader->metricsPort = pProcmonState->metricsPort;
+                pHeader->metricsAddress = address;
+                pHeader->aggregator = aggregator;
+                pHeader->nodeName = node;
+                pHeader->tokenFile = tokenFile;
+
+                result = CONFIGCACHE_Write( &cache,
+                                            path,
+                                            pProcmonState->configFile );
+            }
+
+            CONFIGCACHE_Close( &cache );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileProcess                                                            */
+/*!
+    Compile a process definition into the configuration cache
+
+    The CompileProcess function adds the strings, argument vector,
+    dependency indices and CPU set of a process to the configuration
+    cache, and stores its compiled process definition.  The process'
+    own resource attributes are compiled, rather than those it
+    inherits from its parents.
+
+    @param[in]
+        pCache
+            pointer to the configuration cache being built
+
+    @param[in]
+        n
+            index of the process definition
+
+    @param[in]
+        pProcess
+            pointer to the process to compile
+
+    @retval EOK - the process definition was compiled
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+    @retval other - error adding to the configuration cache
+
+==============================================================================*/
+static int CompileProcess( ConfigCache *pCache, size_t n, Process *pProcess )
+{
+    int result = EINVAL;
+    ConfigCacheProcess def;
+    ConfigCacheProcess *pDef;
+    ProcessResources *pResources;
+    uint32_t *pOffsets = NULL;
+    size_t argc = 0;
+    size_t count;
+    size_t i;
+
+    if ( ( pCache != NULL ) && ( pProcess != NULL ) )
+    {
+        memset( &def, 0, sizeof( def ) );
+        pResources = &pProcess->ownResources;
+
+        result = CONFIGCACHE_AddString( pCache, pProcess->id, &def.id );
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache, pProcess->exec, &def.exec );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pResources->cgroup,
+                                            &def.cgroup );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pResources->cpu_max,
+                                            &def.cpu_max );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pResources->memory_max,
+                                            &def.memory_max );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pProcess->logFile,
+                                            &def.log_file );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pProcess->listen,
+                                            &def.listen );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pProcess->healthCheck,
+                                            &def.health_check );
+        }
+
+        if ( result == EOK )
+        {
+            result = CONFIGCACHE_AddData( pCache,
+                                          pResources->pCpuset,
+                                          sizeof( cpu_set_t ),
+                                          &def.cpuset );
+        }
+
+        while ( ( pProcess->argv != NULL ) && ( pProcess->argv[argc] != NULL ) )
+        {
+            argc++;
+        }
+
+        /* store the offsets of the arguments, and the indices of the
+         * parents, which are never more than the number of arguments */
+        count = ( argc > pProcess->parents.count ) ? argc
+                                                   : pProcess->parents.count;
+        if ( ( result == EOK ) && ( count > 0 ) )
+        {
+            pOffsets = calloc( count, sizeof( uint32_t ) );
+            if ( pOffsets == NULL )
+            {
+                result = ENOMEM;
+            }
+        }
+
+        for ( i = 0 ; ( result == EOK ) && ( i < argc ) ; i++ )
+        {
+            result = CONFIGCACHE_AddString( pCache,
+                                            pProcess->argv[i],
+                                            &pOffsets[i] );
+        }
+
+        if ( ( result == EOK ) && ( argc > 0 ) )
+        {
+            def.argc = argc;
+            result = CONFIGCACHE_AddData( pCache,
+                                          pOffsets,
+                                          argc * sizeof( uint32_t ),
+                                          &def.argv );
+        }
+
+        if ( ( result == EOK ) && ( pProcess->parents.count > 0 ) )
+        {
+            for ( i = 0 ; i < pProcess->parents.count ; i++ )
+            {
+                pOffsets[i] = pProcess->parents.pProcesses[i]->position;
+            }
+
+            def.ndepends = pProcess->parents.count;
+            result = CONFIGCACHE_AddData( pCache,
+                                          pOffsets,
+                                          def.ndepends * sizeof( uint32_t ),
+                                          &def.depends );
+        }
+
+        free( pOffsets );
+
+        def.flags = ( pProcess->monitored ? CONFIGCACHE_MONITORED : 0 ) |
+                    ( pProcess->verbose ? CONFIGCACHE_VERBOSE : 0 ) |
+                    ( pProcess->skip ? CONFIGCACHE_SKIP : 0 ) |
+                    ( pProcess->notify ? CONFIGCACHE_NOTIFY : 0 ) |
+                    ( pProcess->standby ? CONFIGCACHE_STANDBY : 0 ) |
+                    ( pProcess->restart_on_parent_death
+                        ? CONFIGCACHE_RESTART_ON_PARENT_DEATH
+                        : 0 ) |
+                    ( pResources->setNice ? CONFIGCACHE_SET_NICE : 0 );
+        def.wait = pProcess->wait;
+        def.restart_delay = pProcess->restart_delay;
+        def.restart_backoff_max = pProcess->restart_backoff_max;
+        def.restart_limit = pProcess->restart_limit;
+        def.restart_window = pProcess->restart_window;
+        def.nice = pResources->nice;
+        def.ioprio = pResources->ioprio;
+        def.stop_signal = pProcess->stopSignal;
+        def.stop_timeout = pProcess->stopTimeout;
+        def.log_buffer = pProcess->logBufferSize;
+        def.log_file_size = pProcess->logFileSize;
+        def.idle_timeout = pProcess->idleTimeout;
+        def.health_interval = pProcess->healthInterval;
+        def.health_timeout = pProcess->healthTimeout;
+        def.health_failures = pProcess->healthFailures;
+
+        if ( result == EOK )
+        {
+            /* the cache may have moved while it was being added to */
+            pDef = CONFIGCACHE_GetProcess( pCache, n );
+            if ( pDef != NULL )
+            {
+                *pDef = def;
+            }
+            else
+            {
+                result = EINVAL;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetCacheFile                                                              */
+/*!
+    Get the name of the configuration cache
+
+    The GetCacheFile function gets the name of the configuration cache
+    of the configuration file, which is stored alongside the
+    configuration file.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @param[out]
+        buf
+            pointer to a buffer to store the configuration cache name
+
+    @param[in]
+        len
+            size of the buffer
+
+    @retval EOK - the configuration cache name was generated
+    @retval ENAMETOOLONG - the buffer is too small
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int GetCacheFile( ProcmonState *pProcmonState, char *buf, size_t len )
+{
+    int result = EINVAL;
+
+    if ( ( pProcmonState != NULL ) &&
+         ( pProcmonState->configFile != NULL ) &&
+         ( buf != NULL ) )
+    {
+        result = ( (size_t)snprintf( buf,
+                                     len,
+                                     "%s" PROCMON_CACHE_SUFFIX,
+                                     pProcmonState->configFile ) < len )
+                    ? EOK
+                    : ENAMETOOLONG;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupProcess                                                              */
+/*!
+    Set up a process object
+
+    The SetupProcess function is a callback function for the JSON_Iterate
+    function which sets up a process object from the JSON configuration.
+    The process variable definition object is expected to look as follows:
+
+    {
+        "id":"<process reference name (must be unique)>",
+        "exec":"<command to execute to start the process>",
+        "wait": <wait time in seconds>,
+        "notify": <true if the process will notify when it is ready>,
+        "standby": <true if a warm standby of the process is kept>,
+        "depends": ["<process dependency name>","<process dependency name>"],
+        "replicas": <number of instances of the process>,
+        "replica_pinning": "<core|numa>"
+    }
+
+    A process with a replicas attribute is a replica group, which is
+    expanded into that many process objects with the identifiers
+    <id>.0, <id>.1, etc.  See SetupStrings.
+
+    @param[in]
+       pNode
+            pointer to the process definition node
+
+    @param[in]
+        arg
+            opaque pointer argument used for the ProcMon state object
+
+    @retval EOK - the process object was set up successfully
+    @retval EINVAL - the process object could not be set up
+
+==============================================================================*/
+static int SetupProcess( JNode *pNode, void *arg )
+{
+    ProcmonState *pProcmonState = (ProcmonState *)arg;
+    int result = EINVAL;
+    int replicas = 0;
+    int i;
+
+    if ( pProcmonState != NULL )
+    {
+        if ( JSON_GetNum( pNode, "replicas", &replicas ) != EOK )
+        {
+            result = SetupInstance( pNode, pProcmonState, -1 );
+        }
+        else if ( ( replicas < 1 ) || ( replicas > PROCMON_MAX_REPLICAS ) )
+        {
+            fprintf( stderr, "Invalid replicas for %s\n",
+                     JSON_GetStr( pNode, "id" ) );
+        }
+        else
+        {
+            result = EOK;
+            for ( i = 0 ; ( result == EOK ) && ( i < replicas ) ; i++ )
+            {
+                result = SetupInstance( pNode, pProcmonState, i );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupInstance                                                             */
+/*!
+    Set up a process object for a process or a replica group instance
+
+    The SetupInstance function sets up a process object from its JSON
+    configuration and adds it to the process list.  The configuration
+    data of the process is copied into the configuration arena, so the
+    process does not refer to the configuration tree.
+
+    @param[in]
+       pNode
+            pointer to the process definition node
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @param[in]
+        index
+            index of the instance in its replica group, or -1 if the
+            process is not a replica group
+
+    @retval EOK - the process object was set up successfully
+    @retval EINVAL - the process object could not be set up
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int SetupInstance( JNode *pNode,
+                          ProcmonState *pProcmonState,
+                          int index )
+{
+    int result = EINVAL;
+    Process *p;
+    Arena *pArena;
+    cpu_set_t *pCpuset;
+    char *waitstr;
+    char *pinning;
+
+    if( pProcmonState != NULL )
+    {
+        pArena = &pProcmonState->arena;
+
+        /* allocate memory for the process object */
+        p = NewProcess();
+        if ( p != NULL )
+        {
+            p->id = JSON_GetStr( pNode, "id" );
+            p->exec = JSON_GetStr( pNode, "exec" );
+            waitstr = JSON_GetStr( pNode, "wait" );
+            if ( waitstr != NULL )
+            {
+                p->wait = atoi(waitstr);
+            }
+
+            p->monitored = JSON_GetBool( pNode, "monitored" );
+            p->verbose = JSON_GetBool( pNode, "verbose" );
+            p->skip = JSON_GetBool( pNode, "skip" );
+            p->notify = JSON_GetBool( pNode, "notify" );
+            p->standby = JSON_GetBool( pNode, "standby" );
+            (void)JSON_GetNum( pNode, "restart_delay", &p->restart_delay );
+            (void)JSON_GetNum( pNode,
+                               "restart_backoff_max",
+                               &p->restart_backoff_max );
+            (void)JSON_GetNum( pNode, "restart_limit", &p->restart_limit );
+            p->restart_window = PROCMON_RESTART_WINDOW;
+            (void)JSON_GetNum( pNode, "restart_window", &p->restart_window );
+            (void)JSON_GetNum( pNode, "log_buffer", &p->logBufferSize );
+            p->logFile = JSON_GetStr( pNode, "log_file" );
+            p->logFileSize = PROCMON_LOG_FILE_SIZE;
+            (void)JSON_GetNum( pNode, "log_file_size", &p->logFileSize );
+            p->listen = JSON_GetStr( pNode, "listen" );
+            (void)JSON_GetNum( pNode, "idle_timeout", &p->idleTimeout );
+            p->healthCheck = JSON_GetStr( pNode, "health_check" );
+            p->healthInterval = PROCMON_HEALTH_INTERVAL;
+            (void)JSON_GetNum( pNode,
+                               "health_interval",
+                               &p->healthInterval );
+            p->healthTimeout = PROCMON_HEALTH_TIMEOUT;
+            (void)JSON_GetNum( pNode, "health_timeout", &p->healthTimeout );
+            p->healthFailures = PROCMON_HEALTH_FAILURES;
+            (void)JSON_GetNum( pNode,
+                               "health_failures",
+                               &p->healthFailures );
+            p->seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+            p->exitEvent.fd = -1;
+            p->readyEvent.fd = -1;
+            InitStandby( &p->spare );
+            RESOURCES_Init( &p->resources );
+            p->restart_on_parent_death = JSON_GetBool( pNode,
+                                            "restart_on_parent_death" );
+
+            result = SetupResources( pNode, p, pArena );
+
+            if ( result == EOK )
+            {
+                result = SetupStrings( p, pArena, index );
+            }
+
+            METRICS_Init( &p->metrics,
+                          ( p->monitored && !p->skip ) ? p->id : NULL );
+
+            if ( result == EOK )
+            {
+                result = SetupDepends( pNode, p, pArena );
+            }
+
+            /* split the command line into its arguments once, rather
+             * than every time the process is started */
+            if ( ( result == EOK ) && ( p->skip == false ) )
+            {
+                result = ParseCommand( p->exec, pArena, &p->argv );
+                if ( result == EINVAL )
+                {
+                    fprintf( stderr,
+                             "Invalid exec command for %s\n",
+                             ( p->id != NULL ) ? p->id : "process" );
+                }
+            }
+
+            /* spread the instances of a replica group across the CPUs */
+            pinning = JSON_GetStr( pNode, "replica_pinning" );
+            if ( ( result == EOK ) && ( index >= 0 ) && ( pinning != NULL ) )
+            {
+                pCpuset = ARENA_Alloc( pArena, sizeof( cpu_set_t ) );
+                result = ( pCpuset != NULL )
+                         ? RESOURCES_Pin( &p->resources,
+                                          pinning,
+                                          index,
+                                          pCpuset )
+                         : ENOMEM;
+                if ( result != EOK )
+                {
+                    fprintf( stderr,
+                             "Cannot pin %s: %s\n",
+                             p->id,
+                             strerror( result ) );
+                }
+            }
+
+            p->ownResources = p->resources;
+
+            if ( result == EOK )
+            {
+                result = SetupStop( pNode, p );
+            }
+
+            if ( result == EOK )
+            {
+                result = SetupEnvironment( p, pArena );
+            }
+
+            if ( result == EOK )
+            {
+                result = SetupHealthCheck( p );
+            }
+
+            if ( result == EOK )
+            {
+                result = AddProcess( pProcmonState, p );
+            }
+
+            if ( result != EOK )
+            {
+                DiscardProcess( p );
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  NewProcess                                                                */
+/*!
+    Allocate a process object
+
+    The NewProcess function allocates a zeroed process object.  Process
+    objects which have been discarded are reused, otherwise the process
+    object is allocated from the process object arena.  The process
+    objects outlive the configuration which created them, since a
+    running process keeps its process object when the configuration is
+    reloaded.
+
+    @retval pointer to the process object
+    @retval NULL - memory allocation failure
+
+==============================================================================*/
+static Process *NewProcess( void )
+{
+    Process *pProcess;
+
+    pProcess = pProcmonState->pFreeProcesses;
+    if ( pProcess != NULL )
+    {
+        pProcmonState->pFreeProcesses = pProcess->pNextFree;
+        memset( pProcess, 0, sizeof( Process ) );
+    }
+    else
+    {
+        pProcess = ARENA_Alloc( &pProcmonState->processArena,
+                                sizeof( Process ) );
+    }
+
+    return pProcess;
+}
+
+/*============================================================================*/
+/*  SetupStrings                                                              */
+/*!
+    Copy the strings of a process into the configuration arena
+
+    The SetupStrings function copies the strings of a process from the
+    configuration tree into the configuration arena, so the tree can be
+    freed once the configuration has been loaded.
+
+    An instance of a replica group is given its own identifier,
+    <id>.<index>, and the index of the instance is substituted for each
+    {index} in its exec, log_file, listen and health_check attributes,
+    so each instance can be given its own arguments, log file, sockets
+    and health check.  For example, with
+    "exec": "/usr/bin/worker --port 80{index}" the instance worker.3
+    runs "/usr/bin/worker --port 803".
+
+    @param[in]
+        pProcess
+            pointer to the process object
+
+    @param[in]
+        pArena
+            pointer to the configuration arena
+
+    @param[in]
+        index
+            index of the instance in its replica group, or -1 if the
+            process is not a replica group
+
+    @retval EOK - the strings were copied
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int SetupStrings( Process *pProcess, Arena *pArena, int index )
+{
+    int result = EINVAL;
+    char value[16];
+    char **substituted[4];
+    char **copied[3];
+    char *p;
+    size_t len;
+    size_t i;
+
+    if ( ( pProcess != NULL ) && ( pProcess->id != NULL ) )
+    {
+        result = EOK;
+
+        substituted[0] = &pProcess->exec;
+        substituted[1] = &pProcess->logFile;
+        substituted[2] = &pProcess->listen;
+        substituted[3] = &pProcess->healthCheck;
+
+        copied[0] = &pProcess->resources.cgroup;
+        copied[1] = &pProcess->resources.cpu_max;
+        copied[2] = &pProcess->resources.memory_max;
+
+        if ( index >= 0 )
+        {
+            snprintf( value, sizeof( value ), "%d", index );
+
+            len = strlen( pProcess->id ) + strlen( value ) + 2;
+            p = ARENA_Alloc( pArena, len );
+            if ( p != NULL )
+            {
+                sprintf( p, "%s.%s", pProcess->id, value );
+                pProcess->id = p;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+        else
+        {
+            pProcess->id = ARENA_Strdup( pArena, pProcess->id );
+            result = ( pProcess->id != NULL ) ? EOK : ENOMEM;
+        }
+
+        for ( i = 0 ;
+              ( result == EOK ) &&
+              ( i < sizeof( substituted ) / sizeof( substituted[0] ) ) ;
+              i++ )
+        {
+            if ( *substituted[i] == NULL )
+            {
+                /* the attribute is not specified */
+            }
+            else if ( index >= 0 )
+            {
+                len = Substitute( *substituted[i], value, NULL );
+                p = ARENA_Alloc( pArena, len + 1 );
+                if ( p != NULL )
+                {
+                    (void)Substitute( *substituted[i], value, p );
+                    *substituted[i] = p;
+                }
+                else
+                {
+                    result = ENOMEM;
+                }
+            }
+            else
+            {
+                *substituted[i] = ARENA_Strdup( pArena, *substituted[i] );
+                result = ( *substituted[i] != NULL ) ? EOK : ENOMEM;
+            }
+        }
+
+        for ( i = 0 ;
+              ( result == EOK ) &&
+              ( i < sizeof( copied ) / sizeof( copied[0] ) ) ;
+              i++ )
+        {
+            if ( *copied[i] != NULL )
+            {
+                *copied[i] = ARENA_Strdup( pArena, *copied[i] );
+                result = ( *copied[i] != NULL ) ? EOK : ENOMEM;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Substitute                                                                */
+/*!
+    Substitute the index of a replica group instance
+
+    The Substitute function replaces each {index} in a string with the
+    index of a replica group instance.
+
+    @param[in]
+        s
+            pointer to the string to substitute
+
+    @param[in]
+        value
+            pointer to the index of the instance
+
+    @param[out]
+        buf
+            pointer to a buffer to write the NUL terminated result to,
+            or NULL to only calculate its length
+
+    @retval length of the result, excluding its NUL terminator
+
+==============================================================================*/
+static size_t Substitute( const char *s, const char *value, char *buf )
+{
+    static const char token[] = "{index}";
+    size_t n = strlen( value );
+    size_t len = 0;
+
+    while ( *s != '\0' )
+    {
+        if ( strncmp( s, token, sizeof( token ) - 1 ) == 0 )
+        {
+            if ( buf != NULL )
+            {
+                memcpy( &buf[len], value, n );
+            }
+
+            len += n;
+            s += sizeof( token ) - 1;
+        }
+        else
+        {
+            if ( buf != NULL )
+            {
+                buf[len] = *s;
+            }
+
+            len++;
+            s++;
+        }
+    }
+
+    if ( buf != NULL )
+    {
+        buf[len] = '\0';
+    }
+
+    return len;
+}
+
+/*============================================================================*/
+/*  SetupResources                                                            */
+/*!
+    Read the resource attributes of a process
+
+    The SetupResources function reads the cgroup placement, resource
+    limit and scheduling attributes of a process from its configuration.
+    The CPU set of the process is allocated from the configuration arena.
+
+    @param[in]
+        pNode
+            pointer to the process configuration object
+
+    @param[in]
+        pProcess
+            pointer to the process to set up
+
+    @param[in]
+        pArena
+            pointer to the configuration arena
+
+    @retval EOK - the resource attributes were read
+    @retval EINVAL - invalid resource attributes
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int SetupResources( JNode *pNode, Process *pProcess, Arena *pArena )
+{
+    int result = EINVAL;
+    ProcessResources *pResources;
+    char *cpuset;
+    char *ioprio;
+
+    if ( ( pNode != NULL ) && ( pProcess != NULL ) )
+    {
+        result = EOK;
+        pResources = &pProcess->resources;
+
+        pResources->cgroup = JSON_GetStr( pNode, "cgroup" );
+        pResources->cpu_max = JSON_GetStr( pNode, "cpu_max" );
+        pResources->memory_max = JSON_GetStr( pNode, "memory_max" );
+        pResources->setNice = ( JSON_GetNum( pNode,
+                                             "nice",
+                                             &pResources->nice ) == EOK );
+
+        if ( ( pResources->cgroup == NULL ) &&
+             ( ( pResources->cpu_max != NULL ) ||
+               ( pResources->memory_max != NULL ) ) )
+        {
+            fprintf( stderr,
+                     "cpu_max and memory_max require a cgroup for %s\n",
+                     pProcess->id );
+            result = EINVAL;
+        }
+
+        cpuset = JSON_GetStr( pNode, "cpuset" );
+        if ( ( result == EOK ) && ( cpuset != NULL ) )
+        {
+            pResources->pCpuset = ARENA_Alloc( pArena, sizeof( cpu_set_t ) );
+            result = ( pResources->pCpuset != NULL )
+                     ? RESOURCES_ParseCpuset( cpuset, pResources->pCpuset )
+                     : ENOMEM;
+            if ( result == EINVAL )
+            {
+                fprintf( stderr, "Invalid cpuset for %s\n", pProcess->id );
+            }
+        }
+
+        ioprio = JSON_GetStr( pNode, "ioprio" );
+        if ( ( result == EOK ) && ( ioprio != NULL ) )
+        {
+            result = RESOURCES_ParseIoPriority( ioprio, &pResources->ioprio );
+            if ( result == EINVAL )
+            {
+                fprintf( stderr, "Invalid ioprio for %s\n", pProcess->id );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupDepends                                                              */
+/*!
+    Read the dependencies of a process
+
+    The SetupDepends function copies the ids of the processes a process
+    depends on from its configuration into the configuration arena.
+    They are resolved to the parent processes once all of the processes
+    have been set up.
+
+    @param[in]
+        pNode
+            pointer to the process configuration object
+
+    @param[in]
+        pProcess
+            pointer to the process to set up
+
+    @param[in]
+        pArena
+            pointer to the configuration arena
+
+    @retval EOK - the dependencies were read
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int SetupDepends( JNode *pNode, Process *pProcess, Arena *pArena )
+{
+    int result = EINVAL;
+    JNode *pDepends;
+    JNode *pName;
+    JVar *pVar;
+    size_t n = 0;
+    size_t i = 0;
+    size_t count = 0;
+
+    if ( ( pNode != NULL ) && ( pProcess != NULL ) )
+    {
+        result = EOK;
+
+        pDepends = JSON_Attribute( (JObject *)pNode, "depends" );
+        if ( ( pDepends != NULL ) && ( pDepends->type == JSON_ARRAY ) )
+        {
+            while ( JSON_Index( (JArray *)pDepends, (int)n ) != NULL )
+            {
+                n++;
+            }
+
+            pProcess->pDependIds = ARENA_Alloc( pArena,
+                                                ( n + 1 ) * sizeof( char * ) );
+            if ( pProcess->pDependIds == NULL )
+            {
+                result = ENOMEM;
+            }
+
+            for ( i = 0 ; ( result == EOK ) && ( i < n ) ; i++ )
+            {
+                /* only the string dependencies are process ids */
+                pName = JSON_Index( (JArray *)pDepends, (int)i );
+                pVar = (JVar *)pName;
+                if ( ( pName->type == JSON_VAR ) &&
+                     ( pVar->var.type == JVARTYPE_STR ) )
+                {
+                    pProcess->pDependIds[count] =
+                        ARENA_Strdup( pArena, pVar->var.val.str );
+                    if ( pProcess->pDependIds[count++] == NULL )
+                    {
+                        result = ENOMEM;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupEnvironment                                                          */
+/*!
+    Allocate the environment of a process
+
+    The SetupEnvironment function allocates the environment of a process
+    which is passed file descriptors from the configuration arena, so
+    the environment does not need to be allocated each time the process
+    is started.  It is sized for the environment of the process monitor
+    and the variables added by MakeEnvironment.
+
+    @param[in]
+        pProcess
+            pointer to the process to set up
+
+    @param[in]
+        pArena
+            pointer to the configuration arena
+
+    @retval EOK - the environment was allocated, or is not needed
+    @retval EINVAL - invalid arguments
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int SetupEnvironment( Process *pProcess, Arena *pArena )
+{
+    int result = EINVAL;
+
+    if ( pProcess != NULL )
+    {
+        result = EOK;
+
+        if ( ( pProcess->notify == true ) ||
+             ( pProcess->standby == true ) ||
+             ( pProcess->monitored == true ) ||
+             ( pProcess->listen != NULL ) )
+        {
+            pProcess->envp = ARENA_Alloc( pArena,
+                                          ( pProcmonState->envCount + 5 ) *
+                                          sizeof( char * ) +
+                                          PROCMON_ENV_VARS );
+            if ( pProcess->envp == NULL )
+            {
+                result = ENOMEM;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SetupStop                                                                 */
+/*!
+    Read the stop attributes of a process
+
+    The SetupStop function reads the signal used to stop a process, and
+    the time it is given to stop before it is killed, from its
+    configuration.  By default a process is sent SIGTERM and is killed
+    if it has not stopped after PROCMON_STOP_TIMEOUT seconds.
+
+    @param[in]
+        pNode
+            pointer to the process configuration object
+
+    @param[in]
+        pProcess
+            pointer to the process to set up
+
+    @retval EOK - the stop attributes were read
+    @retval EINVAL - invalid stop attributes
+
+==============================================================================*/
+static int SetupStop( JNode *pNode, Process *pProcess )
+{
+    int result = EINVAL;
+    char *signame;
+
+    if ( ( pNode != NULL ) && ( pProcess != NULL ) )
+    {
+        result = EOK;
+
+        pProcess->stopSignal = SIGTERM;
+        signame = JSON_GetStr( pNode, "stop_signal" );
+        if ( signame != NULL )
+        {
+            result = ParseSignal( signame, &pProcess->stopSignal );
+            if ( result != EOK )
+            {
+                fprintf( stderr, "Invalid stop_signal for %s\n", pProcess->id );
+            }
+        }
+
+        pProcess->stopTimeout = PROCMON_STOP_TIMEOUT;
+        (void)JSON_GetNum( pNode, "stop_timeout", &pProcess->stopTimeout );
+        if ( ( result == EOK ) && ( pProcess->stopTimeout < 0 ) )
+        {
+            fprintf( stderr, "Invalid stop_timeout for %s\n", pProcess->id );
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ParseSignal                                                               */
+/*!
+    Parse a signal name
+
+    The ParseSignal function converts a signal name, with or without
+    its SIG prefix ( eg SIGTERM or TERM ), or a signal number, into
+    a signal number.
+
+    @param[in]
+        name
+            pointer to the signal name
+
+    @param[out]
+        pSignal
+            pointer to the location to store the signal number
+
+    @retval EOK - the signal name was parsed
+    @retval EINVAL - invalid signal name
+
+==============================================================================*/
+static int ParseSignal( const char *name, int *pSignal )
+{
+    int result = EINVAL;
+    char *endptr;
+    long n;
+    size_t i;
+
+    if ( ( name != NULL ) && ( pSignal != NULL ) )
+    {
+        if ( strncmp( name, "SIG", 3 ) == 0 )
+        {
+            name += 3;
+        }
+
+        for ( i = 0 ;
+              i < sizeof( SignalNames ) / sizeof( SignalNames[0] ) ;
+              i++ )
+        {
+            if ( strcmp( name, SignalNames[i].name ) == 0 )
+            {
+                *pSignal = SignalNames[i].signal;
+                result = EOK;
+                break;
+            }
+        }
+
+        if ( result != EOK )
+        {
+            n = strtol( name, &endptr, 10 );
+            if ( ( *name != '\0' ) &&
+                 ( *endptr == '\0' ) &&
+                 ( n > 0 ) &&
+                 ( n < NSIG ) )
+            {
+                *pSignal = (int)n;
+                result = EOK;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddProcess                                                                */
+/*!
+    Add a process object to the process monitor
+
+    The AddProcess function adds a process which has been set up to the
+    process index and the process list.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state
+
+    @param[in]
+       pProcess
+            pointer to the process to add
+
+    @retval EOK - the process was added
+    @retval EEXIST - a process with the same id has already been added
+    @retval ENOMEM - memory allocation failure
+    @retval EINVAL - the process has no id
+
+==============================================================================*/
+static int AddProcess( ProcmonState *pProcmonState, Process *pProcess )
+{
+    int result;
+
+    /* add the process to the process index and process list */
+    result = IndexProcess( pProcmonState, pProcess );
+    if ( result == EOK )
+    {
+        result = AppendProcess( &pProcmonState->processes, pProcess );
+    }
+    else if ( result == EEXIST )
+    {
+        fprintf( stderr, "Duplicate process id %s\n", pProcess->id );
+    }
+    else if ( result == EINVAL )
+    {
+        fprintf( stderr, "Process has no id\n" );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FindProcess                                                               */
+/*!
+    Find a process object
+
+    The FindProcess function searches the process index
+    for a process which exactly matches the specified process
+    identifier.
+
+    @param[in]
+       id
+            pointer to the name of the process to search for
+
+    @param[in]
+       pProcmonState
+            pointer to the Process Monitor state object which contains the
+            process index to search in
+
+    @retval pointer to the found Process
+    @retval NULL - if the process object could not be found
+
+==============================================================================*/
+Process *FindProcess( char *id, ProcmonState *pProcmonState )
+{
+    Process *pProcess = NULL;
+    size_t mask;
+    size_t h;
+
+    if ( ( pProcmonState != NULL ) &&
+         ( pProcmonState->indexSize > 0 ) &&
+         ( id != NULL ) )
+    {
+        mask = pProcmonState->indexSize - 1;
+        h = HashId( id ) & mask;
+
+        /* the index is never full, so the search ends at an empty slot */
+        while ( ( pProcess = pProcmonState->pIndex[h] ) != NULL )
+        {
+            if ( strcmp( id, pProcess->id ) == 0 )
+            {
+                break;
+            }
+
+            h = ( h + 1 ) & mask;
+        }
+    }
+
+    return pProcess;
+}
+
+/*============================================================================*/
+/*  IsInstance                                                                */
+/*!
+    Check if a process is an instance of a replica group
+
+    The IsInstance function checks if a process identifier has the form
+    <group>.<index> of an instance of the specified replica group.
+
+    @param[in]
+        id
+            pointer to the process identifier
+
+    @param[in]
+        group
+            pointer to the replica group identifier
+
+    @retval true - the process is an instance of the group
+    @retval false - the process is not an instance of the group
+
+==============================================================================*/
+static bool IsInstance( const char *id, const char *group )
+{
+    bool result = false;
+    size_t len;
+
+    if ( ( id != NULL ) && ( group != NULL ) )
+    {
+        len = strlen( group );
+        if ( ( strncmp( id, group, len ) == 0 ) &&
+             ( id[len] == '.' ) &&
+             ( isdigit( (unsigned char)id[len + 1] ) ) )
+        {
+            id += len + 1;
+            while ( isdigit( (unsigned char)*id ) )
+            {
+                id++;
+            }
+
+            result = ( *id == '\0' );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  IndexProcess                                                              */
+/*!
+    Add a process object to the process index
+
+    The IndexProcess function adds the specified process to the hash
+    index of processes keyed by process identifier, which is used by
+    FindProcess.  The index is grown as needed so that it is never more
+    than half full.
+
+    @param[in]
+       pProcmonState
+            pointer to the Process Monitor state object which contains the
+            process index
+
+    @param[in]
+       pProcess
+            pointer to the process to add to the index
+
+    @retval EOK - the process was added to the index
+    @retval EEXIST - a process with the same identifier already exists
+    @retval ENOMEM - memory allocation failure
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int IndexProcess( ProcmonState *pProcmonState, Process *pProcess )
+{
+    int result = EINVAL;
+    Process **pIndex;
+    size_t size;
+    size_t mask;
+    size_t h;
+    size_t i;
+
+    if ( ( pProcmonState != NULL ) &&
+         ( pProcess != NULL ) &&
+         ( pProcess->id != NULL ) )
+    {
+        result = EOK;
+
+        if ( FindProcess( pProcess->id, pProcmonState ) != NULL )
+        {
+            result = EEXIST;
+        }
+        else if ( ( pProcmonState->processes.count + 1 ) * 2 >
+                  pProcmonState->indexSize )
+        {
+            /* grow the index and re-hash the existing processes */
+            size = ( pProcmonState->indexSize > 0 )
+                    ? pProcmonState->indexSize * 2
+                    : 64;
+
+            pIndex = calloc( size, sizeof( Process * ) );
+            if ( pIndex != NULL )
+            {
+                for ( i = 0 ; i < pProcmonState->indexSize ; i++ )
+                {
+                    if ( pProcmonState->pIndex[i] != NULL )
+                    {
+                        h = HashId( pProcmonState->pIndex[i]->id ) &
+                            ( size - 1 );
+                        while ( pIndex[h] != NULL )
+                        {
+                            h = ( h + 1 ) & ( size - 1 );
+                        }
+
+                        pIndex[h] = pProcmonState->pIndex[i];
+                    }
+                }
+
+                free( pProcmonState->pIndex );
+                pProcmonState->pIndex = pIndex;
+                pProcmonState->indexSize = size;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            mask = pProcmonState->indexSize - 1;
+            h = HashId( pProcess->id ) & mask;
+            while ( pProcmonState->pIndex[h] != NULL )
+            {
+                h = ( h + 1 ) & mask;
+            }
+
+            pProcmonState->pIndex[h] = pProcess;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HashId                                                                    */
+/*!
+    Calculate the hash of a process identifier
+
+    The HashId function calculates the FNV-1a hash of the specified
+    process identifier for use in the process index.
+
+    @param[in]
+       id
+            pointer to the process identifier
+
+    @retval hash of the process identifier
+
+==============================================================================*/
+static uint32_t HashId( const char *id )
+{
+    uint32_t h = 2166136261u;
+
+    while ( *id != '\0' )
+    {
+        h ^= (uint8_t)*id++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+/*============================================================================*/
+/*  AppendProcess                                                             */
+/*!
+    Append a process to a process list
+
+    The AppendProcess function adds a reference to the specified process
+    to the end of the specified process list.  The list storage is grown
+    in powers of 2, so appending a process is amortized constant time.
+
+    @param[in]
+       pList
+            pointer to the process list to append to
+
+    @param[in]
+       pProcess
+            pointer to the process to append
+
+    @retval EOK - the process was appended to the list
+    @retval ENOMEM - memory allocation failure
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int AppendProcess( ProcessList *pList, Process *pProcess )
+{
+    int result = EINVAL;
+    Process **pProcesses;
+    size_t n;
+
+    if ( ( pList != NULL ) && ( pProcess != NULL ) )
+    {
+        result = EOK;
+
+        n = pList->count;
+        if ( ( n & ( n - 1 ) ) == 0 )
+        {
+            /* the list is full when its length is zero or a power of 2 */
+            pProcesses = realloc( pList->pProcesses,
+                                  ( n > 0 ? n * 2 : 1 ) * sizeof( Process * ) );
+            if ( pProcesses != NULL )
+            {
+                pList->pProcesses = pProcesses;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            pList->pProcesses[pList->count++] = pProcess;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BuildDependencyLists                                                      */
+/*!
+    Build parent/child dependency lists for all processes
+
+    The BuildDependencyLists function iterates through the process list
+    and builds the relationships between parents and children based
+    on the dependencies read from the process configuration file.
+    The resulting dependency graph is then validated and analyzed
+    by AnalyzeDependencies.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state object which
+            contains the list of processes to analyze
+
+    @retval EOK - updated all process dependencies
+    @retval ENOMEM - memory allocation failure
+    @retval ENOENT - parent dependency not found
+    @retval ELOOP - the dependency graph contains a cycle
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int BuildDependencyLists( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    Process *pProcess;
+    size_t i;
+    int rc;
+
+    if ( pProcmonState != NULL )
+    {
+        result = EOK;
+
+        for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+        {
+            pProcess = pProcmonState->processes.pProcesses[i];
+            rc = AddParents( pProcmonState, pProcess );
+            if ( rc != EOK )
+            {
+                fprintf( stderr,
+                         "Failed to add parents for %s\n",
+                         pProcess->id );
+                result = rc;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            result = AnalyzeDependencies( pProcmonState );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AnalyzeDependencies                                                       */
+/*!
+    Validate and analyze the dependency graph
+
+    The AnalyzeDependencies function sorts the processes into dependency
+    order, so each process follows all of its parents.  If not all of the
+    processes can be sorted, the dependency graph contains a cycle and is
+    rejected, so a configuration with a cycle is never loaded.
+
+    The length of the longest chain of dependencies of each process and
+    the sums of the wait times along the longest chains of dependencies
+    and dependents of each process are calculated in the same pass.
+    The sorted list and the dependent lists of the processes are then
+    ordered so the processes on the longest chain of wait times are
+    started first, which is still a dependency order.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state object which
+            contains the list of processes to analyze
+
+    @retval EOK - the dependency graph was analyzed
+    @retval ENOMEM - memory allocation failure
+    @retval ELOOP - the dependency graph contains a cycle
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int AnalyzeDependencies( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    ProcessList *pOrder;
+    Process *pProcess;
+    Process *pChild;
+    size_t i;
+    size_t j;
+
+    if ( pProcmonState != NULL )
+    {
+        result = EOK;
+
+        pOrder = &pProcmonState->order;
+        free( pOrder->pProcesses );
+        memset( pOrder, 0, sizeof( ProcessList ) );
+        pProcmonState->graphDepth = 0;
+        pProcmonState->graphWait = 0;
+
+        /* start with the processes which have no dependencies */
+        for ( i = 0 ;
+              ( result == EOK ) && ( i < pProcmonState->processes.count ) ;
+              i++ )
+        {
+            pProcess = pProcmonState->processes.pProcesses[i];
+            pProcess->position = i;
+            pProcess->unsorted = pProcess->parents.count;
+            pProcess->depth = 0;
+            pProcess->startWait = 0;
+
+            if ( pProcess->unsorted == 0 )
+            {
+                result = AppendProcess( pOrder, pProcess );
+            }
+        }
+
+        /* a dependent is sorted once all of its parents are sorted */
+        for ( i = 0 ; ( result == EOK ) && ( i < pOrder->count ) ; i++ )
+        {
+            pProcess = pOrder->pProcesses[i];
+            pProcess->startWait += pProcess->wait;
+
+            for ( j = 0 ;
+                  ( result == EOK ) && ( j < pProcess->children.count ) ;
+                  j++ )
+            {
+                pChild = pProcess->children.pProcesses[j];
+                if ( pChild->depth <= pProcess->depth )
+                {
+                    pChild->depth = pProcess->depth + 1;
+                }
+
+                if ( pChild->startWait < pProcess->startWait )
+                {
+                    pChild->startWait = pProcess->startWait;
+                }
+
+                if ( --pChild->unsorted == 0 )
+                {
+                    result = AppendProcess( pOrder, pChild );
+                }
+            }
+        }
+
+        if ( ( result == EOK ) &&
+             ( pOrder->count < pProcmonState->processes.count ) )
+        {
+            /* the processes which could not be sorted are part of,
+             * or depend on, a dependency cycle */
+            DisplayCycle( pProcmonState );
+            result = ELOOP;
+        }
+
+        if ( result == EOK )
+        {
+            /* accumulate the wait times of the dependents in reverse
+             * dependency order */
+            for ( i = pOrder->count ; i > 0 ; i-- )
+            {
+                pProcess = pOrder->pProcesses[i - 1];
+                pProcess->criticalWait = 0;
+
+                for ( j = 0 ; j < pProcess->children.count ; j++ )
+                {
+                    pChild = pProcess->children.pProcesses[j];
+                    if ( pChild->criticalWait > pProcess->criticalWait )
+                    {
+                        pProcess->criticalWait = pChild->criticalWait;
+                    }
+                }
+
+                pProcess->criticalWait += pProcess->wait;
+
+                if ( pProcess->depth > pProcmonState->graphDepth )
+                {
+                    pProcmonState->graphDepth = pProcess->depth;
+                }
+
+                if ( pProcess->criticalWait > pProcmonState->graphWait )
+                {
+                    pProcmonState->graphWait = pProcess->criticalWait;
+                }
+            }
+
+            /* start the processes on the critical path first */
+            qsort( pOrder->pProcesses,
+                   pOrder->count,
+                   sizeof( Process * ),
+                   CompareCritical );
+
+            for ( i = 0 ; i < pOrder->count ; i++ )
+            {
+                pProcess = pOrder->pProcesses[i];
+                qsort( pProcess->children.pProcesses,
+                       pProcess->children.count,
+                       sizeof( Process * ),
+                       CompareCritical );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayCycle                                                              */
+/*!
+    Display a dependency cycle
+
+    The DisplayCycle function is invoked when not all of the processes
+    could be sorted into dependency order.  Each process which has not
+    been sorted has a parent which has not been sorted, so following the
+    unsorted parents from any unsorted process leads into a cycle within
+    as many steps as there are processes.  The cycle is then displayed
+    by following the same parents until it is closed.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state object which
+            contains the list of processes
+
+==============================================================================*/
+static void DisplayCycle( ProcmonState *pProcmonState )
+{
+    Process *pProcess = NULL;
+    Process *pStart;
+    size_t i;
+
+    for ( i = 0 ;
+          ( pProcess == NULL ) && ( i < pProcmonState->processes.count ) ;
+          i++ )
+    {
+        if ( pProcmonState->processes.pProcesses[i]->unsorted > 0 )
+        {
+            pProcess = pProcmonState->processes.pProcesses[i];
+        }
+    }
+
+    /* walk into the cycle */
+    for ( i = 0 ;
+          ( pProcess != NULL ) && ( i < pProcmonState->processes.count ) ;
+          i++ )
+    {
+        pProcess = UnsortedParent( pProcess );
+    }
+
+    if ( pProcess != NULL )
+    {
+        pStart = pProcess;
+        fprintf( stderr, "Dependency cycle: %s", pStart->id );
+
+        do
+        {
+            pProcess = UnsortedParent( pProcess );
+            if ( pProcess != NULL )
+            {
+                fprintf( stderr, " -> %s", pProcess->id );
+            }
+        } while ( ( pProcess != NULL ) && ( pProcess != pStart ) );
+
+        fprintf( stderr, "\n" );
+    }
+}
+
+/*============================================================================*/
+/*  UnsortedParent                                                            */
+/*!
+    Get the first parent of a process which has not been sorted
+
+    The UnsortedParent function is used by DisplayCycle to follow the
+    parents of the processes which could not be sorted into dependency
+    order.
+
+    @param[in]
+       pProcess
+            pointer to the process which has not been sorted
+
+    @retval pointer to the first parent which has not been sorted
+    @retval NULL - all of the parents have been sorted
+
+==============================================================================*/
+static Process *UnsortedParent( Process *pProcess )
+{
+    Process *pParent = NULL;
+    size_t i;
+
+    for ( i = 0 ;
+          ( pParent == NULL ) && ( i < pProcess->parents.count ) ;
+          i++ )
+    {
+        if ( pProcess->parents.pProcesses[i]->unsorted > 0 )
+        {
+            pParent = pProcess->parents.pProcesses[i];
+        }
+    }
+
+    return pParent;
+}
+
+/*============================================================================*/
+/*  CompareCritical                                                           */
+/*!
+    Compare the startup priority of two processes
+
+    The CompareCritical function is used to sort process lists so the
+    processes with the longest chain of wait times ahead of them are
+    started first.  Processes with equal wait times are ordered by the
+    length of their chain of dependencies, so a process always sorts
+    after its parents, and then in configuration file order.
+
+    @param[in]
+       p1
+            pointer to the first process reference
+
+    @param[in]
+       p2
+            pointer to the second process reference
+
+    @retval -1 - the first process is started first
+    @retval 1 - the second process is started first
+    @retval 0 - the processes are the same
+
+==============================================================================*/
+static int CompareCritical( const void *p1, const void *p2 )
+{
+    const Process *pProcess1 = *(Process * const *)p1;
+    const Process *pProcess2 = *(Process * const *)p2;
+    int result = 0;
+
+    if ( pProcess1->criticalWait != pProcess2->criticalWait )
+    {
+        result = ( pProcess1->criticalWait > pProcess2->criticalWait ) ? -1
+                                                                       : 1;
+    }
+    else if ( pProcess1->depth != pProcess2->depth )
+    {
+        result = ( pProcess1->depth < pProcess2->depth ) ? -1 : 1;
+    }
+    else if ( pProcess1->position != pProcess2->position )
+    {
+        result = ( pProcess1->position < pProcess2->position ) ? -1 : 1;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StartupOrder                                                              */
+/*!
+    Get the order in which processes are started
+
+    The StartupOrder function gets the list of processes in dependency
+    order if the dependency graph has been analyzed, or otherwise the
+    list of processes in configuration file order.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state object which
+            contains the list of processes
+
+    @retval pointer to the list of processes
+
+==============================================================================*/
+static ProcessList *StartupOrder( ProcmonState *pProcmonState )
+{
+    return ( pProcmonState->order.count == pProcmonState->processes.count )
+           ? &pProcmonState->order
+           : &pProcmonState->processes;
+}
+
+/*============================================================================*/
+/*  InheritResources                                                          */
+/*!
+    Inherit resource settings down the dependency graph
+
+    The InheritResources function fills in the resource settings which
+    have not been specified for a process from its first dependency,
+    and so on up the dependency graph, so the cgroup, limits and
+    scheduling attributes of a process apply to the whole subtree of
+    processes which depend on it.
+
+    The inherited settings are recalculated from each process' own
+    resource attributes, so the function can be called again after the
+    dependency graph has changed.  The processes are visited in
+    dependency order, so the settings of the first dependency of a
+    process have already been inherited from its own dependencies.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state object which
+            contains the list of processes
+
+==============================================================================*/
+static void InheritResources( ProcmonState *pProcmonState )
+{
+    ProcessList *pOrder;
+    Process *pProcess;
+    Process *pParent;
+    size_t i;
+    int fd;
+
+    if ( pProcmonState != NULL )
+    {
+        pOrder = StartupOrder( pProcmonState );
+
+        for ( i = 0 ; i < pOrder->count ; i++ )
+        {
+            pProcess = pOrder->pProcesses[i];
+
+            /* keep the open cgroup of the process */
+            fd = pProcess->resources.cgroupfd;
+            pProcess->resources = pProcess->ownResources;
+            pProcess->resources.cgroupfd = fd;
+
+            /* the settings are not inherited if the dependency graph
+             * could not be sorted */
+            if ( ( pOrder == &pProcmonState->order ) &&
+                 ( pProcess->parents.count > 0 ) )
+            {
+                pParent = pProcess->parents.pProcesses[0];
+                RESOURCES_Inherit( &pProcess->resources,
+                                   &pParent->resources );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  AddParents                                                                */
+/*!
+    Add parent dependencies for the specified process
+
+    The AddParents function iterates through the dependency ids of
+    the specified process, searches for the parent processes,
+    and adds references to the parent processes to the process parent
+    dependency list.  The dependencies of a process loaded from the
+    configuration cache have already been resolved to indices into
+    the process list.
+
+    @param[in]
+       pProcmonState
+            pointer to the process monitor state object which
+            contains the list of processes to analyze
+
+    @param[in]
+       pProcess
+            pointer to the process to add the parents of
+
+    @retval EOK - updated all process dependencies
+    @retval ENOMEM - memory allocation failure
+    @retval ENOENT - parent dependency not found
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int AddParents( ProcmonState *pProcmonState, Process *pProcess )
+{
+    size_t n;
+    int i = 0;
+    int result = EINVAL;
+    Process *p;
+    char *id;
+    int rc;
+
+    if ( ( pProcess != NULL ) && ( pProcess->pDependsIndex != NULL ) )
+    {
+        result = EOK;
+
+        /* the dependencies from the configuration cache are indices
+         * into the process list */
+        for ( i = 0 ;
+              ( result == EOK ) && ( (size_t)i < pProcess->ndepends ) ;
+              i++ )
+        {
+            n = pProcess->pDependsIndex[i];
+            if ( n < pProcmonState->processes.count )
+            {
+                p = pProcmonState->processes.pProcesses[n];
+                result = AddParent( pProcess, p );
+            }
+            else
+            {
+                result = ENOENT;
+            }
+        }
+    }
+    else if ( pProcess != NULL )
+    {
+        result = EOK;
+
+        /* iterate through the dependency ids */
+        while ( ( pProcess->pDependIds != NULL ) &&
+                ( ( id = pProcess->pDependIds[i++] ) != NULL ) )
+        {
+            p = FindProcess( id, pProcmonState );
+            if ( p != NULL )
+            {
+                rc = AddParent( pProcess, p );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+            else if ( AddGroupParents( pProcmonState,
+                                       pProcess,
+                                       id,
+                                       &rc ) > 0 )
+            {
+                /* the dependency is on all of the instances
+                 * of a replica group */
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+            else
+            {
+                fprintf( stderr,
+                         "Cannot find parent %s for process %s\n",
+                         id,
+                         pProcess->id );
+                result = ENOENT;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddGroupParents                                                           */
+/*!
+    Add the instances of a replica group as parents of a process
+
+    The AddGroupParents function makes each instance of a replica group
+    a parent of the specified process, so a process which depends on a
+    group waits for all of its instances.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @param[in]
+        pProcess
+            pointer to the dependent process
+
+    @param[in]
+        group
+            pointer to the replica group identifier
+
+    @param[out]
+        pResult
+            pointer to a location to store EOK, or the error from
+            AddParent if any of the instances could not be added
+
+    @retval number of instances of the replica group
+
+==============================================================================*/
+static size_t AddGroupParents( ProcmonState *pProcmonState,
+                               Process *pProcess,
+                               const char *group,
+                               int *pResult )
+{
+    size_t count = 0;
+    size_t i;
+    Process *p;
+    int rc;
+
+    *pResult = EOK;
+
+    for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+    {
+        p = pProcmonState->processes.pProcesses[i];
+        if ( IsInstance( p->id, group ) )
+        {
+            rc = AddParent( pProcess, p );
+            if ( rc != EOK )
+            {
+                *pResult = rc;
+            }
+
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  AddChild                                                                  */
+/*!
+    Add child dependencies for the specified process
+
+    The AddChild function adds the parent/child relationship for the
+    specified parent and child processes.  It adds the child process
+    to the parent's child dependency list
+
+    @param[in]
+        pParent
             pointer to the parent process containing the child list to update
 
     @param[in]
-        pChild
-            pointer to the child process to add to the parent's child list.
+        pChild
+            pointer to the child process to add to the parent's child list.
+
+    @retval EOK - parent/child relationship successfully updated
+    @retval ENOMEM - memory allocation failure
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int AddChild( Process *pParent, Process *pChild )
+{
+    int result = EINVAL;
+
+    if ( ( pParent != NULL ) && ( pChild != NULL ) )
+    {
+        if ( pParent != pChild )
+        {
+            result = AppendProcess( &pParent->children, pChild );
+        }
+        else
+        {
+            fprintf( stderr,
+                     "Process  %s cannot be a child of itself\n",
+                     pParent->id );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddParent                                                                 */
+/*!
+    Add parent dependencies for the specified child process
+
+    The AddParent function adds the parent/child relationship for the
+    specified parent and child processes.  It adds the parent process
+    to the child's parent dependency list
+
+    @param[in]
+        pChild
+            pointer to the child process containing the parent list to update
+
+    @param[in]
+        pParent
+            pointer to the parent process to add to the child's parent list.
+
+    @retval EOK - parent/child relationship successfully updated
+    @retval ENOMEM - memory allocation failure
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int AddParent( Process *pChild, Process *pParent )
+{
+    int result = EINVAL;
+
+    if ( ( pParent != NULL ) && ( pChild != NULL ) )
+    {
+        if ( pParent != pChild )
+        {
+            result = AppendProcess( &pChild->parents, pParent );
+            if ( result == EOK )
+            {
+                result = AddChild( pParent, pChild );
+            }
+        }
+        else
+        {
+            fprintf( stderr,
+                     "Process  %s cannot be a parent of itself\n",
+                     pParent->id );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayConfig                                                             */
+/*!
+    Display the Process configuration managed by the process monitor
+
+    The DisplayConfig function displays the state of each process
+    monitored by the process monitor
+
+    The configuration will not be displayed unless the process monitor's
+    verbose flag has been set via the command line arguments
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state object containing the
+            process configuration to display
+
+    @retval EOK - configuration displayed successfully
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int DisplayConfig( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    Process *pProcess;
+    size_t i;
+    int rc;
+
+    if ( pProcmonState != NULL )
+    {
+        result = EOK;
+
+        if ( pProcmonState->verbose == true )
+        {
+            for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+            {
+                pProcess = pProcmonState->processes.pProcesses[i];
+                rc = DisplayProcess( pProcess );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            printf( "Dependency graph: %zu processes, depth %zu, "
+                    "critical path wait %d s\n\n",
+                    pProcmonState->processes.count,
+                    pProcmonState->graphDepth,
+                    pProcmonState->graphWait );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayProcess                                                            */
+/*!
+    Display the Process configuration for the specified process
+
+    The DisplayProcess function displays the state of the specified process
+    including:
+
+    - process id
+    - process execution statement
+    - wait time
+    - list of dependencies
+    - current operating state
+
+    @param[in]
+        pProcess
+            pointer to the process to display
+
+    @retval EOK - process status displayed successfully
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int DisplayProcess( Process *pProcess )
+{
+    int result = EINVAL;
+
+    if ( pProcess != NULL )
+    {
+        printf("process: %s\n", pProcess->id );
+
+        DisplayState( pProcess );
+
+        printf("\texec: %s\n", pProcess->exec );
+
+        if ( pProcess->wait > 0 )
+        {
+            printf("\twait: %d\n", pProcess->wait );
+        }
+
+        printf( "\tmonitored: %s\n",
+                ( pProcess->monitored == true ) ? "yes" : "no" );
+
+        if ( pProcess->listen != NULL )
+        {
+            printf("\tlisten: %s\n", pProcess->listen );
+        }
+
+        if ( pProcess->healthCheck != NULL )
+        {
+            printf("\thealth_check: %s\n", pProcess->healthCheck );
+        }
+
+        printf("\tDepends on: [");
+        DisplayProcessIds( &pProcess->parents );
+        printf("]\n");
+
+        printf("\tDependency of: [");
+        DisplayProcessIds( &pProcess->children );
+        printf("]\n");
+
+        printf( "\tdepth: %zu, start wait: %d, critical wait: %d\n",
+                pProcess->depth,
+                pProcess->startWait,
+                pProcess->criticalWait );
+
+        printf("\n");
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayState                                                              */
+/*!
+    Display the operating state of the specified process
+
+    The DisplayState function displays the operating state of
+    the specified process.  This can be one of:
+
+    - UNKNOWN
+    - INIT
+    - STARTED
+    - RUNNING
+    - TERMINATED
+    - WAITING
+
+    @param[in]
+        pProcess
+            pointer to the process to display the operating state for
+
+    @retval EOK - process operating state displayed successfully
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int DisplayState( Process *pProcess )
+{
+    int result = EINVAL;
+
+    if ( pProcess != NULL )
+    {
+        if( pProcess->state > ( sizeof( ProcessStates )/sizeof (char *)) )
+        {
+            printf("\tstate: UNKNOWN");
+        }
+        else
+        {
+            printf("\tstate: %s\n", ProcessStates[pProcess->state]);
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayProcessIds                                                         */
+/*!
+    Display the identifiers of the processes in the process list
+
+    The DisplayProcessIds function displays the names of processes
+    in the specified process list.
+
+    @param[in]
+        pList
+            pointer to a process list containing a list of processes
+            to display the names for.
+
+==============================================================================*/
+static void DisplayProcessIds( ProcessList *pList )
+{
+    size_t i;
+
+    for ( i = 0 ; i < pList->count ; i++ )
+    {
+        if ( i > 0 )
+        {
+            printf(",");
+        }
+
+        (void)DisplayProcessId( pList->pProcesses[i] );
+    }
+}
+
+/*============================================================================*/
+/*  DisplayProcessId                                                          */
+/*!
+    Display the process identifier for the specified process
+
+    The DisplayProcessId function displays the process identifier for
+    the specified process.
+
+    @param[in]
+        pProcess
+            pointer to the process to display the process identifier for
+
+    @retval EOK - process identifier displayed successfully
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int DisplayProcessId( Process *pProcess )
+{
+    int result = EINVAL;
+
+    if ( ( pProcess != NULL ) && ( pProcess->id != NULL ) )
+    {
+        printf("%s", pProcess->id );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunProcesses                                                              */
+/*!
+    Run all processes managed by the process monitor
+
+    The RunProcesses function schedules the startup of all the processes
+    managed by the process monitor based on the dependency graph built
+    by BuildDependencyLists.  A process is started as soon as all of its
+    parents are ready, so independent branches of the dependency graph
+    are started concurrently and each process's wait time only delays
+    its own dependents.
+
+    The startup proceeds from the event loop.  Once all processes have
+    been started, the duration of the startup critical path (the longest
+    chain of dependent wait times) is reported by StartupComplete.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor to run the processes for
+
+    @retval EOK - the process startup was scheduled
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int RunProcesses( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    ProcessList *pOrder;
+    Process *pProcess;
+    size_t i;
+
+    if ( pProcmonState != NULL )
+    {
+        result = EOK;
+
+        pProcmonState->startupBegin = EVENTLOOP_GetTime();
+        pProcmonState->traceStartup = TRACE_Begin();
+        pProcmonState->startupPending = 0;
+        pProcmonState->pStartupLast = NULL;
+
+        /* count the number of parents each process is waiting for */
+        for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+        {
+            pProcess = pProcmonState->processes.pProcesses[i];
+            pProcess->pending = pProcess->parents.count;
+            pProcess->pGate = NULL;
+        }
+
+        /* start all the processes which have no dependencies,
+         * starting with the processes on the critical path */
+        pOrder = StartupOrder( pProcmonState );
+        for ( i = 0 ; i < pOrder->count ; i++ )
+        {
+            pProcess = pOrder->pProcesses[i];
+            if ( pProcess->pending == 0 )
+            {
+                Run( pProcess, pProcmonState->startupBegin );
+            }
+        }
+
+        if ( pProcmonState->startupPending == 0 )
+        {
+            /* nothing could be started */
+            result = StartupComplete( pProcmonState );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Run                                                                       */
+/*!
+    Start running a process
+
+    The Run function initiates a process and schedules the time at
+    which it will be considered ready.  The process is set to
+    PROCSTATE_eRUNNING by ProcessReady once its wait time has elapsed,
+    or once it notifies its readiness if it uses the readiness protocol.
+
+    @param[in]
+        pProcess
+            pointer to the process to start
+
+    @param[in]
+        now
+            current monotonic time in milliseconds
+
+    @retval EOK - this process was started
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int Run( Process *pProcess, int64_t now )
+{
+    int result = EINVAL;
+    int wait = 0;
+    bool required = false;
+
+    if ( pProcess != NULL )
+    {
+        result = EOK;
+
+        pProcess->readyTime = now;
+        pProcess->traceReady = TRACE_Begin();
+        pProcmonState->startupPending++;
+
+        if( pProcess->skip == false )
+        {
+            required = StartupWaitRequired( pProcess );
+
+            InitProcess( pProcess );
+
+            if ( required == true )
+            {
+                wait = pProcess->wait;
+                pProcess->state = PROCSTATE_eWAITING;
+            }
+        }
+
+        if ( ( required == true ) && ( UsesReadiness( pProcess ) ) )
+        {
+            /* ProcessReady will be invoked when the process notifies
+             * its readiness or its readiness timeout expires */
+        }
+        else
+        {
+            result = EVENTLOOP_StartTimer( &pProcess->readyTimer,
+                                           wait * 1000,
+                                           ProcessReady,
+                                           pProcess );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ProcessReady                                                              */
+/*!
+    Handle the readiness of a process
+
+    The ProcessReady function is invoked when a process has completed
+    its startup wait, or has notified its readiness.
+
+    During startup, the dependents of the process are started via
+    StartupReady.  After startup, it restarts the dependents of
+    a restarted process which uses the readiness protocol.
+
+    @param[in]
+        arg
+            pointer to the process which is ready
+
+==============================================================================*/
+static void ProcessReady( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+
+    if ( pProcess != NULL )
+    {
+        EVENTLOOP_StopTimer( &pProcess->readyTimer );
+        pProcess->awaitingReady = false;
+
+        TRACE_Async( "ready", pProcess->id, pProcess->traceReady );
+        pProcess->traceReady = 0;
+
+        if ( pProcess->started == true )
+        {
+            /* the process was restarted */
+            if ( pProcess->monitored == true )
+            {
+                RestartDependents( pProcess );
+            }
+        }
+        else
+        {
+            StartupReady( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  StartupReady                                                              */
+/*!
+    Handle the readiness of a process during startup
+
+    The StartupReady function sets the process state to PROCSTATE_eRUNNING
+    and starts any of its dependents which are no longer waiting for
+    other parents.  Once no more processes are waiting to become ready,
+    the startup is completed.
+
+    @param[in]
+        pProcess
+            pointer to the process which is ready
+
+==============================================================================*/
+static void StartupReady( Process *pProcess )
+{
+    Process *pChild;
+    int64_t now;
+    size_t i;
+
+    if ( pProcess != NULL )
+    {
+        now = EVENTLOOP_GetTime();
+
+        pProcess->started = true;
+        pProcess->readyTime = now;
+        pProcess->state = PROCSTATE_eRUNNING;
+
+        if ( ( pProcmonState->pStartupLast == NULL ) ||
+             ( pProcess->readyTime > pProcmonState->pStartupLast->readyTime ) )
+        {
+            pProcmonState->pStartupLast = pProcess;
+        }
+
+        /* start any dependents which are no longer waiting */
+        for ( i = 0 ; i < pProcess->children.count ; i++ )
+        {
+            pChild = pProcess->children.pProcesses[i];
+            if ( --pChild->pending == 0 )
+            {
+                pChild->pGate = pProcess;
+                Run( pChild, now );
+            }
+        }
+
+        if ( --pProcmonState->startupPending == 0 )
+        {
+            StartupComplete( pProcmonState );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  StartupComplete                                                           */
+/*!
+    Complete the process startup
+
+    The StartupComplete function is invoked once no more processes are
+    waiting to become ready.  It reports any processes which could not
+    be started because they are part of a dependency cycle, and reports
+    the startup critical path.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @retval EOK - all processes were started
+    @retval ELOOP - some processes could not be started due to a
+                    dependency cycle
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int StartupComplete( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    Process *pProcess;
+    Process *pLast;
+    size_t i;
+
+    if ( pProcmonState != NULL )
+    {
+        result = EOK;
+
+        /* any process still pending is part of a dependency cycle */
+        for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+        {
+            pProcess = pProcmonState->processes.pProcesses[i];
+            if ( pProcess->pending > 0 )
+            {
+                fprintf( stderr,
+                         "Cannot start %s: dependency cycle detected\n",
+                         pProcess->id );
+                result = ELOOP;
+            }
+        }
+
+        pLast = pProcmonState->pStartupLast;
+        if ( pLast != NULL )
+        {
+            pProcmonState->startupTime = pLast->readyTime -
+                                         pProcmonState->startupBegin;
+
+            syslog( LOG_INFO,
+                    "procmon startup completed in %" PRId64 " ms",
+                    pProcmonState->startupTime );
+
+            if ( pProcmonState->verbose == true )
+            {
+                printf( "Startup completed in %" PRId64 " ms\n",
+                        pProcmonState->startupTime );
+                printf( "Critical path: " );
+                DisplayCriticalPath( pLast );
+                printf( "\n" );
+            }
+        }
+
+        /* write the startup trace */
+        TRACE_Async( "startup", "procmon", pProcmonState->traceStartup );
+        pProcmonState->traceStartup = 0;
+        (void)TRACE_Write();
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  DisplayCriticalPath                                                       */
+/*!
+    Display the startup critical path
+
+    The DisplayCriticalPath function displays the chain of processes
+    which gated the startup of the specified process, starting from
+    the root of the dependency graph.
+
+    @param[in]
+        pProcess
+            pointer to the last process on the critical path
+
+==============================================================================*/
+static void DisplayCriticalPath( Process *pProcess )
+{
+    if ( pProcess != NULL )
+    {
+        if ( pProcess->pGate != NULL )
+        {
+            DisplayCriticalPath( pProcess->pGate );
+            printf(" -> ");
+        }
+
+        printf( "%s", pProcess->id );
+    }
+}
+
+/*============================================================================*/
+/*  StartupWaitRequired                                                       */
+/*!
+    Check if the process startup must be waited for
+
+    The StartupWaitRequired function checks if the process monitor must
+    wait for the process to start up before its dependents can be started.
+    The process must be waited for under the following conditions:
+
+    - it is not already a monitored running process
+    - it is an unmonitored process which has an execution count less than
+      the smallest runcount of its parent(s)
+
+    The wait lasts for the process wait time, or until the process
+    notifies its readiness if it uses the readiness protocol.
+
+    @param[in]
+        pProcess
+            pointer to the process to wait for
+
+    @retval true - the process startup must be waited for
+    @retval false - the process dependents can be started immediately
+
+==============================================================================*/
+static bool StartupWaitRequired( Process *pProcess )
+{
+    bool required = false;
+    pid_t pid;
+
+    if ( ( pProcess != NULL ) && ( UsesActivation( pProcess ) == false ) )
+    {
+        if ( ( pProcess->wait > 0 ) || ( UsesReadiness( pProcess ) ) )
+        {
+            pid = get_pid_from_state( pProcess->id );
+            if ( pid == 0 )
+            {
+                if ( ( pProcess->monitored == true ) ||
+                     ( pProcess->runcount < GetParentRuncount( pProcess ) ) )
+                {
+                    required = true;
+                }
+            }
+        }
+    }
+
+    return required;
+}
+
+/*============================================================================*/
+/*  InitProcess                                                               */
+/*!
+    Initialize a process monitoring instance and start running the process
+
+    The InitProcess function hands the process to the supervisor which
+    starts the process running and makes sure it remains running.
+    If the supervisor is not available, a dedicated process monitoring
+    thread is created instead.
+
+    @param[in]
+        pProcess
+            pointer to the process to start
+
+    @retval EOK - the process is being supervised
+    @retval EINVAL - invalid arguments
+    @retval other - error from pthread_create
+
+==============================================================================*/
+static int InitProcess( Process *pProcess )
+{
+    int result = EINVAL;
+
+    if ( pProcess != NULL )
+    {
+        if ( pProcmonState->supervisor == false )
+        {
+            result = InitMonitorThread( pProcess );
+        }
+        else
+        {
+            result = EOK;
+
+            pProcess->state = PROCSTATE_eSTARTED;
+
+            if ( ( pProcess->monitored == false ) &&
+                 ( pProcess->runcount >= GetParentRuncount( pProcess ) ) )
+            {
+                /* unmonitored process does not need to be run again */
+            }
+            else if ( pProcess->supervised == false )
+            {
+                if ( pProcess->verbose == true )
+                {
+                    printf("Supervising process %s\n", pProcess->id );
+                }
+
+                pProcess->supervised = true;
+                SuperviseProcess( pProcess );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitMonitorThread                                                         */
+/*!
+    Initialize a process monitoring thread and start running the process
+
+    The InitMonitorThread function initiates a process monitoring thread
+    to make sure the process remains running, and starts the process
+    running.
+
+    @param[in]
+        pProcess
+            pointer to the process to start
+
+    @retval EOK - the monitoring thread was successfully created and is running
+    @retval EINVAL - invalid arguments
+    @retval other - error from pthread_create
+
+==============================================================================*/
+static int InitMonitorThread( Process *pProcess )
+{
+    int result = EINVAL;
+
+    if ( pProcess != NULL )
+    {
+        if ( pProcess->verbose == true )
+        {
+            printf("Creating thread for process %s\n", pProcess->id );
+        }
+
+        result = pthread_create( &pProcess->thread,
+                                 NULL,
+                                 &MonitorThread,
+                                 pProcess );
+
+        if ( result == EOK )
+        {
+            pProcess->state = PROCSTATE_eSTARTED;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ParseCommand                                                              */
+/*!
+    Split a command line into its arguments
+
+    The ParseCommand function decomposes a command line into the command
+    and its arguments using shell style quoting, and creates an argument
+    vector suitable for execvp.
+
+    Arguments are separated by white space.  Characters enclosed in single
+    quotes are taken literally.  Within double quotes, a backslash escapes
+    a double quote or a backslash.  Outside of quotes, a backslash escapes
+    the following character.  No other shell expansion is performed.
+
+    The argument vector and the argument strings are allocated as
+    a single block from the configuration arena.
+
+    @param[in]
+        command
+            pointer to the command line to split
+
+    @param[in]
+        pArena
+            pointer to the configuration arena
+
+    @param[out]
+        pArgv
+            pointer to a location to store the argument vector
+
+    @retval EOK - the command line was split
+    @retval EINVAL - the command line is empty or has an unterminated quote
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int ParseCommand( char *command, Arena *pArena, char ***pArgv )
+{
+    int result = EINVAL;
+    char **argv;
+    char *in;
+    char *out;
+    char quote = '\0';
+    char c;
+    size_t len;
+    size_t n = 0;
+
+    if ( ( command != NULL ) && ( pArgv != NULL ) )
+    {
+        /* each argument uses at least one character of the command line,
+         * and the arguments are never longer than the command line */
+        len = strlen( command );
+        argv = ARENA_Alloc( pArena, ( len + 2 ) * sizeof( char * ) + len + 1 );
+        if ( argv != NULL )
+        {
+            result = EOK;
+            in = command;
+            out = (char *)&argv[len + 2];
+
+            while ( *in != '\0' )
+            {
+                /* skip the white space between arguments */
+                while ( ( *in == ' ' ) || ( *in == '\t' ) || ( *in == '\n' ) )
+                {
+                    in++;
+                }
+
+                if ( *in == '\0' )
+                {
+                    break;
+                }
+
+                argv[n++] = out;
+
+                while ( ( *in != '\0' ) &&
+                        ( ( quote != '\0' ) ||
+                          ( ( *in != ' ' ) && ( *in != '\t' ) &&
+                            ( *in != '\n' ) ) ) )
+                {
+                    c = *in++;
+
+                    if ( quote == '\'' )
+                    {
+                        if ( c == '\'' )
+                        {
+                            quote = '\0';
+                        }
+                        else
+                        {
+                            *out++ = c;
+                        }
+                    }
+                    else if ( c == '\\' )
+                    {
+                        if ( ( quote == '"' ) &&
+                             ( *in != '"' ) &&
+                             ( *in != '\\' ) )
+                        {
+                            *out++ = c;
+                        }
+                        else if ( *in != '\0' )
+                        {
+                            *out++ = *in++;
+                        }
+                    }
+                    else if ( quote == '"' )
+                    {
+                        if ( c == '"' )
+                        {
+                            quote = '\0';
+                        }
+                        else
+                        {
+                            *out++ = c;
+                        }
+                    }
+                    else if ( ( c == '\'' ) || ( c == '"' ) )
+                    {
+                        quote = c;
+                    }
+                    else
+                    {
+                        *out++ = c;
+                    }
+                }
+
+                *out++ = '\0';
+            }
+
+            argv[n] = NULL;
+
+            if ( ( quote != '\0' ) || ( n == 0 ) )
+            {
+                result = EINVAL;
+            }
+            else
+            {
+                *pArgv = argv;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LaunchProcess                                                             */
+/*!
+    Launch a process
+
+    The LaunchProcess function starts the process specified in the "exec"
+    attribute of the process object, using its pre-parsed argument vector.
+
+    Rather than forking the process monitor, the child is created with
+    clone( CLONE_VM | CLONE_VFORK ) in the same way as posix_spawn, so
+    the memory of the process monitor is not copied, and the caller is
+    suspended until the child has executed the process.  Unlike
+    posix_spawn, the child detaches from the process monitor session,
+    inherits the lock handle of a monitored process, and moves itself
+    into the cgroup of the process before executing it, so the process
+    death can be detected as soon as this function returns.  The process
+    monitor takes the process lock through the lock handle before the
+    child is created.
+
+    The state of a monitored process must have been prepared before
+    the process is launched.
+
+    @param[in]
+        pProcess
+            pointer to the process to launch
+
+    @param[in]
+        readyfd
+            readiness pipe to pass to the process, or -1
+
+    @param[in]
+        logfd
+            log pipe to pass to the process as its stdout and stderr,
+            or -1 for the process to inherit them from the process monitor
+
+    @param[in]
+        standbyfd
+            barrier socket to pass to a standby of the process, or -1 to
+            launch the process itself.  A standby is passed the lock
+            handle of the standby, through which the process monitor
+            takes the process lock when it promotes the standby.  A
+            monitored process is passed a lock handle through which the
+            process monitor has already taken its process lock
+
+    @param[out]
+        pPid
+            pointer to a location to store the process identifier
+            of the launched process
+
+    @retval EOK - the process was launched
+    @retval EINVAL - invalid arguments
+    @retval other - error from mmap or clone
+
+==============================================================================*/
+static int LaunchProcess( Process *pProcess,
+                          int readyfd,
+                          int logfd,
+                          int standbyfd,
+                          pid_t *pPid )
+{
+    int result = EINVAL;
+    int rc;
+    Launch launch;
+    sigset_t sigmask;
+    sigset_t savedmask;
+    char *stack = MAP_FAILED;
+    int64_t start;
+    pid_t pid;
+
+    if ( ( pProcess != NULL ) &&
+         ( pProcess->argv != NULL ) &&
+         ( pPid != NULL ) )
+    {
+        start = TRACE_Begin();
+
+        memset( &launch, 0, sizeof( launch ) );
+        launch.trace = ( start != 0 );
+        launch.pProcess = pProcess;
+        launch.readyfd = readyfd;
+        launch.logfd = logfd;
+        launch.standbyfd = standbyfd;
+        launch.lockfd = -1;
+        launch.envp = environ;
+
+        if ( standbyfd != -1 )
+        {
+            launch.lockfd = pProcess->spare.lockfd;
+        }
+        else if ( pProcess->monitored == true )
+        {
+            /* the process lock is held from the moment the process
+             * starts, through a lock handle which the process inherits */
+            launch.lockfd = OpenProcessLock( pProcess );
+            launch.lockfailed = ( launch.lockfd == -1 );
+        }
+
+        /* create the cgroup of the process the first time it is used */
+        rc = RESOURCES_Prepare( &pProcess->resources );
+        if ( rc != EOK )
+        {
+            fprintf( stderr,
+                     "Failed to set up cgroup %s for %s: %s\n",
+                     pProcess->resources.cgroup,
+                     pProcess->id,
+                     strerror( rc ) );
+        }
+
+        if ( ( readyfd != -1 ) ||
+             ( standbyfd != -1 ) ||
+             ( launch.lockfd != -1 ) ||
+             ( pProcess->listener.count > 0 ) )
+        {
+            result = ( pProcess->envp != NULL )
+                     ? MakeEnvironment( readyfd,
+                                        &pProcess->listener,
+                                        standbyfd,
+                                        launch.lockfd,
+                                        pProcess->envp )
+                     : ENOMEM;
+            if ( result == EOK )
+            {
+                launch.envp = pProcess->envp;
+            }
+        }
+        else
+        {
+            result = EOK;
+        }
+
+        if ( pProcmonState->launchStack != NULL )
+        {
+            /* launches are serialized, so the stack is shared */
+            stack = pProcmonState->launchStack;
+        }
+        else if ( result == EOK )
+        {
+            stack = mmap( NULL,
+                          PROCMON_LAUNCH_STACK,
+                          PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                          -1,
+                          0 );
+            if ( stack == MAP_FAILED )
+            {
+                result = errno;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            if ( pProcess->verbose == true )
+            {
+                printf( "running %s\n", pProcess->exec );
+            }
+
+            /* no signal handlers may run in the child while it is
+             * sharing our memory */
+            sigfillset( &sigmask );
+            pthread_sigmask( SIG_SETMASK, &sigmask, &launch.sigmask );
+            savedmask = launch.sigmask;
+
+            /* the reload signal is only blocked in the process monitor */
+            sigdelset( &launch.sigmask, SIGHUP );
+
+            pid = clone( LaunchChild,
+                         stack + PROCMON_LAUNCH_STACK,
+                         CLONE_VM | CLONE_VFORK | SIGCHLD,
+                         &launch );
+            if ( pid == -1 )
+            {
+                result = errno;
+            }
+            else
+            {
+                *pPid = pid;
+            }
+
+            pthread_sigmask( SIG_SETMASK, &savedmask, NULL );
+            if ( stack != pProcmonState->launchStack )
+            {
+                munmap( stack, PROCMON_LAUNCH_STACK );
+            }
+
+            if ( launch.execTime != 0 )
+            {
+                /* break down the launch using the child timings */
+                TRACE_Span( "fork", pProcess->id, start, launch.childTime );
+                TRACE_Span( "setup",
+                            pProcess->id,
+                            launch.childTime,
+                            launch.execTime );
+                TRACE_End( "exec", pProcess->id, launch.execTime );
+            }
+        }
+
+        TRACE_End( "launch", pProcess->id, start );
+
+        if ( ( standbyfd == -1 ) && ( launch.lockfd != -1 ) )
+        {
+            /* only the process holds its lock handle */
+            close( launch.lockfd );
+        }
+
+        if ( launch.lockfailed == true )
+        {
+            fprintf( stderr, "Failed to make lock for %s\n", pProcess->id );
+        }
+
+        if ( launch.resourceError != EOK )
+        {
+            fprintf( stderr,
+                     "Failed to apply resource limits for %s: %s\n",
+                     pProcess->id,
+                     strerror( launch.resourceError ) );
+        }
+
+        if ( launch.error != EOK )
+        {
+            /* the child has exited, so the process exit is handled
+             * in the same way as if the process died */
+            fprintf( stderr,
+                     "Failed to execute: %s\nProcess failed with error %s\n",
+                     pProcess->exec,
+                     strerror( launch.error ) );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LaunchChild                                                               */
+/*!
+    Execute a launched process
+
+    The LaunchChild function runs in the child created by LaunchProcess.
+    It detaches the child from the process monitor session, passes it the
+    readiness pipe, the log pipe, the listening sockets and the lock
+    handle, records the pid of a monitored process ( or passes the
+    barrier socket to a standby ), applies its cgroup placement and
+    scheduling attributes, and executes the process.
+
+    The child shares the memory of the process monitor until the process
+    is executed, so only system calls may be used here: no memory
+    allocation, stdio or locking.
+
+    @param[in]
+        arg
+            pointer to the Launch object
+
+    @retval 127 - the process could not be executed
+
+==============================================================================*/
+static int LaunchChild( void *arg )
+{
+    Launch *pLaunch = (Launch *)arg;
+    Process *pProcess = pLaunch->pProcess;
+    StateRecord *pRecord = pProcess->pRecord;
+    size_t i;
+
+    if ( pLaunch->trace == true )
+    {
+        pLaunch->childTime = TRACE_Now();
+    }
+
+    /* detach from parent */
+    (void)setsid();
+
+    if ( pLaunch->readyfd != -1 )
+    {
+        /* pass the readiness pipe to the process */
+        fcntl( pLaunch->readyfd, F_SETFD, 0 );
+    }
+
+    for ( i = 0 ; i < pProcess->listener.count ; i++ )
+    {
+        /* pass the listening sockets to the process */
+        fcntl( pProcess->listener.sources[i].fd, F_SETFD, 0 );
+    }
+
+    if ( pLaunch->logfd != -1 )
+    {
+        /* capture the output of the process */
+        dup2( pLaunch->logfd, STDOUT_FILENO );
+        dup2( pLaunch->logfd, STDERR_FILENO );
+    }
+
+    if ( pLaunch->lockfd != -1 )
+    {
+        /* pass the lock handle to the process, which holds the process
+         * lock while the handle is open */
+        fcntl( pLaunch->lockfd, F_SETFD, 0 );
+    }
+
+    if ( pLaunch->standbyfd != -1 )
+    {
+        /* pass the barrier socket to the standby.  The process lock is
+         * taken through the lock handle and the pid is recorded by the
+         * process monitor when the standby is released */
+        fcntl( pLaunch->standbyfd, F_SETFD, 0 );
+    }
+    else if ( ( pProcess->monitored == true ) && ( pRecord != NULL ) )
+    {
+        /* getpid via the system call since the child shares the
+         * memory of the parent */
+        __atomic_store_n( &pRecord->data.pid,
+                          (pid_t)syscall( SYS_getpid ),
+                          __ATOMIC_RELEASE );
+    }
+
+    /* move into the cgroup and set the scheduling attributes */
+    pLaunch->resourceError = RESOURCES_Apply( &pProcess->resources );
+
+    /* a handler of the process monitor must not run in the child once
+     * the signals are unblocked */
+    ResetSignalHandlers();
+
+    sigprocmask( SIG_SETMASK, &pLaunch->sigmask, NULL );
+
+    if ( pLaunch->trace == true )
+    {
+        pLaunch->execTime = TRACE_Now();
+    }
+
+    /* replace the child with the new process */
+    execvpe( pProcess->argv[0], pProcess->argv, pLaunch->envp );
+
+    /* should not get here unless the process failed to start */
+    pLaunch->error = errno;
+
+    _exit( 127 );
+}
+
+/*============================================================================*/
+/*  ResetSignalHandlers                                                       */
+/*!
+    Reset the caught signals to their default action
+
+    The ResetSignalHandlers function is invoked by a launched child while
+    all signals are blocked.  It resets each signal which has a handler
+    to its default action, as POSIX_SPAWN_SETSIGDEF does, since a handler
+    would run on the memory of the process monitor.  Ignored signals are
+    left ignored, and are inherited by the process.
+
+==============================================================================*/
+static void ResetSignalHandlers( void )
+{
+    struct sigaction action;
+    int sig;
+
+    for ( sig = 1 ; sig < NSIG ; sig++ )
+    {
+        if ( ( sigaction( sig, NULL, &action ) == 0 ) &&
+             ( action.sa_handler != SIG_DFL ) &&
+             ( action.sa_handler != SIG_IGN ) )
+        {
+            action.sa_handler = SIG_DFL;
+            action.sa_flags = 0;
+            (void)sigaction( sig, &action, NULL );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  MakeEnvironment                                                           */
+/*!
+    Make the environment of a process which is passed file descriptors
+
+    The MakeEnvironment function creates a copy of the process monitor
+    environment with the PROCMON_READY_FD variable set to the readiness
+    pipe, the PROCMON_LISTEN_FDS variable set to the comma separated
+    listening sockets of a socket activated process, the
+    PROCMON_STANDBY_FD variable set to the barrier socket of a standby,
+    and the PROCMON_LOCK_FD variable set to the lock handle of a monitored
+    process or standby.  The environment must be created before the
+    process is launched since the launched child cannot allocate memory.
+    It is written to the environment buffer of the process, which is
+    allocated with its configuration so a restart does not allocate
+    memory.
+
+    @param[in]
+        readyfd
+            readiness pipe to pass to the process, or -1
+
+    @param[in]
+        pListener
+            pointer to the listening sockets to pass to the process
+
+    @param[in]
+        standbyfd
+            barrier socket to pass to a standby, or -1
+
+    @param[in]
+        lockfd
+            lock handle to pass to the process, or -1
+
+    @param[out]
+        envp
+            pointer to the environment buffer of the process, which
+            holds PROCMON_ENV_VARS bytes of variables after the
+            environment pointers
+
+    @retval EOK - the environment was created
+    @retval E2BIG - the environment has grown since startup
+
+==============================================================================*/
+static int MakeEnvironment( int readyfd,
+                            Listener *pListener,
+                            int standbyfd,
+                            int lockfd,
+                            char **envp )
+{
+    int result = E2BIG;
+    size_t readylen = strlen( PROCMON_READY_FD );
+    size_t fdslen = strlen( PROCMON_LISTEN_FDS );
+    size_t standbylen = strlen( PROCMON_STANDBY_FD );
+    size_t locklen = strlen( PROCMON_LOCK_FD );
+    size_t n = 0;
+    size_t i;
+    size_t j = 0;
+    char *var;
+    char *end;
+
+    while ( environ[n] != NULL )
+    {
+        n++;
+    }
+
+    if ( n <= pProcmonState->envCount )
+    {
+        /* the variables are stored after the environment pointers */
+        var = (char *)&envp[pProcmonState->envCount + 5];
+        end = var + PROCMON_ENV_VARS;
+
+        for ( i = 0; i < n; i++ )
+        {
+            /* the variables replace any inherited ones */
+            if ( ( strncmp( environ[i], PROCMON_READY_FD, readylen ) == 0 ) &&
+                 ( environ[i][readylen] == '=' ) )
+            {
+                continue;
+            }
+
+            if ( ( strncmp( environ[i], PROCMON_LISTEN_FDS, fdslen ) == 0 ) &&
+                 ( environ[i][fdslen] == '=' ) )
+            {
+                continue;
+            }
+
+            if ( ( strncmp( environ[i],
+                            PROCMON_STANDBY_FD,
+                            standbylen ) == 0 ) &&
+                 ( environ[i][standbylen] == '=' ) )
+            {
+                continue;
+            }
+
+            if ( ( strncmp( environ[i], PROCMON_LOCK_FD, locklen ) == 0 ) &&
+                 ( environ[i][locklen] == '=' ) )
+            {
+                continue;
+            }
+
+            envp[j++] = environ[i];
+        }
+
+        if ( readyfd != -1 )
+        {
+            envp[j++] = var;
+            var += snprintf( var,
+                             end - var,
+                             "%s=%d",
+                             PROCMON_READY_FD,
+                             readyfd ) + 1;
+        }
+
+        if ( ( pListener != NULL ) && ( pListener->count > 0 ) )
+        {
+            envp[j++] = var;
+            var += snprintf( var, end - var, "%s=", PROCMON_LISTEN_FDS );
+            for ( i = 0; i < pListener->count; i++ )
+            {
+                var += snprintf( var,
+                                 end - var,
+                                 ( i > 0 ) ? ",%d" : "%d",
+                                 pListener->sources[i].fd );
+            }
+
+            var++;
+        }
+
+        if ( standbyfd != -1 )
+        {
+            envp[j++] = var;
+            var += snprintf( var,
+                             end - var,
+                             "%s=%d",
+                             PROCMON_STANDBY_FD,
+                             standbyfd ) + 1;
+        }
+
+        if ( lockfd != -1 )
+        {
+            envp[j++] = var;
+            var += snprintf( var,
+                             end - var,
+                             "%s=%d",
+                             PROCMON_LOCK_FD,
+                             lockfd ) + 1;
+        }
+
+        envp[j] = NULL;
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  OpenProcessLock                                                           */
+/*!
+    Open a lock handle holding the process lock of a process
+
+    The OpenProcessLock function opens a lock handle and takes the process
+    lock of a monitored process through it, before the process is
+    launched.  The process inherits the lock handle, so it holds the
+    process lock without being able to modify the state table.  The lock
+    is also held by any children of the process which inherit the lock
+    handle.
+
+    @param[in]
+        pProcess
+            pointer to the monitored process
+
+    @retval file descriptor of the lock handle
+    @retval -1 - the process lock could not be taken
+
+==============================================================================*/
+static int OpenProcessLock( Process *pProcess )
+{
+    int fd = -1;
+
+    if ( ( pProcess != NULL ) && ( pProcess->pRecord != NULL ) )
+    {
+        fd = STATETABLE_OpenLock();
+        if ( ( fd != -1 ) &&
+             ( STATETABLE_LockHandle( pProcess->pRecord, fd ) != EOK ) )
+        {
+            close( fd );
+            fd = -1;
+        }
+    }
+
+    return fd;
+}
+
+/*============================================================================*/
+/*  MonitorThread                                                             */
+/*!
+    Thread to start and optionally monitor a single process for process death
+
+    The MonitorThread function forks the current process and then replaces
+    the new child process with the specified process to be run.
+    If the child process is to be monitored, the parent process will then
+    monitor the child process and re-start it if it terminates for any reason.
+
+    @param[in]
+        arg
+            pointer to a process info (ProcInfo) object containing information
+            about the process to be monitored
+
+    @retval NULL - process completed (or invalid argument)
+
+==============================================================================*/
+static void *MonitorThread( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+    pid_t pid = 0;
+    int wstatus;
+    bool run = true;
+    uint32_t sequence;
+    int64_t delay;
+
+    if ( pProcess != NULL )
+    {
+        if ( ( pProcess->monitored == false ) &&
+             ( pProcess->runcount >= GetParentRuncount( pProcess ) ) )
+        {
+            run = false;
+        }
+
+        while ( run )
+        {
+            /* get the command sequence before checking the process state
+             * so a command issued after the check is not missed */
+            sequence = STATETABLE_GetSequence();
+
+            /* check if the process is already running */
+            pid = get_pid_from_state( pProcess->id );
+
+            if ( pid == -2 )
+            {
+                /* terminate all monitoring and remove the process state */
+                remove_state( pProcess->id );
+                run = false;
+                break;
+            }
+
+            if ( pid == -1 )
+            {
+                /* monitoring has been suspended */
+                /* wait for a command before checking to see if
+                 * the process has been (re)started */
+                STATETABLE_Wait( sequence );
+                continue;
+            }
+
+            if ( ( pid == 0 ) && ( !RestartAllowed( pProcess, &delay ) ) )
+            {
+                /* the restart budget is exhausted */
+                /* wait for a command before checking again */
+                STATETABLE_Wait( sequence );
+                continue;
+            }
+
+            if ( pid == 0 )
+            {
+                /* process is not running */
+                pProcess->runcount++;
+
+                if ( delay != 0 )
+                {
+                    /* wait before restarting the process */
+                    usleep( delay * 1000 );
+                }
+
+                if ( pProcess->monitored == true )
+                {
+                    /* prepare the process state for the process lock */
+                    prepare_state( pProcess );
+                }
+
+                if ( pProcess->listen != NULL )
+                {
+                    /* the process is started immediately with its
+                     * listening sockets since a connection cannot be
+                     * waited for without the event loop */
+                    (void)LISTENER_Open( &pProcess->listener,
+                                         pProcess->listen );
+                }
+
+                /* launch the process. The process has been executed
+                 * and holds its lock when this returns */
+                pProcess->startTime = EVENTLOOP_GetTime();
+                if ( LaunchProcess( pProcess, -1, -1, -1, &pid ) != EOK )
+                {
+                    fprintf( stderr, "Failed to start %s\n", pProcess->id );
+
+                    /* try again later */
+                    sleep( 1 );
+                    continue;
+                }
+
+                RecordStart( pProcess, pid );
+            }
+
+            if ( pProcess->monitored == true )
+            {
+                /* kick off all dependents */
+                RestartDependents( pProcess );
+
+                /* monitor the process to detect process death */
+                Monitor( pProcess->id );
+
+                /* wait for child death.  The exit status of a process
+                 * which was started by another process monitor is not
+                 * known */
+                if ( waitpid( pid, &wstatus, 0 ) != pid )
+                {
+                    wstatus = STATETABLE_STATUS_UNKNOWN;
+                }
+
+                RecordExit( pProcess, wstatus );
+
+                if ( pProcess->verbose == true )
+                {
+                    fprintf( stderr,
+                            "Process %s terminated (wstatus=%d)\n",
+                            pProcess->id,
+                            wstatus );
+                }
+            }
+            else
+            {
+                /* processes which are not monitored */
+                if ( pProcess->verbose == true )
+                {
+                    printf("%s will not be monitored\n", pProcess->id );
+                }
+
+                waitpid( pid, &wstatus, 0 );
+
+                if ( pProcess->verbose == true )
+                {
+                    printf("%s terminated\n", pProcess->id );
+                }
+
+                RestartDependents( pProcess );
+                break;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  SupervisorSupported                                                       */
+/*!
+    Check if the event loop supervisor can be used
+
+    The SupervisorSupported function checks if the kernel supports
+    process file descriptors (pidfd), which are used by the supervisor
+    to detect process death from the event loop.
+
+    @retval true - the supervisor can be used
+    @retval false - the supervisor cannot be used
+
+==============================================================================*/
+static bool SupervisorSupported( void )
+{
+    bool result = false;
+    int fd;
+
+    fd = syscall( SYS_pidfd_open, getpid(), 0 );
+    if ( fd != -1 )
+    {
+        close( fd );
+        result = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SuperviseProcess                                                          */
+/*!
+    Supervise a single process
+
+    The SuperviseProcess function is the event loop equivalent of one
+    iteration of the MonitorThread loop.  It checks the process state
+    and then either:
+
+    - stops supervising the process if monitoring has been terminated
+    - waits for a command if monitoring has been suspended
+    - waits for a command if the process has exhausted its restart budget
+    - watches the process for death if it is already running
+    - waits for a connection to a socket activated process
+    - schedules the process to be started after its restart delay
+
+    It is also invoked as a timer handler.
+
+    @param[in]
+        arg
+            pointer to the Process to supervise
+
+==============================================================================*/
+static void SuperviseProcess( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+    int64_t delay;
+    pid_t pid;
+
+    if ( pProcess != NULL )
+    {
+        /* check if the process is already running */
+        pid = get_pid_from_state( pProcess->id );
+
+        if ( pid == -2 )
+        {
+            /* terminate all monitoring and remove the process state */
+            remove_state( pProcess->id );
+            pProcess->supervised = false;
+            pProcess->metrics.exitTime = 0;
+            pProcess->exitTime = 0;
+
+            /* no connections are queued for a process which is stopped */
+            LISTENER_Close( &pProcess->listener );
+            pProcess->activated = false;
+        }
+        else if ( pid == -1 )
+        {
+            /* monitoring has been suspended */
+            /* HandleCommand will check again when a command is issued */
+            pProcess->suspended = true;
+            pProcess->metrics.exitTime = 0;
+            pProcess->exitTime = 0;
+        }
+        else if ( ( pid == 0 ) &&
+                  ( UsesActivation( pProcess ) ) &&
+                  ( pProcess->activated == false ) )
+        {
+            /* socket activated process is started by HandleConnection */
+            AwaitConnection( pProcess );
+        }
+        else if ( pid == 0 )
+        {
+            /* process is not running */
+            if ( RestartAllowed( pProcess, &delay ) )
+            {
+                pProcess->runcount++;
+
+                /* wait before restarting the process */
+                EVENTLOOP_StartTimer( &pProcess->restartTimer,
+                                      delay,
+                                      SpawnProcess,
+                                      pProcess );
+            }
+            else
+            {
+                /* HandleCommand will check again when a command is issued */
+                pProcess->suspended = true;
+                pProcess->metrics.exitTime = 0;
+                pProcess->exitTime = 0;
+            }
+        }
+        else
+        {
+            /* process is already running */
+            pProcess->startTime = EVENTLOOP_GetTime();
+
+            if ( pProcess->monitored == true )
+            {
+                /* kick off all dependents */
+                RestartDependents( pProcess );
+            }
+
+            WatchProcess( pProcess, pid );
+        }
+
+        if ( pProcess->restartTimer.active == false )
+        {
+            /* the standby is not required unless the process is restarted */
+            StopStandby( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  SpawnProcess                                                              */
+/*!
+    Spawn a supervised process
+
+    The SpawnProcess function is a timer handler which forks a new
+    process to run the specified process and starts watching it for
+    process death.  If the process is monitored, its dependents are
+    restarted.  If the process has a warm standby, the standby is
+    released to take over instead of forking a new process.
+
+    @param[in]
+        arg
+            pointer to the Process to spawn
+
+==============================================================================*/
+static void SpawnProcess( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+    pid_t pid;
+    int readyfd = -1;
+    int result;
+
+    if ( ( pProcess != NULL ) && ( PromoteStandby( pProcess ) == false ) )
+    {
+        if ( UsesReadiness( pProcess ) )
+        {
+            /* create the pipe used by the process to notify readiness */
+            if ( OpenReadyPipe( pProcess, &readyfd ) != EOK )
+            {
+                fprintf( stderr,
+                         "Failed to create readiness pipe for %s\n",
+                         pProcess->id );
+            }
+        }
+
+        if ( pProcess->monitored == true )
+        {
+            /* prepare the process state before the process is started
+             * so its state is available immediately */
+            prepare_state( pProcess );
+        }
+
+        /* launch the process */
+        pProcess->startTime = EVENTLOOP_GetTime();
+        result = LaunchProcess( pProcess,
+                                readyfd,
+                                OpenLog( pProcess ),
+                                -1,
+                                &pid );
+        if ( result != EOK )
+        {
+            fprintf( stderr,
+                     "Failed to start %s: %s\n",
+                     pProcess->id,
+                     strerror( result ) );
+
+            CloseReadyPipe( pProcess );
+
+            /* try again later */
+            EVENTLOOP_StartTimer( &pProcess->restartTimer,
+                                  1000,
+                                  SpawnProcess,
+                                  pProcess );
+        }
+        else
+        {
+            ProcessLaunched( pProcess, pid );
+        }
+
+        if ( readyfd != -1 )
+        {
+            /* only the child needs the write end of the readiness pipe */
+            close( readyfd );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  ProcessLaunched                                                           */
+/*!
+    Start supervising a launched process
+
+    The ProcessLaunched function starts watching a process which has
+    just been launched ( or a standby which has just been released ) for
+    process death, and waits for it to notify its readiness, or kicks
+    off its dependents.  A new standby is launched in the background.
+
+    @param[in]
+        pProcess
+            pointer to the launched process
+
+    @param[in]
+        pid
+            process identifier of the launched process
+
+==============================================================================*/
+static void ProcessLaunched( Process *pProcess, pid_t pid )
+{
+    METRICS_ProcessStarted( &pProcess->metrics );
+    RecordStart( pProcess, pid );
+    WatchProcess( pProcess, pid );
+
+    /* the next connection to a socket activated process is
+     * handled by the process until it exits */
+    pProcess->activated = false;
+    WatchActivity( pProcess );
+
+    if ( pProcess->readyEvent.fd != -1 )
+    {
+        /* wait for the process to notify its readiness
+         * the process wait time becomes the readiness timeout */
+        pProcess->awaitingReady = true;
+        pProcess->traceReady = TRACE_Begin();
+        if ( pProcess->wait > 0 )
+        {
+            EVENTLOOP_StartTimer( &pProcess->readyTimer,
+                                  pProcess->wait * 1000,
+                                  ReadyTimeout,
+                                  pProcess );
+        }
+    }
+    else if ( ( pProcess->started == false ) &&
+              ( UsesReadiness( pProcess ) ) )
+    {
+        /* don't stall the startup if the pipe is not available */
+        EVENTLOOP_StartTimer( &pProcess->readyTimer,
+                              pProcess->wait * 1000,
+                              ProcessReady,
+                              pProcess );
+    }
+    else if ( pProcess->monitored == true )
+    {
+        /* kick off all dependents */
+        RestartDependents( pProcess );
+    }
+
+    if ( ( pProcess->monitored == false ) &&
+         ( pProcess->verbose == true ) )
+    {
+        printf("%s will not be monitored\n", pProcess->id );
+    }
+
+    /* launch a standby to take over from the process */
+    StartStandby( pProcess, PROCMON_STANDBY_DELAY );
+}
+
+/*============================================================================*/
+/*  WatchProcess                                                              */
+/*!
+    Watch a process for process death
+
+    The WatchProcess function opens a process file descriptor (pidfd)
+    for the specified process and adds it to the event loop.  The pidfd
+    becomes readable when the process terminates, at which point
+    HandleProcessExit is invoked.  The process does not need to be a
+    child of the process monitor.
+
+    @param[in]
+        pProcess
+            pointer to the Process to watch
+
+    @param[in]
+        pid
+            process identifier of the running process
+
+    @retval EOK - the process is being watched
+    @retval EINVAL - invalid arguments
+    @retval other - error from pidfd_open or epoll_ctl
+
+==============================================================================*/
+static int WatchProcess( Process *pProcess, pid_t pid )
+{
+    int result = EINVAL;
+    int fd;
+
+    if ( pProcess != NULL )
+    {
+        pProcess->pid = pid;
+
+        fd = syscall( SYS_pidfd_open, pid, 0 );
+        if ( fd != -1 )
+        {
+            pProcess->exitEvent.fd = fd;
+            pProcess->exitEvent.handler = HandleProcessExit;
+            pProcess->exitEvent.arg = pProcess;
+
+            result = EVENTLOOP_Add( &pProcess->exitEvent, EPOLLIN );
+        }
+        else
+        {
+            result = errno;
+        }
+
+        if ( result == EOK )
+        {
+            StartHealthCheck( pProcess );
+        }
+        else
+        {
+            fprintf( stderr,
+                     "Failed to watch process %s (%s)\n",
+                     pProcess->id,
+                     strerror( result ) );
+
+            if ( fd != -1 )
+            {
+                close( fd );
+                pProcess->exitEvent.fd = -1;
+            }
+
+            /* check on the process again later */
+            EVENTLOOP_StartTimer( &pProcess->restartTimer,
+                                  ( result == ESRCH ) ? 0 : 1000,
+                                  SuperviseProcess,
+                                  pProcess );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  HandleProcessExit                                                         */
+/*!
+    Handle the death of a supervised process
+
+    The HandleProcessExit function is an event loop handler which is
+    invoked when the pidfd of a supervised process becomes readable,
+    indicating that the process has terminated.  It reaps the process
+    and either re-runs the supervision logic for monitored processes,
+    or restarts the dependents of unmonitored processes which have
+    run to completion.
+
+    @param[in]
+        pSource
+            pointer to the process exit event source
+
+    @param[in]
+        events
+            epoll events (unused)
+
+==============================================================================*/
+static void HandleProcessExit( EventSource *pSource, uint32_t events )
+{
+    Process *pProcess;
+    int wstatus = 0;
+
+    if ( ( pSource != NULL ) && ( pSource->fd != -1 ) )
+    {
+        pProcess = (Process *)pSource->arg;
+
+        /* stop watching the process */
+        EVENTLOOP_Remove( pSource );
+        close( pSource->fd );
+        pSource->fd = -1;
+
+        /* the process has stopped so it does not need to be killed */
+        EVENTLOOP_StopTimer( &pProcess->stopTimer );
+
+        /* a process which has stopped can no longer be idle */
+        EVENTLOOP_StopTimer( &pProcess->idleTimer );
+        LISTENER_Unwatch( &pProcess->listener );
+
+        /* nor can its health be checked */
+        HEALTH_Stop( &pProcess->health );
+
+        /* a process which has terminated can no longer notify readiness */
+        CloseReadyPipe( pProcess );
+
+        /* reap the child if it was spawned by us.  The exit status of
+         * a process which was adopted from the peer is not known */
+        if ( waitpid( pProcess->pid, &wstatus, WNOHANG ) != pProcess->pid )
+        {
+            wstatus = STATETABLE_STATUS_UNKNOWN;
+        }
+
+        /* start measuring the restart latency */
+        METRICS_ProcessExited( &pProcess->metrics );
+        RecordExit( pProcess, wstatus );
+
+        if ( ( pProcess->monitored == false ) ||
+             ( pProcess->reloading == true ) ||
+             ( pProcess->stopping == true ) ||
+             ( pProcmonState->shuttingDown == true ) )
+        {
+            /* only a process which is restarted is taken over by its
+             * standby */
+            StopStandby( pProcess );
+        }
+
+        if ( pProcmonState->shuttingDown == true )
+        {
+            /* the process was stopped to shut down the process monitor */
+            ShutdownStopped( pProcess );
+        }
+        else if ( pProcess == pProcmonState->pMonitoredProcess )
+        {
+            if ( pProcess->verbose == true )
+            {
+                fprintf( stderr,
+                        "Process monitor %s terminated\n",
+                        pProcess->id );
+            }
+
+            SupervisePeer( pProcess );
+        }
+        else if ( pProcess->reloading == true )
+        {
+            /* the process was stopped to apply a configuration reload */
+            ReloadComplete( pProcess );
+        }
+        else if ( pProcess->stopping == true )
+        {
+            /* the process was stopped to restart it with its parent */
+            pProcess->stopping = false;
+            pProcess->supervised = false;
+            pProcmonState->subtreeStopping--;
+            SubtreeStopped( pProcmonState );
+        }
+        else if ( pProcess->monitored == true )
+        {
+            if ( pProcess->verbose == true )
+            {
+                fprintf( stderr,
+                        "Process %s terminated (wstatus=%d)\n",
+                        pProcess->id,
+                        wstatus );
+            }
+
+            SuperviseProcess( pProcess );
+        }
+        else
+        {
+            if ( pProcess->verbose == true )
+            {
+                printf("%s terminated\n", pProcess->id );
+            }
+
+            pProcess->supervised = false;
+            RestartDependents( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  StopProcess                                                               */
+/*!
+    Stop a supervised process
+
+    The StopProcess function asks a running supervised process to stop
+    by sending it its stop signal.  If the process has not terminated
+    when its stop timeout expires it is killed by KillProcess.  A process
+    with a stop timeout of 0, or whose stop signal is SIGKILL, is killed
+    immediately.
+
+    HandleProcessExit is invoked once the process has terminated.
+
+    @param[in]
+        pProcess
+            pointer to the process to stop
+
+==============================================================================*/
+static void StopProcess( Process *pProcess )
+{
+    int sig;
+
+    if ( ( pProcess != NULL ) &&
+         ( pProcess->exitEvent.fd != -1 ) &&
+         ( pProcess->pid > 0 ) &&
+         ( pProcess->stopTimer.active == false ) )
+    {
+        sig = ( pProcess->stopTimeout > 0 ) ? pProcess->stopSignal : SIGKILL;
+
+        if ( pProcess->verbose == true )
+        {
+            printf( "stopping %s (%s)\n", pProcess->id, strsignal( sig ) );
+        }
+
+        if ( kill( pProcess->pid, sig ) == -1 )
+        {
+            if ( errno != ESRCH )
+            {
+                fprintf( stderr,
+                         "Failed to stop %s (%s)\n",
+                         pProcess->id,
+                         strerror( errno ) );
+            }
+        }
+        else if ( sig != SIGKILL )
+        {
+            /* kill the process if it does not stop in time */
+            EVENTLOOP_StartTimer( &pProcess->stopTimer,
+                                  (int64_t)pProcess->stopTimeout * 1000,
+                                  KillProcess,
+                                  pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  KillProcess                                                               */
+/*!
+    Kill a process which has not stopped
+
+    The KillProcess function is invoked when the stop timeout of a
+    process expires before the process has terminated.  The process
+    is killed with SIGKILL.
+
+    @param[in]
+        arg
+            pointer to the process to kill
+
+==============================================================================*/
+static void KillProcess( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+
+    if ( ( pProcess != NULL ) &&
+         ( pProcess->exitEvent.fd != -1 ) &&
+         ( pProcess->pid > 0 ) )
+    {
+        fprintf( stderr,
+                 "%s did not stop within %ds, killing it\n",
+                 pProcess->id,
+                 pProcess->stopTimeout );
+
+        (void)kill( pProcess->pid, SIGKILL );
+    }
+}
+
+/*============================================================================*/
+/*  RecordExit                                                                */
+/*!
+    Record the exit of a monitored process
+
+    The RecordExit function adds the exit status and uptime of a
+    monitored process to its exit history in the state table, and
+    starts measuring the time taken to restart it.  The exit is reported
+    to the cluster aggregator.
+
+    @param[in]
+        pProcess
+            pointer to the process which exited
+
+    @param[in]
+        wstatus
+            wait status of the process, or STATETABLE_STATUS_UNKNOWN
+
+==============================================================================*/
+static void RecordExit( Process *pProcess, int wstatus )
+{
+    StateRecord *pRecord;
+    int64_t now;
+    int64_t uptime;
+
+    if ( ( pProcess != NULL ) && ( pProcess->monitored == true ) )
+    {
+        pRecord = ( pProcess->pRecord != NULL )
+                  ? pProcess->pRecord
+                  : STATETABLE_Find( pProcess->id );
+
+        now = EVENTLOOP_GetTime();
+        uptime = ( pProcess->startTime != 0 ) ? now - pProcess->startTime : 0;
+        if ( uptime > UINT32_MAX )
+        {
+            uptime = UINT32_MAX;
+        }
+
+        if ( STATETABLE_RecordExit( pRecord,
+                                    wstatus,
+                                    (uint32_t)uptime ) == EOK )
+        {
+            pProcess->exitTime = now;
+        }
+
+        pProcess->traceRestart = TRACE_Begin();
+
+        if ( wstatus == STATETABLE_STATUS_UNKNOWN )
+        {
+            (void)CLUSTER_Send( &pProcmonState->agent,
+                                "exit %s unknown",
+                                pProcess->id );
+        }
+        else if ( WIFSIGNALED( wstatus ) )
+        {
+            (void)CLUSTER_Send( &pProcmonState->agent,
+                                "exit %s signal %d",
+                                pProcess->id,
+                                WTERMSIG( wstatus ) );
+        }
+        else
+        {
+            (void)CLUSTER_Send( &pProcmonState->agent,
+                                "exit %s code %d",
+                                pProcess->id,
+                                WEXITSTATUS( wstatus ) );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  RecordStart                                                               */
+/*!
+    Record the restart of a monitored process
+
+    The RecordStart function records the time taken to restart a
+    monitored process in the most recent entry of its exit history.
+    Nothing is recorded for the first start of the process.  The start
+    or restart is reported to the cluster aggregator.
+
+    @param[in]
+        pProcess
+            pointer to the process which was started
+
+    @param[in]
+        pid
+            process identifier of the started process
+
+==============================================================================*/
+static void RecordStart( Process *pProcess, pid_t pid )
+{
+    int64_t latency;
+
+    if ( ( pProcess != NULL ) && ( pProcess->monitored == true ) )
+    {
+        if ( pProcess->exitTime != 0 )
+        {
+            latency = EVENTLOOP_GetTime() - pProcess->exitTime;
+            if ( latency > UINT32_MAX )
+            {
+                latency = UINT32_MAX;
+            }
+
+            (void)STATETABLE_RecordRestart( pProcess->pRecord,
+                                            (uint32_t)latency );
+            pProcess->exitTime = 0;
+
+            TRACE_Async( "restart", pProcess->id, pProcess->traceRestart );
+            pProcess->traceRestart = 0;
+
+            (void)CLUSTER_Send( &pProcmonState->agent,
+                                "restart %s %d %u",
+                                pProcess->id,
+                                (int)pid,
+                                (uint32_t)latency );
+        }
+        else
+        {
+            (void)CLUSTER_Send( &pProcmonState->agent,
+                                "start %s %d",
+                                pProcess->id,
+                                (int)pid );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  UsesReadiness                                                             */
+/*!
+    Check if a process uses the readiness protocol
+
+    The UsesReadiness function checks if the process has opted in
+    to the readiness notification protocol via the "notify" attribute.
+    The readiness protocol requires the event loop supervisor.
+
+    @param[in]
+        pProcess
+            pointer to the process to check
+
+    @retval true - the process will notify its readiness
+    @retval false - the process wait time is used to determine readiness
+
+==============================================================================*/
+static bool UsesReadiness( Process *pProcess )
+{
+    return ( pProcess != NULL ) &&
+           ( pProcess->notify == true ) &&
+           ( pProcmonState->supervisor == true );
+}
+
+/*============================================================================*/
+/*  UsesActivation                                                            */
+/*!
+    Check if a process is socket activated
+
+    The UsesActivation function checks if a monitored process has
+    listening sockets specified by its "listen" attribute, and is only
+    started when a connection arrives.  Socket activation requires the
+    event loop supervisor.
+
+    @param[in]
+        pProcess
+            pointer to the process to check
+
+    @retval true - the process is started when a connection arrives
+    @retval false - the process is started immediately
+
+==============================================================================*/
+static bool UsesActivation( Process *pProcess )
+{
+    return ( pProcess != NULL ) &&
+           ( pProcess->listen != NULL ) &&
+           ( pProcess->monitored == true ) &&
+           ( pProcmonState->supervisor == true );
+}
+
+/*============================================================================*/
+/*  AwaitConnection                                                           */
+/*!
+    Wait for a connection to a socket activated process
+
+    The AwaitConnection function binds the listening sockets of a socket
+    activated process the first time it is used, and watches them for a
+    connection.  HandleConnection starts the process once a connection
+    arrives.  If the sockets cannot be bound, this is tried again later.
+
+    @param[in]
+        pProcess
+            pointer to the socket activated process
+
+==============================================================================*/
+static void AwaitConnection( Process *pProcess )
+{
+    int result;
+
+    if ( pProcess != NULL )
+    {
+        result = LISTENER_Open( &pProcess->listener, pProcess->listen );
+        if ( result == EOK )
+        {
+            result = LISTENER_Watch( &pProcess->listener,
+                                     EPOLLIN,
+                                     HandleConnection,
+                                     pProcess );
+        }
+
+        if ( result == EOK )
+        {
+            if ( pProcess->verbose == true )
+            {
+                printf( "%s is waiting for a connection on %s\n",
+                        pProcess->id,
+                        pProcess->listen );
+            }
+        }
+        else
+        {
+            fprintf( stderr,
+                     "Failed to listen for %s: %s\n",
+                     pProcess->id,
+                     strerror( result ) );
+
+            /* try again later */
+            EVENTLOOP_StartTimer( &pProcess->restartTimer,
+                                  1000,
+                                  SuperviseProcess,
+                                  pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleConnection                                                          */
+/*!
+    Handle a connection to a socket activated process
+
+    The HandleConnection function is invoked by the event loop when a
+    connection arrives on a listening socket of a socket activated
+    process which is not running.  The connection is left for the process
+    to accept, and the process is started.  Connections are queued on the
+    listening sockets until the process accepts them.
+
+    @param[in]
+        pSource
+            pointer to the listening socket event source
+
+    @param[in]
+        events
+            epoll events on the listening socket
+
+==============================================================================*/
+static void HandleConnection( EventSource *pSource, uint32_t events )
+{
+    Process *pProcess;
+
+    (void)events;
+
+    if ( ( pSource != NULL ) && ( pSource->arg != NULL ) )
+    {
+        pProcess = (Process *)pSource->arg;
+
+        /* the connection is handled by the started process */
+        LISTENER_Unwatch( &pProcess->listener );
+        pProcess->activated = true;
+
+        if ( pProcess->verbose == true )
+        {
+            printf( "starting %s for a connection\n", pProcess->id );
+        }
+
+        SuperviseProcess( pProcess );
+    }
+}
+
+/*============================================================================*/
+/*  WatchActivity                                                             */
+/*!
+    Watch a socket activated process for idleness
+
+    The WatchActivity function starts the idle timer of a socket
+    activated process which has an idle timeout, and watches its
+    listening sockets for new connections, each of which restarts the
+    idle timer.  Established connections are checked when the idle timer
+    expires.
+
+    @param[in]
+        pProcess
+            pointer to the socket activated process which was started
+
+==============================================================================*/
+static void WatchActivity( Process *pProcess )
+{
+    if ( ( pProcess != NULL ) &&
+         ( pProcess->idleTimeout > 0 ) &&
+         ( pProcess->listener.addresses != NULL ) )
+    {
+        /* edge triggered, so each new connection is reported once
+         * rather than until the process accepts it */
+        if ( LISTENER_Watch( &pProcess->listener,
+                             EPOLLIN | EPOLLET,
+                             HandleActivity,
+                             pProcess ) == EOK )
+        {
+            EVENTLOOP_StartTimer( &pProcess->idleTimer,
+                                  (int64_t)pProcess->idleTimeout * 1000,
+                                  IdleTimeout,
+                                  pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleActivity                                                            */
+/*!
+    Handle a new connection to a running socket activated process
+
+    The HandleActivity function is invoked by the event loop when a new
+    connection arrives for a running socket activated process, and
+    restarts its idle timer.
+
+    @param[in]
+        pSource
+            pointer to the listening socket event source
+
+    @param[in]
+        events
+            epoll events on the listening socket
+
+==============================================================================*/
+static void HandleActivity( EventSource *pSource, uint32_t events )
+{
+    Process *pProcess;
+
+    (void)events;
+
+    if ( ( pSource != NULL ) && ( pSource->arg != NULL ) )
+    {
+        pProcess = (Process *)pSource->arg;
+
+        EVENTLOOP_StartTimer( &pProcess->idleTimer,
+                              (int64_t)pProcess->idleTimeout * 1000,
+                              IdleTimeout,
+                              pProcess );
+    }
+}
+
+/*============================================================================*/
+/*  IdleTimeout                                                               */
+/*!
+    Stop an idle socket activated process
+
+    The IdleTimeout function is invoked when a socket activated process
+    has not received a new connection within its idle timeout.  If a
+    connection accepted from its sockets is still established, the idle
+    timer is restarted.  Otherwise the process is stopped, and is started
+    again when the next connection arrives.  Stopping an idle process
+    does not count against its restart budget.
+
+    @param[in]
+        arg
+            pointer to the idle process
+
+==============================================================================*/
+static void IdleTimeout( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+
+    if ( ( pProcess != NULL ) && ( pProcess->exitEvent.fd != -1 ) )
+    {
+        if ( LISTENER_Connected( &pProcess->listener ) == true )
+        {
+            /* an established connection keeps the process active */
+            EVENTLOOP_StartTimer( &pProcess->idleTimer,
+                                  (int64_t)pProcess->idleTimeout * 1000,
+                                  IdleTimeout,
+                                  pProcess );
+        }
+        else
+        {
+            if ( pProcess->verbose == true )
+            {
+                printf( "%s is idle\n", pProcess->id );
+            }
+
+            pProcess->restarting = true;
+            StopProcess( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  SetupHealthCheck                                                          */
+/*!
+    Set up the health check of a process
+
+    The SetupHealthCheck function parses the health check of a process
+    from its health_check, health_interval, health_timeout and
+    health_failures attributes.
+
+    @param[in]
+        pProcess
+            pointer to the process to set up
+
+    @retval EOK - the health check was set up
+    @retval EINVAL - invalid health check
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int SetupHealthCheck( Process *pProcess )
+{
+    int result = EINVAL;
+
+    if ( pProcess != NULL )
+    {
+        if ( ( pProcess->healthInterval <= 0 ) ||
+             ( pProcess->healthTimeout <= 0 ) ||
+             ( pProcess->healthFailures <= 0 ) )
+        {
+            result = EINVAL;
+        }
+        else
+        {
+            result = HEALTH_Init( &pProcess->health,
+                                  pProcess->healthCheck,
+                                  pProcess->healthInterval,
+                                  pProcess->healthTimeout,
+                                  pProcess->healthFailures );
+        }
+
+        if ( result == EINVAL )
+        {
+            fprintf( stderr,
+                     "Invalid health check for %s\n",
+                     ( pProcess->id != NULL ) ? pProcess->id : "process" );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StartHealthCheck                                                          */
+/*!
+    Start checking the health of a running process
+
+    The StartHealthCheck function starts the health check of a running
+    monitored process which has a health_check attribute.  The health
+    check of a heartbeat process uses the heartbeat counter in the
+    state record of the process.
+
+    @param[in]
+        pProcess
+            pointer to the running process
+
+==============================================================================*/
+static void StartHealthCheck( Process *pProcess )
+{
+    StateRecord *pRecord;
+
+    if ( ( pProcess != NULL ) &&
+         ( pProcess->monitored == true ) &&
+         ( pProcess->health.type != HEALTH_eNONE ) )
+    {
+        pRecord = ( pProcess->pRecord != NULL )
+                  ? pProcess->pRecord
+                  : STATETABLE_Find( pProcess->id );
+
+        (void)HEALTH_Start( &pProcess->health,
+                            ( pRecord != NULL ) ? &pRecord->data.heartbeat
+                                                : NULL,
+                            HealthChanged,
+                            pProcess );
+    }
+}
+
+/*============================================================================*/
+/*  HealthChanged                                                             */
+/*!
+    Handle a change in the health of a process
+
+    The HealthChanged function is invoked when a process first passes
+    its health check, and when it has failed its health check the
+    configured number of consecutive times.  The change is reported to
+    the cluster aggregator.
+
+    An unhealthy process is stopped, and its termination is then handled
+    in the same way as a crash: it counts against the restart budget of
+    the process, and the process is restarted along with its dependents.
+
+    @param[in]
+        arg
+            pointer to the process
+
+    @param[in]
+        healthy
+            indicates whether the process is healthy
+
+==============================================================================*/
+static void HealthChanged( void *arg, bool healthy )
+{
+    Process *pProcess = (Process *)arg;
+
+    if ( ( pProcess != NULL ) && ( pProcess->exitEvent.fd != -1 ) )
+    {
+        (void)CLUSTER_Send( &pProcmonState->agent,
+                            "health %s %s",
+                            pProcess->id,
+                            healthy ? "healthy" : "unhealthy" );
+
+        if ( healthy == false )
+        {
+            fprintf( stderr, "%s failed its health check\n", pProcess->id );
+            syslog( LOG_ERR, "%s failed its health check", pProcess->id );
+
+            StopProcess( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  OpenLog                                                                   */
+/*!
+    Open the output capture of a process
+
+    The OpenLog function opens the output capture of a process which
+    has a log_buffer or log_file attribute the first time it is spawned.
+    The capture is kept open while the process is restarted.
+
+    @param[in]
+        pProcess
+            pointer to the process
+
+    @retval fd - log pipe to pass to the process
+    @retval -1 - the output of the process is not captured
+
+==============================================================================*/
+static int OpenLog( Process *pProcess )
+{
+    int rc;
+
+    if ( ( pProcess->logBufferSize > 0 ) || ( pProcess->logFile != NULL ) )
+    {
+        rc = LOGBUFFER_Open( &pProcess->log,
+                             ( pProcess->logBufferSize > 0 )
+                                ? pProcess->logBufferSize
+                                : 0,
+                             pProcess->logFile,
+                             ( pProcess->logFileSize > 0 )
+                                ? pProcess->logFileSize
+                                : 0 );
+        if ( rc != EOK )
+        {
+            fprintf( stderr,
+                     "Failed to capture the output of %s: %s\n",
+                     pProcess->id,
+                     strerror( rc ) );
+        }
+    }
+
+    return LOGBUFFER_GetFd( &pProcess->log );
+}
+
+/*============================================================================*/
+/*  OpenReadyPipe                                                             */
+/*!
+    Open a readiness notification pipe
+
+    The OpenReadyPipe function creates the pipe which is inherited
+    by a process to notify the process monitor that it is ready.
+    The read end of the pipe is added to the event loop, and the
+    write end is returned to be passed to the process.
+
+    Both ends of the pipe are created close-on-exec, so the write end
+    must be made inheritable in the child process before it is executed.
+
+    @param[in]
+        pProcess
+            pointer to the process to create the pipe for
+
+    @param[out]
+        pWriteFd
+            pointer to a location to store the write end of the pipe
+
+    @retval EOK - the readiness pipe was created
+    @retval EINVAL - invalid arguments
+    @retval other - error from pipe2 or epoll_ctl
+
+==============================================================================*/
+static int OpenReadyPipe( Process *pProcess, int *pWriteFd )
+{
+    int result = EINVAL;
+    int fds[2];
+
+    if ( ( pProcess != NULL ) && ( pWriteFd != NULL ) )
+    {
+        CloseReadyPipe( pProcess );
+
+        if ( pipe2( fds, O_CLOEXEC | O_NONBLOCK ) == 0 )
+        {
+            /* only the read end used by the event loop is non-blocking,
+             * so the process does not have to handle EAGAIN when it
+             * writes its notification */
+            fcntl( fds[1], F_SETFL, 0 );
+
+            pProcess->readyEvent.fd = fds[0];
+            pProcess->readyEvent.handler = HandleReadyNotification;
+            pProcess->readyEvent.arg = pProcess;
+
+            result = EVENTLOOP_Add( &pProcess->readyEvent, EPOLLIN );
+            if ( result == EOK )
+            {
+                *pWriteFd = fds[1];
+            }
+            else
+            {
+                close( fds[0] );
+                close( fds[1] );
+                pProcess->readyEvent.fd = -1;
+            }
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CloseReadyPipe                                                            */
+/*!
+    Close a readiness notification pipe
+
+    The CloseReadyPipe function removes the read end of the process
+    readiness pipe from the event loop and closes it.
+
+    @param[in]
+        pProcess
+            pointer to the process to close the readiness pipe for
+
+==============================================================================*/
+static void CloseReadyPipe( Process *pProcess )
+{
+    if ( ( pProcess != NULL ) && ( pProcess->readyEvent.fd != -1 ) )
+    {
+        EVENTLOOP_Remove( &pProcess->readyEvent );
+        close( pProcess->readyEvent.fd );
+        pProcess->readyEvent.fd = -1;
+    }
+}
+
+/*============================================================================*/
+/*  HandleReadyNotification                                                   */
+/*!
+    Handle a readiness notification from a process
+
+    The HandleReadyNotification function is an event loop handler which
+    is invoked when data is available on a process readiness pipe.
+    If the process has written "READY" (or the sd_notify style "READY=1")
+    to the pipe, the process is marked as ready.  The pipe is closed
+    once the notification has been received, or the process closes
+    its end of the pipe.
+
+    @param[in]
+        pSource
+            pointer to the readiness pipe event source
+
+    @param[in]
+        events
+            epoll events (unused)
+
+==============================================================================*/
+static void HandleReadyNotification( EventSource *pSource, uint32_t events )
+{
+    Process *pProcess;
+    char buf[64];
+    ssize_t n;
+
+    if ( ( pSource != NULL ) && ( pSource->fd != -1 ) )
+    {
+        pProcess = (Process *)pSource->arg;
+
+        n = read( pSource->fd, buf, sizeof( buf ) - 1 );
+        if ( n > 0 )
+        {
+            buf[n] = '\0';
+            if ( strstr( buf, "READY" ) != NULL )
+            {
+                if ( pProcess->verbose == true )
+                {
+                    printf( "%s is ready\n", pProcess->id );
+                }
+
+                CloseReadyPipe( pProcess );
+
+                if ( pProcess->awaitingReady == true )
+                {
+                    ProcessReady( pProcess );
+                }
+            }
+        }
+        else if ( ( n == 0 ) || ( errno != EAGAIN ) )
+        {
+            /* the process closed the pipe without notifying readiness.
+             * The readiness timeout (if any) still applies */
+            CloseReadyPipe( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  ReadyTimeout                                                              */
+/*!
+    Handle a readiness notification timeout
+
+    The ReadyTimeout function is a timer handler which is invoked when
+    a process has not notified its readiness within its wait time.
+    The process is assumed to be ready so its dependents are not
+    held up indefinitely.
+
+    @param[in]
+        arg
+            pointer to the process which has not notified its readiness
+
+==============================================================================*/
+static void ReadyTimeout( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+
+    if ( ( pProcess != NULL ) && ( pProcess->awaitingReady == true ) )
+    {
+        fprintf( stderr,
+                 "%s did not notify readiness within %d seconds\n",
+                 pProcess->id,
+                 pProcess->wait );
+
+        CloseReadyPipe( pProcess );
+        ProcessReady( pProcess );
+    }
+}
+
+/*============================================================================*/
+/*  UsesStandby                                                               */
+/*!
+    Check if a process is kept with a warm standby
+
+    The UsesStandby function checks if a monitored process has opted in
+    to a warm standby via the "standby" attribute.  A standby is held at
+    a barrier by the event loop supervisor, which releases it when the
+    process dies.
+
+    @param[in]
+        pProcess
+            pointer to the process to check
+
+    @retval true - the process is kept with a warm standby
+    @retval false - the process is restarted by launching it again
+
+==============================================================================*/
+static bool UsesStandby( Process *pProcess )
+{
+    return ( pProcess != NULL ) &&
+           ( pProcess->standby == true ) &&
+           ( pProcess->monitored == true ) &&
+           ( pProcess->skip == false ) &&
+           ( pProcmonState->supervisor == true );
+}
+
+/*============================================================================*/
+/*  StartStandby                                                              */
+/*!
+    Schedule the launch of a standby
+
+    The StartStandby function schedules the launch of a warm standby for
+    a process which does not have one.
+
+    @param[in]
+        pProcess
+            pointer to the process to launch a standby for
+
+    @param[in]
+        delay
+            time (in milliseconds) to wait before launching the standby
+
+==============================================================================*/
+static void StartStandby( Process *pProcess, int64_t delay )
+{
+    if ( ( UsesStandby( pProcess ) ) &&
+         ( pProcess->spare.pid == 0 ) &&
+         ( pProcess->spare.timer.active == false ) )
+    {
+        EVENTLOOP_StartTimer( &pProcess->spare.timer,
+                              delay,
+                              SpawnStandby,
+                              pProcess );
+    }
+}
+
+/*============================================================================*/
+/*  SpawnStandby                                                              */
+/*!
+    Launch a warm standby
+
+    The SpawnStandby function is a timer handler which launches a
+    standby of a running process.  The standby is executed in the same
+    way as the process itself, so it pays for its exec, dynamic linking
+    and initialization up front, but it does not take the process lock.
+
+    The standby is passed the PROCMON_STANDBY_FD environment variable,
+    which is a socket it must block reading once it has initialized ( and
+    notified its readiness if the process uses the readiness protocol ).
+    When the process dies, the standby is released by writing to
+    the socket, and it takes over from the process.  If the socket is
+    closed instead, the standby is no longer required and must exit.
+
+    @param[in]
+        arg
+            pointer to the process to launch a standby for
+
+==============================================================================*/
+static void SpawnStandby( void *arg )
+{
+    Process *pProcess = (Process *)arg;
+    Standby *pStandby;
+    int fds[2];
+    int readyfds[2] = { -1, -1 };
+    int result = EOK;
+    pid_t pid;
+
+    if ( ( UsesStandby( pProcess ) ) &&
+         ( pProcess->spare.pid == 0 ) &&
+         ( pProcess->exitEvent.fd != -1 ) &&
+         ( pProcess->reloading == false ) &&
+         ( pProcess->stopping == false ) &&
+         ( pProcess->removed == false ) &&
+         ( pProcmonState->shuttingDown == false ) )
+    {
+        pStandby = &pProcess->spare;
+
+        /* the barrier is a socket, so releasing a standby which has
+         * died does not raise SIGPIPE */
+        if ( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) == 0 )
+        {
+            pStandby->barrierfd = fds[0];
+        }
+        else
+        {
+            result = errno;
+            fds[1] = -1;
+        }
+
+        if ( result == EOK )
+        {
+            pStandby->lockfd = STATETABLE_OpenLock();
+            if ( pStandby->lockfd == -1 )
+            {
+                result = errno;
+            }
+        }
+
+        if ( ( result == EOK ) && ( UsesReadiness( pProcess ) ) )
+        {
+            /* the standby notifies its readiness on its own pipe */
+            if ( pipe2( readyfds, O_CLOEXEC | O_NONBLOCK ) == 0 )
+            {
+                fcntl( readyfds[1], F_SETFL, 0 );
+
+                pStandby->readyEvent.fd = readyfds[0];
+                pStandby->readyEvent.handler = HandleStandbyReady;
+                pStandby->readyEvent.arg = pProcess;
+                if ( EVENTLOOP_Add( &pStandby->readyEvent, EPOLLIN ) != EOK )
+                {
+                    close( readyfds[0] );
+                    pStandby->readyEvent.fd = -1;
+                }
+            }
+        }
+
+        if ( result == EOK )
+        {
+            result = LaunchProcess( pProcess,
+                                    readyfds[1],
+                                    OpenLog( pProcess ),
+                                    fds[1],
+                                    &pid );
+        }
+
+        if ( result == EOK )
+        {
+            pStandby->pid = pid;
+            pStandby->ready = false;
+
+            pStandby->exitEvent.fd = syscall( SYS_pidfd_open, pid, 0 );
+            pStandby->exitEvent.handler = HandleStandbyExit;
+            pStandby->exitEvent.arg = pProcess;
+            if ( pStandby->exitEvent.fd == -1 )
+            {
+                result = errno;
+            }
+            else
+            {
+                result = EVENTLOOP_Add( &pStandby->exitEvent, EPOLLIN );
+            }
+
+            if ( result != EOK )
+            {
+                /* a standby which cannot be watched cannot be used */
+                (void)kill( pid, SIGKILL );
+                (void)waitpid( pid, NULL, 0 );
+                pStandby->pid = 0;
+            }
+            else if ( pProcess->verbose == true )
+            {
+                printf( "%s standby %d launched\n", pProcess->id, (int)pid );
+            }
+        }
+
+        /* only the standby needs its end of the barrier and the
+         * readiness pipe */
+        if ( fds[1] != -1 )
+        {
+            close( fds[1] );
+        }
+
+        if ( readyfds[1] != -1 )
+        {
+            close( readyfds[1] );
+        }
+
+        if ( result != EOK )
+        {
+            fprintf( stderr,
+                     "Failed to start standby for %s: %s\n",
+                     pProcess->id,
+                     strerror( result ) );
+
+            if ( pStandby->exitEvent.fd != -1 )
+            {
+                close( pStandby->exitEvent.fd );
+            }
+
+            CloseStandby( pStandby );
+            StartStandby( pProcess, PROCMON_STANDBY_DELAY );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleStandbyReady                                                        */
+/*!
+    Handle a readiness notification from a standby
+
+    The HandleStandbyReady function is an event loop handler which is
+    invoked when data is available on the readiness pipe of a standby.
+    A standby which has notified its readiness is ready as soon as it
+    is released.
+
+    @param[in]
+        pSource
+            pointer to the readiness pipe event source
+
+    @param[in]
+        events
+            epoll events (unused)
+
+==============================================================================*/
+static void HandleStandbyReady( EventSource *pSource, uint32_t events )
+{
+    Process *pProcess;
+    char buf[64];
+    ssize_t n;
+
+    if ( ( pSource != NULL ) && ( pSource->fd != -1 ) )
+    {
+        pProcess = (Process *)pSource->arg;
+
+        n = read( pSource->fd, buf, sizeof( buf ) - 1 );
+        if ( n > 0 )
+        {
+            buf[n] = '\0';
+            if ( strstr( buf, "READY" ) != NULL )
+            {
+                if ( pProcess->verbose == true )
+                {
+                    printf( "%s standby is ready\n", pProcess->id );
+                }
+
+                pProcess->spare.ready = true;
+                n = 0;
+            }
+        }
+
+        if ( ( n == 0 ) || ( ( n < 0 ) && ( errno != EAGAIN ) ) )
+        {
+            EVENTLOOP_Remove( pSource );
+            close( pSource->fd );
+            pSource->fd = -1;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HandleStandbyExit                                                         */
+/*!
+    Handle the death of a standby
+
+    The HandleStandbyExit function is an event loop handler which is
+    invoked when the pidfd of a standby becomes readable, indicating that
+    the standby has terminated before it was released.  The standby is
+    reaped, and a new standby is launched later if the process is still
+    running.  A process which was removed by a configuration reload is
+    freed once both it and its standby have stopped.
+
+    @param[in]
+        pSource
+            pointer to the standby exit event source
+
+    @param[in]
+        events
+            epoll events (unused)
+
+==============================================================================*/
+static void HandleStandbyExit( EventSource *pSource, uint32_t events )
+{
+    Process *pProcess;
+    Standby *pStandby;
+
+    if ( ( pSource != NULL ) && ( pSource->fd != -1 ) )
+    {
+        pProcess = (Process *)pSource->arg;
+        pStandby = &pProcess->spare;
+
+        EVENTLOOP_Remove( pSource );
+        close( pSource->fd );
+        pSource->fd = -1;
+
+        (void)waitpid( pStandby->pid, NULL, WNOHANG );
+
+        if ( ( pStandby->barrierfd != -1 ) || ( pProcess->verbose == true ) )
+        {
+            fprintf( stderr,
+                     "%s standby %d terminated\n",
+                     pProcess->id,
+                     (int)pStandby->pid );
+        }
+
+        CloseStandby( pStandby );
+
+        if ( pProcess->removed == true )
+        {
+            FreeRemovedProcess( pProcess );
+        }
+        else
+        {
+            StartStandby( pProcess, PROCMON_STANDBY_DELAY );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  PromoteStandby                                                            */
+/*!
+    Release a standby to take over from a process
+
+    The PromoteStandby function releases the warm standby of a process
+    which has died from its barrier.  The process state is prepared as
+    if the process had been started again, and the process lock is taken
+    on behalf of the standby through its lock handle, so the standby
+    owns the state record in the same way as a launched process.
+    A new standby is launched in the background.
+
+    @param[in]
+        pProcess
+            pointer to the process whose standby is to be released
+
+    @retval true - the standby has taken over from the process
+    @retval false - there is no standby to release
+
+==============================================================================*/
+static bool PromoteStandby( Process *pProcess )
+{
+    bool result = false;
+    Standby *pStandby;
+    StateRecord *pRecord;
+    bool ready;
+    pid_t pid;
+    int rc;
+
+    if ( ( UsesStandby( pProcess ) ) &&
+         ( pProcess->spare.pid > 0 ) &&
+         ( pProcess->spare.barrierfd != -1 ) &&
+         ( pProcess->exitEvent.fd == -1 ) )
+    {
+        pStandby = &pProcess->spare;
+
+        /* release the standby */
+        if ( send( pStandby->barrierfd, "GO\n", 3, MSG_NOSIGNAL ) == 3 )
+        {
+            pid = pStandby->pid;
+            ready = pStandby->ready;
+            result = true;
+
+            if ( pProcess->verbose == true )
+            {
+                printf( "%s standby %d released\n", pProcess->id, (int)pid );
+            }
+
+            prepare_state( pProcess );
+            pRecord = pProcess->pRecord;
+
+            rc = STATETABLE_LockHandle( pRecord, pStandby->lockfd );
+            if ( rc != EOK )
+            {
+                fprintf( stderr,
+                         "Failed to make lock for %s: %s\n",
+                         pProcess->id,
+                         strerror( rc ) );
+            }
+
+            if ( pRecord != NULL )
+            {
+                __atomic_store_n( &pRecord->data.pid, pid, __ATOMIC_RELEASE );
+            }
+
+            /* a standby which has not yet notified its readiness will
+             * notify it as the process */
+            CloseReadyPipe( pProcess );
+            if ( pStandby->readyEvent.fd != -1 )
+            {
+                EVENTLOOP_Remove( &pStandby->readyEvent );
+                pProcess->readyEvent.fd = pStandby->readyEvent.fd;
+                pProcess->readyEvent.handler = HandleReadyNotification;
+                pProcess->readyEvent.arg = pProcess;
+                pStandby->readyEvent.fd = -1;
+
+                if ( EVENTLOOP_Add( &pProcess->readyEvent, EPOLLIN ) != EOK )
+                {
+                    close( pProcess->readyEvent.fd );
+                    pProcess->readyEvent.fd = -1;
+                }
+            }
+
+            /* the standby is now watched as the process */
+            EVENTLOOP_Remove( &pStandby->exitEvent );
+            close( pStandby->exitEvent.fd );
+            pStandby->exitEvent.fd = -1;
+            CloseStandby( pStandby );
+
+            pProcess->startTime = EVENTLOOP_GetTime();
+            ProcessLaunched( pProcess, pid );
+
+            if ( ( ready == true ) && ( pProcess->started == false ) )
+            {
+                ProcessReady( pProcess );
+            }
+        }
+        else
+        {
+            /* the standby has gone, HandleStandbyExit will reap it */
+            StopStandby( pProcess );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StopStandby                                                               */
+/*!
+    Stop the standby of a process
+
+    The StopStandby function stops the warm standby of a process which
+    is no longer being restarted.  The barrier socket is closed and
+    the standby is killed, since it has not served any requests.
+    HandleStandbyExit reaps the standby.
+
+    @param[in]
+        pProcess
+            pointer to the process whose standby is to be stopped
+
+==============================================================================*/
+static void StopStandby( Process *pProcess )
+{
+    Standby *pStandby;
+
+    if ( pProcess != NULL )
+    {
+        pStandby = &pProcess->spare;
+        EVENTLOOP_StopTimer( &pStandby->timer );
+
+        if ( ( pStandby->pid > 0 ) && ( pStandby->barrierfd != -1 ) )
+        {
+            if ( pProcess->verbose == true )
+            {
+                printf( "stopping %s standby %d\n",
+                        pProcess->id,
+                        (int)pStandby->pid );
+            }
+
+            CloseStandby( pStandby );
+            (void)kill( pStandby->pid, SIGKILL );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  InitStandby                                                               */
+/*!
+    Initialize a standby object
+
+    @param[in]
+        pStandby
+            pointer to the standby object to initialize
+
+==============================================================================*/
+static void InitStandby( Standby *pStandby )
+{
+    if ( pStandby != NULL )
+    {
+        pStandby->pid = 0;
+        pStandby->barrierfd = -1;
+        pStandby->lockfd = -1;
+        pStandby->ready = false;
+        pStandby->exitEvent.fd = -1;
+        pStandby->readyEvent.fd = -1;
+    }
+}
+
+/*============================================================================*/
+/*  CloseStandby                                                              */
+/*!
+    Close the barrier, lock handle and readiness pipe of a standby
+
+    The CloseStandby function closes the process monitor's references to
+    a standby.  The pid and exit notification of a standby which has not
+    yet been reaped are kept.
+
+    @param[in]
+        pStandby
+            pointer to the standby to close
+
+==============================================================================*/
+static void CloseStandby( Standby *pStandby )
+{
+    if ( pStandby != NULL )
+    {
+        if ( pStandby->barrierfd != -1 )
+        {
+            close( pStandby->barrierfd );
+            pStandby->barrierfd = -1;
+        }
+
+        if ( pStandby->lockfd != -1 )
+        {
+            close( pStandby->lockfd );
+            pStandby->lockfd = -1;
+        }
+
+        if ( pStandby->readyEvent.fd != -1 )
+        {
+            EVENTLOOP_Remove( &pStandby->readyEvent );
+            close( pStandby->readyEvent.fd );
+            pStandby->readyEvent.fd = -1;
+        }
+
+        if ( pStandby->exitEvent.fd == -1 )
+        {
+            pStandby->pid = 0;
+        }
+
+        pStandby->ready = false;
+    }
+}
+
+/*============================================================================*/
+/*  InitCommandRelay                                                          */
+/*!
+    Initialize the command relay
+
+    The InitCommandRelay function creates an eventfd which is signalled
+    whenever a process monitoring command (start, stop, delete) is issued,
+    and adds it to the event loop.  Commands are signalled via a futex in
+    the shared state table, which cannot be waited on by the event loop,
+    so a relay thread waits on the futex and signals the eventfd.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @retval EOK - the command relay was created
+    @retval EINVAL - invalid arguments
+    @retval other - error from eventfd, epoll_ctl or pthread_create
+
+==============================================================================*/
+static int InitCommandRelay( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    if ( pProcmonState != NULL )
+    {
+        pProcmonState->commandEvent.fd = eventfd( 0,
+                                                  EFD_CLOEXEC | EFD_NONBLOCK );
+        if ( pProcmonState->commandEvent.fd != -1 )
+        {
+            pProcmonState->commandEvent.handler = HandleCommand;
+            pProcmonState->commandEvent.arg = pProcmonState;
+            result = EVENTLOOP_Add( &pProcmonState->commandEvent, EPOLLIN );
+        }
+        else
+        {
+            result = errno;
+        }
+
+        if ( result == EOK )
+        {
+            pthread_attr_init( &attr );
+            pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+            result = pthread_create( &thread,
+                                     &attr,
+                                     &CommandRelayThread,
+                                     &pProcmonState->commandEvent );
+            pthread_attr_destroy( &attr );
+        }
+
+        if ( ( result != EOK ) && ( pProcmonState->commandEvent.fd != -1 ) )
+        {
+            EVENTLOOP_Remove( &pProcmonState->commandEvent );
+            close( pProcmonState->commandEvent.fd );
+            pProcmonState->commandEvent.fd = -1;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CommandRelayThread                                                        */
+/*!
+    Relay process monitoring commands to the event loop
+
+    The CommandRelayThread function blocks on the state table command
+    futex, and signals the command eventfd each time the command
+    sequence number changes.
+
+    @param[in]
+        arg
+            pointer to the command event source
+
+    @retval NULL - the thread does not return
+
+==============================================================================*/
+static void *CommandRelayThread( void *arg )
+{
+    EventSource *pSource = (EventSource *)arg;
+    uint32_t sequence;
+    uint32_t current;
+    uint64_t n = 1;
+
+    if ( pSource != NULL )
+    {
+        sequence = STATETABLE_GetSequence();
+
+        while ( 1 )
+        {
+            STATETABLE_Wait( sequence );
+
+            current = STATETABLE_GetSequence();
+            if ( current != sequence )
+            {
+                sequence = current;
+                if ( write( pSource->fd, &n, sizeof( n ) ) != sizeof( n ) )
+                {
+                    /* the eventfd counter is already signalled */
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  HandleCommand                                                             */
+/*!
+    Handle a process monitoring command
+
+    The HandleCommand function is invoked from the event loop when a
+    process monitoring command has been issued.  It re-checks the state
+    of all processes whose monitoring has been suspended, so they are
+    (re)started or removed as soon as a command is issued.  A pending
+    restart of a process which has been suspended or stopped by the
+    command is cancelled.  Commands to running processes are handled
+    via process death.
+
+    @param[in]
+        pSource
+            pointer to the command event source
+
+    @param[in]
+        events
+            epoll events which are ready
+
+==============================================================================*/
+static void HandleCommand( EventSource *pSource, uint32_t events )
+{
+    ProcmonState *pState;
+    Process *pProcess;
+    uint64_t n;
+    size_t i;
+
+    if ( pSource != NULL )
+    {
+        pState = (ProcmonState *)pSource->arg;
+
+        /* clear the eventfd counter */
+        if ( ( read( pSource->fd, &n, sizeof( n ) ) == sizeof( n ) ) &&
+             ( pState != NULL ) &&
+             ( pState->shuttingDown == false ) )
+        {
+            for ( i = 0 ; i < pState->processes.count ; i++ )
+            {
+                pProcess = pState->processes.pProcesses[i];
+                if ( pProcess->suspended == true )
+                {
+                    pProcess->suspended = false;
+                    SuperviseProcess( pProcess );
+                }
+                else if ( ( pProcess->restartTimer.active == true ) &&
+                          ( get_pid_from_state( pProcess->id ) < 0 ) )
+                {
+                    /* the process is waiting out its restart delay */
+                    EVENTLOOP_StopTimer( &pProcess->restartTimer );
+                    SuperviseProcess( pProcess );
+                }
+            }
+
+            pProcess = pState->pMonitoredProcess;
+            if ( ( pProcess != NULL ) && ( pProcess->suspended == true ) )
+            {
+                pProcess->suspended = false;
+                SupervisePeer( pProcess );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  RestartDependents                                                         */
+/*!
+    Restart all dependent processes (if applicable)
+
+    The RestartDependents function checks and restarts each of the
+    dependent processes of the specified process if they meet the
+    following conditions:
+
+        - the dependent process has the "restart_on_parent_death" flag set
+        - the dependent process does not have the "skip" flag set
+        - the dependent process has been initialized
+
+    When processes are supervised by the event loop, the whole subtree
+    of dependents is restarted at once by RestartSubtree.
+
+    @param[in]
+        pProcess
+            pointer to the process whose dependents should be restarted
+
+    @retval EOK - all dependent processes were sent a restart signal
+    @retval EINVAL - invalid arguments
+    @retval other - error if dependent's process state could not be accessed
+
+==============================================================================*/
+static int RestartDependents( Process *pProcess )
+{
+    int result = EINVAL;
+    size_t i;
+    int rc;
+    int wait;
+
+    if ( pProcess != NULL )
+    {
+        result = EOK;
+
+        /* iterate through all dependent processes and restart them
+         * if necessary */
+        /* a process using the readiness protocol is already ready
+         * so its dependents do not need to wait for it */
+        wait = UsesReadiness( pProcess ) ? 0 : pProcess->wait;
+
+        if ( UsesActivation( pProcess ) )
+        {
+            /* the dependents of a socket activated process keep their
+             * connections to its listening sockets, which remain open
+             * while the process is restarted */
+        }
+        else if ( pProcmonState->supervisor == true )
+        {
+            RestartSubtree( pProcess, wait );
+        }
+        else
+        {
+            for ( i = 0 ; i < pProcess->children.count ; i++ )
+            {
+                rc = RestartDependent( pProcess->children.pProcesses[i],
+                                       wait );
+                if ( rc != EOK )
+                {
+                    result = EOK;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RestartDependent                                                          */
+/*!
+    Restart a dependent process
+
+    The RestartDependent function checks and restarts a dependent
+    process if it meets the following conditions:
+
+        - the dependent process has the "restart_on_parent_death" flag set
+        - the dependent process does not have the "skip" flag set
+        - the dependent process has been initialized
+
+    @param[in]
+        pProcess
+            pointer to the dependent process to restart
+
+    @param[in]
+        wait
+            optional time to wait after the processes death is detected
+            before the new process is spawned.  0=no wait
+
+    @retval EOK - the dependent process was sent a restart signal
+    @retval EINVAL - invalid arguments
+    @retval other - error if dependent process state could not be accessed
+
+==============================================================================*/
+static int RestartDependent( Process *pProcess, int wait )
+{
+   int result = EINVAL;
+
+   if ( pProcess != NULL )
+   {
+       result = EOK;
+
+       if ( pProcess->restart_on_parent_death &&
+            pProcess->skip == false &&
+            ( pProcess->state != PROCSTATE_eINIT ) )
+       {
+           /* set delay after process death detection before process will
+            * be initiated */
+           pProcess->restart_delay = wait;
+
+           /* restart the process */
+           if ( pProcess->monitored )
+           {
+               /* the restart does not count against the restart budget */
+               pProcess->restarting = true;
+               result = restart( pProcess->id );
+               if ( result != EOK )
+               {
+                   pProcess->restarting = false;
+               }
+           }
+           else
+           {
+               result = InitProcess( pProcess );
+           }
+       }
+   }
+
+   return result;
+}
+
+/*============================================================================*/
+/*  RestartSubtree                                                            */
+/*!
+    Restart the subtree of dependents of a restarted process
+
+    The RestartSubtree function is invoked when a supervised process has
+    been restarted.  It collects the transitive closure of its dependents
+    which must be restarted with it ( see SubtreeRestartRequired ), so a
+    dependent which is shared by several restarted processes is only
+    restarted once.
+
+    The subtree is stopped in reverse topological order, dependents
+    before the processes they depend on.  Once all of the subtree has
+    stopped, and the wait time of the restarted process has elapsed,
+    the subtree is started again by the startup scheduler, which starts
+    independent branches of the subtree in parallel.
+
+    A subtree restart which is requested while another one is in
+    progress is merged into it.
+
+    @param[in]
+        pProcess
+            pointer to the process which was restarted
+
+    @param[in]
+        wait
+            time (in seconds) to wait for the restarted process before
+            starting its subtree
+
+==============================================================================*/
+static void RestartSubtree( Process *pProcess, int wait )
+{
+    ProcessList subtree;
+    size_t i;
+
+    if ( pProcess != NULL )
+    {
+        memset( &subtree, 0, sizeof( subtree ) );
+
+        /* the subtree is collected in reverse topological order */
+        for ( i = 0 ; i < pProcess->children.count ; i++ )
+        {
+            CollectSubtree( pProcess->children.pProcesses[i], &subtree );
+        }
+
+        if ( subtree.count > 0 )
+        {
+            if ( pProcess->verbose == true )
+            {
+                printf( "Restarting %zu dependents of %s\n",
+                        subtree.count,
+                        pProcess->id );
+            }
+
+            for ( i = 0 ; i < subtree.count ; i++ )
+            {
+                StopSubtreeProcess( subtree.pProcesses[i] );
+            }
+
+            /* wait for the restarted process before starting its subtree */
+            EVENTLOOP_StartTimer( &pProcmonState->subtreeTimer,
+                                  (int64_t)wait * 1000,
+                                  SubtreeStopped,
+                                  pProcmonState );
+        }
+
+        free( subtree.pProcesses );
+    }
+}
+
+/*============================================================================*/
+/*  SubtreeRestartRequired                                                    */
+/*!
+    Check if a dependent process must be restarted with its parent
+
+    The SubtreeRestartRequired function checks if a dependent of a
+    restarted process must be restarted.  The dependent is restarted if:
+
+        - the dependent process has the "restart_on_parent_death" flag set
+        - the dependent process does not have the "skip" flag set
+        - the dependent process has completed its initial startup
+        - the dependent process is not already being restarted
+        - monitoring of the dependent process has not been suspended
+        - the dependent process has not failed
+
+    @param[in]
+        pProcess
+            pointer to the dependent process
+
+    @retval true - the dependent process must be restarted
+    @retval false - the dependent process is not restarted
+
+==============================================================================*/
+static bool SubtreeRestartRequired( Process *pProcess )
+{
+    return ( pProcess != NULL ) &&
+           ( pProcess->restart_on_parent_death == true ) &&
+           ( pProcess->skip == false ) &&
+           ( pProcess->started == true ) &&
+           ( pProcess->state != PROCSTATE_eINIT ) &&
+           ( pProcess->suspended == false ) &&
+           ( pProcess->state != PROCSTATE_eFAILED );
+}
+
+/*============================================================================*/
+/*  CollectSubtree                                                            */
+/*!
+    Collect a subtree of processes to restart
+
+    The CollectSubtree function adds a dependent process which must be
+    restarted, and all of its dependents which must be restarted with
+    it, to the subtree list.  Each process is added after all of its
+    collected dependents, so the list is in reverse topological order.
+
+    A collected process is returned to PROCSTATE_eINIT so it is not
+    collected again, and is started again by the startup scheduler.
+
+    @param[in]
+        pProcess
+            pointer to the dependent process to collect
+
+    @param[in,out]
+        pList
+            pointer to the subtree list
+
+==============================================================================*/
+static void CollectSubtree( Process *pProcess, ProcessList *pList )
+{
+    size_t i;
+
+    if ( SubtreeRestartRequired( pProcess ) )
+    {
+        pProcess->state = PROCSTATE_eINIT;
+        pProcess->started = false;
+
+        for ( i = 0 ; i < pProcess->children.count ; i++ )
+        {
+            CollectSubtree( pProcess->children.pProcesses[i], pList );
+        }
+
+        (void)AppendProcess( pList, pProcess );
+    }
+}
+
+/*============================================================================*/
+/*  StopSubtreeProcess                                                        */
+/*!
+    Stop a process of a subtree restart
+
+    The StopSubtreeProcess function stops a collected process so it can
+    be started again by the startup scheduler.  A running process is
+    stopped by StopProcess, and HandleProcessExit invokes SubtreeStopped
+    once it has terminated.  Pending restarts and readiness timeouts of
+    the process are cancelled.
+
+    @param[in]
+        pProcess
+            pointer to the process to stop
+
+==============================================================================*/
+static void StopSubtreeProcess( Process *pProcess )
+{
+    if ( pProcess != NULL )
+    {
+        EVENTLOOP_StopTimer( &pProcess->restartTimer );
+        EVENTLOOP_StopTimer( &pProcess->readyTimer );
+        pProcess->awaitingReady = false;
+
+        /* the restart does not count against the restart budget */
+        pProcess->restarting = true;
+
+        if ( pProcess->exitEvent.fd == -1 )
+        {
+            /* the process is not running */
+            pProcess->supervised = false;
+        }
+        else
+        {
+            if ( pProcess->stopping == false )
+            {
+                pProcess->stopping = true;
+                pProcmonState->subtreeStopping++;
+            }
+
+            StopProcess( pProcess );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  SubtreeStopped                                                            */
+/*!
+    Start a stopped subtree
+
+    The SubtreeStopped function is invoked when a process of a subtree
+    restart has stopped, and as the timer handler of the restarted
+    parent's wait time.  Once the whole subtree has stopped and the wait
+    time has elapsed, the subtree is started by the startup scheduler.
+
+    @param[in]
+        arg
+            pointer to the process monitor state
+
+==============================================================================*/
+static void SubtreeStopped( void *arg )
+{
+    ProcmonState *pState = (ProcmonState *)arg;
+
+    if ( ( pState != NULL ) &&
+         ( pState->subtreeStopping == 0 ) &&
+         ( pState->subtreeTimer.active == false ) )
+    {
+        ScheduleProcesses( pState );
+    }
+}
+
+/*============================================================================*/
+/*  GetParentRuncount                                                         */
+/*!
+    Get the parent runcount
+
+    The GetParentRuncount function gets the largest runcount from all of the
+    processes parents.
+
+    @param[in]
+        pProcess
+            pointer to a process to get the parent runcount for
+
+    @retval count of number of times this processes parents have been run
+
+==============================================================================*/
+static size_t GetParentRuncount( Process *pProcess )
+{
+    size_t runcount = 0;
+    Process *pParent;
+    size_t i;
+
+    if ( pProcess != NULL )
+    {
+        for ( i = 0 ; i < pProcess->parents.count ; i++ )
+        {
+            pParent = pProcess->parents.pProcesses[i];
+            if( pParent->runcount > runcount )
+            {
+                runcount = pParent->runcount;
+            }
+        }
+    }
+
+    return runcount;
+}
+
+/*============================================================================*/
+/*  RestartAllowed                                                            */
+/*!
+    Check if a process may be (re)started
+
+    The RestartAllowed function determines if a process which is not
+    running may be started, and how long to wait before starting it.
+
+    Restarts of a monitored process which crashed are counted against the
+    process restart budget.  If the process has been restarted more than
+    restart_limit times within the restart window, the process is
+    considered failed and is not restarted until it is started again
+    using the start command.  Consecutive crash restarts are delayed
+    using an exponential backoff.
+
+    Initial starts, and restarts due to the restart of a parent, are
+    not counted against the restart budget.
+
+    @param[in]
+        pProcess
+            pointer to the process to check
+
+    @param[out]
+        pDelay
+            pointer to a location to store the delay (in milliseconds)
+            before the process is started
+
+    @retval true - the process may be started after the delay
+    @retval false - the process has failed and must not be restarted
+
+==============================================================================*/
+static bool RestartAllowed( Process *pProcess, int64_t *pDelay )
+{
+    bool allowed = false;
+    int64_t now;
+    int64_t delay = 0;
+    int64_t backoff;
+
+    if ( pProcess != NULL )
+    {
+        allowed = true;
+        now = EVENTLOOP_GetTime();
+        delay = (int64_t)pProcess->restart_delay * 1000;
+
+        if ( pProcess->state == PROCSTATE_eFAILED )
+        {
+            if ( ( pProcess->pRecord != NULL ) &&
+                 ( __atomic_load_n( &pProcess->pRecord->data.failed,
+                                    __ATOMIC_ACQUIRE ) != 0 ) )
+            {
+                /* wait for the start command to clear the failure */
+                allowed = false;
+            }
+            else
+            {
+                /* the process was started again, reset the restart budget */
+                pProcess->state = PROCSTATE_eSTARTED;
+                pProcess->crashes = 0;
+                pProcess->windowRestarts = 0;
+                pProcess->windowStart = now;
+            }
+        }
+        else if ( pProcess->restarting == true )
+        {
+            /* restart requested due to the restart of the parent */
+            pProcess->restarting = false;
+        }
+        else if ( ( pProcess->monitored == true ) &&
+                  ( pProcess->runcount > 0 ) )
+        {
+            /* the process crashed */
+            if ( pProcess->restart_limit > 0 )
+            {
+                if ( now - pProcess->windowStart >=
+                     (int64_t)pProcess->restart_window * 1000 )
+                {
+                    /* start a new restart window */
+                    pProcess->windowStart = now;
+                    pProcess->windowRestarts = 0;
+                }
+
+                if ( ++pProcess->windowRestarts > pProcess->restart_limit )
+                {
+                    FailProcess( pProcess );
+                    allowed = false;
+                }
+            }
+
+            /* GetBackoffDelay counts the crash, so it is called once */
+            backoff = GetBackoffDelay( pProcess );
+            if ( backoff > delay )
+            {
+                delay = backoff;
+            }
+        }
+    }
+
+    if ( pDelay != NULL )
+    {
+        *pDelay = delay;
+    }
+
+    return allowed;
+}
+
+/*============================================================================*/
+/*  GetBackoffDelay                                                           */
+/*!
+    Get the restart backoff delay of a crashed process
+
+    The GetBackoffDelay function updates the consecutive crash count
+    of a process which has crashed, and calculates its restart backoff
+    delay.  The delay starts at one second on the second consecutive
+    crash and doubles with each crash up to the restart_backoff_max
+    limit.  Up to a quarter of the delay is randomly removed so that
+    processes which crashed together are not restarted together.
+
+    The consecutive crash count is reset once the process has run for
+    longer than the maximum backoff delay.
+
+    @param[in]
+        pProcess
+            pointer to the process which crashed
+
+    @retval the restart backoff delay in milliseconds
+
+==============================================================================*/
+static int64_t GetBackoffDelay( Process *pProcess )
+{
+    int64_t delay = 0;
+    int64_t max;
+
+    if ( ( pProcess != NULL ) && ( pProcess->restart_backoff_max > 0 ) )
+    {
+        max = (int64_t)pProcess->restart_backoff_max * 1000;
+
+        if ( EVENTLOOP_GetTime() - pProcess->startTime >= max )
+        {
+            /* the process ran long enough to be considered healthy */
+            pProcess->crashes = 0;
+        }
+
+        if ( pProcess->crashes++ > 0 )
+        {
+            delay = (int64_t)1000 << ( pProcess->crashes < 32
+                                        ? pProcess->crashes - 2
+                                        : 30 );
+            if ( delay > max )
+            {
+                delay = max;
+            }
+
+            /* add jitter */
+            delay -= rand_r( &pProcess->seed ) % ( delay / 4 + 1 );
+        }
+    }
+
+    return delay;
+}
+
+/*============================================================================*/
+/*  FailProcess                                                               */
+/*!
+    Mark a process as failed
+
+    The FailProcess function is invoked when a process has exhausted its
+    restart budget.  The failure is recorded in the process state so it
+    is visible to the process list, and is reported via syslog and to the
+    cluster aggregator.
+
+    @param[in]
+        pProcess
+            pointer to the process which failed
+
+==============================================================================*/
+static void FailProcess( Process *pProcess )
+{
+    if ( pProcess != NULL )
+    {
+        pProcess->state = PROCSTATE_eFAILED;
+
+        if ( pProcess->pRecord != NULL )
+        {
+            __atomic_store_n( &pProcess->pRecord->data.failed,
+                              1,
+                              __ATOMIC_RELEASE );
+        }
+
+        (void)CLUSTER_Send( &pProcmonState->agent,
+                            "failed %s",
+                            pProcess->id );
+
+        fprintf( stderr,
+                 "%s failed: restarted more than %d times in %d seconds\n",
+                 pProcess->id,
+                 pProcess->restart_limit,
+                 pProcess->restart_window );
+
+        syslog( LOG_ERR,
+                "%s failed: restarted more than %d times in %d seconds",
+                pProcess->id,
+                pProcess->restart_limit,
+                pProcess->restart_window );
+    }
+}
+
+/*============================================================================*/
+/*  Monitor                                                                   */
+/*!
+    Monitor a process and wait for process death
+
+    The Monitor function looks up the process state record and then tries
+    to create a write lock on the record, which it will not be able to do
+    while the process is alive.  This monitor function will then block
+    until it CAN place a write lock on the record, indicating that the
+    process which owns the record lock has terminated (died).  It will
+    then remove its lock on the record and exit allowing the calling
+    function to restart the process if necessary.
+
+    @param[in]
+        name
+            name of the process to monitor
+
+==============================================================================*/
+static void Monitor( char *name )
+{
+    StateRecord *pRecord;
+    int rc;
+
+    if ( name != NULL )
+    {
+        pRecord = STATETABLE_Find( name );
+        if ( pRecord != NULL )
+        {
+            /* wait for process to exit */
+            while ( 1 )
+            {
+                rc = waitlock( pRecord );
+                if ( rc == EOK )
+                {
+                    /* process exited */
+                    unlock( pRecord );
+                    break;
+                }
+                else if ( rc == EDEADLK )
+                {
+                    /* we need to check for deadlock in the case
+                     * where the procmon primary and secondary processes
+                     * are trying to lock each other.  In this case, we
+                     * revert to polling once/second */
+                    sleep(1);
+                }
+                else
+                {
+                    fprintf( stderr,
+                             "Error getting process lock: %s\n",
+                             strerror( rc ) );
+                    break;
+                }
+            }
+        }
+        else
+        {
+            fprintf( stderr,
+                     "Failed to start monitoring on process %s\n",
+                     name );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  makelock                                                                  */
+/*!
+    Create a process lock
+
+    The makelock function creates a process lock for the
+    specified process.  This lock is used to detect process death.
+    The lock is taken through a lock handle, so that it is not released
+    when the process closes another file descriptor of the state table.
+
+    @param[in]
+        pProcess
+            pointer to the process to make a lock for
+
+    @param[in]
+        fd
+            lock handle opened with STATETABLE_OpenLock
+
+    @retval EOK - this process is running
+    @retval EINVAL - invalid arguments
+    @retval other error returned by fcntl
+
+==============================================================================*/
+static int makelock( Process *pProcess, int fd )
+{
+    StateRecord *pRecord;
+    int rc = EINVAL;
+    bool created;
+    pid_t pid;
+    char *name;
+
+    if ( pProcess != NULL )
+    {
+        pid = pProcess->pid;
+        name = pProcess->id;
+
+        if ( pProcess->verbose == true )
+        {
+            printf("makelock: %s (%d)\n", name, pid );
+        }
+
+        /* get the state record associated with the monitored process */
+        pRecord = STATETABLE_Add( name, &created );
+        if ( pRecord != NULL )
+        {
+            /* increment the run count */
+            pRecord->data.runcount = created ? 1 : pRecord->data.runcount + 1;
+
+            /* set the start time */
+            pRecord->data.starttime = time(NULL);
+
+            /* the process is being started so it has not failed */
+            __atomic_store_n( &pRecord->data.failed, 0, __ATOMIC_RELEASE );
+
+            /* the commands use the stop attributes to stop the process */
+            pRecord->data.stopSignal = pProcess->stopSignal;
+            pRecord->data.stopTimeout = pProcess->stopTimeout;
+
+            /* set the executable name/args */
+            if ( pProcess->exec != NULL )
+            {
+                strncpy( pRecord->exec,
+                         pProcess->exec,
+                         sizeof( pRecord->exec ) - 1 );
+            }
+
+            /* set the process identifier */
+            __atomic_store_n( &pRecord->data.pid, pid, __ATOMIC_RELEASE );
+
+            /* establish a lock on the record */
+            rc = STATETABLE_LockHandle( pRecord, fd );
+        }
+        else
+        {
+            rc = errno;
+        }
+    }
+
+    return rc;
+}
+
+/*============================================================================*/
+/*  waitlock                                                                  */
+/*!
+    Try to set a write lock for the specified state record
+
+    The waitlock function will try to set a write lock on the
+    state record associated with a running process.
+    If the process is healthy, IT will have a write lock on the
+    record.  If the process which owns the record lock is dead,
+    then the waitlock will complete indicating that the
+    process can be restarted.
+
+    This function will block until process death
+
+    @param[in]
+        pRecord
+            state record of the process to monitor for death
+
+    @retval EOK - this process has died
+    @retval EINVAL - invalid arguments
+    @retval other error returned by fcntl
+
+==============================================================================*/
+static int waitlock( StateRecord *pRecord )
+{
+    return STATETABLE_Lock( pRecord, F_SETLKW );
+}
+
+/*============================================================================*/
+/*  unlock                                                                    */
+/*!
+    Unlock the process state record
+
+    The unlock function will try to unlock the state record associated
+    with the monitored process.
+
+    @param[in]
+        pRecord
+            state record of the monitored process
+
+    @retval EOK - lock action was successful
+    @retval EINVAL - invalid arguments
+    @retval other error returned by fcntl
+
+==============================================================================*/
+static int unlock( StateRecord *pRecord )
+{
+    return STATETABLE_Lock( pRecord, F_UNLCK );
+}
+
+/*============================================================================*/
+/*  prepare_state                                                             */
+/*!
+    Prepare the process state before the process is started
+
+    The prepare_state function is invoked by the process monitor before
+    it forks a monitored process.  It creates the process state record if
+    it does not exist, or updates the run count and start time of an
+    existing record.  The process lock on the record is taken for the
+    process through the lock handle it is launched with.
+
+    Since the state record exists before the process is started, the
+    process monitor can start monitoring the process without waiting
+    for the process to create its own state record.
+
+    @param[in]
+        pProcess
+            pointer to the process to prepare the state record for
+
+    @retval EOK - the process state record was prepared
+    @retval EINVAL - invalid arguments
+    @retval other - the state record could not be created
+
+==============================================================================*/
+static int prepare_state( Process *pProcess )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+    bool created;
+
+    if ( pProcess != NULL )
+    {
+        /* the process is not running until it has been launched */
+        pProcess->pid = 0;
+
+        pRecord = STATETABLE_Add( pProcess->id, &created );
+        if ( pRecord != NULL )
+        {
+            /* increment the run count */
+            pRecord->data.runcount = created ? 1 : pRecord->data.runcount + 1;
+
+            /* clear the process identifier until the child records it */
+            __atomic_store_n( &pRecord->data.pid, 0, __ATOMIC_RELEASE );
+
+            /* set the start time */
+            pRecord->data.starttime = time(NULL);
+
+            /* the process is being started so it has not failed */
+            __atomic_store_n( &pRecord->data.failed, 0, __ATOMIC_RELEASE );
+
+            /* the commands use the stop attributes to stop the process */
+            pRecord->data.stopSignal = pProcess->stopSignal;
+            pRecord->data.stopTimeout = pProcess->stopTimeout;
+
+            /* set the executable name/args */
+            if ( pProcess->exec != NULL )
+            {
+                strncpy( pRecord->exec,
+                         pProcess->exec,
+                         sizeof( pRecord->exec ) - 1 );
+            }
+
+            pProcess->pRecord = pRecord;
+            result = EOK;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  get_pid_from_state                                                        */
+/*!
+    read process id from the process state
+
+    The get_pid_from_state function looks up the state record
+    associated with the specified process name, and then
+    reads the process id from the record.
+
+    The pid is then checked to see if the process exists by invoking
+    kill(pid, 0)
+
+    @param[in]
+        name
+            name of the process to get the process id for
+
+    @retval pid - process id contained within the process state record
+    @retval 0 - process is not running (or has no state record)
+    @retval -1 - process monitoring is suspended
+    @retval -2 - process monitoring is stopped
+
+==============================================================================*/
+static pid_t get_pid_from_state( char *name )
+{
+    StateRecord *pRecord;
+    uint32_t terminate;
+    pid_t pid = 0;
+
+    if ( name != NULL )
+    {
+        pRecord = STATETABLE_Find( name );
+        if ( pRecord != NULL )
+        {
+            pid = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
+            terminate = __atomic_load_n( &pRecord->data.terminate,
+                                         __ATOMIC_ACQUIRE );
+
+            if ( terminate == STATETABLE_SUSPEND )
+            {
+                /* suspend monitoring */
+                pid = -1;
+            }
+
+            if ( terminate == STATETABLE_STOP )
+            {
+                /* abort monitoring */
+                pid = -2;
+            }
+        }
+
+        if ( pid > 0 )
+        {
+            /* check if the PID exists */
+            if ( kill( pid, 0 ) == -1 )
+            {
+                if ( errno == ESRCH )
+                {
+                    pid = 0;
+                }
+            }
+        }
+
+    }
+
+    return pid;
+}
+
+/*============================================================================*/
+/*  ForEachInstance                                                           */
+/*!
+    Apply a process command to a process or a replica group
+
+    The ForEachInstance function applies a process command to the named
+    process.  If there is no process with that name, but there are
+    instances of a replica group with that name, the command is applied
+    to each instance of the group.
+
+    @param[in]
+        name
+            name of the process or replica group
+
+    @param[in]
+        fn
+            pointer to the process command
+
+    @retval EOK - the command was applied to the process or each
+                  instance of the group
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has no process state record
+    @retval ENOMEM - memory allocation failure
+    @retval other - the error from the command for the process, or the
+                    last error from the command for an instance
+
+==============================================================================*/
+static int ForEachInstance( char *name, int (*fn)( char *name ) )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+    char (*pIds)[STATETABLE_ID_LEN];
+    size_t count;
+    size_t n = 0;
+    size_t i;
+    int rc;
+
+    if ( ( name != NULL ) && ( fn != NULL ) )
+    {
+        if ( STATETABLE_Find( name ) != NULL )
+        {
+            result = fn( name );
+        }
+        else
+        {
+            /* collect the instances before applying the command, as the
+             * command may remove their state records */
+            count = STATETABLE_Count();
+            pIds = calloc( count + 1, STATETABLE_ID_LEN );
+            if ( pIds != NULL )
+            {
+                for ( i = 0 ; i < count ; i++ )
+                {
+                    pRecord = STATETABLE_Get( i );
+                    if ( ( pRecord != NULL ) &&
+                         ( IsInstance( pRecord->id, name ) ) )
+                    {
+                        strncpy( pIds[n], pRecord->id, STATETABLE_ID_LEN - 1 );
+                        n++;
+                    }
+                }
+
+                result = ( n > 0 ) ? EOK : ENOENT;
+                for ( i = 0 ; i < n ; i++ )
+                {
+                    rc = fn( pIds[i] );
+                    if ( rc != EOK )
+                    {
+                        result = rc;
+                    }
+                }
+
+                free( pIds );
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  start                                                                     */
+/*!
+    start the specified process
+
+    The start function tries to start the named monitored process.
+    Only processes which have a process state record and are known
+    to the process monitor (via the configuration file) can be started.
+
+    To start a monitored process, we remove the special terminate
+    instruction from the process state, allowing the process to be
+    re-started by the process monitor.
+
+    @param[in]
+        name
+            name of the process to start
+
+    @retval EOK - the process will be restarted by the process monitor
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has no process state record
+
+==============================================================================*/
+static int start( char *name )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+
+    if ( name != NULL )
+    {
+        pRecord = STATETABLE_Find( name );
+        if ( pRecord != NULL )
+        {
+            /* clear the terminate instruction and any failure */
+            __atomic_store_n( &pRecord->data.terminate, 0, __ATOMIC_RELEASE );
+            __atomic_store_n( &pRecord->data.failed, 0, __ATOMIC_RELEASE );
+
+            /* wake up the process monitors */
+            result = STATETABLE_Notify();
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  restart                                                                   */
+/*!
+    restart the specified process
+
+    The restart function tries to restart the named monitored process
+    by stopping it with StopPid and letting the process monitor
+    restart it.
+
+    @param[in]
+        name
+            name of the process to restart
+
+    @retval EOK - the process will be restarted by the monitoring thread
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has no process state record
+
+==============================================================================*/
+static int restart( char *name )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+    pid_t pid;
+
+    if ( name != NULL )
+    {
+        printf("restarting %s\n", name );
+
+        pRecord = STATETABLE_Find( name );
+        if ( pRecord != NULL )
+        {
+            /* get the process id from the process state */
+            pid = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
+
+            /* terminate the process */
+            if ( pid <= 0 )
+            {
+                /* the process has not yet taken its lock */
+                result = ESRCH;
+            }
+            else
+            {
+                result = StopPid( pid,
+                                  pRecord->data.stopSignal,
+                                  pRecord->data.stopTimeout );
+            }
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  heartbeat                                                                 */
+/*!
+    record a heartbeat for the specified process
+
+    The heartbeat function increments the heartbeat counter in the
+    state record of the named monitored process.  A process which has
+    a heartbeat health check must record a heartbeat at least once per
+    health check interval, for example by running procmon -b.
+
+    @param[in]
+        name
+            name of the process to record a heartbeat for
+
+    @retval EOK - the heartbeat was recorded
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has no process state record
+
+==============================================================================*/
+static int heartbeat( char *name )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+
+    if ( name != NULL )
+    {
+        pRecord = STATETABLE_Find( name );
+        if ( pRecord != NULL )
+        {
+            (void)__atomic_add_fetch( &pRecord->data.heartbeat,
+                                      1,
+                                      __ATOMIC_RELEASE );
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  terminate_and_stop_monitoring                                             */
+/*!
+    terminate the specified process
+
+    The terminate function tries to terminate the named
+    monitored process. Only processes which have a process state record
+    can be terminated.
+
+    To terminate a monitored process, we write a special terminate
+    instruction into the process state and then stop the process with
+    its stop signal.  The process monitor will notice the termination
+    instruction and not try to restart the process.
+
+    After the process has been terminated, its process state will be
+    permanently removed so it cannot be restarted.
+
+    @param[in]
+        name
+            name of the process to terminate
+
+    @retval EOK - the process was stopped
+    @retval error code indicating inability to kill the process
+
+==============================================================================*/
+static int terminate_and_stop_monitoring( char *name )
+{
+    return terminate_command( name, STATETABLE_STOP );
+}
+
+/*============================================================================*/
+/*  terminate                                                                 */
+/*!
+    terminate the specified process
+
+    The terminate function tries to terminate the named
+    monitored process. Only processes which have a process state record
+    can be terminated.
+
+    To terminate a monitored process, we write a special terminate
+    instruction into the process state and then stop the process with
+    its stop signal.  The process monitor will notice the termination
+    instruction and not try to restart the process.
+
+    @param[in]
+        name
+            name of the process to terminate
+
+    @retval EOK - the process was stopped
+    @retval error code indicating inability to kill the process
+
+==============================================================================*/
+static int terminate( char *name )
+{
+    return terminate_command( name, STATETABLE_SUSPEND );
+}
+
+/*============================================================================*/
+/*  terminate_command                                                         */
+/*!
+    terminate the specified process
+
+    The terminate_command function tries to terminate the named
+    monitored process. Only processes which have a process state record
+    can be terminated.
+
+    To terminate a monitored process, we write a special terminate
+    instruction into the process state and then stop the process with
+    StopPid.  The process monitor will notice the termination
+    instruction and not try to restart the process.
+
+    See the cmd argument for a description of the termination modes.
+
+    @param[in]
+        name
+            name of the process to terminate
+
+    @param[in]
+        cmd
+            the terminate command to use:
+
+            - STATETABLE_SUSPEND = terminate and suspend monitoring
+            - STATETABLE_STOP = terminate and stop monitoring
+
+    @retval EOK - kill signal was successfully sent to the process
+    @retval ENOENT - the process has no process state record
+    @retval error code indicating inability to kill the process
+
+==============================================================================*/
+static int terminate_command( char *name, uint32_t cmd )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+    pid_t pid;
+
+    if ( name != NULL )
+    {
+        pRecord = STATETABLE_Find( name );
+        if ( pRecord != NULL )
+        {
+            /* get the process id */
+            pid = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
+
+            /* reset the start time in the process state */
+            ResetStartTime( pRecord );
+
+            /* write the terminate command into the process state */
+            __atomic_store_n( &pRecord->data.terminate,
+                              cmd,
+                              __ATOMIC_RELEASE );
+
+            /* terminate the process */
+            result = ( pid > 0 ) ? StopPid( pid,
+                                            pRecord->data.stopSignal,
+                                            pRecord->data.stopTimeout )
+                                 : EOK;
+
+            /* wake up the process monitors */
+            STATETABLE_Notify();
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StopPid                                                                   */
+/*!
+    Stop a process by its process id
+
+    The StopPid function is used by the procmon commands to stop a
+    monitored process.  The process is sent its stop signal, and is
+    killed with SIGKILL if it has not terminated when its stop timeout
+    expires.  A process with a stop timeout of 0 is killed immediately.
+
+    @param[in]
+        pid
+            process id of the process to stop
+
+    @param[in]
+        sig
+            signal used to ask the process to stop
+
+    @param[in]
+        timeout
+            time (in seconds) to wait for the process to stop before
+            killing it
+
+    @retval EOK - the process was stopped
+    @retval EINVAL - invalid arguments
+    @retval other - error from kill
+
+==============================================================================*/
+static int StopPid( pid_t pid, int sig, int timeout )
+{
+    int result = EINVAL;
+
+    if ( pid > 0 )
+    {
+        result = EOK;
+
+        if ( ( sig > 0 ) && ( sig != SIGKILL ) && ( timeout > 0 ) )
+        {
+            if ( kill( pid, sig ) == -1 )
+            {
+                result = errno;
+            }
+            else
+            {
+                (void)WaitForExit( &pid, 1, timeout * 1000 );
+            }
+        }
+        else if ( kill( pid, SIGKILL ) == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            pid = 0;
+        }
+
+        if ( ( result == EOK ) &&
+             ( pid > 0 ) &&
+             ( kill( pid, SIGKILL ) == -1 ) &&
+             ( errno != ESRCH ) )
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WaitForExit                                                               */
+/*!
+    Wait for processes to exit
+
+    The WaitForExit function waits for a set of processes, which need not
+    be children of the caller, to exit.  The processes are watched using
+    process file descriptors (pidfds), so the function returns as soon
+    as the last process has exited.  On kernels which do not support
+    pidfds the processes are polled.
+
+    The process id of each process which has exited is set to 0.
+
+    @param[in,out]
+        pids
+            array of process ids to wait for.  Entries which are 0 are
+            ignored
+
+    @param[in]
+        n
+            number of entries in the pids array
+
+    @param[in]
+        timeout
+            maximum time (in milliseconds) to wait, or -1 to wait until
+            all of the processes have exited
+
+    @retval EOK - all of the processes have exited
+    @retval EINVAL - invalid arguments
+    @retval ETIMEDOUT - some of the processes are still running
+    @retval ENOMEM - memory allocation failure
+
+==============================================================================*/
+static int WaitForExit( pid_t *pids, size_t n, int timeout )
+{
+    int result = EINVAL;
+    struct pollfd *fds;
+    int64_t deadline;
+    int64_t wait;
+    bool infinite = ( timeout < 0 );
+    size_t running = 0;
+    bool polled = false;
+    size_t i;
+
+    if ( pids != NULL )
+    {
+        fds = calloc( n, sizeof( struct pollfd ) );
+        result = ( fds != NULL ) ? EOK : ENOMEM;
+
+        for ( i = 0 ; ( result == EOK ) && ( i < n ) ; i++ )
+        {
+            fds[i].fd = ( pids[i] > 0 )
+                        ? syscall( SYS_pidfd_open, pids[i], 0 )
+                        : -1;
+            fds[i].events = POLLIN;
+
+            if ( ( fds[i].fd == -1 ) && ( errno == ESRCH ) )
+            {
+                /* the process has already exited */
+                pids[i] = 0;
+            }
+            else if ( pids[i] > 0 )
+            {
+                /* processes without a pidfd are polled */
+                polled = polled || ( fds[i].fd == -1 );
+                running++;
+            }
+        }
+
+        deadline = EVENTLOOP_GetTime() + timeout;
+
+        while ( ( result == EOK ) && ( running > 0 ) )
+        {
+            wait = ( infinite == true ) ? -1 : deadline - EVENTLOOP_GetTime();
+            if ( ( infinite == false ) && ( wait <= 0 ) )
+            {
+                result = ETIMEDOUT;
+                break;
+            }
+
+            if ( ( polled == true ) &&
+                 ( ( infinite == true ) || ( wait > 10 ) ) )
+            {
+                wait = 10;
+            }
+
+            if ( ( poll( fds, n, (int)wait ) == -1 ) && ( errno != EINTR ) )
+            {
+                result = errno;
+            }
+
+            for ( i = 0 ; i < n ; i++ )
+            {
+                if ( ( pids[i] > 0 ) &&
+                     ( ( fds[i].fd != -1 )
+                        ? ( ( fds[i].revents & POLLIN ) != 0 )
+                        : ( kill( pids[i], 0 ) == -1 ) ) )
+                {
+                    pids[i] = 0;
+                    running--;
+                }
+            }
+        }
+
+        for ( i = 0 ; ( fds != NULL ) && ( i < n ) ; i++ )
+        {
+            if ( fds[i].fd != -1 )
+            {
+                close( fds[i].fd );
+            }
+        }
+
+        free( fds );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResetStartTime                                                            */
+/*!
+    reset the start/stop time the specified process
+
+    The ResetStartTime function resets the starttime field in the
+    process state to the current time so the start/stop time of the
+    process can be calculated correctly.
+
+    @param[in]
+        pRecord
+            pointer to the process state record
+
+    @retval EOK - the start/stop time was updated
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int ResetStartTime( StateRecord *pRecord )
+{
+    int result = EINVAL;
+
+    if ( pRecord != NULL )
+    {
+        /* set the starttime */
+        pRecord->data.starttime = time(NULL);
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  remove_state                                                              */
+/*!
+    Remove a process state record
+
+    The remove_state function removes the process state record
+    associated with the specified process from the state table.
+
+    @param[in]
+        name
+            name of the monitored process
+
+    @retval EOK - the process state was successfully removed
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has no process state record
+
+==============================================================================*/
+static int remove_state( char *name )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+
+    if ( name != NULL )
+    {
+        pRecord = STATETABLE_Find( name );
+        result = ( pRecord != NULL ) ? STATETABLE_Remove( pRecord ) : ENOENT;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ListProcesses                                                             */
+/*!
+    List all monitored processes
+
+    The ListProcesses function displays information about the monitored
+    processes.  The process information is requested from the running
+    process monitor via its control socket.  If the process monitor is not
+    running, the process information is read directly from the process
+    state table.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @retval EOK - processes listed successfully
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+static int ListProcesses( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    StateRecord *pRecord;
+    size_t i;
+    int rc;
+    bool json = false;
+    int n = 0;
+
+    if ( pProcmonState != NULL )
+    {
+        result = EOK;
+
+        if ( pProcmonState->outputFormat == NULL )
+        {
+            printf( "%-15s %8s %8s %16s %7s   %s\n",
+                    "Process Name",
+                    "pid",
+                    "Restarts",
+                    "Since",
+                    "Status",
+                    "Command" );
+        }
+        else if ( strcmp( pProcmonState->outputFormat, "json" ) == 0 )
+        {
+            printf("[");
+            json = true;
+        }
+
+        if ( QueryProcesses( pProcmonState ) != EOK )
+        {
+            for ( i = 0 ; i < STATETABLE_Count() ; i++ )
+            {
+                pRecord = STATETABLE_Get( i );
+                if ( pRecord != NULL )
+                {
+                    if ( ( json == true ) && ( n++ != 0 ) )
+                    {
+                        printf(",");
+                    }
+
+                    rc = DisplayProcessInfo( stdout,
+                                             pProcmonState->outputFormat,
+                                             pRecord );
+                    if ( rc != EOK )
+                    {
+                        result = rc;
+                    }
+                }
+            }
+        }
+
+        if ( json == true )
+        {
+            printf("]");
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  QueryProcesses                                                            */
+/*!
+    Query the running process monitor for the monitored processes
+
+    The QueryProcesses function requests a snapshot of all the monitored
+    processes from the running process monitor via its control socket,
+    and displays the response in the requested output format.
+
+    The JSON lines response contains one JSON object per process, which
+    is converted into a JSON array.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
 
-    @retval EOK - parent/child relationship successfully updated
-    @retval ENOMEM - memory allocation failure
+    @retval EOK - processes listed successfully
     @retval EINVAL - invalid arguments
+    @retval ENOTCONN - the process monitor is not running
+    @retval other - error communicating with the process monitor
 
 ==============================================================================*/
-static int AddChild( Process *pParent, Process *pChild )
+static int QueryProcesses( ProcmonState *pProcmonState )
 {
     int result = EINVAL;
-    ProcessNode *pNode;
+    char request[CONTROL_MAX_REQUEST];
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    bool json;
+    FILE *fp;
+    int fd;
+    int n = 0;
 
-    if ( ( pParent != NULL ) && ( pChild != NULL ) )
+    if ( pProcmonState != NULL )
     {
-        if ( pParent != pChild )
-        {
-            result = ENOMEM;
-            pNode = calloc( 1, sizeof( ProcessNode ) );
-            if ( pNode != NULL )
-            {
-                pNode->pProcess = pChild;
-                pNode->pNext = pParent->pChildren;
-                pParent->pChildren = pNode;
+        json = ( pProcmonState->outputFormat != NULL ) &&
+               ( strcmp( pProcmonState->outputFormat, "json" ) == 0 );
 
-                result = EOK;
-            }
+        snprintf( request,
+                  sizeof( request ),
+                  "list %s\n",
+                  ( pProcmonState->outputFormat != NULL )
+                    ? pProcmonState->outputFormat
+                    : "" );
+
+        fd = CONTROL_Connect( PROCMON_CONTROL_SOCKET );
+        if ( fd == -1 )
+        {
+            result = ENOTCONN;
+        }
+        else if ( write( fd, request, strlen( request ) ) == -1 )
+        {
+            result = errno;
+            close( fd );
+        }
+        else if ( ( fp = fdopen( fd, "r" ) ) == NULL )
+        {
+            result = errno;
+            close( fd );
         }
         else
         {
-            fprintf( stderr,
-                     "Process  %s cannot be a child of itself\n",
-                     pParent->id );
+            result = EOK;
+
+            while ( ( len = getline( &line, &size, fp ) ) > 0 )
+            {
+                if ( json == true )
+                {
+                    /* join the JSON lines into a JSON array */
+                    if ( line[len - 1] == '\n' )
+                    {
+                        line[len - 1] = '\0';
+                    }
+
+                    printf( "%s%s", ( n++ != 0 ) ? "," : "", line );
+                }
+                else
+                {
+                    fputs( line, stdout );
+                }
+            }
+
+            free( line );
+            fclose( fp );
         }
     }
 
@@ -954,52 +9474,105 @@ static int AddChild( Process *pParent, Process *pChild )
 }
 
 /*============================================================================*/
-/*  AddParent                                                                 */
+/*  HandleControlRequest                                                      */
 /*!
-    Add parent dependencies for the specified child process
+    Handle a control socket request
 
-    The AddParent function adds the parent/child relationship for the
-    specified parent and child processes.  It adds the parent process
-    to the child's parent dependency list
+    The HandleControlRequest function is invoked by the control module
+    when a request is received on the control socket.
+
+    The following requests are supported:
+
+    - list - list all processes in the process list (-l) format
+    - list json - list all processes as JSON lines, one JSON object
+                  per process
+    - shutdown - stop all processes and exit
+    - log <id> - the captured output of a process
+    - trace - write the lifecycle trace file
 
     @param[in]
-        pChild
-            pointer to the child process containing the parent list to update
+        fp
+            output stream to write the response to
 
     @param[in]
-        pParent
-            pointer to the parent process to add to the child's parent list.
+        request
+            pointer to the NUL terminated request line
 
-    @retval EOK - parent/child relationship successfully updated
-    @retval ENOMEM - memory allocation failure
+    @param[in]
+        arg
+            pointer to the process monitor state
+
+    @retval EOK - the request was handled
     @retval EINVAL - invalid arguments
+    @retval ENOTSUP - unsupported request
 
 ==============================================================================*/
-static int AddParent( Process *pChild, Process *pParent )
+static int HandleControlRequest( FILE *fp, char *request, void *arg )
 {
     int result = EINVAL;
-    ProcessNode *pNode;
+    StateRecord *pRecord;
+    Process *pProcess;
+    char *saveptr;
+    char *cmd;
+    char *format;
+    size_t i;
 
-    if ( ( pParent != NULL ) && ( pChild != NULL ) )
+    if ( ( fp != NULL ) && ( request != NULL ) )
     {
-        if ( pParent != pChild )
+        cmd = strtok_r( request, " ", &saveptr );
+        format = strtok_r( NULL, " ", &saveptr );
+
+        if ( ( cmd != NULL ) && ( strcmp( cmd, "metrics" ) == 0 ) )
         {
-            result = ENOMEM;
-            pNode = calloc( 1, sizeof( ProcessNode ) );
-            if ( pNode != NULL )
+            result = METRICS_Write( fp, GetProcessMetrics, arg );
+        }
+        else if ( ( cmd != NULL ) && ( strcmp( cmd, "reload" ) == 0 ) )
+        {
+            result = ReloadConfig( (ProcmonState *)arg, fp );
+        }
+        else if ( ( cmd != NULL ) && ( strcmp( cmd, "shutdown" ) == 0 ) )
+        {
+            result = Shutdown( (ProcmonState *)arg, fp );
+        }
+        else if ( ( cmd != NULL ) && ( strcmp( cmd, "trace" ) == 0 ) )
+        {
+            result = TRACE_Write();
+            fprintf( fp, "{\"result\": \"%s\"}\n", strerror( result ) );
+        }
+        else if ( ( cmd != NULL ) && ( strcmp( cmd, "log" ) == 0 ) )
+        {
+            pProcess = ( format != NULL )
+                        ? FindProcess( format, (ProcmonState *)arg )
+                        : NULL;
+            result = ( pProcess != NULL ) ? LOGBUFFER_Write( &pProcess->log,
+                                                             fp )
+                                          : ENOENT;
+            if ( result != EOK )
             {
-                pNode->pProcess = pParent;
-                pNode->pNext = pChild->pParents;
-                pChild->pParents = pNode;
+                fprintf( fp, "{\"error\": \"%s\"}\n", strerror( result ) );
+            }
+        }
+        else if ( ( cmd != NULL ) && ( strcmp( cmd, "list" ) == 0 ) )
+        {
+            result = EOK;
 
-                result = AddChild( pParent, pChild );
+            for ( i = 0 ; i < STATETABLE_Count() ; i++ )
+            {
+                pRecord = STATETABLE_Get( i );
+                if ( pRecord != NULL )
+                {
+                    DisplayProcessInfo( fp, format, pRecord );
+                    if ( format != NULL )
+                    {
+                        fputc( '\n', fp );
+                    }
+                }
             }
         }
         else
         {
-            fprintf( stderr,
-                     "Process  %s cannot be a parent of itself\n",
-                     pParent->id );
+            fprintf( fp, "{\"error\": \"unsupported request\"}\n" );
+            result = ENOTSUP;
         }
     }
 
@@ -1007,431 +9580,809 @@ static int AddParent( Process *pChild, Process *pParent )
 }
 
 /*============================================================================*/
-/*  DisplayConfig                                                             */
+/*  StartMetrics                                                              */
 /*!
-    Display the Process configuration managed by the process monitor
-
-    The DisplayConfig function displays the state of each process
-    monitored by the process monitor
+    Start sampling the process metrics
 
-    The configuration will not be displayed unless the process monitor's
-    verbose flag has been set via the command line arguments
+    The StartMetrics function starts the timer used to periodically
+    sample the resource usage of the monitored processes, and serves
+    the process metrics on the OpenMetrics endpoint if a metrics port
+    has been configured.
 
     @param[in]
         pProcmonState
-            pointer to the process monitor state object containing the
-            process configuration to display
+            pointer to the process monitor state
 
-    @retval EOK - configuration displayed successfully
+    @retval EOK - the process metrics were started
     @retval EINVAL - invalid arguments
+    @retval other - error from CONTROL_ListenTcp
 
 ==============================================================================*/
-static int DisplayConfig( ProcmonState *pProcmonState )
+static int StartMetrics( ProcmonState *pProcmonState )
 {
     int result = EINVAL;
-    ProcessNode *pProcessNode;
-    Process *pProcess;
-    int rc;
+    char *address;
 
     if ( pProcmonState != NULL )
     {
         result = EOK;
 
-        if ( pProcmonState->verbose == true )
+        if ( pProcmonState->metricsInterval > 0 )
+        {
+            /* take the first sample now */
+            SampleMetrics( pProcmonState );
+        }
+
+        if ( pProcmonState->metricsPort > 0 )
         {
-            pProcessNode = pProcmonState->pFirst;
-            while ( pProcessNode != NULL )
+            address = ( pProcmonState->metricsAddress != NULL )
+                        ? pProcmonState->metricsAddress
+                        : PROCMON_METRICS_ADDRESS;
+
+            result = CONTROL_ListenTcp( address,
+                                        (uint16_t)pProcmonState->metricsPort,
+                                        HandleMetricsRequest,
+                                        pProcmonState );
+            if ( result != EOK )
             {
-                pProcess = pProcessNode->pProcess;
-                rc = DisplayProcess( pProcess );
-                if ( rc != EOK )
+                fprintf( stderr,
+                         "Failed to serve metrics on %s:%d: %s\n",
+                         address,
+                         pProcmonState->metricsPort,
+                         strerror( result ) );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SampleMetrics                                                             */
+/*!
+    Sample the process metrics
+
+    The SampleMetrics function is a timer handler which samples the
+    resource usage of each monitored process and then re-arms the
+    metrics timer for the next sample.
+
+    @param[in]
+        arg
+            pointer to the process monitor state
+
+==============================================================================*/
+static void SampleMetrics( void *arg )
+{
+    ProcmonState *pProcmonState = (ProcmonState *)arg;
+    Process *pProcess;
+    StateExit last;
+    uint64_t restarts;
+    uint32_t exits;
+    pid_t pid;
+    size_t i;
+
+    if ( pProcmonState != NULL )
+    {
+        for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+        {
+            pProcess = pProcmonState->processes.pProcesses[i];
+            if ( pProcess->metrics.id != NULL )
+            {
+                pid = 0;
+                restarts = 0;
+
+                if ( pProcess->pRecord != NULL )
                 {
-                    result = rc;
+                    pid = __atomic_load_n( &pProcess->pRecord->data.pid,
+                                           __ATOMIC_ACQUIRE );
+                    if ( pProcess->pRecord->data.runcount > 0 )
+                    {
+                        restarts = pProcess->pRecord->data.runcount - 1;
+                    }
                 }
 
-                pProcessNode = pProcessNode->pNext;
+                /* the pid may hold a suspended or stopped indication */
+                (void)METRICS_Sample( &pProcess->metrics,
+                                      ( pid > 0 ) ? pid : 0,
+                                      restarts );
+
+                /* sample the most recent exit of the process */
+                if ( STATETABLE_GetHistory( pProcess->pRecord,
+                                            &last,
+                                            1 ) == 1 )
+                {
+                    exits = __atomic_load_n( &pProcess->pRecord->data.exits,
+                                             __ATOMIC_ACQUIRE );
+                    METRICS_SampleExits( &pProcess->metrics,
+                                         exits,
+                                         last.status,
+                                         last.uptime );
+                }
             }
         }
-    }
 
-    return result;
+        EVENTLOOP_StartTimer( &pProcmonState->metricsTimer,
+                              (int64_t)pProcmonState->metricsInterval * 1000,
+                              SampleMetrics,
+                              pProcmonState );
+    }
 }
 
 /*============================================================================*/
-/*  DisplayProcess                                                            */
+/*  GetProcessMetrics                                                         */
 /*!
-    Display the Process configuration for the specified process
+    Get the metrics of a process
 
-    The DisplayProcess function displays the state of the specified process
-    including:
+    The GetProcessMetrics function is a metrics iterator which returns
+    the metrics of the n'th configured process.
 
-    - process id
-    - process execution statement
-    - wait time
-    - list of dependencies
-    - current operating state
+    @param[in]
+        n
+            index of the process
 
     @param[in]
-        pProcess
-            pointer to the process to display
+        arg
+            pointer to the process monitor state
 
-    @retval EOK - process status displayed successfully
-    @retval EINVAL - invalid arguments
+    @retval pointer to the process metrics
+    @retval NULL - there are no more processes
 
 ==============================================================================*/
-static int DisplayProcess( Process *pProcess )
+static ProcessMetrics *GetProcessMetrics( size_t n, void *arg )
 {
-    int result = EINVAL;
-    ProcessNode *pProcessNode;
+    ProcmonState *pProcmonState = (ProcmonState *)arg;
+    ProcessMetrics *pMetrics = NULL;
 
-    if ( pProcess != NULL )
+    if ( ( pProcmonState != NULL ) &&
+         ( n < pProcmonState->processes.count ) )
     {
-        printf("process: %s\n", pProcess->id );
+        pMetrics = &pProcmonState->processes.pProcesses[n]->metrics;
+    }
 
-        DisplayState( pProcess );
+    return pMetrics;
+}
 
-        printf("\texec: %s\n", pProcess->exec );
+/*============================================================================*/
+/*  HandleMetricsRequest                                                      */
+/*!
+    Handle a request on the OpenMetrics endpoint
 
-        if ( pProcess->wait > 0 )
-        {
-            printf("\twait: %d\n", pProcess->wait );
-        }
+    The HandleMetricsRequest function is a control handler which serves
+    the process metrics in response to an HTTP request line received
+    on the OpenMetrics endpoint.
 
-        printf( "\tmonitored: %s\n",
-                ( pProcess->monitored == true ) ? "yes" : "no" );
+    @param[in]
+        fp
+            output stream to write the response to
 
-        printf("\tDepends on: [");
-        DisplayProcessIds( pProcess->pParents );
-        printf("]\n");
+    @param[in]
+        request
+            pointer to the HTTP request line
 
-        printf("\tDependency of: [");
-        DisplayProcessIds( pProcess->pChildren );
-        printf("]\n");
+    @param[in]
+        arg
+            pointer to the process monitor state
 
-        printf("\n");
+    @retval EOK - the metrics were served
+    @retval other - error from METRICS_ServeHttp
+
+==============================================================================*/
+static int HandleMetricsRequest( FILE *fp, char *request, void *arg )
+{
+    return METRICS_ServeHttp( fp, request, GetProcessMetrics, arg );
+}
+
+/*============================================================================*/
+/*  StartCluster                                                              */
+/*!
+    Join the cluster
+
+    The StartCluster function connects the process monitor to the cluster
+    aggregator if one has been configured.  The aggregator is sent the
+    state of every process when the connection is established, and
+    then every start, exit, restart and health change.  The node is
+    named by the "node" setting, or by its host name.  The shared secret
+    of the cluster is read from the file named by the "token_file"
+    setting, which is required.
+
+    The cluster agent is served by the event loop, so it requires the
+    event loop supervisor.
+
+    @param[in]
+        pProcmonState
+            pointer to the process monitor state
+
+    @retval EOK - the cluster agent was started, or no aggregator has
+                  been configured
+    @retval EINVAL - invalid arguments or cluster settings
+    @retval ENOTSUP - processes are not supervised by the event loop
+    @retval other - error from gethostname, CLUSTER_ReadToken or
+                    CLUSTER_Connect
+
+==============================================================================*/
+static int StartCluster( ProcmonState *pProcmonState )
+{
+    int result = EINVAL;
+    char hostname[CLUSTER_NODE_LEN];
+    char token[CLUSTER_TOKEN_LEN];
+    char *node;
 
+    if ( pProcmonState != NULL )
+    {
         result = EOK;
+
+        if ( pProcmonState->aggregator != NULL )
+        {
+            result = CLUSTER_ReadToken( pProcmonState->tokenFile,
+                                        token,
+                                        sizeof( token ) );
+
+            node = pProcmonState->nodeName;
+            if ( ( result == EOK ) && ( node == NULL ) )
+            {
+                if ( gethostname( hostname, sizeof( hostname ) ) == 0 )
+                {
+                    hostname[sizeof( hostname ) - 1] = '\0';
+                    node = hostname;
+                }
+                else
+                {
+                    result = errno;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                result = ( pProcmonState->supervisor == true )
+                         ? CLUSTER_Connect( &pProcmonState->agent,
+                                            pProcmonState->aggregator,
+                                            node,
+                                            token,
+                                            HandleClusterCommand,
+                                            SendSnapshot,
+                                            pProcmonState )
+                         : ENOTSUP;
+            }
+
+            memset( token, 0, sizeof( token ) );
+
+            if ( result != EOK )
+            {
+                fprintf( stderr,
+                         "Failed to join the cluster at %s: %s\n",
+                         pProcmonState->aggregator,
+                         strerror( result ) );
+            }
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  DisplayState                                                              */
+/*  SendSnapshot                                                              */
 /*!
-    Display the operating state of the specified process
+    Send the state of every process to the cluster aggregator
 
-    The DisplayState function displays the operating state of
-    the specified process.  This can be one of:
-
-    - UNKNOWN
-    - INIT
-    - STARTED
-    - RUNNING
-    - TERMINATED
-    - WAITING
+    The SendSnapshot function is invoked by the cluster agent when it
+    has connected to the aggregator, so it can bring the aggregator up
+    to date before it sends changes.
 
     @param[in]
-        pProcess
-            pointer to the process to display the operating state for
-
-    @retval EOK - process operating state displayed successfully
-    @retval EINVAL - invalid arguments
+        arg
+            pointer to the process monitor state
 
 ==============================================================================*/
-static int DisplayState( Process *pProcess )
+static void SendSnapshot( void *arg )
 {
-    int result = EINVAL;
+    ProcmonState *pState = (ProcmonState *)arg;
+    StateRecord *pRecord;
+    LockData ldata;
+    size_t i;
 
-    if ( pProcess != NULL )
+    if ( pState != NULL )
     {
-        if( pProcess->state > ( sizeof( ProcessStates )/sizeof (char *)) )
-        {
-            printf("\tstate: UNKNOWN");
-        }
-        else
+        for ( i = 0 ; i < STATETABLE_Count() ; i++ )
         {
-            printf("\tstate: %s\n", ProcessStates[pProcess->state]);
-            result = EOK;
+            pRecord = STATETABLE_Get( i );
+            if ( pRecord != NULL )
+            {
+                /* get a snapshot of the process state */
+                memcpy( &ldata, &pRecord->data, sizeof( LockData ) );
+
+                (void)CLUSTER_Send( &pState->agent,
+                                    "state %s %d %zu %s",
+                                    pRecord->id,
+                                    ( ldata.pid > 0 ) ? (int)ldata.pid : 0,
+                                    ldata.runcount,
+                                    GetStatus( &ldata ) );
+            }
         }
     }
-
-    return result;
 }
 
 /*============================================================================*/
-/*  DisplayProcessIds                                                         */
+/*  HandleClusterCommand                                                      */
 /*!
-    Display the identifiers of the processes in the process node list
+    Handle a command from the cluster aggregator
 
-    The DisplayProcessIds function displays the names of processes
-    in the specified process node list.
+    The HandleClusterCommand function is invoked by the cluster agent
+    when the aggregator sends a command for a process.  The commands
+    have the same effect as the equivalent procmon commands, but are
+    carried out from the event loop without waiting for the process to
+    stop:
+
+    - restart - restart the process (-r)
+    - start - start monitoring a stopped process (-s)
+    - stop - stop the process and suspend monitoring (-k)
+    - delete - stop the process and delete monitoring (-d)
+
+    A command for a replica group is carried out for each of its
+    instances.
 
     @param[in]
-        pProcessNode
-            pointer to a process node list containing a list of processes
-            to display the names for.
+        command
+            the command
+
+    @param[in]
+        id
+            identifier of the process
+
+    @param[in]
+        arg
+            pointer to the process monitor state
+
+    @retval EOK - the command was carried out
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process is not known
+    @retval ESRCH - the process to restart is not running
+    @retval ENOTSUP - unsupported command
 
 ==============================================================================*/
-static void DisplayProcessIds( ProcessNode *pProcessNode )
+static int HandleClusterCommand( const char *command,
+                                 const char *id,
+                                 void *arg )
 {
-    int count = 0;
-    while( pProcessNode != NULL )
+    int result = EINVAL;
+    ProcmonState *pState = (ProcmonState *)arg;
+    Process *pProcess;
+    size_t count = 0;
+    size_t i;
+    int rc;
+
+    if ( ( command != NULL ) && ( id != NULL ) && ( pState != NULL ) )
     {
-        if ( ++count > 1 )
+        pProcess = FindProcess( (char *)id, pState );
+        if ( pProcess != NULL )
         {
-            printf(",");
+            result = HandleInstanceCommand( command, pProcess );
+        }
+        else
+        {
+            /* apply the command to each instance of a replica group */
+            result = ENOENT;
+            for ( i = 0 ; i < pState->processes.count ; i++ )
+            {
+                pProcess = pState->processes.pProcesses[i];
+                if ( IsInstance( pProcess->id, id ) )
+                {
+                    rc = HandleInstanceCommand( command, pProcess );
+                    if ( ( count++ == 0 ) || ( rc != EOK ) )
+                    {
+                        result = rc;
+                    }
+                }
+            }
         }
-
-        (void)DisplayProcessId( pProcessNode->pProcess );
-        pProcessNode = pProcessNode->pNext;
     }
+
+    return result;
 }
 
 /*============================================================================*/
-/*  DisplayProcessId                                                          */
+/*  HandleInstanceCommand                                                     */
 /*!
-    Display the process identifier for the specified process
+    Handle a command from the cluster aggregator for a single process
 
-    The DisplayProcessId function displays the process identifier for
-    the specified process.
+    @param[in]
+        command
+            the command
 
     @param[in]
         pProcess
-            pointer to the process to display the process identifier for
+            pointer to the process
 
-    @retval EOK - process identifier displayed successfully
+    @retval EOK - the command was carried out
     @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has no process state record
+    @retval ESRCH - the process to restart is not running
+    @retval ENOTSUP - unsupported command
 
 ==============================================================================*/
-static int DisplayProcessId( Process *pProcess )
+static int HandleInstanceCommand( const char *command,
+                                  Process *pProcess )
 {
     int result = EINVAL;
+    StateRecord *pRecord;
 
-    if ( ( pProcess != NULL ) && ( pProcess->id != NULL ) )
+    if ( ( command != NULL ) && ( pProcess != NULL ) )
     {
-        printf("%s", pProcess->id );
-        result = EOK;
+        pRecord = ( pProcess->pRecord != NULL )
+                  ? pProcess->pRecord
+                  : STATETABLE_Find( pProcess->id );
+
+        if ( pRecord == NULL )
+        {
+            result = ENOENT;
+        }
+        else if ( strcmp( command, "restart" ) == 0 )
+        {
+            result = ( pProcess->exitEvent.fd != -1 ) ? EOK : ESRCH;
+            StopProcess( pProcess );
+        }
+        else if ( strcmp( command, "start" ) == 0 )
+        {
+            result = start( pProcess->id );
+        }
+        else if ( ( strcmp( command, "stop" ) == 0 ) ||
+                  ( strcmp( command, "delete" ) == 0 ) )
+        {
+            /* write the terminate command into the process state */
+            ResetStartTime( pRecord );
+            __atomic_store_n( &pRecord->data.terminate,
+                              ( strcmp( command, "stop" ) == 0 )
+                                ? STATETABLE_SUSPEND
+                                : STATETABLE_STOP,
+                              __ATOMIC_RELEASE );
+
+            StopProcess( pProcess );
+
+            /* wake up the process monitors */
+            result = STATETABLE_Notify();
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  RunProcesses                                                              */
+/*  InitReloadSignal                                                          */
 /*!
-    Run all processes managed by the process monitor
+    Receive configuration reload requests
 
-    The RunProcesses function ierates the through all the processes
-    managed by the process monitor and attempds to run them based on their
-    specified dependencies.  A process can only be run if
-        1) it has no dependencies
-        2) all its dependencies are already running
-        3) it is not already running
+    The InitReloadSignal function creates a signalfd which receives the
+    SIGHUP signal, and adds it to the event loop so the configuration
+    file is reloaded when the signal is received.  SIGHUP must already
+    be blocked in all threads.
 
     @param[in]
         pProcmonState
-            pointer to the process monitor to run the processes for
+            pointer to the process monitor state
 
-    @retval EOK - all processes successfully running
+    @retval EOK - the reload signal is being received
     @retval EINVAL - invalid arguments
+    @retval other - error from signalfd or EVENTLOOP_Add
 
 ==============================================================================*/
-static int RunProcesses( ProcmonState *pProcmonState )
+static int InitReloadSignal( ProcmonState *pProcmonState )
 {
     int result = EINVAL;
-    bool running = false;
-    Process *pProcess;
-    ProcessNode *pProcessNode;
+    sigset_t sigmask;
+    int fd;
 
     if ( pProcmonState != NULL )
     {
-        while( running == false )
+        sigemptyset( &sigmask );
+        sigaddset( &sigmask, SIGHUP );
+
+        fd = signalfd( -1, &sigmask, SFD_NONBLOCK | SFD_CLOEXEC );
+        if ( fd != -1 )
         {
-            running = true;
-            pProcessNode = pProcmonState->pFirst;
-            while( pProcessNode != NULL )
-            {
-                pProcess = pProcessNode->pProcess;
-                if ( Runnable( pProcess ) == EOK )
-                {
-                    Run( pProcess );
-                }
-                else
-                {
-                    running = false;
-                }
+            pProcmonState->reloadEvent.fd = fd;
+            pProcmonState->reloadEvent.handler = HandleReloadSignal;
+            pProcmonState->reloadEvent.arg = pProcmonState;
 
-                pProcessNode = pProcessNode->pNext;
+            result = EVENTLOOP_Add( &pProcmonState->reloadEvent, EPOLLIN );
+            if ( result != EOK )
+            {
+                close( fd );
+                pProcmonState->reloadEvent.fd = -1;
             }
         }
+        else
+        {
+            result = errno;
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  Runnable                                                                  */
+/*  HandleReloadSignal                                                        */
 /*!
-    Check if a process is runnable
+    Handle a configuration reload signal
 
-    The Runnable function checks if the specified process is runnable.
-    A process can only be run if
-        1) it has no dependencies
-        2) all its dependencies are already running
-        3) it is not already running
+    The HandleReloadSignal function is an event loop handler which is
+    invoked when SIGHUP is received, and reloads the configuration file.
 
     @param[in]
-        pProcess
-            pointer to the process to check the runnable state for
+        pSource
+            pointer to the reload signal event source
 
-    @retval EOK - this process is runnable
-    @retval EINVAL - invalid arguments
+    @param[in]
+        events
+            epoll events (unused)
 
 ==============================================================================*/
-static int Runnable( Process *pProcess )
+static void HandleReloadSignal( EventSource *pSource, uint32_t events )
 {
-    ProcessNode *pProcessNode;
-    int result = EINVAL;
+    struct signalfd_siginfo info;
 
-    if ( pProcess != NULL )
+    if ( pSource != NULL )
     {
-        pProcessNode = pProcess->pParents;
+        /* several signals may be merged into a single reload */
+        while ( read( pSource->fd, &info, sizeof( info ) ) == sizeof( info ) );
 
-        result = EOK;
+        (void)ReloadConfig( (ProcmonState *)pSource->arg, NULL );
+    }
+}
+
+/*============================================================================*/
+/*  RequestReload                                                             */
+/*!
+    Request a configuration reload
+
+    The RequestReload function asks the running process monitor to
+    reload its configuration file via the control socket, and displays
+    the result of the reload.
+
+    @retval EOK - the configuration was reloaded
+    @retval ENOTCONN - the process monitor is not running
+    @retval EIO - the configuration could not be reloaded
+    @retval other - error writing to the control socket
+
+==============================================================================*/
+static int RequestReload( void )
+{
+    int result;
+    char *line = NULL;
+    size_t size = 0;
+    FILE *fp;
+    int fd;
+
+    fd = CONTROL_Connect( PROCMON_CONTROL_SOCKET );
+    if ( fd == -1 )
+    {
+        result = ENOTCONN;
+    }
+    else if ( write( fd, "reload\n", 7 ) == -1 )
+    {
+        result = errno;
+        close( fd );
+    }
+    else if ( ( fp = fdopen( fd, "r" ) ) == NULL )
+    {
+        result = errno;
+        close( fd );
+    }
+    else
+    {
+        result = EIO;
 
-        while ( pProcessNode != NULL )
+        if ( getline( &line, &size, fp ) > 0 )
         {
-            if ( pProcessNode->pProcess != NULL )
+            fputs( line, stdout );
+            if ( strncmp( line, "reloaded", 8 ) == 0 )
             {
-                if ( pProcessNode->pProcess->state != PROCSTATE_eRUNNING )
-                {
-                    result = EAGAIN;
-                    break;
-                }
+                result = EOK;
             }
-
-            pProcessNode = pProcessNode->pNext;
         }
+
+        free( line );
+        fclose( fp );
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  Run                                                                       */
+/*  QueryLog                                                                  */
 /*!
-    Start running a process
+    Display the captured output of a process
 
-    The Run function initiates a process and sets
-    its state to PROCSTATE_eRUNNING once it is successfully
-    running.
+    The QueryLog function requests the captured output of a process
+    from the primary process monitor via its control socket, and writes
+    it to stdout.
 
     @param[in]
-        pProcess
-            pointer to the process to start
+        name
+            name of the process
 
-    @retval EOK - this process is running
+    @retval EOK - the output of the process was displayed
     @retval EINVAL - invalid arguments
+    @retval ENOTCONN - the process monitor is not running
+    @retval ENOENT - the output of the process is not captured
+    @retval other - error communicating with the process monitor
 
 ==============================================================================*/
-static int Run( Process *pProcess )
+static int QueryLog( char *name )
 {
     int result = EINVAL;
+    char request[CONTROL_MAX_REQUEST];
+    char buf[BUFSIZ];
+    size_t n;
+    FILE *fp;
+    int fd;
 
-    if ( pProcess != NULL )
+    if ( name != NULL )
     {
-        if( pProcess->skip == false )
+        snprintf( request, sizeof( request ), "log %s\n", name );
+
+        fd = CONTROL_Connect( PROCMON_CONTROL_SOCKET );
+        if ( fd == -1 )
         {
-            InitProcess( pProcess );
-            WaitProcess( pProcess );
+            result = ENOTCONN;
+        }
+        else if ( write( fd, request, strlen( request ) ) == -1 )
+        {
+            result = errno;
+            close( fd );
+        }
+        else if ( ( fp = fdopen( fd, "r" ) ) == NULL )
+        {
+            result = errno;
+            close( fd );
         }
+        else
+        {
+            result = EOK;
 
-        pProcess->state = PROCSTATE_eRUNNING;
+            n = fread( buf, 1, sizeof( buf ), fp );
+            if ( ( n > 0 ) && ( strncmp( buf, "{\"error\"", 8 ) == 0 ) )
+            {
+                /* the process is unknown or its output is not captured */
+                result = ENOENT;
+            }
 
-        result = EOK;
+            while ( ( result == EOK ) && ( n > 0 ) )
+            {
+                fwrite( buf, 1, n, stdout );
+                n = fread( buf, 1, sizeof( buf ), fp );
+            }
+
+            fclose( fp );
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  WaitProcess                                                               */
+/*  RunAggregator                                                             */
 /*!
-    Wait for a process to start up
+    Run the cluster aggregator
 
-    The WaitProcess function waits for the process to start up
-    under the following conditions:
+    The RunAggregator function runs the cluster aggregator, which accepts
+    connections from the cluster agents of the process monitors in a
+    fleet, and serves fleet-wide queries and commands on the aggregator
+    control socket.  It only returns if the aggregator cannot be started.
 
-    - it has a defined wait time
-    - it is not already a monitored running process
-    - it is an unmonitored process which has an execution count less than
-      the smallest runcount of its parent(s)
+    @param[in]
+        address
+            address to accept agent connections on
 
     @param[in]
-        pProcess
-            pointer to the process to wait for
+        tokenFile
+            path of the file holding the shared secret of the cluster
+
+    @retval EINVAL - invalid arguments
+    @retval other - error from CLUSTER_ReadToken, EVENTLOOP_Init or
+                    AGGREGATOR_Start
 
 ==============================================================================*/
-static void WaitProcess( Process *pProcess )
+static int RunAggregator( char *address, const char *tokenFile )
 {
-    pid_t pid;
+    int result = EINVAL;
+    char token[CLUSTER_TOKEN_LEN];
 
-    if ( pProcess != NULL )
+    if ( address != NULL )
     {
-        if ( pProcess->wait > 0 )
+        result = CLUSTER_ReadToken( tokenFile, token, sizeof( token ) );
+        if ( result == EOK )
         {
-            pid = get_pid_from_lockfile( pProcess->id );
-            if ( pid == 0 )
-            {
-                if ( ( pProcess->monitored == true ) ||
-                     ( pProcess->runcount < GetParentRuncount( pProcess ) ) )
-                {
-                    pProcess->state = PROCSTATE_eWAITING;
-                    sleep( pProcess->wait );
-                }
-            }
+            result = EVENTLOOP_Init();
+        }
+
+        if ( result == EOK )
+        {
+            result = AGGREGATOR_Start( address,
+                                       AGGREGATOR_CONTROL_SOCKET,
+                                       token );
+            memset( token, 0, sizeof( token ) );
+        }
+
+        if ( result == EOK )
+        {
+            setvbuf( stdout, NULL, _IOLBF, 0 );
+            printf( "aggregating on %s\n", address );
+
+            EVENTLOOP_Run();
         }
     }
+
+    return result;
 }
 
 /*============================================================================*/
-/*  InitProcess                                                               */
+/*  QueryAggregator                                                           */
 /*!
-    Initialize a process monitoring instance and start running the process
+    Query the cluster aggregator
 
-    The InitProcess function initiates a process monitoring thread
-    to make sure the process remains running, and starts the process
-    running.
+    The QueryAggregator function sends a request to the cluster
+    aggregator via its control socket, and writes the response to
+    stdout.
 
     @param[in]
-        pProcess
-            pointer to the process to start
+        request
+            the request, for example "list" or "rolling <id> 2"
 
-    @retval EOK - the monitoring thread was successfully created and is running
+    @retval EOK - the response was displayed
     @retval EINVAL - invalid arguments
-    @retval other - error from pthread_create
+    @retval ENOTCONN - the aggregator is not running
+    @retval EIO - the aggregator could not carry out the request
+    @retval other - error communicating with the aggregator
 
 ==============================================================================*/
-static int InitProcess( Process *pProcess )
+static int QueryAggregator( char *request )
 {
     int result = EINVAL;
+    char line[CONTROL_MAX_REQUEST];
+    char buf[BUFSIZ];
+    size_t n;
+    FILE *fp;
+    int fd;
 
-    if ( pProcess != NULL )
+    if ( ( request != NULL ) && ( strlen( request ) < sizeof( line ) - 1 ) )
     {
-        if ( pProcess->verbose == true )
+        snprintf( line, sizeof( line ), "%s\n", request );
+
+        fd = CONTROL_Connect( AGGREGATOR_CONTROL_SOCKET );
+        if ( fd == -1 )
         {
-            printf("Creating thread for process %s\n", pProcess->id );
+            result = ENOTCONN;
+        }
+        else if ( write( fd, line, strlen( line ) ) == -1 )
+        {
+            result = errno;
+            close( fd );
         }
+        else if ( ( fp = fdopen( fd, "r" ) ) == NULL )
+        {
+            result = errno;
+            close( fd );
+        }
+        else
+        {
+            result = EOK;
 
-        result = pthread_create( &pProcess->thread,
-                                 NULL,
-                                 &MonitorThread,
-                                 pProcess );
+            n = fread( buf, 1, sizeof( buf ), fp );
+            if ( ( n > 0 ) && ( strncmp( buf, "{\"error\"", 8 ) == 0 ) )
+            {
+                result = EIO;
+            }
 
-        if ( result == EOK )
-        {
-            pProcess->state = PROCSTATE_eSTARTED;
+            while ( n > 0 )
+            {
+                fwrite( buf, 1, n, stdout );
+                n = fread( buf, 1, sizeof( buf ), fp );
+            }
+
+            fclose( fp );
         }
     }
 
@@ -1439,890 +10390,1073 @@ static int InitProcess( Process *pProcess )
 }
 
 /*============================================================================*/
-/*  RunProcess                                                                */
+/*  ReloadConfig                                                              */
 /*!
-    Run the process
+    Reload the configuration file
+
+    The ReloadConfig function parses the configuration file again and
+    applies the differences between the new configuration and the
+    running processes.  Processes which have been added are started,
+    processes which have been removed are stopped, and processes whose
+    configuration has changed are restarted.  Processes whose
+    configuration has not changed keep running.
 
-    The RunProcess function runs the process specified in the "exec"
-    attribute of the process object using the execvp system call.
-    It first decomposes the command string into the command and
-    its arguments and creates an arg vector.
+    The new configuration is validated before it is applied, and the
+    running processes are not changed if it is invalid.
 
-    This function should not return unless an error has occurred.
+    The configuration cache no longer matches the configuration file,
+    so it is compiled again the next time the process monitor starts.
 
     @param[in]
-        pProcess
-            pointer to the process to run
+        pProcmonState
+            pointer to the process monitor state
 
-    @retval EINVAL - invalid arguments
-    @retval other - error from pthread_create
+    @param[in]
+        fp
+            output stream to write the result of the reload to, or NULL
+
+    @retval EOK - the configuration was reloaded
+    @retval EINVAL - the configuration is invalid
+    @retval ENOTSUP - processes are not supervised by the event loop
+    @retval other - error building the dependency graph
 
 ==============================================================================*/
-static int RunProcess( Process *pProcess )
+static int ReloadConfig( ProcmonState *pProcmonState, FILE *fp )
 {
-    char *argv[40];
-    char *saveptr;
-    char *exec;
-    int i = 0;
     int result = EINVAL;
+    ProcmonState config;
+    size_t i;
 
-    if ( pProcess != NULL )
+    memset( &config, 0, sizeof( config ) );
+
+    if ( ( pProcmonState != NULL ) && ( pProcmonState->configFile != NULL ) )
     {
-        if ( pProcess->verbose == true )
+        if ( pProcmonState->supervisor == false )
         {
-            printf("RunProcess: %s\n", pProcess->id );
+            /* monitoring threads cannot be moved to a new configuration */
+            result = ENOTSUP;
         }
-
-        exec = strdup( pProcess->exec );
-        if ( exec != NULL )
+        else if ( pProcmonState->shuttingDown == true )
         {
-            argv[0] = strtok_r( exec, " ", &saveptr );
-            do
-            {
-                i++;
-                argv[i] = strtok_r( NULL, " ", &saveptr );
-            } while( argv[i] != NULL );
+            /* the processes are being stopped */
+            result = ECANCELED;
         }
-
-        /* create a lock file if this process is to be monitored */
-        if ( pProcess->monitored == true )
+        else
         {
-            /* get the process id of this process */
-            pProcess->pid = getpid();
-
-            if ( makelock( pProcess ) != EOK )
-            {
-                fprintf( stderr,
-                         "Failed to make lock for %s\n",
-                         pProcess->id );
-            }
+            config.configFile = pProcmonState->configFile;
+            result = ParseConfigFile( &config );
         }
 
-        /* spawn the new process, replacing this process with the new one */
-        if ( pProcess->verbose == true )
+        if ( result == EOK )
         {
-            printf( "running %s\n", pProcess->exec );
+            InheritResources( &config );
+            ApplyConfig( pProcmonState, &config, fp );
         }
+        else
+        {
+            for ( i = 0 ; i < config.processes.count ; i++ )
+            {
+                DiscardProcess( config.processes.pProcesses[i] );
+            }
 
-        execvp( argv[0], argv );
+            ARENA_Free( &config.arena );
 
-        /* should not get here unless the process failed to start */
-        result = errno;
+            fprintf( stderr,
+                     "Failed to reload %s: %s\n",
+                     pProcmonState->configFile,
+                     strerror( result ) );
 
-        fprintf( stderr,
-                 "Failed to execute: %s\nProcess failed with error %s\n",
-                 pProcess->exec,
-                 strerror(result));
+            if ( fp != NULL )
+            {
+                fprintf( fp, "reload failed: %s\n", strerror( result ) );
+            }
+        }
 
+        free( config.processes.pProcesses );
+        free( config.order.pProcesses );
+        free( config.pIndex );
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  MonitorThread                                                             */
+/*  ApplyConfig                                                               */
 /*!
-    Thread to start and optionally monitor a single process for process death
+    Apply a new configuration to the running processes
 
-    The MonitorThread function forks the current process and then replaces
-    the new child process with the specified process to be run.
-    If the child process is to be monitored, the parent process will then
-    monitor the child process and re-start it if it terminates for any reason.
+    The ApplyConfig function compares each process of the new
+    configuration with the running process of the same id.  The running
+    process objects are kept, with their configuration updated, so
+    unchanged processes are not disturbed.  The process list, index and
+    dependency graph are then rebuilt in the order of the new
+    configuration before the changed processes are restarted and the
+    added processes are started.
+
+    Added processes are started by the startup scheduler, so they wait
+    for any of their parents which are not yet ready.
 
     @param[in]
-        arg
-            pointer to a process info (ProcInfo) object containing information
-            about the process to be monitored
+        pProcmonState
+            pointer to the process monitor state
 
-    @retval NULL - process completed (or invalid argument)
+    @param[in]
+        pConfig
+            pointer to the state object containing the validated
+            processes of the new configuration
+
+    @param[in]
+        fp
+            output stream to write the result of the reload to, or NULL
 
 ==============================================================================*/
-static void *MonitorThread( void *arg )
+static void ApplyConfig( ProcmonState *pProcmonState,
+                         ProcmonState *pConfig,
+                         FILE *fp )
 {
-    Process *pProcess = (Process *)arg;
-    pid_t pid = 0;
-    int wstatus;
-    bool run = true;
+    ProcessList processes;
+    ProcessList previous;
+    Process *pProcess;
+    Process *pNew;
+    size_t added = 0;
+    size_t removed = 0;
+    size_t changed = 0;
+    size_t i;
 
-    if ( pProcess != NULL )
+    memset( &processes, 0, sizeof( processes ) );
+
+    /* compare all of the processes before any are updated, as the
+     * inherited resources refer to the resources of their parents */
+    for ( i = 0 ; i < pConfig->processes.count ; i++ )
     {
-        if ( ( pProcess->monitored == false ) &&
-             ( pProcess->runcount >= GetParentRuncount( pProcess ) ) )
+        pNew = pConfig->processes.pProcesses[i];
+        pProcess = FindProcess( pNew->id, pProcmonState );
+        if ( pProcess != NULL )
         {
-            run = false;
+            pProcess->changed = ProcessChanged( pProcess, pNew );
+            if ( pProcess->changed == true )
+            {
+                changed++;
+            }
         }
+    }
 
-        while ( run )
+    /* match the new processes with the running processes */
+    for ( i = 0 ; i < pConfig->processes.count ; i++ )
+    {
+        pNew = pConfig->processes.pProcesses[i];
+        pProcess = FindProcess( pNew->id, pProcmonState );
+        if ( pProcess == NULL )
         {
-            /* check if the process is already running */
-            pid = get_pid_from_lockfile( pProcess->id );
+            pProcess = pNew;
+            added++;
+        }
+        else
+        {
+            UpdateProcess( pProcess, pNew );
+        }
 
-            if ( pid == -2 )
-            {
-                /* terminate all monitoring and remove lockfile */
-                remove_lockfile( pProcess->id );
-                run = false;
-                break;
-            }
+        (void)AppendProcess( &processes, pProcess );
+    }
 
-            if ( pid == -1 )
+    /* the running processes now refer to the new configuration arena.
+     * The previous arena is retired until the removed processes which
+     * still refer to it have stopped */
+    ARENA_Move( &pProcmonState->retired, &pProcmonState->arena );
+    pProcmonState->arena = pConfig->arena;
+    memset( &pConfig->arena, 0, sizeof( Arena ) );
+    pProcmonState->retiredRefs++;
+
+    /* the settings are not reloaded, so they are kept in the new arena */
+    pProcmonState->metricsAddress =
+        ARENA_Strdup( &pProcmonState->arena, pProcmonState->metricsAddress );
+    pProcmonState->aggregator =
+        ARENA_Strdup( &pProcmonState->arena, pProcmonState->aggregator );
+    pProcmonState->nodeName =
+        ARENA_Strdup( &pProcmonState->arena, pProcmonState->nodeName );
+    pProcmonState->tokenFile =
+        ARENA_Strdup( &pProcmonState->arena, pProcmonState->tokenFile );
+
+    /* stop the processes which are no longer configured */
+    for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+    {
+        pProcess = pProcmonState->processes.pProcesses[i];
+        if ( FindProcess( pProcess->id, pConfig ) == NULL )
+        {
+            if ( pProcess->verbose == true )
             {
-                /* monitoring has been suspended */
-                /* periodically check to see if the process has
-                 * been (re)started */
-                sleep(1);
-                continue;
+                printf( "Removing %s\n", pProcess->id );
             }
 
-            if ( pid == 0 )
-            {
-                /* process is not running */
-                pProcess->runcount++;
+            /* the process is stopped once the process list has been
+             * rebuilt without it, and is freed once it has stopped */
+            pProcess->removed = true;
+            pProcess->metrics.id = NULL;
+            METRICS_Close( &pProcess->metrics );
+            pProcess->parents.count = 0;
+            pProcess->children.count = 0;
+            pProcmonState->retiredRefs++;
+            removed++;
+        }
+    }
 
-                if ( pProcess->restart_delay != 0 )
-                {
-                    /* wait before restarting the process */
-                    sleep( pProcess->restart_delay );
-                }
+    /* free the new process objects which were merged into
+     * running processes */
+    for ( i = 0 ; i < pConfig->processes.count ; i++ )
+    {
+        pNew = pConfig->processes.pProcesses[i];
+        if ( FindProcess( pNew->id, pProcmonState ) != NULL )
+        {
+            DiscardProcess( pNew );
+        }
+    }
 
-                /* fork a new process which will run the specified process */
-                pid = fork();
-            }
+    ReleaseRetired( pProcmonState );
 
-            if ( pid == 0 )
-            {
-                /* child */
-                /* detach from parent */
-                pid = setsid();
-                if ( pid == -1 )
-                {
-                    fprintf( stderr, "error: %s\n", strerror(errno));
-                }
+    /* rebuild the process list, index and dependency graph */
+    previous = pProcmonState->processes;
+    memset( &pProcmonState->processes, 0, sizeof( ProcessList ) );
+    free( pProcmonState->pIndex );
+    pProcmonState->pIndex = NULL;
+    pProcmonState->indexSize = 0;
 
-                /* run the process */
-                RunProcess( pProcess );
+    for ( i = 0 ; i < processes.count ; i++ )
+    {
+        pProcess = processes.pProcesses[i];
+        pProcess->parents.count = 0;
+        pProcess->children.count = 0;
+        (void)IndexProcess( pProcmonState, pProcess );
+        (void)AppendProcess( &pProcmonState->processes, pProcess );
+    }
 
-                /* if we get here the exec failed */
-                fprintf( stderr, "Failed to execute: %s\n", pProcess->exec );
-                break;
-            }
-            else
-            {
-                if( pProcess->monitored == true )
-                {
-                    /* kick off all dependents */
-                    RestartDependents( pProcess );
+    free( processes.pProcesses );
 
-                    /* wait for child to start up */
-                    usleep(500000);
+    (void)BuildDependencyLists( pProcmonState );
+    InheritResources( pProcmonState );
 
-                    /* monitor the process to detect process death */
-                    Monitor( pProcess->id, -1 );
+    /* stop the removed processes */
+    for ( i = 0 ; i < previous.count ; i++ )
+    {
+        pProcess = previous.pProcesses[i];
+        if ( pProcess->removed == true )
+        {
+            ReloadProcess( pProcess );
+        }
+    }
 
-                    /* wait for child death */
-                    waitpid( pid, &wstatus, 0 );
+    free( previous.pProcesses );
 
-                    if ( pProcess->verbose == true )
-                    {
-                        fprintf( stderr,
-                                "Process %s terminated (wstatus=%d)\n",
-                                pProcess->id,
-                                wstatus );
-                    }
-                }
-                else
-                {
-                    /* processes which are not monitored */
-                    if ( pProcess->verbose == true )
-                    {
-                        printf("%s will not be monitored\n", pProcess->id );
-                    }
+    /* restart the processes whose configuration has changed */
+    for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+    {
+        pProcess = pProcmonState->processes.pProcesses[i];
+        if ( pProcess->changed == true )
+        {
+            pProcess->changed = false;
+            ReloadProcess( pProcess );
+        }
+    }
 
-                    waitpid( pid, &wstatus, 0 );
+    /* schedule the processes which have not been started yet */
+    ScheduleProcesses( pProcmonState );
 
-                    if ( pProcess->verbose == true )
-                    {
-                        printf("%s terminated\n", pProcess->id );
-                    }
+    syslog( LOG_INFO,
+            "procmon reloaded %s: %zu added, %zu removed, %zu changed",
+            pProcmonState->configFile,
+            added,
+            removed,
+            changed );
 
-                    RestartDependents( pProcess );
-                    break;
-                }
-            }
-        }
+    if ( fp != NULL )
+    {
+        fprintf( fp,
+                 "reloaded %s: %zu added, %zu removed, %zu changed, "
+                 "%zu unchanged\n",
+                 pProcmonState->configFile,
+                 added,
+                 removed,
+                 changed,
+                 pConfig->processes.count - added - changed );
     }
-
-    return NULL;
 }
 
 /*============================================================================*/
-/*  RestartDependents                                                         */
+/*  ScheduleProcesses                                                         */
 /*!
-    Restart all dependent processes (if applicable)
+    Schedule the processes which have not been started
 
-    The RestartDependents function checks and restarts each of the
-    dependent processes of the specified process if they meet the
-    following conditions:
+    The ScheduleProcesses function starts the processes which have not
+    completed their startup, using the startup scheduler.  The number
+    of parents each process is waiting for is recalculated, and the
+    processes which are not waiting for any parents are started.  Their
+    dependents are started as they become ready.
 
-        - the dependent process has the "restart_on_parent_death" flag set
-        - the dependent process does not have the "skip" flag set
-        - the dependent process has been initialized
+    It is used to start the processes added by a configuration reload,
+    and the subtree of a restarted process.
 
     @param[in]
-        pProcess
-            pointer to the process whose dependents should be restarted
-
-    @retval EOK - all dependent processes were sent a restart signal
-    @retval EINVAL - invalid arguments
-    @retval other - error if dependent's lockfile could not be accessed
+        pProcmonState
+            pointer to the process monitor state
 
 ==============================================================================*/
-static int RestartDependents( Process *pProcess )
+static void ScheduleProcesses( ProcmonState *pProcmonState )
 {
-    int result = EINVAL;
-    ProcessNode *pProcessNode;
-    int rc;
+    ProcessList *pOrder;
+    Process *pProcess;
+    int64_t now;
+    size_t i;
+    size_t j;
 
-    if ( pProcess != NULL )
+    if ( pProcmonState != NULL )
     {
-        result = EOK;
+        now = EVENTLOOP_GetTime();
+        if ( pProcmonState->startupPending == 0 )
+        {
+            pProcmonState->startupBegin = now;
+            pProcmonState->pStartupLast = NULL;
+        }
 
-        /* iterate through all dependent processes and restart them
-         * if necessary */
-        pProcessNode = pProcess->pChildren;
-        while( pProcessNode != NULL )
+        for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
         {
-            rc = RestartDependent( pProcessNode->pProcess, pProcess->wait );
-            if ( rc != EOK )
+            pProcess = pProcmonState->processes.pProcesses[i];
+            if ( pProcess->started == false )
             {
-                result = EOK;
+                pProcess->pending = 0;
+                for ( j = 0 ; j < pProcess->parents.count ; j++ )
+                {
+                    if ( pProcess->parents.pProcesses[j]->started == false )
+                    {
+                        pProcess->pending++;
+                    }
+                }
+            }
+            else
+            {
+                pProcess->pending = 0;
             }
+        }
 
-            pProcessNode = pProcessNode->pNext;
+        pOrder = StartupOrder( pProcmonState );
+        for ( i = 0 ; i < pOrder->count ; i++ )
+        {
+            pProcess = pOrder->pProcesses[i];
+            if ( ( pProcess->started == false ) &&
+                 ( pProcess->pending == 0 ) &&
+                 ( pProcess->state == PROCSTATE_eINIT ) &&
+                 ( pProcess->supervised == false ) &&
+                 ( pProcess->stopping == false ) &&
+                 ( pProcess->readyTimer.active == false ) )
+            {
+                Run( pProcess, now );
+            }
         }
     }
-
-    return result;
 }
 
 /*============================================================================*/
-/*  RestartDependent                                                          */
+/*  ProcessChanged                                                            */
 /*!
-    Restart a dependent process
-
-    The RestartDependent function checks and restarts a dependent
-    process if it meets the following conditions:
+    Check if a process must be restarted to apply its new configuration
 
-        - the dependent process has the "restart_on_parent_death" flag set
-        - the dependent process does not have the "skip" flag set
-        - the dependent process has been initialized
+    The ProcessChanged function compares the configuration of a running
+    process with its new configuration.  A process must be restarted if
+    its command, output capture, monitoring, readiness notification,
+    dependencies or ( inherited ) resource attributes have changed.
+    The restart policy, stop attributes and wait time of a process are
+    updated without restarting it.
 
     @param[in]
         pProcess
-            pointer to the dependent process to restart
+            pointer to the running process
 
     @param[in]
-        wait
-            optional time to wait after the processes death is detected
-            before the new process is spawned.  0=no wait
+        pNew
+            pointer to the new configuration of the process
 
-    @retval EOK - the dependent process was sent a restart signal
-    @retval EINVAL - invalid arguments
-    @retval other - error if dependent process lockfile could not be accessed
+    @retval true - the process must be restarted
+    @retval false - the process can keep running
 
 ==============================================================================*/
-static int RestartDependent( Process *pProcess, int wait )
+static bool ProcessChanged( Process *pProcess, Process *pNew )
 {
-   int result = EINVAL;
-
-   if ( pProcess != NULL )
-   {
-       result = EOK;
-
-       if ( pProcess->restart_on_parent_death &&
-            pProcess->skip == false &&
-            ( pProcess->state != PROCSTATE_eINIT ) )
-       {
-           /* set delay after process death detection before process will
-            * be initiated */
-           pProcess->restart_delay = wait;
-
-           /* restart the process */
-           if ( pProcess->monitored )
-           {
-               result = restart( pProcess->id );
-           }
-           else
-           {
-               result = InitProcess( pProcess );
-           }
-       }
-   }
+    bool changed;
+    size_t i;
+
+    changed = ( ( pProcess->exec == NULL ) || ( pNew->exec == NULL ) )
+                ? ( pProcess->exec != pNew->exec )
+                : ( strcmp( pProcess->exec, pNew->exec ) != 0 );
+
+    changed = changed ||
+              ( ( ( pProcess->logFile == NULL ) || ( pNew->logFile == NULL ) )
+                  ? ( pProcess->logFile != pNew->logFile )
+                  : ( strcmp( pProcess->logFile, pNew->logFile ) != 0 ) );
+
+    changed = changed ||
+              ( ( ( pProcess->listen == NULL ) || ( pNew->listen == NULL ) )
+                  ? ( pProcess->listen != pNew->listen )
+                  : ( strcmp( pProcess->listen, pNew->listen ) != 0 ) );
+
+    changed = changed ||
+              ( pProcess->logBufferSize != pNew->logBufferSize ) ||
+              ( pProcess->logFileSize != pNew->logFileSize ) ||
+              ( pProcess->monitored != pNew->monitored ) ||
+              ( pProcess->skip != pNew->skip ) ||
+              ( pProcess->notify != pNew->notify ) ||
+              ( pProcess->parents.count != pNew->parents.count ) ||
+              !RESOURCES_Equal( &pProcess->resources, &pNew->resources );
+
+    for ( i = 0 ; ( changed == false ) && ( i < pNew->parents.count ) ; i++ )
+    {
+        changed = strcmp( pProcess->parents.pProcesses[i]->id,
+                          pNew->parents.pProcesses[i]->id ) != 0;
+    }
 
-   return result;
+    return changed;
 }
 
 /*============================================================================*/
-/*  GetParentRuncount                                                         */
+/*  UpdateProcess                                                             */
 /*!
-    Get the parent runcount
+    Update the configuration of a running process
 
-    The GetParentRuncount function gets the largest runcount from all of the
-    processes parents.
+    The UpdateProcess function moves the new configuration of a process
+    into the running process object, which keeps its runtime state.
+    The strings, parsed command and resource attributes of the new
+    process object are allocated from the new configuration arena, and
+    are taken over by the running process.
 
     @param[in]
         pProcess
-            pointer to a process to get the parent runcount for
+            pointer to the running process
 
-    @retval count of number of times this processes parents have been run
+    @param[in]
+        pNew
+            pointer to the new configuration of the process
 
 ==============================================================================*/
-static size_t GetParentRuncount( Process *pProcess )
+static void UpdateProcess( Process *pProcess, Process *pNew )
 {
-    size_t runcount = 0;
-    ProcessNode *pNode;
-    Process *pParent;
-
-    if ( pProcess != NULL )
+    pProcess->id = pNew->id;
+    pProcess->exec = pNew->exec;
+    pProcess->argv = pNew->argv;
+    pProcess->envp = pNew->envp;
+
+    pProcess->wait = pNew->wait;
+    pProcess->restart_delay = pNew->restart_delay;
+    pProcess->restart_backoff_max = pNew->restart_backoff_max;
+    pProcess->restart_limit = pNew->restart_limit;
+    pProcess->restart_window = pNew->restart_window;
+    pProcess->stopSignal = pNew->stopSignal;
+    pProcess->stopTimeout = pNew->stopTimeout;
+    pProcess->logBufferSize = pNew->logBufferSize;
+    pProcess->logFile = pNew->logFile;
+    pProcess->logFileSize = pNew->logFileSize;
+    pProcess->listen = pNew->listen;
+    pProcess->idleTimeout = pNew->idleTimeout;
+    pProcess->healthCheck = pNew->healthCheck;
+    pProcess->healthInterval = pNew->healthInterval;
+    pProcess->healthTimeout = pNew->healthTimeout;
+    pProcess->healthFailures = pNew->healthFailures;
+    pProcess->restart_on_parent_death = pNew->restart_on_parent_death;
+    pProcess->monitored = pNew->monitored;
+    pProcess->verbose = pNew->verbose;
+    pProcess->skip = pNew->skip;
+    pProcess->notify = pNew->notify;
+    pProcess->standby = pNew->standby;
+    pProcess->pDependIds = pNew->pDependIds;
+    pProcess->pDependsIndex = pNew->pDependsIndex;
+    pProcess->ndepends = pNew->ndepends;
+
+    if ( ( pProcess->changed == true ) &&
+         ( pProcess->resources.cgroupfd != -1 ) )
     {
-        pNode = pProcess->pParents;
-        while( pNode != NULL )
-        {
-            pParent = pNode->pProcess;
-            if ( pParent != NULL )
-            {
-                if( pParent->runcount > runcount )
-                {
-                    runcount = pParent->runcount;
-                }
-            }
+        /* prepare the cgroup again in case its limits have changed */
+        close( pProcess->resources.cgroupfd );
+        pProcess->resources.cgroupfd = -1;
+    }
 
-            pNode = pNode->pNext;
-        }
+    pProcess->ownResources = pNew->ownResources;
+
+    pProcess->metrics.id = ( pProcess->monitored && !pProcess->skip )
+                            ? pProcess->id
+                            : NULL;
+
+    if ( UsesStandby( pProcess ) == false )
+    {
+        StopStandby( pProcess );
+    }
+    else if ( pProcess->exitEvent.fd != -1 )
+    {
+        StartStandby( pProcess, PROCMON_STANDBY_DELAY );
     }
 
-    return runcount;
+    /* the new health check applies from now on, without restarting the
+     * process */
+    HEALTH_Close( &pProcess->health );
+    pProcess->health = pNew->health;
+    memset( &pNew->health, 0, sizeof( HealthCheck ) );
+    if ( pProcess->exitEvent.fd != -1 )
+    {
+        StartHealthCheck( pProcess );
+    }
 }
 
 /*============================================================================*/
-/*  Monitor                                                                   */
+/*  ReloadProcess                                                             */
 /*!
-    Monitor a process and wait for process death
+    Stop a process to apply a configuration reload
 
-    The Monitor function opens the process lockfile and then tries to
-    create a write lock on the file, which it will not be able to do
-    while the process is alive.  This monitor function will then block
-    until it CAN place a write lock on the file, indicating that the
-    process which owns the lockfile has terminated (died).  It will
-    then remove its lock on the file and delete the lock file and exit
-    allowing the calling function to restart the process if necessary.
-
-    @param[in]
-        pid
-            process identifier of the process to monitor
+    The ReloadProcess function stops a process which has been changed
+    or removed by a configuration reload.  If the process is running it
+    is killed, and ReloadComplete is invoked once it has terminated.
+    A process which has not been started yet by the startup scheduler
+    is left to be started with its new configuration.
 
     @param[in]
-        fd
-            file descriptor for the process lockfile
+        pProcess
+            pointer to the process to stop
 
 ==============================================================================*/
-static void Monitor( char *name, int fd )
+static void ReloadProcess( Process *pProcess )
 {
-    int rc;
-
-    if ( name != NULL )
+    if ( pProcess != NULL )
     {
-        if ( fd == -1 )
-        {
-            /* try to open the lock file */
-            fd = open_lockfile( name );
-        }
+        EVENTLOOP_StopTimer( &pProcess->restartTimer );
+        pProcess->suspended = false;
 
-        if ( fd != -1 )
+        if ( pProcess->exitEvent.fd != -1 )
         {
-            /* wait for process to exit */
-            while ( 1 )
+            if ( pProcess->verbose == true )
             {
-                rc = waitlock( fd );
-                if ( rc == EOK )
-                {
-                    /* process exited */
-                    unlock( fd );
-                    close( fd );
-                    break;
-                }
-                else if ( rc == EDEADLK )
-                {
-                    /* we need to check for deadlock in the case
-                     * where the procmon primary and secondary processes
-                     * are trying to lock each other.  In this case, we
-                     * revert to polling once/second */
-                    sleep(1);
-                }
-                else
-                {
-                    fprintf( stderr,
-                             "Error getting lockfile: %s\n",
-                             strerror( rc ) );
-                    break;
-                }
+                printf( "Stopping %s to reload its configuration\n",
+                        pProcess->id );
             }
+
+            pProcess->reloading = true;
+            StopProcess( pProcess );
         }
-        else
+        else if ( ( pProcess->started == true ) ||
+                  ( pProcess->removed == true ) )
         {
-            fprintf( stderr,
-                     "Failed to start monitoring on process %s\n",
-                     name );
+            ReloadComplete( pProcess );
         }
     }
 }
 
 /*============================================================================*/
-/*  makelock                                                                  */
+/*  ReloadComplete                                                            */
 /*!
-    Create a process lock
+    Complete the configuration reload of a process
 
-    The makelock function creates a process lock for the
-    specified process.  This lock is used to detect process death.
+    The ReloadComplete function is invoked once a process which has been
+    changed or removed by a configuration reload has stopped.  The state
+    record of a process which is no longer monitored is removed, and a
+    changed process is started again with its new configuration.
+    A removed process is freed once its standby has stopped too.
+    A suspended or failed process remains suspended or failed.
 
     @param[in]
         pProcess
-            pointer to the process to make a lock for
-
-    @retval EOK - this process is running
-    @retval EINVAL - invalid arguments
-    @retval other error returned by fcntl
+            pointer to the stopped process
 
 ==============================================================================*/
-static int makelock( Process *pProcess )
+static void ReloadComplete( Process *pProcess )
 {
-    int fd;
-    LockData ldata;
-    int rc = EINVAL;
-    pid_t pid;
-    char *name;
-    int n;
-
     if ( pProcess != NULL )
     {
-        rc = EOK;
+        pProcess->reloading = false;
+        pProcess->supervised = false;
 
-        pid = pProcess->pid;
-        name = pProcess->id;
+        if ( ( pProcess->removed == true ) ||
+             ( pProcess->skip == true ) ||
+             ( pProcess->monitored == false ) )
+        {
+            (void)remove_state( pProcess->id );
+            pProcess->pRecord = NULL;
+        }
 
-        if ( pProcess->verbose == true )
+        if ( ( pProcess->removed == true ) ||
+             ( LOGBUFFER_Equal( &pProcess->log,
+                                pProcess->logBufferSize,
+                                pProcess->logFile,
+                                pProcess->logFileSize ) == false ) )
         {
-            printf("makelock: %s (%d)\n", name, pid );
+            /* the output capture is opened again with its new settings */
+            LOGBUFFER_Close( &pProcess->log );
         }
 
-        /* clear the lockdata object */
-        memset( (void *)&ldata, 0, sizeof(LockData) );
+        if ( ( pProcess->removed == true ) ||
+             ( pProcess->skip == true ) ||
+             ( LISTENER_Equal( &pProcess->listener,
+                               pProcess->listen ) == false ) )
+        {
+            /* the listening sockets are bound again to their new
+             * addresses */
+            LISTENER_Close( &pProcess->listener );
+            pProcess->activated = false;
+        }
 
-        /* create a lock file to associate with the monitored process */
-        fd = open_lockfile( name );
-        if ( fd == -1 )
+        if ( ( pProcess->removed == false ) && ( pProcess->skip == false ) )
         {
-            /* create the lock file for this process */
-            fd = create_lockfile( pProcess );
+            /* the restart does not count against the restart budget */
+            pProcess->restarting = true;
+            pProcess->supervised = true;
+            SuperviseProcess( pProcess );
         }
-        else
+
+        if ( pProcess->removed == true )
         {
-            /* get the previous lock data */
-            n = read( fd, &ldata, sizeof(LockData) );
-            if ( n == sizeof( LockData ) )
-            {
-                /* increment the run count */
-                ldata.runcount++;
+            FreeRemovedProcess( pProcess );
+        }
+    }
+}
 
-                /* set the process identifier */
-                ldata.pid = pid;
+/*============================================================================*/
+/*  FreeRemovedProcess                                                        */
+/*!
+    Free a process which was removed by a configuration reload
 
-                /* set the start time */
-                ldata.starttime = time(NULL);
+    The FreeRemovedProcess function returns a process which was removed
+    by a configuration reload to the process pool once it has stopped,
+    and its standby has been reaped.  Its timers are stopped, and the
+    references of the startup critical path to it are cleared, so that
+    nothing refers to the process object when it is reused.  The process
+    releases the retired configuration its strings refer to.
 
-                /* seek to the start of the lock file */
-                if ( lseek( fd, 0, SEEK_SET ) != -1 )
-                {
-                    /* write back the updated lock data */
-                    n = write(fd, &ldata, sizeof(LockData) );
-                    if ( n != sizeof(LockData) )
-                    {
-                        rc = errno;
-                    }
-                }
-            }
+    @param[in]
+        pProcess
+            pointer to the removed process
+
+==============================================================================*/
+static void FreeRemovedProcess( Process *pProcess )
+{
+    size_t i;
+
+    if ( ( pProcess != NULL ) &&
+         ( pProcess->removed == true ) &&
+         ( pProcess->reloading == false ) &&
+         ( pProcess->exitEvent.fd == -1 ) &&
+         ( pProcess->spare.exitEvent.fd == -1 ) )
+    {
+        EVENTLOOP_StopTimer( &pProcess->readyTimer );
+        EVENTLOOP_StopTimer( &pProcess->restartTimer );
+        EVENTLOOP_StopTimer( &pProcess->stopTimer );
+        EVENTLOOP_StopTimer( &pProcess->idleTimer );
+        EVENTLOOP_StopTimer( &pProcess->spare.timer );
+        CloseReadyPipe( pProcess );
+        CloseStandby( &pProcess->spare );
+
+        if ( pProcmonState->pStartupLast == pProcess )
+        {
+            pProcmonState->pStartupLast = NULL;
         }
 
-        /* establish a lock on the file */
-        if ( rc == EOK )
+        for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
         {
-            rc = lock( fd, F_SETLK );
+            if ( pProcmonState->processes.pProcesses[i]->pGate == pProcess )
+            {
+                pProcmonState->processes.pProcesses[i]->pGate = NULL;
+            }
         }
-    }
 
-    return rc;
+        /* the process no longer refers to its configuration */
+        pProcess->removed = false;
+        DiscardProcess( pProcess );
+        ReleaseRetired( pProcmonState );
+    }
 }
 
 /*============================================================================*/
-/*  waitlock                                                                  */
+/*  ReleaseRetired                                                            */
 /*!
-    Try to set a write lock for the specified file descriptor
-
-    The waitlock function will try to set a write lock for the
-    specified file descriptor associated with a running process.
-    If the process is healthy, IT will have a write lock on the
-    file descriptor.  If the process which owns the file descriptor
-    is dead, then the waitlock will complete indicating that the
-    process can be restarted.
+    Release a reference to the retired configuration arenas
 
-    This function will block until process death
+    The ReleaseRetired function is invoked when a removed process which
+    refers to the strings of a previous configuration has stopped.  The
+    retired configuration arenas are freed once none of the removed
+    processes are still running.
 
     @param[in]
-        fd
-            file descriptor of process to monitor for death
-
-    @retval EOK - this process has died
-    @retval EINVAL - invalid arguments
-    @retval other error returned by fcntl
+        pProcmonState
+            pointer to the process monitor state
 
 ==============================================================================*/
-static int waitlock( int fd )
+static void ReleaseRetired( ProcmonState *pProcmonState )
 {
-    return lock( fd, F_SETLKW );
+    if ( ( pProcmonState != NULL ) && ( pProcmonState->retiredRefs > 0 ) )
+    {
+        pProcmonState->retiredRefs--;
+        if ( pProcmonState->retiredRefs == 0 )
+        {
+            ARENA_Free( &pProcmonState->retired );
+        }
+    }
 }
 
 /*============================================================================*/
-/*  lock                                                                      */
+/*  DiscardProcess                                                            */
 /*!
-    Perform a lock operation on the specified file descriptor
-
-    The lock function will try to perform the specified lock command
-    on the specified file descriptor associated with a single
-    monitored process.
-
-    Valid commands are:
+    Free a process object which is no longer used
 
-    - F_SETLKW - try to acquire a lock and wait if the lock is already held
-    - F_SETLK - try to acquire a lock
-    - F_UNLCK - release a lock
+    The DiscardProcess function returns a process object which was never
+    run, or which has been freed by FreeRemovedProcess, to the free list
+    of the process pool, to be reused by NewProcess.  Its strings are
+    released with the configuration arena they were allocated from.
 
     @param[in]
-        fd
-            file descriptor of process to monitor for death
-
-    @param[in]
-        cmd
-            type of lock operation to perform
-
-    @retval EOK - lock action was successful
-    @retval EINVAL - invalid arguments
-    @retval other error returned by fcntl
+        pProcess
+            pointer to the process object to free
 
 ==============================================================================*/
-static int lock( int fd, int cmd )
+static void DiscardProcess( Process *pProcess )
 {
-    char lockfile[64];
-    int result = EINVAL;
-    struct flock lock;
-    pid_t pidf;
-
-    if ( fd != -1 )
+    if ( pProcess != NULL )
     {
-        if ( ( cmd == F_SETLKW ) ||
-             ( cmd == F_SETLK ) ||
-             ( cmd == F_UNLCK ) )
-        {
-            lock.l_type = F_WRLCK;
-            lock.l_whence = SEEK_SET;
-            lock.l_start = 0;
-            lock.l_len = 1;
+        HEALTH_Close( &pProcess->health );
+        free( pProcess->parents.pProcesses );
+        free( pProcess->children.pProcesses );
 
-            result = fcntl( fd, cmd, &lock );
-            if ( result == -1 )
-            {
-                result = errno;
-            }
-        }
-        else
-        {
-            result = ENOTSUP;
-        }
+        pProcess->pNextFree = pProcmonState->pFreeProcesses;
+        pProcmonState->pFreeProcesses = pProcess;
     }
-
-    return result;
 }
 
 /*============================================================================*/
-/*  unlock                                                                    */
+/*  GetStatus                                                                 */
 /*!
-    Unlock the process lockfile
-
-    The unlock function will try to unlock the lockfile associated
-    with the monitored process.
+    Get the status of a process
 
-    @param[in]
-        fd
-            file descriptor of the process lockfile
+    The GetStatus function gets the status of a process from a snapshot
+    of its process state.
 
     @param[in]
-        cmd
-            type of lock operation to perform
+        pData
+            pointer to a snapshot of the process state
 
-    @retval EOK - lock action was successful
-    @retval EINVAL - invalid arguments
-    @retval other error returned by fcntl
+    @retval "failed" - the process has exhausted its restart budget
+    @retval "running" - the process is running
+    @retval "stopped" - the process is not running
 
 ==============================================================================*/
-static int unlock( int fd )
+static char *GetStatus( LockData *pData )
 {
-    return lock( fd, F_UNLCK );
-}
+    bool running;
+
+    /* check if process is running */
+    running = ( pData->pid > 0 );
 
+    if ( ( running == true ) && ( kill( pData->pid, 0 ) == -1 ) )
+    {
+        running = ( errno == ESRCH ) ? false : true;
+    }
+
+    return ( pData->failed != 0 ) ? "failed"
+           : running ? "running" : "stopped";
+}
 
 /*============================================================================*/
-/*  create_lockfile                                                           */
+/*  DisplayProcessInfo                                                        */
 /*!
-    Create a process lockfile
+    Display information about the specified process
+
+    The DisplayProcessInfo function displays information about a process
+    obtained from the process's state record, including the Name, PID, and
+    running state.
 
-    The create_lockfile process will create a lockfile associated with
-    a process to be monitored for death.
+    @param[in]
+        fp
+            output stream to write the process information to
 
-    The lockfile will be constructed using /tmp.procmon. followed
-    by the process identifier of the monitored process.
+    @param[in]
+        outputFormat
+            pointer to the output format name, or NULL for the process
+            list format
 
     @param[in]
-        pProcess
-            pointer to the process to create the lockfile for
+        pRecord
+            pointer to the state record of the process to display
 
-    @retval fd - file descriptor for the lockfile of the monitored process
-    @retval -1 - unable to create lockfile
+    @retval EOK - process displayed successfully
+    @retval EINVAL - invalid arguments
 
 ==============================================================================*/
-static int create_lockfile( Process *pProcess )
+static int DisplayProcessInfo( FILE *fp,
+                               char *outputFormat,
+                               StateRecord *pRecord )
 {
-    char lockfile[256];
-    int fd = -1;
-    int result;
-    struct flock lock;
+    int result = EINVAL;
     LockData ldata;
+    StateExit history[STATETABLE_HISTORY_LEN];
+    size_t count;
+    size_t i;
+    char proctime[64];
+    char *status;
     char *name;
     char *exec;
-    int n;
-    int len;
 
-    if ( pProcess != NULL )
+    if ( ( fp != NULL ) &&
+         ( pRecord != NULL ) )
     {
-        memset( (void *)&ldata, 0, sizeof(LockData) );
+        /* get a snapshot of the process state */
+        memcpy( &ldata, &pRecord->data, sizeof(LockData) );
+        name = pRecord->id;
+        exec = pRecord->exec;
 
-        name =  pProcess->id;
+        status = GetStatus( &ldata );
 
-        if ( name != NULL )
-        {
-            /* build the process lockfile name */
-            sprintf( lockfile, "/tmp/procmon.%s", name );
+        /* calculate the process time */
+        (void)GetProcessTime( time(NULL) - ldata.starttime,
+                              proctime,
+                              sizeof(proctime) );
 
-            /* create the process lockfile */
-            fd = open( lockfile, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR );
-            if ( fd != -1 )
+        if ( outputFormat == NULL )
+        {
+            /* display the row of process data */
+            fprintf( fp,
+                     "%-15s %8d %8ld %16s %s : %.*s\n",
+                     name,
+                     ldata.pid,
+                     ldata.runcount,
+                     proctime,
+                     status,
+                     STATETABLE_EXEC_LEN,
+                     exec );
+        }
+        else if ( strcmp( outputFormat, "json" ) == 0 )
+        {
+            fprintf( fp, "{\"name\": " );
+            WriteJsonString( fp, name, STATETABLE_ID_LEN );
+            fprintf( fp, ",\"pid\": %d,", ldata.pid );
+            fprintf( fp, "\"runcount\": %ld,", ldata.runcount );
+            fprintf( fp, "\"since\": " );
+            WriteJsonString( fp, proctime, sizeof( proctime ) );
+            fprintf( fp, ",\"state\": " );
+            WriteJsonString( fp, status, strlen( status ) );
+            fprintf( fp, ",\"exec\": " );
+            WriteJsonString( fp, exec, STATETABLE_EXEC_LEN );
+            fprintf( fp, ",\"exits\": %u,", ldata.exits );
+
+            /* write the exit history, newest first */
+            count = STATETABLE_GetHistory( pRecord,
+                                           history,
+                                           STATETABLE_HISTORY_LEN );
+            fprintf( fp, "\"history\": [" );
+            for ( i = 0 ; i < count ; i++ )
             {
-                ldata.pid = pProcess->pid;
-                ldata.runcount = 1;
-                ldata.starttime = time(NULL);
-                ldata.terminate = 0x0000;
-
-                /* write the lockdata object */
-                n = write(fd, &ldata, sizeof(LockData) );
-                if ( n == sizeof(LockData) )
-                {
-                    exec = pProcess->exec;
-                    if ( exec != NULL )
-                    {
-                        len = strlen( exec );
-
-                        /* write the executable name/args */
-                        write( fd, exec, strlen(exec) );
-                    }
-                }
+                fprintf( fp, "%s{", ( i > 0 ) ? "," : "" );
+                fprintf( fp, "\"time\": %" PRId64 ",", history[i].timestamp );
+                WriteExitStatus( fp, history[i].status );
+                fprintf( fp, "\"uptime_ms\": %u,", history[i].uptime );
+                fprintf( fp,
+                         "\"restart_latency_ms\": %u}",
+                         history[i].latency );
             }
+            fprintf( fp, "]}" );
         }
+
+        result = EOK;
     }
 
-    return fd;
+    return result;
+
 }
 
 /*============================================================================*/
-/*  open_lockfile                                                             */
+/*  WriteExitStatus                                                           */
 /*!
-    Open a process lockfile
+    Write the exit status of a process as JSON attributes
 
-    The open_lockfile function tries to open the process lockfile
-    associated with the specified process id for read/write access.
-    It will try up to 5 times, waiting for 0.1 seconds each time.
+    The WriteExitStatus function writes an exit_code attribute for a
+    process which exited, or a signal attribute for a process which was
+    terminated by a signal.  Nothing is written if the exit status is
+    not known.
 
     @param[in]
-        pid
-            monitored process
+        fp
+            output stream to write to
 
-    @retval fd - file descriptor for the open lockfile of the monitored process
-    @retval -1 - unable to open lockfile
+    @param[in]
+        wstatus
+            wait status of the process, or STATETABLE_STATUS_UNKNOWN
 
 ==============================================================================*/
-static int open_lockfile( char *name )
+static void WriteExitStatus( FILE *fp, int wstatus )
 {
-    char lockfile[256];
-    int fd = -1;
-    int result;
-    struct flock lock;
-    int tries = 0;
+    if ( wstatus == STATETABLE_STATUS_UNKNOWN )
+    {
+        /* the exit status is not known */
+    }
+    else if ( WIFEXITED( wstatus ) )
+    {
+        fprintf( fp, "\"exit_code\": %d,", WEXITSTATUS( wstatus ) );
+    }
+    else if ( WIFSIGNALED( wstatus ) )
+    {
+        fprintf( fp, "\"signal\": %d,", WTERMSIG( wstatus ) );
+    }
+}
 
-    if ( name != NULL )
+/*============================================================================*/
+/*  WriteJsonString                                                           */
+/*!
+    Write a JSON string
+
+    The WriteJsonString function writes a string as a quoted JSON string,
+    escaping quotes, backslashes and control characters.  The string
+    is read up to its NUL terminator or its maximum length, since the
+    strings of a state record may be changed while they are read.
+
+    @param[in]
+        fp
+            output stream to write to
+
+    @param[in]
+        str
+            string to write
+
+    @param[in]
+        len
+            maximum length of the string
+
+==============================================================================*/
+static void WriteJsonString( FILE *fp, const char *str, size_t len )
+{
+    size_t i;
+
+    fputc( '"', fp );
+
+    for ( i = 0 ; ( i < len ) && ( str[i] != '\0' ) ; i++ )
     {
-        sprintf( lockfile, "/tmp/procmon.%s", name );
-        while ( ( tries++ < 5 ) &&
-                ( fd == -1 ) )
+        if ( ( str[i] == '"' ) || ( str[i] == '\\' ) )
         {
-            fd = open( lockfile, O_RDWR );
-            if ( fd == -1 )
-            {
-                usleep( 100000 );
-            }
+            fprintf( fp, "\\%c", str[i] );
+        }
+        else if ( (unsigned char)str[i] < 0x20 )
+        {
+            fprintf( fp, "\\u%04x", (unsigned char)str[i] );
+        }
+        else
+        {
+            fputc( str[i], fp );
         }
     }
 
-    return fd;
-
+    fputc( '"', fp );
 }
 
 /*============================================================================*/
-/*  get_pid_from_lockfile                                                     */
+/*  GetProcessTime                                                            */
 /*!
-    read process id from lockfile
+    Convert the process run/stop time into a human readable string
 
-    The get_pid_from_lockfile function tries to open the process lockfile
-    associated with the specified process name for read access, and then
-    read the process id from the lockfile.
+    The GetProcessTime function converts the process run/stop time into
+    a string in the form <d>d<h>h<m>m<s>s where
 
-    The pid is then checked to see if the process exists by invoking
-    kill(pid, 0)
+    <d> is the process run/stop time in days
+    <h> is the process run/stop time in hours
+    <m> is the process run/stop time in minutes
+    <s> is the process run/stop time in seconds
+
+    So, for example if a process has been running for 3 days, 12 hours,
+    45 minutes, and 37 seconds, the generated string will be: 3d12h45m37s
 
     @param[in]
-        name
-            name of the process to get the process id for
+        runtime
+            the process run/stop time in seconds
+
+    @param[in]
+        buf
+            pointer to a buffer to store the generated string
 
-    @retval pid - process id contained within the process lockfile
-    @retval 0 - unable to open/read lockfile
-    @retval -1 - process is actively terminated
+    @param[in]
+        len
+            length of the buffer to store the generated string
+
+    @retval EOK - time string was generated successfully
+    @retval EINVAL - invalid arguments
 
 ==============================================================================*/
-static pid_t get_pid_from_lockfile( char *name )
+static int GetProcessTime( long runtime, char *buf, size_t len )
 {
-    char lockfile[256];
-    int fd = -1;
-    pid_t pid = 0;
-    LockData ldata;
+    int result = EINVAL;
+    int days;
+    int hours;
+    int mins;
+    int secs;
 
-    if ( name != NULL )
+    if ( buf != NULL )
     {
-        sprintf( lockfile, "/tmp/procmon.%s", name );
-        fd = open( lockfile, O_RDWR );
-        if ( fd != -1 )
+        if ( runtime < 60 )
         {
-            read( fd, &ldata, sizeof( LockData ) );
-            pid = ldata.pid;
-            close( fd );
+            snprintf(buf, len, "%lds", runtime);
         }
-
-        if ( ldata.terminate == 0xDEADBEEF )
+        else if ( runtime < 3600 )
         {
-            /* suspend monitoring */
-            pid = -1;
+            mins = runtime / 60;
+            runtime -= ( mins * 60 );
+            secs = runtime;
+            snprintf(buf, len, "%dm%02ds", mins, secs );
         }
-
-        if ( ldata.terminate == 0xDEAFBABE )
+        else if ( runtime < 86400 )
         {
-            /* abort monitoring */
-            pid = -2;
+            hours = runtime / 3600;
+            runtime -= ( hours * 3600 );
+            mins = runtime / 60;
+            runtime -= ( mins * 60 );
+            secs = runtime;
+            snprintf(buf, len, "%dh%02dm%02ds", hours, mins, secs );
         }
-
-        if ( pid > 0 )
+        else
         {
-            /* check if the PID exists */
-            if ( kill( pid, 0 ) == -1 )
-            {
-                if ( errno == ESRCH )
-                {
-                    pid = 0;
-                }
-            }
+            days = runtime / 86400;
+            runtime -= ( days * 86400 );
+            hours = runtime / 3600;
+            runtime -= ( hours * 3600 );
+            mins = runtime / 60;
+            runtime -= ( mins * 60 );
+            secs = runtime;
+            snprintf(buf, len, "%dd%02dh%02dm%02ds", days, hours, mins, secs );
         }
 
+        result = EOK;
     }
 
-    return pid;
+    return result;
 }
 
 /*============================================================================*/
-/*  start                                                                     */
+/*  ShutdownAllProcesses                                                      */
 /*!
-    start the specified process
+    Shut down all monitored processes
 
-    The start function tries to start the named monitored process.
-    Only processes which have a /tmp/procmon.<name> and are known
-    to the process monitor (via the configuration file) can be started.
+    The ShutdownAllProcesses function asks the primary process monitor
+    to shut down.  The primary stops the processes in reverse dependency
+    order, and the function returns once the primary has exited.
 
-    To start a monitored process, we remove the special terminate
-    instruction from the lockfile, allowing the process to be re-started
-    by the Monitoring thread.
+    If the primary cannot perform the shutdown, all of the processes in
+    the process state table are stopped by StopAllProcesses.
 
     @param[in]
-        name
-            name of the process to start
+        pProcmonState
+            pointer to the process monitor state
 
-    @retval EOK - the process will be restarted by the monitoring thread
+    @retval EOK - all processes shut down successfully
     @retval EINVAL - invalid arguments
+    @retval other - one or more processes could not be shut down
 
 ==============================================================================*/
-static int start( char *name )
+static int ShutdownAllProcesses( ProcmonState *pProcmonState )
 {
-    int fd;
     int result = EINVAL;
-    LockData ldata;
-    off_t pos;
-    size_t len;
-    void *p;
-    pid_t pid;
-
-    /* calculate the offset and length of the terminate field
-     * in the LockData structure */
-    p = (void *)&(ldata.terminate);
-    pos = p - (void *)&ldata;
-    len = sizeof( ldata.terminate );
 
-    if ( name != NULL )
+    if ( pProcmonState != NULL )
     {
-        fd = open_lockfile( name );
-        if ( fd != -1 )
-        {
-            /* clear the terminate instruction */
-            ldata.terminate = 0;
-
-            /* write the terminate command into the LockData object */
-            lseek( fd, pos, SEEK_SET );
-            if ( write( fd, p, len ) == len )
-            {
-                result = EOK;
-            }
-            else
-            {
-                result = errno;
-            }
+        printf("shutting down all processes....\n");
 
-            /* close the lockfile */
-            close( fd );
-        }
-        else
+        result = RequestShutdown();
+        if ( ( result == ENOTCONN ) || ( result == ENOTSUP ) )
         {
-            result = errno;
+            result = StopAllProcesses();
         }
     }
 
@@ -2330,375 +11464,486 @@ static int start( char *name )
 }
 
 /*============================================================================*/
-/*  restart                                                                   */
+/*  RequestShutdown                                                           */
 /*!
-    restart the specified process
-
-    The restart function tries to restart the named monitored process
-    by sending it a SIGKILL signal and letting the process monitoring
-    thread restart it.
+    Request the primary process monitor to shut down
 
-    @param[in]
-        name
-            name of the process to restart
+    The RequestShutdown function sends a shutdown request to the primary
+    process monitor via its control socket, and waits for the primary
+    to exit once it has stopped all of its processes.
 
-    @retval EOK - the process will be restarted by the monitoring thread
-    @retval EINVAL - invalid arguments
+    @retval EOK - the process monitor has shut down
+    @retval ENOTCONN - the process monitor is not running
+    @retval ENOTSUP - the process monitor cannot perform the shutdown
+    @retval other - error communicating with the process monitor
 
 ==============================================================================*/
-static int restart( char *name )
+static int RequestShutdown( void )
 {
+    int result;
+    char *line = NULL;
+    size_t size = 0;
+    pid_t pid = 0;
+    FILE *fp;
     int fd;
-    int result = EINVAL;
-    LockData ldata;
-    pid_t pid;
 
-    if ( name != NULL )
+    fd = CONTROL_Connect( PROCMON_CONTROL_SOCKET );
+    if ( fd == -1 )
     {
-        printf("restarting %s\n", name );
-
-        /* open the process lock file */
-        fd = open_lockfile( name );
-        if ( fd != -1 )
-        {
-            /* read the Lock Data */
-            read( fd, &ldata, sizeof( LockData ) );
-
-            /* get the process id from the LockData */
-            pid = ldata.pid;
-
-            /* close the lockfile */
-            close( fd );
+        result = ENOTCONN;
+    }
+    else if ( write( fd, "shutdown\n", 9 ) == -1 )
+    {
+        result = errno;
+        close( fd );
+    }
+    else if ( ( fp = fdopen( fd, "r" ) ) == NULL )
+    {
+        result = errno;
+        close( fd );
+    }
+    else
+    {
+        result = ENOTSUP;
 
-            /* terminate the process */
-            result = kill( pid, SIGKILL );
-            if ( result != EOK )
-            {
-                result = errno;
-            }
-        }
-        else
+        if ( ( getline( &line, &size, fp ) > 0 ) &&
+             ( sscanf( line, "shutting down %d", &pid ) == 1 ) &&
+             ( pid > 0 ) )
         {
-            result = errno;
+            /* the primary exits once all of its processes have stopped */
+            result = WaitForExit( &pid, 1, -1 );
         }
+
+        free( line );
+        fclose( fp );
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  terminate_and_stop_monitoring                                             */
+/*  StopAllProcesses                                                          */
 /*!
-    terminate the specified process
+    Stop all processes in the process state table
 
-    The terminate function tries to terminate the named
-    monitored process. Only processes which have a /tmp/procmon.<name>
-    can be terminated.
+    The StopAllProcesses function is used to shut down the process
+    monitor when the primary process monitor cannot perform the shutdown
+    itself.  All of the processes in the process state table are sent
+    their stop signal at once, and those which have not stopped when
+    their stop timeout expires are killed.  The process monitor
+    processes are stopped once all of the other processes have stopped.
 
-    To terminate a monitored process, we write a special terminate
-    instruction into the lockfile and then send a SIGKILL signal
-    to the process to terminate it.  The monitoring thread will notice
-    the termination instruction and not try to restart the process.
+    @retval EOK - all processes shut down successfully
+    @retval ENOMEM - memory allocation failure
+    @retval other - one or more processes could not be shut down
 
-    After the process has been terminated, it's lockfile will be
-    permanently deleted so it cannot be restarted.
+==============================================================================*/
+static int StopAllProcesses( void )
+{
+    int result = EOK;
+    StateRecord *pRecord;
+    pid_t *pids;
+    char *pName;
+    size_t n;
+    size_t i;
+    int timeout = 0;
+    int sig;
+
+    n = STATETABLE_Count();
+    pids = calloc( n + 1, sizeof( pid_t ) );
+    if ( pids == NULL )
+    {
+        result = ENOMEM;
+    }
 
-    @param[in]
-        name
-            name of the process to terminate
+    for ( i = 0 ; ( pids != NULL ) && ( i < n ) ; i++ )
+    {
+        pRecord = STATETABLE_Get( i );
+        if ( pRecord != NULL )
+        {
+            pName = pRecord->id;
 
-    @retval EOK - kill signal was successfully sent to the process
-    @retval error code indicating inability to kill the process
+            /* shutdown all processes except the process monitor
+             * processes to give them a chance to clean up */
+            if ( strncmp( pName, "procmon", 7 ) != 0 )
+            {
+                printf("terminating %s\n", pName );
 
-==============================================================================*/
-static int terminate_and_stop_monitoring( char *name )
-{
-    return terminate_command( name, 0xDEAFBABE );
-}
+                ResetStartTime( pRecord );
+                __atomic_store_n( &pRecord->data.terminate,
+                                  STATETABLE_STOP,
+                                  __ATOMIC_RELEASE );
 
-/*============================================================================*/
-/*  terminate                                                                 */
-/*!
-    terminate the specified process
+                pids[i] = __atomic_load_n( &pRecord->data.pid,
+                                           __ATOMIC_ACQUIRE );
+                sig = ( pRecord->data.stopTimeout > 0 )
+                      ? (int)pRecord->data.stopSignal
+                      : SIGKILL;
 
-    The terminate function tries to terminate the named
-    monitored process. Only processes which have a /tmp/procmon.<name>
-    can be terminated.
+                if ( pids[i] <= 0 )
+                {
+                    pids[i] = 0;
+                }
+                else if ( kill( pids[i], sig ) == -1 )
+                {
+                    fprintf( stderr,
+                             "Failed to terminate %s (%s)\n",
+                             pName,
+                             strerror( errno ) );
+                    result = ( errno == ESRCH ) ? result : errno;
+                    pids[i] = 0;
+
+                    /* remove the process state */
+                    remove_state( pName );
+                }
+                else if ( (int)pRecord->data.stopTimeout > timeout )
+                {
+                    timeout = pRecord->data.stopTimeout;
+                }
+            }
+        }
+    }
 
-    To terminate a monitored process, we write a special terminate
-    instruction into the lockfile and then send a SIGKILL signal
-    to the process to terminate it.  The monitoring thread will notice
-    the termination instruction and not try to restart the process.
+    /* wake up the process monitors */
+    STATETABLE_Notify();
 
-    @param[in]
-        name
-            name of the process to terminate
+    /* wait for the processes to stop, and kill those which don't */
+    if ( ( pids != NULL ) &&
+         ( WaitForExit( pids, n, timeout * 1000 ) == ETIMEDOUT ) )
+    {
+        for ( i = 0 ; i < n ; i++ )
+        {
+            if ( pids[i] > 0 )
+            {
+                (void)kill( pids[i], SIGKILL );
+            }
+        }
 
-    @retval EOK - kill signal was successfully sent to the process
-    @retval error code indicating inability to kill the process
+        (void)WaitForExit( pids, n, 1000 );
+    }
 
-==============================================================================*/
-static int terminate( char *name )
-{
-    return terminate_command( name, 0xDEADBEEF );
+    /* terminate the process monitor primary and secondary */
+    terminate_and_stop_monitoring( "procmon1" );
+    terminate_and_stop_monitoring( "procmon2" );
+
+    /* remove the process monitor state records */
+    remove_state( "procmon1" );
+    remove_state( "procmon2" );
+
+    free( pids );
+
+    return result;
 }
 
 /*============================================================================*/
-/*  terminate_command                                                         */
+/*  Shutdown                                                                  */
 /*!
-    terminate the specified process
-
-    The terminate_command function tries to terminate the named
-    monitored process. Only processes which have a /tmp/procmon.<name>
-    can be terminated.
+    Shut down the process monitor
 
-    To terminate a monitored process, we write a special terminate
-    instruction into the lockfile and then send a SIGKILL signal
-    to the process to terminate it.  The monitoring thread will notice
-    the termination instruction and not try to restart the process.
+    The Shutdown function handles a shutdown request received by the
+    primary process monitor.  The peer process monitor is stopped, and
+    the processes are stopped in reverse dependency order: a process is
+    stopped once all of its dependents have stopped, so independent
+    branches of the process graph are stopped in parallel.  The process
+    monitor exits as soon as the last process has stopped.
 
-    See the cmd argument for a description of the termination modes.
+    The response contains the process id of the process monitor, so
+    the requester can wait for it to exit.
 
     @param[in]
-        name
-            name of the process to terminate
+        pProcmonState
+            pointer to the process monitor state
 
     @param[in]
-        cmd
-            the terminate command to use:
+        fp
+            output stream to write the response to
 
-            - 0xDEADBEEF = terminate and suspend monitoring
-            - 0xDEAFBABE = terminate and stop monitoring
-
-    @retval EOK - kill signal was successfully sent to the process
-    @retval error code indicating inability to kill the process
+    @retval EOK - the shutdown has started
+    @retval EINVAL - invalid arguments
+    @retval ENOTSUP - the processes are not supervised by the event loop
 
 ==============================================================================*/
-static int terminate_command( char *name, uint32_t cmd )
+static int Shutdown( ProcmonState *pProcmonState, FILE *fp )
 {
-    int fd;
     int result = EINVAL;
-    LockData ldata;
-    off_t pos;
-    size_t len;
-    void *p;
-    pid_t pid;
-
-    /* calculate the offset and length of the terminate field
-     * in the LockData structure */
-    p = (void *)&(ldata.terminate);
-    pos = p - (void *)&ldata;
-    len = sizeof( ldata.terminate );
+    StateRecord *pRecord;
+    Process *pProcess;
+    size_t i;
 
-    if ( name != NULL )
+    if ( ( pProcmonState != NULL ) && ( fp != NULL ) )
     {
-        fd = open_lockfile( name );
-        if ( fd != -1 )
+        if ( pProcmonState->supervisor == false )
+        {
+            fprintf( fp, "{\"error\": \"unsupported request\"}\n" );
+            result = ENOTSUP;
+        }
+        else
         {
-            /* read the Lock Data */
-            read( fd, &ldata, sizeof( LockData ) );
+            result = EOK;
+            fprintf( fp, "shutting down %d\n", (int)getpid() );
+        }
 
-            /* get the process id */
-            pid = ldata.pid;
+        if ( ( result == EOK ) && ( pProcmonState->shuttingDown == false ) )
+        {
+            pProcmonState->shuttingDown = true;
+            pProcmonState->shutdownPending = 0;
+            EVENTLOOP_StopTimer( &pProcmonState->subtreeTimer );
+
+            pProcess = pProcmonState->pMonitoredProcess;
+            if ( pProcess != NULL )
+            {
+                /* keep the peer from taking over from us */
+                pRecord = STATETABLE_Find( pProcess->id );
+                if ( pRecord != NULL )
+                {
+                    __atomic_store_n( &pRecord->data.terminate,
+                                      STATETABLE_STOP,
+                                      __ATOMIC_RELEASE );
+                }
 
-            /* set the terminate instruction */
-            ldata.terminate = cmd;
+                EVENTLOOP_StopTimer( &pProcess->restartTimer );
+                if ( pProcess->exitEvent.fd != -1 )
+                {
+                    pProcmonState->shutdownPending++;
+                    StopProcess( pProcess );
+                }
+                else
+                {
+                    remove_state( pProcess->id );
+                }
+            }
 
-            /* reset the start time in the LockData object */
-            ResetStartTime( fd );
+            for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
+            {
+                pProcess = pProcmonState->processes.pProcesses[i];
+
+                /* nothing is started while the processes are stopped */
+                EVENTLOOP_StopTimer( &pProcess->restartTimer );
+                EVENTLOOP_StopTimer( &pProcess->readyTimer );
+                EVENTLOOP_StopTimer( &pProcess->idleTimer );
+                HEALTH_Stop( &pProcess->health );
+                CloseReadyPipe( pProcess );
+                LISTENER_Close( &pProcess->listener );
+                pProcess->awaitingReady = false;
+
+                pProcess->stopPending = pProcess->children.count;
+                pProcmonState->shutdownPending++;
+            }
 
-            /* write the terminate command into the LockData object */
-            lseek( fd, pos, SEEK_SET );
-            if ( write( fd, p, len ) == len )
+            /* stop the processes which have no dependents */
+            for ( i = 0 ; i < pProcmonState->processes.count ; i++ )
             {
-                /* terminate the process */
-                result = kill( pid, SIGKILL );
-                if ( result != EOK )
+                pProcess = pProcmonState->processes.pProcesses[i];
+                if ( pProcess->children.count == 0 )
                 {
-                    /* get the error */
-                    result = errno;
+                    ShutdownProcess( pProcess );
                 }
             }
-            else
+
+            if ( pProcmonState->shutdownPending == 0 )
             {
-                result = errno;
+                EVENTLOOP_StartTimer( &pProcmonState->shutdownTimer,
+                                      0,
+                                      ShutdownComplete,
+                                      pProcmonState );
             }
+        }
+    }
 
+    return result;
+}
 
-            /* close the lockfile */
-            close( fd );
+/*============================================================================*/
+/*  ShutdownProcess                                                           */
+/*!
+    Stop a process during shutdown
+
+    The ShutdownProcess function is invoked during shutdown once all of
+    the dependents of a process have stopped.  A running process is
+    stopped by StopProcess, and ShutdownStopped is invoked when it has
+    terminated.
+
+    @param[in]
+        pProcess
+            pointer to the process to stop
+
+==============================================================================*/
+static void ShutdownProcess( Process *pProcess )
+{
+    if ( pProcess != NULL )
+    {
+        if ( pProcess->exitEvent.fd != -1 )
+        {
+            StopProcess( pProcess );
         }
         else
         {
-            result = errno;
+            ShutdownStopped( pProcess );
         }
     }
-
-    return result;
 }
 
 /*============================================================================*/
-/*  ResetStartTime                                                            */
+/*  ShutdownStopped                                                           */
 /*!
-    reset the start/stop time the specified process
+    Handle a process which has stopped during shutdown
 
-    The ResetStartTime function resets the statttime field in the
-    LockData object to the current time so the start/stop time of the
-    process can be calculated correctly.
+    The ShutdownStopped function is invoked during shutdown when a
+    process has stopped.  Its process state record is removed, and its
+    parents are stopped once all of their dependents have stopped.
 
-    @param[in]
-        fd
-            file descriptor for the open lockdata file
+    A process which terminates while its dependents are still being
+    stopped is handled once they have stopped.
 
-    @retval EOK - the start/stop time was correctly written to the lockdata file
-    @retval error code indicating inability to write the lockdata file
+    @param[in]
+        pProcess
+            pointer to the process which has stopped
 
 ==============================================================================*/
-static int ResetStartTime( int fd )
+static void ShutdownStopped( Process *pProcess )
 {
-    LockData ldata;
-    off_t pos;
-    size_t len;
-    void *p;
-
-    int result = EINVAL;
+    Process *pParent;
+    size_t i;
 
-    if ( fd != -1 )
+    if ( ( pProcess != NULL ) &&
+         ( ( pProcess == pProcmonState->pMonitoredProcess ) ||
+           ( pProcess->stopPending == 0 ) ) )
     {
-        result = EOK;
-
-        /* calculate the offset and length of the terminate field
-         * in the LockData structure */
-        p = (void *)&(ldata.starttime);
-        pos = p - (void *)&ldata;
-        len = sizeof( ldata.starttime );
+        if ( pProcess->verbose == true )
+        {
+            printf( "%s stopped\n", pProcess->id );
+        }
 
-        /* set the starttime */
-        ldata.starttime = time(NULL);
+        remove_state( pProcess->id );
+        pProcess->supervised = false;
 
-        /* move to the offset within the lockdata file to write the starttime */
-        if( lseek( fd, pos, SEEK_SET ) != -1 )
+        if ( pProcess != pProcmonState->pMonitoredProcess )
         {
-            /* write the starttime into the lockdata file */
-            if ( write( fd, p, len ) != len )
+            for ( i = 0 ; i < pProcess->parents.count ; i++ )
             {
-                result = errno;
+                pParent = pProcess->parents.pProcesses[i];
+                if ( --pParent->stopPending == 0 )
+                {
+                    ShutdownProcess( pParent );
+                }
             }
         }
-        else
+
+        if ( --pProcmonState->shutdownPending == 0 )
         {
-            result = errno;
+            /* exit from the event loop once the request is complete */
+            EVENTLOOP_StartTimer( &pProcmonState->shutdownTimer,
+                                  0,
+                                  ShutdownComplete,
+                                  pProcmonState );
         }
     }
-
-    return result;
 }
 
 /*============================================================================*/
-/*  remove_lockfile                                                           */
+/*  ShutdownComplete                                                          */
 /*!
-    Remove a process lockfile
+    Complete the shutdown of the process monitor
 
-    The remove_lockfile function tries to delete the process lockfile
-    associated with the specified process id.
+    The ShutdownComplete function is invoked once all of the processes
+    have stopped.  The process monitor state records are removed and
+    the process monitor exits.
 
     @param[in]
-        pid
-            monitored process
-
-    @retval EOK - lock file successfully removed
-    @retval errno - error returned from unlink function
+        arg
+            pointer to the process monitor state
 
 ==============================================================================*/
-static int remove_lockfile( char *name )
+static void ShutdownComplete( void *arg )
 {
-    char lockfile[64];
-    int result = EINVAL;
+    ProcmonState *pState = (ProcmonState *)arg;
 
-    if ( name != NULL )
+    if ( pState != NULL )
     {
-        sprintf( lockfile, "/tmp/procmon.%s", name );
-        if ( unlink( lockfile ) == -1 )
-        {
-            result = errno;
-        }
-        else
+        if ( pState->verbose == true )
         {
-            result = EOK;
+            printf( "shutdown complete\n" );
         }
-    }
 
-    return result;
+        /* remove the process monitor state records */
+        remove_state( "procmon1" );
+        remove_state( "procmon2" );
+
+        (void)TRACE_Write();
+
+        exit( 0 );
+    }
 }
 
 /*============================================================================*/
-/*  ListProcesses                                                             */
+/*  MonitorProcmon                                                            */
 /*!
-    List all monitored processes
+    Monitor the process monitor process
+
+    The MonitorProcmon function creates and initializes a new process
+    which starts and monitors either the primary or secondary process
+    monitor depending on the value of the primary attribute in the
+    provided process monitor state object.
 
-    The ListProcesses function iterates through the /tmp/procmon.*
-    entries and displays information about the monitored processes
+    When processes are supervised by the event loop, the peer process
+    monitor is watched via a pidfd.  Otherwise a monitoring thread
+    is created for it.
 
     @param[in]
         pProcmonState
             pointer to the process monitor state
 
-    @retval EOK - processes listed successfully
+    @retval EOK - the process monitor was started successfully
+    @retval ENOMEM - memory allocation failure
     @retval EINVAL - invalid arguments
 
 ==============================================================================*/
-static int ListProcesses( ProcmonState *pProcmonState )
+static int MonitorProcmon( ProcmonState *pProcmonState )
 {
+    Process *p;
     int result = EINVAL;
-    DIR *dir = NULL;
-    struct dirent *entry;
-    char *pName;
-    int rc;
-    bool closeBracket = false;
-    int n = 0;
 
     if ( pProcmonState != NULL )
     {
-        result = EOK;
-
-        if ( pProcmonState->outputFormat == NULL )
-        {
-            printf( "%-15s %8s %8s %16s %7s   %s\n",
-                    "Process Name",
-                    "pid",
-                    "Restarts",
-                    "Since",
-                    "Status",
-                    "Command" );
-        }
-        else if ( strcmp( pProcmonState->outputFormat, "json" ) == 0 )
+        /* allocate memory for the monitored process object */
+        p = NewProcess();
+        if ( p != NULL )
         {
-            printf("[");
-            closeBracket = true;
-        }
+            p->verbose = pProcmonState->verbose;
+            p->monitored = true;
+            p->exitEvent.fd = -1;
+            p->readyEvent.fd = -1;
+            RESOURCES_Init( &p->resources );
+            METRICS_Init( &p->metrics, NULL );
 
-        dir = opendir( "/tmp" );
-        if( dir != NULL )
-        {
-            while( entry = readdir( dir ) )
+            /* the peer is passed its lock handle in its environment */
+            p->envp = malloc( ( pProcmonState->envCount + 5 ) *
+                              sizeof( char * ) +
+                              PROCMON_ENV_VARS );
+
+            /* store a reference to the monitored process */
+            pProcmonState->pMonitoredProcess = p;
+
+            result = SetupPeer( pProcmonState, p );
+            if ( result == EOK )
             {
-                if ( strncmp( entry->d_name, "procmon.", 8 ) == 0 )
+                if ( pProcmonState->supervisor == true )
                 {
-                    pName = &entry->d_name[8];
-                    rc = DisplayProcessInfo( pProcmonState, pName, n++ );
-                    if ( rc != EOK )
-                    {
-                        result = rc;
-                    }
+                    /* watch the peer process monitor from the event loop */
+                    p->supervised = true;
+                    p->state = PROCSTATE_eSTARTED;
+                    SupervisePeer( p );
+                }
+                else
+                {
+                    /* start the procmon process monitor */
+                    result = InitMonitorThread( p );
                 }
             }
-
-            closedir( dir );
         }
-
-        if ( closeBracket )
+        else
         {
-            printf("]");
+            result = ENOMEM;
         }
     }
 
@@ -2706,343 +11951,351 @@ static int ListProcesses( ProcmonState *pProcmonState )
 }
 
 /*============================================================================*/
-/*  DisplayProcessInfo                                                        */
+/*  SetupPeer                                                                 */
 /*!
-    Display information about the specified process
+    Set up the peer process monitor
 
-    The DisplayProcessInfo function displays information about a process
-    obtained from the process's lockfile, including the Name, PID, and
-    running state.
+    The SetupPeer function sets the process identifier and command of
+    the peer process monitor.  If we are the primary, we will be
+    monitoring the secondary and vice-versa.  The command and argument
+    vector are kept in the process monitor state.
 
     @param[in]
         pProcmonState
             pointer to the process monitor state
 
     @param[in]
-        name
-            name of the process to display
-
-    @param[in]
-        n
-            index of the displayed process (0=first)
+        p
+            pointer to the peer process monitor to set up
 
-    @retval EOK - process displayed successfully
+    @retval EOK - the peer process monitor was set up
     @retval EINVAL - invalid arguments
 
 ==============================================================================*/
-static int DisplayProcessInfo( ProcmonState *pProcmonState, char *name, int n )
+static int SetupPeer( ProcmonState *pProcmonState, Process *p )
 {
     int result = EINVAL;
-    int fd;
-    LockData ldata;
-    bool running;
-    char exec[BUFSIZ];
-    char proctime[64];
-    int len;
+    char *fileArg;
 
-    if ( ( pProcmonState != NULL ) &&
-         ( name != NULL ) )
+    if ( ( pProcmonState != NULL ) && ( p != NULL ) )
     {
-        /* clear the lock data */
-        memset( (void *)&ldata, 0, sizeof(LockData) );
-
-        /* open the lock file */
-        fd = open_lockfile( name );
-        if ( fd != -1 )
-        {
-            /* get the lock data */
-            if ( read( fd, &ldata, sizeof(LockData) ) == sizeof(LockData) )
-            {
-                /* check if process is running */
-                running = true;
-
-                if ( kill( ldata.pid, 0 ) == -1 )
-                {
-                    running = ( errno == ESRCH ) ? false : true;
-                }
-
-                /* read the execution string */
-                len = read( fd, exec, BUFSIZ );
-
-                /* calculate the process time */
-                (void)GetProcessTime( time(NULL) - ldata.starttime,
-                                      proctime,
-                                      sizeof(proctime) );
-
-                if ( pProcmonState->outputFormat == NULL )
-                {
-                    /* display the row of process data */
-                    printf( "%-15s %8d %8ld %16s %s : %.*s\n",
-                            name,
-                            ldata.pid,
-                            ldata.runcount,
-                            proctime,
-                            running ? "running" : "stopped",
-                            len,
-                            exec );
-                }
-                else if ( strcmp( pProcmonState->outputFormat, "json" ) == 0 )
-                {
-                    if ( n != 0 )
-                    {
-                        printf(",");
-                    }
-
-                    printf("{\"name\": \"%s\",", name );
-                    printf("\"pid\": %d,", ldata.pid );
-                    printf("\"runcount\": %ld,", ldata.runcount );
-                    printf("\"since\": \"%s\",", proctime );
-                    printf("\"state\": \"%s\",",running ? "running":"stopped" );
-                    printf("\"exec\": \"%.*s\"}", len, exec );
-                }
+        fileArg =  pProcmonState->primary ? "-f" : "-F";
+
+        /* build the command of the process we are starting/monitoring */
+        snprintf( pProcmonState->peerCommand,
+                  sizeof( pProcmonState->peerCommand ),
+                  pProcmonState->verbose ? "%s -v %s %s" : "%s %s %s",
+                  pProcmonState->argv0,
+                  fileArg,
+                  pProcmonState->configFile );
+
+        p->id = pProcmonState->primary ? "procmon2" : "procmon1";
+        p->exec = pProcmonState->peerCommand;
+        p->argv = pProcmonState->peerArgv;
+
+        /* build the argument vector directly so the paths
+         * are not split */
+        p->argv[0] = pProcmonState->argv0;
+        p->argv[1] = pProcmonState->verbose ? "-v" : fileArg;
+        p->argv[2] = pProcmonState->verbose ? fileArg
+                                            : pProcmonState->configFile;
+        p->argv[3] = pProcmonState->verbose ? pProcmonState->configFile
+                                            : NULL;
+        p->argv[4] = NULL;
+
+        /* the state record belongs to the new peer identifier */
+        p->pRecord = NULL;
+        p->pid = 0;
+        p->runcount = 0;
+
+        p->stopSignal = SIGTERM;
+        p->stopTimeout = PROCMON_STOP_TIMEOUT;
 
-                result = EOK;
-            }
-            else
-            {
-                result = errno;
-            }
-        }
-        else
-        {
-            result = errno;
-        }
+        result = EOK;
     }
 
     return result;
-
 }
 
 /*============================================================================*/
-/*  GetProcessTime                                                            */
+/*  SupervisePeer                                                             */
 /*!
-    Convert the process run/stop time into a human readable string
-
-    The GetProcessTime function converts the process run/stop time into
-    a string in the form <d>d<h>h<m>m<s>s where
-
-    <d> is the process run/stop time in days
-    <h> is the process run/stop time in hours
-    <m> is the process run/stop time in minutes
-    <s> is the process run/stop time in seconds
+    Supervise the peer process monitor
 
-    So, for example if a process has been running for 3 days, 12 hours,
-    45 minutes, and 37 seconds, the generated string will be: 3d12h45m37s
+    The SupervisePeer function is invoked when the peer process monitor
+    is first supervised, and whenever its pidfd indicates that it has
+    terminated.  The peer is alive while it holds the lock on its
+    process state record.  The function:
 
-    @param[in]
-        runtime
-            the process run/stop time in seconds
+    - stops supervising the peer if monitoring has been terminated
+    - waits for a command if monitoring has been suspended
+    - watches the peer for death if it is running
+    - promotes the secondary to primary if the primary is not running.
+      The primary takes over the running processes without restarting
+      them
+    - schedules the secondary to be started if it is not running
 
-    @param[in]
-        buf
-            pointer to a buffer to store the generated string
+    It is also invoked as a timer handler.
 
     @param[in]
-        len
-            length of the buffer to store the generated string
-
-    @retval EOK - time string was generated successfully
-    @retval EINVAL - invalid arguments
+        arg
+            pointer to the peer process monitor
 
 ==============================================================================*/
-static int GetProcessTime( long runtime, char *buf, size_t len )
+static void SupervisePeer( void *arg )
 {
-    int result = EINVAL;
-    int days;
-    int hours;
-    int mins;
-    int secs;
+    Process *pProcess = (Process *)arg;
+    StateRecord *pRecord;
+    uint32_t terminate = 0;
+    int64_t delay;
+    pid_t pid = 0;
+    int rc = EOK;
 
-    if ( buf != NULL )
+    if ( pProcess != NULL )
     {
-        if ( runtime < 60 )
+        pRecord = STATETABLE_Find( pProcess->id );
+        if ( pRecord != NULL )
         {
-            snprintf(buf, len, "%lds", runtime);
+            terminate = __atomic_load_n( &pRecord->data.terminate,
+                                         __ATOMIC_ACQUIRE );
+
+            /* the peer holds the lock on its record while it is alive */
+            rc = STATETABLE_Lock( pRecord, F_GETLK );
+            pid = __atomic_load_n( &pRecord->data.pid, __ATOMIC_ACQUIRE );
         }
-        else if ( runtime < 3600 )
+
+        if ( terminate == STATETABLE_STOP )
         {
-            mins = runtime / 60;
-            runtime -= ( mins * 60 );
-            secs = runtime;
-            snprintf(buf, len, "%dm%02ds", mins, secs );
+            /* terminate all monitoring and remove the process state */
+            remove_state( pProcess->id );
+            pProcess->supervised = false;
         }
-        else if ( runtime < 86400 )
+        else if ( terminate == STATETABLE_SUSPEND )
         {
-            hours = runtime / 3600;
-            runtime -= ( hours * 3600 );
-            mins = runtime / 60;
-            runtime -= ( mins * 60 );
-            secs = runtime;
-            snprintf(buf, len, "%dh%02dm%02ds", hours, mins, secs );
+            /* HandleCommand will check again when a command is issued */
+            pProcess->suspended = true;
         }
-        else
+        else if ( ( rc == EAGAIN ) && ( pid > 0 ) )
         {
-            days = runtime / 86400;
-            runtime -= ( days * 86400 );
-            hours = runtime / 3600;
-            runtime -= ( hours * 3600 );
-            mins = runtime / 60;
-            runtime -= ( mins * 60 );
-            secs = runtime;
-            snprintf(buf, len, "%dd%02dh%02dm%02ds", days, hours, mins, secs );
+            /* the peer is running */
+            pProcess->startTime = EVENTLOOP_GetTime();
+            WatchProcess( pProcess, pid );
+        }
+        else if ( pProcmonState->primary == false )
+        {
+            /* the primary has failed, so take over from it */
+            PromoteToPrimary( pProcmonState );
         }
+        else if ( RestartAllowed( pProcess, &delay ) )
+        {
+            pProcess->runcount++;
 
-        result = EOK;
+            /* wait before restarting the secondary */
+            EVENTLOOP_StartTimer( &pProcess->restartTimer,
+                                  delay,
+                                  SpawnProcess,
+                                  pProcess );
+        }
+        else
+        {
+            /* HandleCommand will check again when a command is issued */
+            pProcess->suspended = true;
+        }
     }
-
-    return result;
 }
 
 /*============================================================================*/
-/*  ShutdownAllProcesses                                                      */
+/*  PromoteToPrimary                                                          */
 /*!
-    Shut down all monitored processes
+    Promote the secondary process monitor to primary
+
+    The PromoteToPrimary function is invoked by the secondary process
+    monitor when the primary is not running.  It takes over the primary
+    process state record lock, processes the configuration file and
+    starts a new secondary process monitor.
 
-    The ShutdownAllProcesses function iterates through all the procmon lock
-    files in the /tmp directory and shuts them down one by one.
+    Processes which are still running are adopted by the new primary
+    via their process state records and are not restarted.
 
     @param[in]
         pProcmonState
             pointer to the process monitor state
 
-    @retval EOK - all processes shut down successfully
+    @retval EOK - the secondary has been promoted to primary
     @retval EINVAL - invalid arguments
-    @retval other - one or more processes could not be shut down
+    @retval other - the primary process lock could not be created
 
 ==============================================================================*/
-static int ShutdownAllProcesses( ProcmonState *pProcmonState )
+static int PromoteToPrimary( ProcmonState *pProcmonState )
 {
     int result = EINVAL;
-    DIR *dir = NULL;
-    struct dirent *entry;
-    char *pName;
-    int rc;
+    Process *pPeer;
+    Process *pOld;
 
-    if ( pProcmonState != NULL )
+    if ( ( pProcmonState != NULL ) &&
+         ( pProcmonState->pMonitoredProcess != NULL ) )
     {
-        result = EOK;
-
-        printf("shutting down all processes....\n");
+        pPeer = pProcmonState->pMonitoredProcess;
+        pOld = pProcmonState->pProcess;
 
-        dir = opendir( "/tmp" );
-        if( dir != NULL )
+        syslog( LOG_NOTICE, "procmon secondary taking over as primary" );
+        if ( pProcmonState->verbose == true )
         {
-            while( entry = readdir( dir ) )
-            {
-                if ( strncmp( entry->d_name, "procmon.", 8 ) == 0 )
-                {
-                    pName = &entry->d_name[8];
-
-                    /* shutdown all processes except the process monitor
-                     * processes to give them a chance to clean up */
-                    if ( strncmp( pName, "procmon", 7 ) != 0 )
-                    {
-                        printf("terminating %s\n", pName );
-                        rc = terminate_and_stop_monitoring( pName );
-                        if ( rc != EOK )
-                        {
-                            fprintf( stderr,
-                                    "Failed to terminate %s (%s)\n",
-                                    pName,
-                                    strerror(rc));
-                            result = rc;
-
-                            /* remove the lock file */
-                            remove_lockfile( pName );
-                        }
-                    }
-                }
-            }
-
-            closedir( dir );
+            printf("Taking over as the primary process monitor\n");
         }
 
-        /* give processes a chance to shut down and be properly cleaned
-         * up before we shutdown the process monitor processes */
-        sleep(1);
+        /* release the secondary process lock so a new secondary
+         * can be started */
+        if ( pProcmonState->lockfd != -1 )
+        {
+            close( pProcmonState->lockfd );
+            pProcmonState->lockfd = -1;
+        }
 
-        /* terminate the process monitor primary and secondary */
-        terminate_and_stop_monitoring( "procmon1" );
-        terminate_and_stop_monitoring( "procmon1" );
+        pProcmonState->primary = true;
 
-        /* give process monitor processes a chance to shutdown */
-        sleep( 1 );
+        /* take over the primary process lock */
+        result = MakeOwnLock( pProcmonState );
+        if ( result == EOK )
+        {
+            DiscardProcess( pOld );
 
-        /* remove the process monitor lockfiles */
-        remove_lockfile( "procmon1" );
-        remove_lockfile( "procmon2" );
+            /* the peer is now the secondary process monitor */
+            if ( SetupPeer( pProcmonState, pPeer ) == EOK )
+            {
+                StartPrimary( pProcmonState );
+                SupervisePeer( pPeer );
+            }
+        }
+        else
+        {
+            fprintf( stderr,
+                     "Failed to take over the primary lock (%s)\n",
+                     strerror( result ) );
+        }
     }
 
     return result;
 }
 
 /*============================================================================*/
-/*  MonitorProcmon                                                            */
+/*  StartPrimary                                                              */
 /*!
-    Monitor the process monitor process
+    Start the primary process monitor services
 
-    The MonitorProcmon function creates and initializes a new process
-    which starts and monitors either the primary or secondary process
-    monitor depending on the value of the primary attribute in the
-    provided process monitor state object.
+    The StartPrimary function creates the control socket, processes the
+    configuration file and installs the configuration reload signal.
+    It is invoked once by the primary process monitor, either at startup
+    or when the secondary takes over from a failed primary.
 
     @param[in]
         pProcmonState
             pointer to the process monitor state
 
-    @retval EOK - the process monitor was started successfully
+    @retval EOK - the primary process monitor services were started
+    @retval EALREADY - the primary process monitor services are running
     @retval EINVAL - invalid arguments
 
 ==============================================================================*/
-static int MonitorProcmon( ProcmonState *pProcmonState )
+static int StartPrimary( ProcmonState *pProcmonState )
 {
-    Process *p;
-    char cmd[BUFSIZ];
     int result = EINVAL;
-    char *fileArg;
 
     if ( pProcmonState != NULL )
     {
-        /* allocate memory for the monitored process object */
-        p = calloc( 1, sizeof( Process ) );
-        if ( p != NULL )
+        if ( pProcmonState->serving == false )
         {
-            /* if we are the primary, we will be monitoring the secondary
-             * and vice-versa */
-            fileArg =  pProcmonState->primary ? "-f" : "-F";
+            pProcmonState->serving = true;
+            result = EOK;
 
-            /* build the command of the process we are starting/monitoring */
-            snprintf( cmd,
-                      BUFSIZ,
-                      pProcmonState->verbose ? "%s -v %s %s" : "%s %s %s",
-                      pProcmonState->argv0,
-                      fileArg,
-                      pProcmonState->configFile );
+            /* serve process status queries */
+            if ( CONTROL_Listen( PROCMON_CONTROL_SOCKET,
+                                 HandleControlRequest,
+                                 pProcmonState ) != EOK )
+            {
+                fprintf( stderr,
+                         "Failed to create the control socket %s\n",
+                         PROCMON_CONTROL_SOCKET );
+            }
 
-            /* build the procmonProcess object */
-            p->exec = strdup(cmd);
-            p->verbose = pProcmonState->verbose;
-            p->monitored = true;
-            p->id = pProcmonState->primary ? "procmon2" : "procmon1";
+            if ( pProcmonState->verbose == true )
+            {
+                printf("Processing the config file \n");
+            }
 
-            /* store a reference to the monitored process */
-            pProcmonState->pMonitoredProcess = p;
+            /* the primary process monitor processes the config file */
+            ProcessConfigFile( pProcmonState );
 
-            /* start the procmon process monitor */
-            result = InitProcess( p );
+            /* reload the config file on SIGHUP */
+            if ( InitReloadSignal( pProcmonState ) != EOK )
+            {
+                fprintf( stderr, "Failed to create the reload signal\n" );
+            }
+        }
+        else
+        {
+            result = EALREADY;
         }
     }
 
     return result;
 }
 
+/*============================================================================*/
+/*  OpenOwnLock                                                               */
+/*!
+    Open the lock handle of the process monitor
+
+    The OpenOwnLock function gets the lock handle through which the
+    process monitor holds its process lock.  A process monitor which was
+    launched by its peer adopts the lock handle passed to it in the
+    PROCMON_LOCK_FD variable, which already holds its process lock.
+    Otherwise a new lock handle is opened.
+
+    @retval file descriptor of the lock handle
+    @retval -1 - the lock handle could not be opened (see errno)
+
+==============================================================================*/
+static int OpenOwnLock( void )
+{
+    struct stat handle;
+    struct stat table;
+    char *var;
+    int fd = -1;
+
+    var = getenv( PROCMON_LOCK_FD );
+    if ( var != NULL )
+    {
+        /* only a lock handle of the state table is adopted */
+        fd = atoi( var );
+        if ( ( fstat( fd, &handle ) == 0 ) &&
+             ( fstat( STATETABLE_GetFd(), &table ) == 0 ) &&
+             ( handle.st_dev == table.st_dev ) &&
+             ( handle.st_ino == table.st_ino ) )
+        {
+            /* the processes we launch are passed their own handles */
+            fcntl( fd, F_SETFD, FD_CLOEXEC );
+        }
+        else
+        {
+            fd = -1;
+        }
+
+        /* the lock handle is only adopted once */
+        unsetenv( PROCMON_LOCK_FD );
+    }
+
+    return ( fd != -1 ) ? fd : STATETABLE_OpenLock();
+}
+
 /*============================================================================*/
 /*  MakeOwnLock                                                               */
 /*!
-    Create a lockfile for the procmon process
+    Create a process lock for the procmon process
 
-    The MakeOwnLock function creates a new lockfile for the process monitor.
-    It will create a lock file for the primary or secondary process monitor,
+    The MakeOwnLock function creates a new process lock for the process
+    monitor.  It will create a process state record and lock for the
+    primary or secondary process monitor,
     depending on the value of the "primary" attribute in the ProcmonState
     object.
 
@@ -3050,7 +12303,7 @@ static int MonitorProcmon( ProcmonState *pProcmonState )
         pProcmonState
             pointer to the process monitor state
 
-    @retval EOK - the process monitor lock file was created successfully
+    @retval EOK - the process monitor lock was created successfully
     @retval ENOMEM - memory allocation failure
     @retval EINVAL - invalid arguments
 
@@ -3060,12 +12313,11 @@ static int MakeOwnLock( ProcmonState *pProcmonState )
     int result = EINVAL;
     Process *p;
     char *fileArg;
-    char cmd[BUFSIZ];
 
     if ( pProcmonState != NULL )
     {
         /* allocate the process object */
-        p = calloc( 1, sizeof( Process ) );
+        p = NewProcess();
         if ( p != NULL )
         {
             /* get the process identifier */
@@ -3082,20 +12334,29 @@ static int MakeOwnLock( ProcmonState *pProcmonState )
 
             /* generate the command to show in the process list */
             fileArg =  pProcmonState->primary ? "-F" : "-f";
-            snprintf( cmd,
-                      BUFSIZ,
+            snprintf( pProcmonState->ownCommand,
+                      sizeof( pProcmonState->ownCommand ),
                       pProcmonState->verbose ? "%s -v %s %s" : "%s %s %s",
                       pProcmonState->argv0,
                       fileArg,
                       pProcmonState->configFile );
 
-            p->exec = strdup(cmd);
+            p->exec = pProcmonState->ownCommand;
 
             /* store a reference to the process object */
             pProcmonState->pProcess = p;
 
-            /* create the lock file */
-            result = makelock(p);
+            /* create the process lock on a lock handle of our own, since
+             * a POSIX record lock would be released when any descriptor
+             * of the state table is closed, such as a standby lock handle */
+            if ( pProcmonState->lockfd == -1 )
+            {
+                pProcmonState->lockfd = OpenOwnLock();
+            }
+
+            result = ( pProcmonState->lockfd != -1 )
+                     ? makelock( p, pProcmonState->lockfd )
+                     : errno;
         }
         else
         {
@@ -0,0 +1,954 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup resources resources
+ * @brief Process resource limits
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file resources.c
+
+    Process Resource Limits
+
+    The resources module places launched processes into cgroup v2
+    cgroups with cpu.max and memory.max limits, and sets their CPU
+    affinity, nice value and I/O priority.
+
+    The instances of a replicated process can be pinned to their own
+    CPU, or to their own NUMA node, by RESOURCES_Pin, which spreads them
+    round robin across the CPUs or nodes the process is allowed to use.
+
+    The work is split in two.  RESOURCES_Prepare runs in the process
+    monitor before a process is launched, and creates the cgroup and
+    writes its limits.  RESOURCES_Apply runs in the launched child
+    before it executes the process.  Since the child shares the memory
+    of the process monitor at that point, RESOURCES_Apply only makes
+    system calls.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "resources.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! ioprio_set target type for a single process */
+#define IOPRIO_WHO_PROCESS      ( 1 )
+
+/*! number of bits used by the I/O priority level */
+#define IOPRIO_CLASS_SHIFT      ( 13 )
+
+/*! real time I/O scheduling class */
+#define IOPRIO_CLASS_RT         ( 1 )
+
+/*! best effort I/O scheduling class */
+#define IOPRIO_CLASS_BE         ( 2 )
+
+/*! idle I/O scheduling class */
+#define IOPRIO_CLASS_IDLE       ( 3 )
+
+/*! default I/O priority level within a scheduling class */
+#define IOPRIO_DEFAULT_LEVEL    ( 4 )
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int MakeCgroup( ProcessResources *pResources, char *path );
+static int EnableControllers( ProcessResources *pResources, char *path );
+static int WriteFile( char *dir, char *name, char *value );
+static bool SameString( const char *s1, const char *s2 );
+static int ReadCpuList( const char *path, cpu_set_t *pCpuset );
+static int GetNodeCpus( size_t n,
+                        const cpu_set_t *pAllowed,
+                        cpu_set_t *pCpuset );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  RESOURCES_Init                                                            */
+/*!
+    Initialize a process resources object
+
+    The RESOURCES_Init function initializes a process resources object
+    which leaves all of the process resources unchanged.
+
+    @param[in]
+        pResources
+            pointer to the process resources object to initialize
+
+==============================================================================*/
+void RESOURCES_Init( ProcessResources *pResources )
+{
+    if ( pResources != NULL )
+    {
+        memset( pResources, 0, sizeof( ProcessResources ) );
+        pResources->cgroupfd = -1;
+    }
+}
+
+/*============================================================================*/
+/*  RESOURCES_ParseCpuset                                                     */
+/*!
+    Parse a CPU list
+
+    The RESOURCES_ParseCpuset function parses a CPU list in the cpuset
+    list format ( eg "0-3,6" ) into a CPU set.
+
+    @param[in]
+        cpuset
+            pointer to the CPU list to parse
+
+    @param[out]
+        pCpuset
+            pointer to the CPU set to store the parsed CPU list in
+
+    @retval EOK - the CPU list was parsed
+    @retval EINVAL - invalid CPU list
+
+==============================================================================*/
+int RESOURCES_ParseCpuset( const char *cpuset, cpu_set_t *pCpuset )
+{
+    int result = EINVAL;
+    const char *p = cpuset;
+    char *end;
+    unsigned long first;
+    unsigned long last;
+    unsigned long cpu;
+
+    if ( ( cpuset != NULL ) && ( pCpuset != NULL ) )
+    {
+        CPU_ZERO( pCpuset );
+        result = EOK;
+
+        do
+        {
+            first = strtoul( p, &end, 10 );
+            last = first;
+
+            if ( end == p )
+            {
+                result = EINVAL;
+            }
+            else if ( *end == '-' )
+            {
+                p = end + 1;
+                last = strtoul( p, &end, 10 );
+                if ( ( end == p ) || ( last < first ) )
+                {
+                    result = EINVAL;
+                }
+            }
+
+            if ( ( result == EOK ) && ( last >= CPU_SETSIZE ) )
+            {
+                result = EINVAL;
+            }
+
+            for ( cpu = first; ( result == EOK ) && ( cpu <= last ); cpu++ )
+            {
+                CPU_SET( cpu, pCpuset );
+            }
+
+            p = end + 1;
+
+        } while ( ( result == EOK ) && ( *end == ',' ) );
+
+        if ( ( result == EOK ) && ( *end != '\0' ) )
+        {
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RESOURCES_ParseIoPriority                                                 */
+/*!
+    Parse an I/O priority
+
+    The RESOURCES_ParseIoPriority function parses an I/O priority
+    of the form "<class>[/<level>]", where class is one of "rt",
+    "be" or "idle", and level is 0 ( highest ) to 7 ( lowest ).
+
+    @param[in]
+        ioprio
+            pointer to the I/O priority to parse
+
+    @param[out]
+        pValue
+            pointer to a location to store the I/O priority value
+            as passed to ioprio_set
+
+    @retval EOK - the I/O priority was parsed
+    @retval EINVAL - invalid I/O priority
+
+==============================================================================*/
+int RESOURCES_ParseIoPriority( const char *ioprio, int *pValue )
+{
+    int result = EINVAL;
+    int class = 0;
+    int level = IOPRIO_DEFAULT_LEVEL;
+    const char *p;
+    char *end;
+    size_t len;
+
+    if ( ( ioprio != NULL ) && ( pValue != NULL ) )
+    {
+        p = strchr( ioprio, '/' );
+        len = ( p != NULL ) ? (size_t)( p - ioprio ) : strlen( ioprio );
+
+        if ( ( len == 2 ) && ( strncmp( ioprio, "rt", len ) == 0 ) )
+        {
+            class = IOPRIO_CLASS_RT;
+        }
+        else if ( ( len == 2 ) && ( strncmp( ioprio, "be", len ) == 0 ) )
+        {
+            class = IOPRIO_CLASS_BE;
+        }
+        else if ( ( len == 4 ) && ( strncmp( ioprio, "idle", len ) == 0 ) )
+        {
+            class = IOPRIO_CLASS_IDLE;
+            level = 0;
+        }
+
+        if ( ( class != 0 ) && ( p != NULL ) )
+        {
+            level = strtol( p + 1, &end, 10 );
+            if ( ( end == p + 1 ) || ( *end != '\0' ) ||
+                 ( level < 0 ) || ( level > 7 ) )
+            {
+                class = 0;
+            }
+        }
+
+        if ( class != 0 )
+        {
+            *pValue = ( class << IOPRIO_CLASS_SHIFT ) | level;
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RESOURCES_Pin                                                             */
+/*!
+    Pin an instance of a replicated process
+
+    The RESOURCES_Pin function sets the CPU affinity of one instance of
+    a replicated process according to a pinning policy.  The instances
+    are spread round robin across the CPUs the process is allowed to
+    use, which are those of its cpuset, or those of the process monitor
+    if it has no cpuset.
+
+    - core - the instance is pinned to a single CPU
+    - numa - the instance is pinned to the CPUs of a single NUMA node.
+             Nodes which have none of the allowed CPUs are skipped, and
+             a system without NUMA information is treated as one node.
+
+    @param[in,out]
+        pResources
+            pointer to the resources of the instance
+
+    @param[in]
+        policy
+            pointer to the name of the pinning policy
+
+    @param[in]
+        index
+            index of the instance in its replica group
+
+    @param[out]
+        pCpuset
+            pointer to the storage for the CPU set of the instance, which
+            its resources refer to once it has been pinned
+
+    @retval EOK - the instance was pinned
+    @retval EINVAL - invalid pinning policy
+    @retval ENOENT - there are no CPUs to pin the instance to
+    @retval other - error from sched_getaffinity
+
+==============================================================================*/
+int RESOURCES_Pin( ProcessResources *pResources,
+                   const char *policy,
+                   size_t index,
+                   cpu_set_t *pCpuset )
+{
+    int result = EINVAL;
+    cpu_set_t allowed;
+    size_t count = 0;
+    size_t n;
+    int cpu;
+
+    if ( ( pResources != NULL ) && ( policy != NULL ) && ( pCpuset != NULL ) )
+    {
+        result = EOK;
+        CPU_ZERO( pCpuset );
+
+        if ( pResources->pCpuset != NULL )
+        {
+            allowed = *pResources->pCpuset;
+        }
+        else if ( sched_getaffinity( 0, sizeof( allowed ), &allowed ) != 0 )
+        {
+            result = errno;
+        }
+
+        if ( result != EOK )
+        {
+            /* the allowed CPUs are not known */
+        }
+        else if ( strcmp( policy, "core" ) == 0 )
+        {
+            count = CPU_COUNT( &allowed );
+            n = ( count > 0 ) ? index % count : 0;
+
+            for ( cpu = 0 ; ( count > 0 ) && ( cpu < CPU_SETSIZE ) ; cpu++ )
+            {
+                if ( CPU_ISSET( cpu, &allowed ) && ( n-- == 0 ) )
+                {
+                    CPU_SET( cpu, pCpuset );
+                    break;
+                }
+            }
+        }
+        else if ( strcmp( policy, "numa" ) == 0 )
+        {
+            /* count the nodes which have allowed CPUs */
+            while ( GetNodeCpus( count, &allowed, pCpuset ) == EOK )
+            {
+                count++;
+            }
+
+            if ( count > 0 )
+            {
+                result = GetNodeCpus( index % count, &allowed, pCpuset );
+            }
+            else
+            {
+                *pCpuset = allowed;
+            }
+        }
+        else
+        {
+            result = EINVAL;
+        }
+
+        if ( ( result == EOK ) && ( CPU_COUNT( pCpuset ) == 0 ) )
+        {
+            result = ENOENT;
+        }
+
+        if ( result == EOK )
+        {
+            pResources->pCpuset = pCpuset;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RESOURCES_Inherit                                                         */
+/*!
+    Inherit process resources from a parent process
+
+    The RESOURCES_Inherit function copies the resource settings of a
+    parent process which have not been specified for a process.
+
+    The cgroup and its cpu.max and memory.max limits are inherited
+    together, and only if the process does not specify its own cgroup,
+    so the process joins its parent's cgroup and shares its limits.
+    The CPU affinity, nice value and I/O priority are inherited
+    individually.
+
+    @param[in,out]
+        pResources
+            pointer to the process resources to update
+
+    @param[in]
+        pParent
+            pointer to the resources of the parent process
+
+==============================================================================*/
+void RESOURCES_Inherit( ProcessResources *pResources,
+                        const ProcessResources *pParent )
+{
+    if ( ( pResources != NULL ) && ( pParent != NULL ) )
+    {
+        if ( pResources->cgroup == NULL )
+        {
+            pResources->cgroup = pParent->cgroup;
+            pResources->cpu_max = pParent->cpu_max;
+            pResources->memory_max = pParent->memory_max;
+        }
+
+        if ( pResources->pCpuset == NULL )
+        {
+            pResources->pCpuset = pParent->pCpuset;
+        }
+
+        if ( pResources->setNice == false )
+        {
+            pResources->setNice = pParent->setNice;
+            pResources->nice = pParent->nice;
+        }
+
+        if ( pResources->ioprio == 0 )
+        {
+            pResources->ioprio = pParent->ioprio;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  RESOURCES_Equal                                                           */
+/*!
+    Compare two sets of process resources
+
+    The RESOURCES_Equal function checks if two sets of process resources
+    would place a process in the same cgroup with the same limits and
+    scheduling attributes.  The open cgroup.procs file is not compared.
+
+    @param[in]
+        pResources1
+            pointer to the first set of process resources
+
+    @param[in]
+        pResources2
+            pointer to the second set of process resources
+
+    @retval true - the process resources are the same
+    @retval false - the process resources are different
+
+==============================================================================*/
+bool RESOURCES_Equal( const ProcessResources *pResources1,
+                      const ProcessResources *pResources2 )
+{
+    bool equal = false;
+
+    if ( ( pResources1 != NULL ) && ( pResources2 != NULL ) )
+    {
+        equal = SameString( pResources1->cgroup, pResources2->cgroup ) &&
+                SameString( pResources1->cpu_max, pResources2->cpu_max ) &&
+                SameString( pResources1->memory_max,
+                            pResources2->memory_max ) &&
+                ( pResources1->setNice == pResources2->setNice ) &&
+                ( pResources1->nice == pResources2->nice ) &&
+                ( pResources1->ioprio == pResources2->ioprio );
+
+        if ( ( pResources1->pCpuset == NULL ) ||
+             ( pResources2->pCpuset == NULL ) )
+        {
+            equal = equal &&
+                    ( pResources1->pCpuset == pResources2->pCpuset );
+        }
+        else
+        {
+            equal = equal &&
+                    CPU_EQUAL( pResources1->pCpuset, pResources2->pCpuset );
+        }
+    }
+
+    return equal;
+}
+
+/*============================================================================*/
+/*  RESOURCES_Prepare                                                         */
+/*!
+    Prepare the cgroup of a process
+
+    The RESOURCES_Prepare function creates the cgroup of a process
+    ( and any missing parent cgroups ), enables the cpu and memory
+    controllers needed for its limits, writes its cpu.max and memory.max
+    limits, and opens its cgroup.procs file so the launched child can
+    move itself into the cgroup.
+
+    The cgroup is only prepared once.  Subsequent calls do nothing.
+
+    @param[in]
+        pResources
+            pointer to the process resources
+
+    @retval EOK - the cgroup is ready, or no cgroup is required
+    @retval EINVAL - invalid arguments
+    @retval ENAMETOOLONG - the cgroup path is too long
+    @retval other - error creating or configuring the cgroup
+
+==============================================================================*/
+int RESOURCES_Prepare( ProcessResources *pResources )
+{
+    int result = EINVAL;
+    char path[PATH_MAX];
+    char *cgroup;
+    int n;
+
+    if ( pResources != NULL )
+    {
+        result = EOK;
+
+        if ( ( pResources->cgroup != NULL ) && ( pResources->cgroupfd == -1 ) )
+        {
+            /* cgroups are always relative to the cgroup root */
+            cgroup = pResources->cgroup;
+            while ( *cgroup == '/' )
+            {
+                cgroup++;
+            }
+
+            n = snprintf( path,
+                          sizeof( path ),
+                          "%s/%s",
+                          RESOURCES_CGROUP_ROOT,
+                          cgroup );
+            if ( ( n < 0 ) || ( (size_t)n >= sizeof( path ) ) )
+            {
+                result = ENAMETOOLONG;
+            }
+            else
+            {
+                result = MakeCgroup( pResources, path );
+            }
+
+            if ( ( result == EOK ) && ( pResources->cpu_max != NULL ) )
+            {
+                result = WriteFile( path, "cpu.max", pResources->cpu_max );
+            }
+
+            if ( ( result == EOK ) && ( pResources->memory_max != NULL ) )
+            {
+                result = WriteFile( path,
+                                    "memory.max",
+                                    pResources->memory_max );
+            }
+
+            if ( ( result == EOK ) &&
+                 ( strlen( path ) + strlen( "/cgroup.procs" ) <
+                   sizeof( path ) ) )
+            {
+                strcat( path, "/cgroup.procs" );
+                pResources->cgroupfd = open( path, O_WRONLY | O_CLOEXEC );
+                if ( pResources->cgroupfd == -1 )
+                {
+                    result = errno;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RESOURCES_Apply                                                           */
+/*!
+    Apply the process resources to the calling process
+
+    The RESOURCES_Apply function is invoked in a launched child before
+    it executes its process.  It moves the child into its prepared
+    cgroup, and sets its CPU affinity, nice value and I/O priority.
+
+    Only system calls are made, since the child may be sharing the
+    memory of the process monitor.  All of the settings are attempted
+    even if one of them fails.
+
+    @param[in]
+        pResources
+            pointer to the process resources
+
+    @retval EOK - the process resources were applied
+    @retval EINVAL - invalid arguments
+    @retval other - error from the last setting which failed
+
+==============================================================================*/
+int RESOURCES_Apply( ProcessResources *pResources )
+{
+    int result = EINVAL;
+
+    if ( pResources != NULL )
+    {
+        result = EOK;
+
+        /* writing 0 to cgroup.procs moves the writing process */
+        if ( ( pResources->cgroupfd != -1 ) &&
+             ( write( pResources->cgroupfd, "0", 1 ) != 1 ) )
+        {
+            result = errno;
+        }
+
+        if ( ( pResources->pCpuset != NULL ) &&
+             ( sched_setaffinity( 0,
+                                  sizeof( cpu_set_t ),
+                                  pResources->pCpuset ) == -1 ) )
+        {
+            result = errno;
+        }
+
+        if ( ( pResources->setNice == true ) &&
+             ( setpriority( PRIO_PROCESS, 0, pResources->nice ) == -1 ) )
+        {
+            result = errno;
+        }
+
+        if ( ( pResources->ioprio != 0 ) &&
+             ( syscall( SYS_ioprio_set,
+                        IOPRIO_WHO_PROCESS,
+                        0,
+                        pResources->ioprio ) == -1 ) )
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MakeCgroup                                                                */
+/*!
+    Create a cgroup and its parent cgroups
+
+    The MakeCgroup function creates each missing cgroup in the specified
+    path below the cgroup root.  The controllers needed by the process
+    limits are enabled in each parent cgroup before its child cgroup
+    is created.
+
+    @param[in]
+        pResources
+            pointer to the process resources
+
+    @param[in]
+        path
+            absolute path of the cgroup to create
+
+    @retval EOK - the cgroup exists
+    @retval other - error from mkdir
+
+==============================================================================*/
+static int MakeCgroup( ProcessResources *pResources, char *path )
+{
+    int result = EOK;
+    char *p = path + strlen( RESOURCES_CGROUP_ROOT );
+
+    while ( ( result == EOK ) && ( p != NULL ) )
+    {
+        /* enable the controllers in the parent of the next cgroup */
+        *p = '\0';
+        (void)EnableControllers( pResources, path );
+        *p = '/';
+
+        p = strchr( p + 1, '/' );
+        if ( p != NULL )
+        {
+            *p = '\0';
+        }
+
+        if ( ( mkdir( path, 0755 ) == -1 ) && ( errno != EEXIST ) )
+        {
+            result = errno;
+        }
+
+        if ( p != NULL )
+        {
+            *p = '/';
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EnableControllers                                                         */
+/*!
+    Enable the controllers needed by the process limits
+
+    The EnableControllers function enables the cpu and/or memory
+    controllers for the children of the specified cgroup, if the
+    process has cpu.max and/or memory.max limits.
+
+    @param[in]
+        pResources
+            pointer to the process resources
+
+    @param[in]
+        path
+            path of the parent cgroup
+
+    @retval EOK - the controllers were enabled
+    @retval other - error writing cgroup.subtree_control
+
+==============================================================================*/
+static int EnableControllers( ProcessResources *pResources, char *path )
+{
+    int result = EOK;
+
+    if ( pResources->cpu_max != NULL )
+    {
+        result = WriteFile( path, "cgroup.subtree_control", "+cpu" );
+    }
+
+    if ( ( result == EOK ) && ( pResources->memory_max != NULL ) )
+    {
+        result = WriteFile( path, "cgroup.subtree_control", "+memory" );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WriteFile                                                                 */
+/*!
+    Write a value to a cgroup interface file
+
+    @param[in]
+        dir
+            path of the cgroup directory
+
+    @param[in]
+        name
+            name of the interface file
+
+    @param[in]
+        value
+            value to write
+
+    @retval EOK - the value was written
+    @retval ENAMETOOLONG - the file path is too long
+    @retval other - error from open or write
+
+==============================================================================*/
+static int WriteFile( char *dir, char *name, char *value )
+{
+    int result = EOK;
+    char path[PATH_MAX];
+    size_t len = strlen( value );
+    int fd;
+    int n;
+
+    n = snprintf( path, sizeof( path ), "%s/%s", dir, name );
+    if ( ( n < 0 ) || ( (size_t)n >= sizeof( path ) ) )
+    {
+        result = ENAMETOOLONG;
+    }
+    else
+    {
+        fd = open( path, O_WRONLY | O_CLOEXEC );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            if ( write( fd, value, len ) != (ssize_t)len )
+            {
+                result = errno;
+            }
+
+            close( fd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SameString                                                                */
+/*!
+    Compare two optional strings
+
+    @param[in]
+        s1
+            pointer to the first string, or NULL
+
+    @param[in]
+        s2
+            pointer to the second string, or NULL
+
+    @retval true - both strings are NULL or have the same content
+    @retval false - the strings are different
+
+==============================================================================*/
+static bool SameString( const char *s1, const char *s2 )
+{
+    return ( ( s1 == NULL ) || ( s2 == NULL ) ) ? ( s1 == s2 )
+                                                : ( strcmp( s1, s2 ) == 0 );
+}
+
+/*============================================================================*/
+/*  GetNodeCpus                                                               */
+/*!
+    Get the allowed CPUs of a NUMA node
+
+    The GetNodeCpus function gets the CPUs of the nth online NUMA node
+    which has any of the allowed CPUs, counting from 0.
+
+    @param[in]
+        n
+            number of the node amongst the online nodes with allowed CPUs
+
+    @param[in]
+        pAllowed
+            pointer to the allowed CPUs
+
+    @param[out]
+        pCpuset
+            pointer to a location to store the allowed CPUs of the node
+
+    @retval EOK - the CPUs of the node were stored
+    @retval ENOENT - there are not that many nodes with allowed CPUs
+    @retval other - the online nodes could not be read
+
+==============================================================================*/
+static int GetNodeCpus( size_t n,
+                        const cpu_set_t *pAllowed,
+                        cpu_set_t *pCpuset )
+{
+    int result;
+    cpu_set_t nodes;
+    char path[PATH_MAX];
+    int node;
+
+    result = ReadCpuList( RESOURCES_NODE_ROOT "/online", &nodes );
+    if ( result == EOK )
+    {
+        result = ENOENT;
+
+        for ( node = 0 ; node < CPU_SETSIZE ; node++ )
+        {
+            if ( CPU_ISSET( node, &nodes ) )
+            {
+                snprintf( path,
+                          sizeof( path ),
+                          RESOURCES_NODE_ROOT "/node%d/cpulist",
+                          node );
+
+                if ( ReadCpuList( path, pCpuset ) == EOK )
+                {
+                    /* skip the nodes which have none of the allowed CPUs */
+                    CPU_AND( pCpuset, pCpuset, pAllowed );
+                    if ( ( CPU_COUNT( pCpuset ) > 0 ) && ( n-- == 0 ) )
+                    {
+                        result = EOK;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ReadCpuList                                                               */
+/*!
+    Read a CPU list file
+
+    The ReadCpuList function reads a sysfs file containing a list of
+    CPUs or nodes in the cpuset format, eg "0-3,8".
+
+    @param[in]
+        path
+            path of the file to read
+
+    @param[out]
+        pCpuset
+            pointer to a location to store the CPUs of the list
+
+    @retval EOK - the list was read
+    @retval EINVAL - the file does not contain a CPU list
+    @retval other - error from open or read
+
+==============================================================================*/
+static int ReadCpuList( const char *path, cpu_set_t *pCpuset )
+{
+    int result = EINVAL;
+    char buf[BUFSIZ];
+    ssize_t n;
+    int fd;
+
+    fd = open( path, O_RDONLY | O_CLOEXEC );
+    if ( fd == -1 )
+    {
+        result = errno;
+    }
+    else
+    {
+        n = read( fd, buf, sizeof( buf ) - 1 );
+        if ( n < 0 )
+        {
+            result = errno;
+        }
+        else
+        {
+            /* strip the trailing newline */
+            buf[n] = '\0';
+            buf[strcspn( buf, "\n" )] = '\0';
+
+            result = RESOURCES_ParseCpuset( buf, pCpuset );
+        }
+
+        close( fd );
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of resources group */
@@ -0,0 +1,1090 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup statetable statetable
+ * @brief Process monitor shared state table
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file statetable.c
+
+    Process Monitor State Table
+
+    The statetable module manages a fixed layout array of process
+    state records in a shared memory region (/dev/shm/procmon) which
+    is shared by the primary and backup process monitors and the
+    procmon command line tools.
+
+    Records are located via a hash index keyed by the process id, so
+    process state queries and commands are plain memory loads and
+    stores with no system calls.  Records are never moved or freed,
+    so a record pointer remains valid for the lifetime of the process.
+
+    Each record also has an associated byte range lock in the shared
+    memory object, which is held by a monitored process and is used
+    to detect process death by processes which cannot use a pidfd.
+
+    Process monitoring commands are signalled by incrementing a command
+    sequence number in the state table, which is used as a futex so
+    the process monitors can block until a command is issued.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "statetable.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*! maximum time (in milliseconds) to wait for another process to
+ *  finish initializing the state table */
+#define STATETABLE_INIT_TIMEOUT ( 1000 )
+
+/*! maximum number of attempts to read an exit history entry which
+ *  is being written */
+#define STATETABLE_READ_RETRIES ( 100 )
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! state table shared memory file descriptor */
+static int tablefd = -1;
+
+/*! pointer to the mapped state table */
+static StateTable *pTable = NULL;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static int InitTable( StateTable *pStateTable );
+static uint32_t Hash( const char *id );
+static StateRecord *FindRecord( const char *id, bool any );
+static int LockTable( void );
+static void BeginWrite( StateExit *pExit );
+static void EndWrite( StateExit *pExit );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  STATETABLE_Open                                                           */
+/*!
+    Open the shared state table
+
+    The STATETABLE_Open function opens (and creates if necessary) the
+    shared memory object containing the process state table, and maps
+    it into the address space of the calling process.
+
+    The state table file descriptor is close-on-exec.
+
+    @retval EOK - the state table was opened
+    @retval EPROTO - the state table has an incompatible layout
+    @retval other - error from shm_open, ftruncate or mmap
+
+==============================================================================*/
+int STATETABLE_Open( void )
+{
+    int result = EOK;
+    bool created = false;
+    void *p;
+    int wait = 0;
+
+    if ( pTable == NULL )
+    {
+        tablefd = shm_open( STATETABLE_NAME,
+                            O_RDWR | O_CREAT | O_EXCL,
+                            S_IRUSR | S_IWUSR );
+        if ( tablefd != -1 )
+        {
+            created = true;
+            if ( ftruncate( tablefd, sizeof( StateTable ) ) == -1 )
+            {
+                result = errno;
+            }
+        }
+        else if ( errno == EEXIST )
+        {
+            tablefd = shm_open( STATETABLE_NAME, O_RDWR, 0 );
+        }
+
+        if ( tablefd == -1 )
+        {
+            result = errno;
+        }
+
+        if ( result == EOK )
+        {
+            p = mmap( NULL,
+                      sizeof( StateTable ),
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED,
+                      tablefd,
+                      0 );
+            if ( p != MAP_FAILED )
+            {
+                pTable = (StateTable *)p;
+            }
+            else
+            {
+                result = errno;
+            }
+        }
+
+        if ( ( result == EOK ) && ( created == true ) )
+        {
+            result = InitTable( pTable );
+        }
+        else if ( result == EOK )
+        {
+            /* wait for the creator to finish initializing the table */
+            while ( ( __atomic_load_n( &pTable->magic, __ATOMIC_ACQUIRE ) !=
+                        STATETABLE_MAGIC ) &&
+                    ( wait++ < STATETABLE_INIT_TIMEOUT ) )
+            {
+                usleep( 1000 );
+            }
+
+            if ( pTable->magic != STATETABLE_MAGIC )
+            {
+                /* the creator died before initializing the table */
+                result = InitTable( pTable );
+            }
+            else if ( pTable->version != STATETABLE_VERSION )
+            {
+                fprintf( stderr,
+                         "state table version %u is not supported\n",
+                         pTable->version );
+                result = EPROTO;
+            }
+        }
+
+        if ( ( result != EOK ) && ( tablefd != -1 ) )
+        {
+            if ( pTable != NULL )
+            {
+                munmap( pTable, sizeof( StateTable ) );
+                pTable = NULL;
+            }
+
+            close( tablefd );
+            tablefd = -1;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_GetFd                                                          */
+/*!
+    Get the state table file descriptor
+
+    The STATETABLE_GetFd function gets the file descriptor of the
+    shared memory object containing the state table.
+
+    @retval file descriptor of the state table
+    @retval -1 - the state table is not open
+
+==============================================================================*/
+int STATETABLE_GetFd( void )
+{
+    return tablefd;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Find                                                           */
+/*!
+    Find a process state record
+
+    The STATETABLE_Find function looks up the state record of the
+    monitored process with the specified identifier.
+
+    @param[in]
+        id
+            pointer to the identifier of the process to find
+
+    @retval pointer to the process state record
+    @retval NULL - the process is not in the state table
+
+==============================================================================*/
+StateRecord *STATETABLE_Find( const char *id )
+{
+    return FindRecord( id, false );
+}
+
+/*============================================================================*/
+/*  STATETABLE_Add                                                            */
+/*!
+    Add a process state record
+
+    The STATETABLE_Add function gets the state record for the process
+    with the specified identifier, creating it if it does not exist.
+    A record which was previously removed is re-used.
+
+    @param[in]
+        id
+            pointer to the identifier of the process to add
+
+    @param[out]
+        pCreated
+            optional pointer to a location to store a flag indicating
+            if a new or re-used record was returned
+
+    @retval pointer to the process state record
+    @retval NULL - the record could not be created, errno is set to
+                   indicate the reason
+
+==============================================================================*/
+StateRecord *STATETABLE_Add( const char *id, bool *pCreated )
+{
+    StateRecord *pRecord = NULL;
+    bool created = false;
+    uint32_t h;
+    uint32_t n;
+    int i;
+
+    if ( ( pTable != NULL ) && ( id != NULL ) )
+    {
+        if ( strlen( id ) >= STATETABLE_ID_LEN )
+        {
+            errno = ENAMETOOLONG;
+        }
+        else if ( LockTable() == EOK )
+        {
+            pRecord = FindRecord( id, true );
+            if ( pRecord == NULL )
+            {
+                n = pTable->count;
+                if ( n < STATETABLE_MAX_ENTRIES )
+                {
+                    pRecord = &pTable->records[n];
+                    memset( pRecord, 0, sizeof( StateRecord ) );
+                    strcpy( pRecord->id, id );
+                    __atomic_store_n( &pTable->count, n + 1, __ATOMIC_RELEASE );
+
+                    /* publish the record in the index */
+                    h = Hash( id );
+                    for ( i = 0 ; i < STATETABLE_INDEX_SIZE ; i++ )
+                    {
+                        if ( pTable->index[h] == 0 )
+                        {
+                            __atomic_store_n( &pTable->index[h],
+                                              n + 1,
+                                              __ATOMIC_RELEASE );
+                            break;
+                        }
+
+                        h = ( h + 1 ) % STATETABLE_INDEX_SIZE;
+                    }
+                }
+                else
+                {
+                    errno = ENOSPC;
+                }
+            }
+
+            if ( ( pRecord != NULL ) &&
+                 ( __atomic_load_n( &pRecord->inuse, __ATOMIC_ACQUIRE ) == 0 ) )
+            {
+                memset( &pRecord->data, 0, sizeof( LockData ) );
+                memset( pRecord->exec, 0, sizeof( pRecord->exec ) );
+                __atomic_store_n( &pRecord->inuse, 1, __ATOMIC_RELEASE );
+                created = true;
+            }
+
+            pthread_mutex_unlock( &pTable->mutex );
+        }
+    }
+
+    if ( pCreated != NULL )
+    {
+        *pCreated = created;
+    }
+
+    return pRecord;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Remove                                                         */
+/*!
+    Remove a process state record
+
+    The STATETABLE_Remove function marks a process state record as
+    no longer in use.  The record remains allocated and will be re-used
+    if a process with the same identifier is added again.
+
+    @param[in]
+        pRecord
+            pointer to the process state record to remove
+
+    @retval EOK - the record was removed
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+int STATETABLE_Remove( StateRecord *pRecord )
+{
+    int result = EINVAL;
+
+    if ( pRecord != NULL )
+    {
+        __atomic_store_n( &pRecord->inuse, 0, __ATOMIC_RELEASE );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Get                                                            */
+/*!
+    Get a process state record by position
+
+    The STATETABLE_Get function gets the nth record in the state table.
+    It is used to iterate through all the records in the state table
+    in the order they were added.
+
+    @param[in]
+        n
+            index of the record to get
+
+    @retval pointer to the process state record
+    @retval NULL - the nth record is not in use
+
+==============================================================================*/
+StateRecord *STATETABLE_Get( size_t n )
+{
+    StateRecord *pRecord = NULL;
+
+    if ( ( pTable != NULL ) && ( n < STATETABLE_Count() ) )
+    {
+        pRecord = &pTable->records[n];
+        if ( __atomic_load_n( &pRecord->inuse, __ATOMIC_ACQUIRE ) == 0 )
+        {
+            pRecord = NULL;
+        }
+    }
+
+    return pRecord;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Count                                                          */
+/*!
+    Get the number of allocated state records
+
+    The STATETABLE_Count function gets the number of records which have
+    been allocated in the state table, including removed records.
+
+    @retval number of allocated records
+
+==============================================================================*/
+size_t STATETABLE_Count( void )
+{
+    size_t count = 0;
+
+    if ( pTable != NULL )
+    {
+        count = __atomic_load_n( &pTable->count, __ATOMIC_ACQUIRE );
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Lock                                                           */
+/*!
+    Perform a lock operation on a process state record
+
+    The STATETABLE_Lock function performs a lock operation on the byte
+    range lock associated with the specified state record.
+
+    Valid commands are:
+
+    - F_SETLKW - try to acquire a lock and wait if the lock is already held
+    - F_SETLK - try to acquire a lock
+    - F_UNLCK - release a lock
+    - F_GETLK - check if the lock is held by another process
+
+    @param[in]
+        pRecord
+            pointer to the state record to lock
+
+    @param[in]
+        cmd
+            type of lock operation to perform
+
+    @retval EOK - lock action was successful
+    @retval EAGAIN - ( F_GETLK ) the lock is held by another process
+    @retval EINVAL - invalid arguments
+    @retval ENOTSUP - unsupported lock operation
+    @retval other error returned by fcntl
+
+==============================================================================*/
+int STATETABLE_Lock( StateRecord *pRecord, int cmd )
+{
+    int result = EINVAL;
+    struct flock lock;
+
+    if ( ( pTable != NULL ) && ( pRecord != NULL ) )
+    {
+        if ( ( cmd == F_SETLKW ) ||
+             ( cmd == F_SETLK ) ||
+             ( cmd == F_UNLCK ) ||
+             ( cmd == F_GETLK ) )
+        {
+            memset( &lock, 0, sizeof( lock ) );
+            lock.l_type = ( cmd == F_UNLCK ) ? F_UNLCK : F_WRLCK;
+            lock.l_whence = SEEK_SET;
+            lock.l_start = pRecord - pTable->records;
+            lock.l_len = 1;
+
+            result = fcntl( tablefd,
+                            ( cmd == F_UNLCK ) ? F_SETLK : cmd,
+                            &lock );
+            if ( result == -1 )
+            {
+                result = errno;
+            }
+            else if ( ( cmd == F_GETLK ) && ( lock.l_type != F_UNLCK ) )
+            {
+                result = EAGAIN;
+            }
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_OpenLock                                                       */
+/*!
+    Open a lock handle for the state table
+
+    The STATETABLE_OpenLock function opens a new file description of the
+    state table.  A process state record locked through it with
+    STATETABLE_LockHandle is locked on behalf of whichever processes hold
+    the file description, rather than the calling process, so a process
+    monitor can take the lock of a process which is already running and
+    has inherited the file description.  The file descriptor is opened
+    read-only with FD_CLOEXEC set, so a process which is passed a lock
+    handle cannot modify the state table.
+
+    @retval file descriptor of the lock handle
+    @retval -1 - the lock handle could not be opened (see errno)
+
+==============================================================================*/
+int STATETABLE_OpenLock( void )
+{
+    return shm_open( STATETABLE_NAME, O_RDONLY, 0 );
+}
+
+/*============================================================================*/
+/*  STATETABLE_LockHandle                                                     */
+/*!
+    Lock a process state record through a lock handle
+
+    The STATETABLE_LockHandle function acquires the lock associated with
+    the specified state record through a lock handle opened with
+    STATETABLE_OpenLock.  The lock is an open file description lock,
+    which conflicts with the locks taken with STATETABLE_Lock, and is
+    held until every file descriptor referring to the lock handle has
+    been closed.  Since the lock handle is read-only, a read lock is
+    taken once no other lock is found on the record, so the locks of
+    a record must only be taken by one thread at a time.
+
+    @param[in]
+        pRecord
+            pointer to the state record to lock
+
+    @param[in]
+        fd
+            file descriptor of the lock handle
+
+    @retval EOK - the lock was acquired
+    @retval EAGAIN - the record is locked through another file description
+    @retval EINVAL - invalid arguments
+    @retval other error returned by fcntl
+
+==============================================================================*/
+int STATETABLE_LockHandle( StateRecord *pRecord, int fd )
+{
+    int result = EINVAL;
+    struct flock lock;
+
+    if ( ( pTable != NULL ) && ( pRecord != NULL ) && ( fd != -1 ) )
+    {
+        memset( &lock, 0, sizeof( lock ) );
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        lock.l_start = pRecord - pTable->records;
+        lock.l_len = 1;
+
+        if ( fcntl( fd, F_OFD_GETLK, &lock ) == -1 )
+        {
+            result = errno;
+        }
+        else if ( lock.l_type != F_UNLCK )
+        {
+            result = EAGAIN;
+        }
+        else
+        {
+            /* a read lock conflicts with every lock but another read
+             * lock, which is not taken on a free record */
+            lock.l_type = F_RDLCK;
+            result = ( fcntl( fd, F_OFD_SETLK, &lock ) == 0 ) ? EOK : errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_GetSequence                                                    */
+/*!
+    Get the current command sequence number
+
+    The STATETABLE_GetSequence function gets the command sequence number
+    from the state table.  It must be read before examining the process
+    state so that a command issued afterwards is not missed when waiting
+    via STATETABLE_Wait.
+
+    @retval the current command sequence number
+
+==============================================================================*/
+uint32_t STATETABLE_GetSequence( void )
+{
+    uint32_t sequence = 0;
+
+    if ( pTable != NULL )
+    {
+        sequence = __atomic_load_n( &pTable->sequence, __ATOMIC_ACQUIRE );
+    }
+
+    return sequence;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Notify                                                         */
+/*!
+    Notify the process monitors of a command
+
+    The STATETABLE_Notify function increments the command sequence number
+    and wakes all processes and threads which are waiting for a command.
+    It is invoked after a command has been written into a process state
+    record.
+
+    @retval EOK - the command was signalled
+    @retval EINVAL - the state table is not open
+    @retval other - error from the futex system call
+
+==============================================================================*/
+int STATETABLE_Notify( void )
+{
+    int result = EINVAL;
+
+    if ( pTable != NULL )
+    {
+        __atomic_add_fetch( &pTable->sequence, 1, __ATOMIC_RELEASE );
+
+        result = syscall( SYS_futex,
+                          &pTable->sequence,
+                          FUTEX_WAKE,
+                          INT_MAX,
+                          NULL,
+                          NULL,
+                          0 );
+
+        result = ( result == -1 ) ? errno : EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_Wait                                                           */
+/*!
+    Wait for a process monitoring command
+
+    The STATETABLE_Wait function blocks the calling thread until the
+    command sequence number differs from the specified sequence number,
+    ie until a command has been issued since the sequence number was
+    read.  It returns immediately if a command has already been issued.
+
+    @param[in]
+        sequence
+            command sequence number obtained from STATETABLE_GetSequence
+
+    @retval EOK - a command has been issued
+    @retval EINTR - the wait was interrupted by a signal
+    @retval EINVAL - the state table is not open
+    @retval other - error from the futex system call
+
+==============================================================================*/
+int STATETABLE_Wait( uint32_t sequence )
+{
+    int result = EINVAL;
+
+    if ( pTable != NULL )
+    {
+        result = syscall( SYS_futex,
+                          &pTable->sequence,
+                          FUTEX_WAIT,
+                          sequence,
+                          NULL,
+                          NULL,
+                          0 );
+
+        if ( result == -1 )
+        {
+            /* EAGAIN indicates the sequence number has already changed */
+            result = ( errno == EAGAIN ) ? EOK : errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_RecordExit                                                     */
+/*!
+    Record the exit of a process in its exit history
+
+    The STATETABLE_RecordExit function adds an entry to the exit history
+    of a process, replacing the oldest entry once the history is full.
+    The history is written by the process monitor which supervises the
+    process, and is read without locks.  Each entry is protected by a
+    sequence number which is odd while the entry is being written, so a
+    reader can detect and retry a torn read.
+
+    @param[in]
+        pRecord
+            pointer to the state record of the process
+
+    @param[in]
+        status
+            wait status of the process, or STATETABLE_STATUS_UNKNOWN
+
+    @param[in]
+        uptime
+            length of time (in milliseconds) the process ran for
+
+    @retval EOK - the exit was recorded
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+int STATETABLE_RecordExit( StateRecord *pRecord,
+                           int status,
+                           uint32_t uptime )
+{
+    int result = EINVAL;
+    StateExit *pExit;
+    uint32_t n;
+
+    if ( pRecord != NULL )
+    {
+        n = __atomic_load_n( &pRecord->data.exits, __ATOMIC_RELAXED );
+        pExit = &pRecord->data.history[n % STATETABLE_HISTORY_LEN];
+
+        BeginWrite( pExit );
+        __atomic_store_n( &pExit->status, status, __ATOMIC_RELAXED );
+        __atomic_store_n( &pExit->uptime, uptime, __ATOMIC_RELAXED );
+        __atomic_store_n( &pExit->latency, 0, __ATOMIC_RELAXED );
+        __atomic_store_n( &pExit->timestamp,
+                          (int64_t)time( NULL ),
+                          __ATOMIC_RELAXED );
+        EndWrite( pExit );
+
+        /* publish the entry */
+        __atomic_store_n( &pRecord->data.exits, n + 1, __ATOMIC_RELEASE );
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_RecordRestart                                                  */
+/*!
+    Record the restart latency of a process
+
+    The STATETABLE_RecordRestart function records the time taken to
+    restart a process in the most recent entry of its exit history.
+
+    @param[in]
+        pRecord
+            pointer to the state record of the process
+
+    @param[in]
+        latency
+            length of time (in milliseconds) from the exit of the process
+            until it was started again
+
+    @retval EOK - the restart latency was recorded
+    @retval EINVAL - invalid arguments
+    @retval ENOENT - the process has not exited
+
+==============================================================================*/
+int STATETABLE_RecordRestart( StateRecord *pRecord, uint32_t latency )
+{
+    int result = EINVAL;
+    StateExit *pExit;
+    uint32_t n;
+
+    if ( pRecord != NULL )
+    {
+        n = __atomic_load_n( &pRecord->data.exits, __ATOMIC_RELAXED );
+        if ( n > 0 )
+        {
+            pExit = &pRecord->data.history[( n - 1 ) % STATETABLE_HISTORY_LEN];
+
+            BeginWrite( pExit );
+            __atomic_store_n( &pExit->latency, latency, __ATOMIC_RELAXED );
+            EndWrite( pExit );
+
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATETABLE_GetHistory                                                     */
+/*!
+    Get the exit history of a process
+
+    The STATETABLE_GetHistory function copies the most recent entries of
+    the exit history of a process, newest first.  An entry which is
+    being written while it is copied is copied again.
+
+    @param[in]
+        pRecord
+            pointer to the state record of the process
+
+    @param[out]
+        pHistory
+            pointer to an array to copy the exit history to
+
+    @param[in]
+        n
+            maximum number of entries to copy
+
+    @retval number of entries copied
+
+==============================================================================*/
+size_t STATETABLE_GetHistory( StateRecord *pRecord,
+                              StateExit *pHistory,
+                              size_t n )
+{
+    StateExit *pExit;
+    uint32_t exits;
+    uint32_t sequence;
+    size_t count = 0;
+    size_t i;
+    int retries;
+
+    if ( ( pRecord != NULL ) && ( pHistory != NULL ) )
+    {
+        exits = __atomic_load_n( &pRecord->data.exits, __ATOMIC_ACQUIRE );
+
+        for ( i = 0 ;
+              ( i < n ) && ( i < exits ) && ( i < STATETABLE_HISTORY_LEN ) ;
+              i++ )
+        {
+            pExit = &pRecord->data.history[( exits - 1 - i ) %
+                                            STATETABLE_HISTORY_LEN];
+
+            for ( retries = 0 ; retries < STATETABLE_READ_RETRIES ; retries++ )
+            {
+                sequence = __atomic_load_n( &pExit->sequence,
+                                            __ATOMIC_ACQUIRE );
+                if ( ( sequence & 1 ) == 0 )
+                {
+                    pHistory[count].sequence = sequence;
+                    pHistory[count].status =
+                        __atomic_load_n( &pExit->status, __ATOMIC_RELAXED );
+                    pHistory[count].uptime =
+                        __atomic_load_n( &pExit->uptime, __ATOMIC_RELAXED );
+                    pHistory[count].latency =
+                        __atomic_load_n( &pExit->latency, __ATOMIC_RELAXED );
+                    pHistory[count].timestamp =
+                        __atomic_load_n( &pExit->timestamp, __ATOMIC_RELAXED );
+
+                    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+                    if ( __atomic_load_n( &pExit->sequence,
+                                          __ATOMIC_RELAXED ) == sequence )
+                    {
+                        count++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  BeginWrite                                                                */
+/*!
+    Begin writing an exit history entry
+
+    The BeginWrite function makes the sequence number of an exit history
+    entry odd, so readers will not use the entry while it is written.
+
+    @param[in]
+        pExit
+            pointer to the exit history entry
+
+==============================================================================*/
+static void BeginWrite( StateExit *pExit )
+{
+    uint32_t sequence;
+
+    sequence = __atomic_load_n( &pExit->sequence, __ATOMIC_RELAXED );
+    __atomic_store_n( &pExit->sequence, sequence | 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+/*============================================================================*/
+/*  EndWrite                                                                  */
+/*!
+    Finish writing an exit history entry
+
+    The EndWrite function makes the sequence number of an exit history
+    entry even again, so readers can use the entry.
+
+    @param[in]
+        pExit
+            pointer to the exit history entry
+
+==============================================================================*/
+static void EndWrite( StateExit *pExit )
+{
+    uint32_t sequence;
+
+    sequence = __atomic_load_n( &pExit->sequence, __ATOMIC_RELAXED );
+    __atomic_store_n( &pExit->sequence, sequence + 1, __ATOMIC_RELEASE );
+}
+
+/*============================================================================*/
+/*  InitTable                                                                 */
+/*!
+    Initialize the state table
+
+    The InitTable function initializes a newly created state table.
+    The table magic number is set last to indicate to other processes
+    that the table is ready for use.
+
+    @param[in]
+        pStateTable
+            pointer to the state table to initialize
+
+    @retval EOK - the state table was initialized
+    @retval other - error from the pthread mutex functions
+
+==============================================================================*/
+static int InitTable( StateTable *pStateTable )
+{
+    int result;
+    pthread_mutexattr_t attr;
+
+    memset( pStateTable, 0, sizeof( StateTable ) );
+
+    result = pthread_mutexattr_init( &attr );
+    if ( result == EOK )
+    {
+        pthread_mutexattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+        pthread_mutexattr_setrobust( &attr, PTHREAD_MUTEX_ROBUST );
+        result = pthread_mutex_init( &pStateTable->mutex, &attr );
+        pthread_mutexattr_destroy( &attr );
+    }
+
+    if ( result == EOK )
+    {
+        pStateTable->version = STATETABLE_VERSION;
+        __atomic_store_n( &pStateTable->magic,
+                          STATETABLE_MAGIC,
+                          __ATOMIC_RELEASE );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Hash                                                                      */
+/*!
+    Calculate the index hash of a process identifier
+
+    The Hash function calculates the FNV-1a hash of the process identifier
+    and reduces it to a state table index slot.
+
+    @param[in]
+        id
+            pointer to the process identifier
+
+    @retval index slot for the process identifier
+
+==============================================================================*/
+static uint32_t Hash( const char *id )
+{
+    uint32_t h = 2166136261u;
+
+    while ( *id != '\0' )
+    {
+        h ^= (uint8_t)*id++;
+        h *= 16777619u;
+    }
+
+    return h % STATETABLE_INDEX_SIZE;
+}
+
+/*============================================================================*/
+/*  FindRecord                                                                */
+/*!
+    Find a process state record
+
+    The FindRecord function searches the state table index for the
+    record of the process with the specified identifier.
+
+    @param[in]
+        id
+            pointer to the identifier of the process to find
+
+    @param[in]
+        any
+            true to also find records which are no longer in use
+
+    @retval pointer to the process state record
+    @retval NULL - the process record was not found
+
+==============================================================================*/
+static StateRecord *FindRecord( const char *id, bool any )
+{
+    StateRecord *pRecord = NULL;
+    StateRecord *p;
+    uint32_t h;
+    uint32_t slot;
+    int i;
+
+    if ( ( pTable != NULL ) && ( id != NULL ) )
+    {
+        h = Hash( id );
+        for ( i = 0 ; i < STATETABLE_INDEX_SIZE ; i++ )
+        {
+            slot = __atomic_load_n( &pTable->index[h], __ATOMIC_ACQUIRE );
+            if ( ( slot == 0 ) || ( slot > STATETABLE_MAX_ENTRIES ) )
+            {
+                break;
+            }
+
+            p = &pTable->records[slot - 1];
+            if ( strncmp( p->id, id, STATETABLE_ID_LEN ) == 0 )
+            {
+                if ( ( any == true ) ||
+                     ( __atomic_load_n( &p->inuse, __ATOMIC_ACQUIRE ) != 0 ) )
+                {
+                    pRecord = p;
+                }
+
+                break;
+            }
+
+            h = ( h + 1 ) % STATETABLE_INDEX_SIZE;
+        }
+    }
+
+    return pRecord;
+}
+
+/*============================================================================*/
+/*  LockTable                                                                 */
+/*!
+    Lock the state table for insertion
+
+    The LockTable function acquires the state table mutex.  If the
+    previous owner of the mutex died while holding it, the mutex is
+    made consistent again since insertions publish records atomically.
+
+    @retval EOK - the state table is locked
+    @retval other - error from pthread_mutex_lock
+
+==============================================================================*/
+static int LockTable( void )
+{
+    int result;
+
+    result = pthread_mutex_lock( &pTable->mutex );
+    if ( result == EOWNERDEAD )
+    {
+        result = pthread_mutex_consistent( &pTable->mutex );
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of statetable group */
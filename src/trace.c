@@ -0,0 +1,677 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup trace trace
+ * @brief Lifecycle tracing
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file trace.c
+
+    Lifecycle Tracing
+
+    The trace module records spans of the process monitor lifecycle,
+    such as parsing the configuration, launching a process, waiting for
+    a process to become ready, and restarting a process, and exports
+    them in the Chrome trace event format, which can be loaded into
+    chrome://tracing or https://ui.perfetto.dev.
+
+    Spans are timed with the monotonic clock in microseconds.  Each
+    thread records its spans into its own fixed size ring buffer, so
+    recording a span takes no lock and allocates no memory after the
+    first span of the thread.  A ring buffer is only read when the trace
+    is written, and each event carries a sequence number so an event
+    which is overwritten while it is read is skipped.
+
+    Tracing is disabled unless TRACE_Enable is called, in which case
+    TRACE_Begin returns 0 and the other functions return immediately.
+
+    Spans of a thread which nest are exported as complete events of the
+    thread.  Spans which overlap, such as the ready waits of processes
+    which start concurrently, are recorded with TRACE_Async and exported
+    as asynchronous events on a track per argument.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include "trace.h"
+
+/*==============================================================================
+        Definitions
+==============================================================================*/
+
+#ifndef EOK
+/*! success result */
+#define EOK 0
+#endif
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! the TraceEvent object holds a single span */
+typedef struct _traceEvent
+{
+    /*! index of the event in its ring buffer plus one, or 0 while the
+     *  event is being written */
+    uint64_t sequence;
+
+    /*! name of the span, which must be a string constant */
+    const char *name;
+
+    /*! argument of the span, or an empty string */
+    char arg[TRACE_ARG_LEN];
+
+    /*! monotonic time (in microseconds) at which the span started */
+    int64_t start;
+
+    /*! duration of the span in microseconds */
+    int64_t duration;
+
+    /*! indicates that the span may overlap other spans of the thread */
+    bool async;
+
+} TraceEvent;
+
+/*! the TraceBuffer object is the ring buffer of the spans recorded by
+ *  a single thread */
+typedef struct _traceBuffer
+{
+    /*! spans, indexed by their index modulo TRACE_BUFFER_EVENTS */
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+
+    /*! total number of spans recorded by the thread */
+    uint64_t head;
+
+    /*! thread identifier of the thread */
+    pid_t tid;
+
+    /*! pointer to the next ring buffer */
+    struct _traceBuffer *pNext;
+
+} TraceBuffer;
+
+/*==============================================================================
+        File Scoped Variables
+==============================================================================*/
+
+/*! indicates that tracing is enabled */
+static bool enabled = false;
+
+/*! path of the trace file */
+static char tracePath[PATH_MAX];
+
+/*! ring buffers of all threads which have recorded a span */
+static TraceBuffer *pBuffers = NULL;
+
+/*! ring buffer of the current thread */
+static __thread TraceBuffer *pThreadBuffer = NULL;
+
+/*==============================================================================
+        Function declarations
+==============================================================================*/
+
+static void Record( const char *name,
+                    const char *arg,
+                    int64_t start,
+                    int64_t end,
+                    bool async );
+static TraceBuffer *GetBuffer( void );
+static bool ReadEvent( TraceBuffer *pBuffer,
+                       uint64_t n,
+                       TraceEvent *pEvent );
+static void WriteEvent( FILE *fp,
+                        TraceBuffer *pBuffer,
+                        TraceEvent *pEvent,
+                        bool *pFirst );
+static void WriteString( FILE *fp, const char *str );
+
+/*==============================================================================
+        Public function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  TRACE_Enable                                                              */
+/*!
+    Enable lifecycle tracing
+
+    The TRACE_Enable function enables the recording of spans, which are
+    written to the specified trace file by TRACE_Write.
+
+    @param[in]
+        path
+            path of the trace file
+
+    @retval EOK - tracing was enabled
+    @retval EINVAL - invalid arguments
+
+==============================================================================*/
+int TRACE_Enable( const char *path )
+{
+    int result = EINVAL;
+
+    if ( ( path != NULL ) &&
+         ( *path != '\0' ) &&
+         ( strlen( path ) < sizeof( tracePath ) ) )
+    {
+        strcpy( tracePath, path );
+        __atomic_store_n( &enabled, true, __ATOMIC_RELEASE );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TRACE_Now                                                                 */
+/*!
+    Get the trace clock
+
+    The TRACE_Now function gets the monotonic time in microseconds.  It
+    only makes a (vDSO) system call, so it may be used by a launched
+    child which shares the memory of the process monitor.
+
+    @retval monotonic time in microseconds
+
+==============================================================================*/
+int64_t TRACE_Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*============================================================================*/
+/*  TRACE_Begin                                                               */
+/*!
+    Begin a span
+
+    The TRACE_Begin function gets the start time of a span.
+
+    @retval start time of the span in microseconds
+    @retval 0 - tracing is disabled
+
+==============================================================================*/
+int64_t TRACE_Begin( void )
+{
+    return __atomic_load_n( &enabled, __ATOMIC_RELAXED ) ? TRACE_Now() : 0;
+}
+
+/*============================================================================*/
+/*  TRACE_End                                                                 */
+/*!
+    End a span
+
+    The TRACE_End function records a span of the current thread which
+    started at the specified time and ends now.
+
+    @param[in]
+        name
+            name of the span, which must be a string constant
+
+    @param[in]
+        arg
+            argument of the span, such as a process identifier, or NULL
+
+    @param[in]
+        start
+            start time of the span from TRACE_Begin, or 0 to record
+            nothing
+
+==============================================================================*/
+void TRACE_End( const char *name, const char *arg, int64_t start )
+{
+    if ( start != 0 )
+    {
+        Record( name, arg, start, TRACE_Now(), false );
+    }
+}
+
+/*============================================================================*/
+/*  TRACE_Span                                                                */
+/*!
+    Record a span
+
+    The TRACE_Span function records a span of the current thread with
+    the specified start and end times, for example a span which was
+    timed by a launched child.
+
+    @param[in]
+        name
+            name of the span, which must be a string constant
+
+    @param[in]
+        arg
+            argument of the span, such as a process identifier, or NULL
+
+    @param[in]
+        start
+            start time of the span in microseconds, or 0 to record
+            nothing
+
+    @param[in]
+        end
+            end time of the span in microseconds
+
+==============================================================================*/
+void TRACE_Span( const char *name,
+                 const char *arg,
+                 int64_t start,
+                 int64_t end )
+{
+    if ( ( start != 0 ) && ( end >= start ) )
+    {
+        Record( name, arg, start, end, false );
+    }
+}
+
+/*============================================================================*/
+/*  TRACE_Async                                                               */
+/*!
+    End an asynchronous span
+
+    The TRACE_Async function records a span which started at the
+    specified time and ends now, and which may overlap the other spans
+    of the current thread, such as the time a process takes to become
+    ready.  Asynchronous spans are displayed on a track per argument.
+
+    @param[in]
+        name
+            name of the span, which must be a string constant
+
+    @param[in]
+        arg
+            argument of the span, such as a process identifier, or NULL
+
+    @param[in]
+        start
+            start time of the span from TRACE_Begin, or 0 to record
+            nothing
+
+==============================================================================*/
+void TRACE_Async( const char *name, const char *arg, int64_t start )
+{
+    if ( start != 0 )
+    {
+        Record( name, arg, start, TRACE_Now(), true );
+    }
+}
+
+/*============================================================================*/
+/*  TRACE_Write                                                               */
+/*!
+    Write the trace file
+
+    The TRACE_Write function writes the recorded spans of all threads to
+    the trace file in the Chrome trace event JSON format.  The file is
+    written to a temporary file which is then renamed, so a reader never
+    sees a partial trace.  The spans are kept, so the trace file can be
+    written again later with the spans recorded since.
+
+    @retval EOK - the trace file was written
+    @retval ENOTSUP - tracing is disabled
+    @retval other - error from fopen, fclose or rename
+
+==============================================================================*/
+int TRACE_Write( void )
+{
+    int result = ENOTSUP;
+    char path[sizeof( tracePath ) + 4];
+    TraceBuffer *pBuffer;
+    TraceEvent event;
+    uint64_t head;
+    uint64_t n;
+    bool first = true;
+    FILE *fp;
+
+    if ( __atomic_load_n( &enabled, __ATOMIC_ACQUIRE ) == true )
+    {
+        snprintf( path, sizeof( path ), "%s.tmp", tracePath );
+
+        fp = fopen( path, "w" );
+        if ( fp == NULL )
+        {
+            result = errno;
+        }
+        else
+        {
+            fprintf( fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" );
+
+            for ( pBuffer = __atomic_load_n( &pBuffers, __ATOMIC_ACQUIRE ) ;
+                  pBuffer != NULL ;
+                  pBuffer = pBuffer->pNext )
+            {
+                head = __atomic_load_n( &pBuffer->head, __ATOMIC_ACQUIRE );
+                n = ( head > TRACE_BUFFER_EVENTS )
+                    ? head - TRACE_BUFFER_EVENTS
+                    : 0;
+
+                for ( ; n < head ; n++ )
+                {
+                    if ( ReadEvent( pBuffer, n, &event ) == true )
+                    {
+                        WriteEvent( fp, pBuffer, &event, &first );
+                    }
+                }
+            }
+
+            fprintf( fp, "\n]}\n" );
+
+            result = ( fclose( fp ) == 0 ) ? EOK : errno;
+            if ( ( result == EOK ) && ( rename( path, tracePath ) != 0 ) )
+            {
+                result = errno;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*==============================================================================
+        Private function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  Record                                                                    */
+/*!
+    Record a span in the ring buffer of the current thread
+
+    @param[in]
+        name
+            name of the span
+
+    @param[in]
+        arg
+            argument of the span, or NULL
+
+    @param[in]
+        start
+            start time of the span in microseconds
+
+    @param[in]
+        end
+            end time of the span in microseconds
+
+    @param[in]
+        async
+            indicates that the span may overlap other spans
+
+==============================================================================*/
+static void Record( const char *name,
+                    const char *arg,
+                    int64_t start,
+                    int64_t end,
+                    bool async )
+{
+    TraceBuffer *pBuffer;
+    TraceEvent *pEvent;
+    uint64_t n;
+
+    pBuffer = GetBuffer();
+    if ( ( pBuffer != NULL ) && ( name != NULL ) )
+    {
+        n = pBuffer->head;
+        pEvent = &pBuffer->events[n % TRACE_BUFFER_EVENTS];
+
+        /* invalidate the event while it is written */
+        __atomic_store_n( &pEvent->sequence, 0, __ATOMIC_RELAXED );
+        __atomic_thread_fence( __ATOMIC_RELEASE );
+
+        pEvent->name = name;
+        snprintf( pEvent->arg,
+                  sizeof( pEvent->arg ),
+                  "%s",
+                  ( arg != NULL ) ? arg : "" );
+        pEvent->start = start;
+        pEvent->duration = end - start;
+        pEvent->async = async;
+
+        /* publish the event */
+        __atomic_store_n( &pEvent->sequence, n + 1, __ATOMIC_RELEASE );
+        __atomic_store_n( &pBuffer->head, n + 1, __ATOMIC_RELEASE );
+    }
+}
+
+/*============================================================================*/
+/*  GetBuffer                                                                 */
+/*!
+    Get the ring buffer of the current thread
+
+    The GetBuffer function gets the ring buffer of the current thread,
+    creating it and adding it to the list of ring buffers when the thread
+    records its first span.
+
+    @retval pointer to the ring buffer of the current thread
+    @retval NULL - the ring buffer could not be created
+
+==============================================================================*/
+static TraceBuffer *GetBuffer( void )
+{
+    TraceBuffer *pBuffer = pThreadBuffer;
+
+    if ( pBuffer == NULL )
+    {
+        pBuffer = calloc( 1, sizeof( TraceBuffer ) );
+        if ( pBuffer != NULL )
+        {
+            pBuffer->tid = (pid_t)syscall( SYS_gettid );
+
+            /* add the ring buffer to the list without a lock */
+            pBuffer->pNext = __atomic_load_n( &pBuffers, __ATOMIC_RELAXED );
+            while ( !__atomic_compare_exchange_n( &pBuffers,
+                                                  &pBuffer->pNext,
+                                                  pBuffer,
+                                                  true,
+                                                  __ATOMIC_RELEASE,
+                                                  __ATOMIC_RELAXED ) )
+            {
+            }
+
+            pThreadBuffer = pBuffer;
+        }
+    }
+
+    return pBuffer;
+}
+
+/*============================================================================*/
+/*  ReadEvent                                                                 */
+/*!
+    Read a span from a ring buffer
+
+    The ReadEvent function copies a span from the ring buffer of another
+    thread.  A span which is being overwritten while it is copied is not
+    read.
+
+    @param[in]
+        pBuffer
+            pointer to the ring buffer
+
+    @param[in]
+        n
+            index of the span
+
+    @param[out]
+        pEvent
+            pointer to the location to copy the span to
+
+    @retval true - the span was read
+    @retval false - the span has been overwritten
+
+==============================================================================*/
+static bool ReadEvent( TraceBuffer *pBuffer,
+                       uint64_t n,
+                       TraceEvent *pEvent )
+{
+    TraceEvent *pSource = &pBuffer->events[n % TRACE_BUFFER_EVENTS];
+    bool result = false;
+
+    if ( __atomic_load_n( &pSource->sequence, __ATOMIC_ACQUIRE ) == n + 1 )
+    {
+        memcpy( pEvent, pSource, sizeof( TraceEvent ) );
+        pEvent->arg[sizeof( pEvent->arg ) - 1] = '\0';
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        result = ( __atomic_load_n( &pSource->sequence,
+                                    __ATOMIC_RELAXED ) == n + 1 );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WriteEvent                                                                */
+/*!
+    Write a span as Chrome trace events
+
+    A span is written as a complete ( X ) event of its thread, or as a
+    pair of asynchronous begin ( b ) and end ( e ) events whose id is
+    the argument of the span.
+
+    @param[in]
+        fp
+            output stream of the trace file
+
+    @param[in]
+        pBuffer
+            pointer to the ring buffer of the thread which recorded
+            the span
+
+    @param[in]
+        pEvent
+            pointer to the span
+
+    @param[in,out]
+        pFirst
+            indicates that no event has been written yet
+
+==============================================================================*/
+static void WriteEvent( FILE *fp,
+                        TraceBuffer *pBuffer,
+                        TraceEvent *pEvent,
+                        bool *pFirst )
+{
+    int pid = (int)getpid();
+
+    fprintf( fp, "%s\n{\"name\": ", *pFirst ? "" : "," );
+    WriteString( fp, pEvent->name );
+
+    if ( pEvent->async == false )
+    {
+        fprintf( fp,
+                 ", \"cat\": \"procmon\", \"ph\": \"X\", \"ts\": %" PRId64
+                 ", \"dur\": %" PRId64 ", \"pid\": %d, \"tid\": %d",
+                 pEvent->start,
+                 pEvent->duration,
+                 pid,
+                 (int)pBuffer->tid );
+    }
+    else
+    {
+        fprintf( fp,
+                 ", \"cat\": \"process\", \"ph\": \"b\", \"ts\": %" PRId64
+                 ", \"pid\": %d, \"tid\": %d, \"id\": ",
+                 pEvent->start,
+                 pid,
+                 (int)pBuffer->tid );
+        WriteString( fp, pEvent->arg );
+        fprintf( fp, "},\n{\"name\": " );
+        WriteString( fp, pEvent->name );
+        fprintf( fp,
+                 ", \"cat\": \"process\", \"ph\": \"e\", \"ts\": %" PRId64
+                 ", \"pid\": %d, \"tid\": %d, \"id\": ",
+                 pEvent->start + pEvent->duration,
+                 pid,
+                 (int)pBuffer->tid );
+        WriteString( fp, pEvent->arg );
+    }
+
+    fprintf( fp, ", \"args\": {\"id\": " );
+    WriteString( fp, pEvent->arg );
+    fprintf( fp, "}}" );
+
+    *pFirst = false;
+}
+
+/*============================================================================*/
+/*  WriteString                                                               */
+/*!
+    Write a JSON string
+
+    @param[in]
+        fp
+            output stream
+
+    @param[in]
+        str
+            NUL terminated string to write with JSON escaping
+
+==============================================================================*/
+static void WriteString( FILE *fp, const char *str )
+{
+    fputc( '"', fp );
+
+    for ( ; *str != '\0' ; str++ )
+    {
+        if ( ( *str == '"' ) || ( *str == '\\' ) )
+        {
+            fprintf( fp, "\\%c", *str );
+        }
+        else if ( (unsigned char)*str < 0x20 )
+        {
+            fprintf( fp, "\\u%04x", (unsigned char)*str );
+        }
+        else
+        {
+            fputc( *str, fp );
+        }
+    }
+
+    fputc( '"', fp );
+}
+
+/*! @}
+ * end of trace group */